@@ -0,0 +1,158 @@
+#include "commandstream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Compares replaying one frame of commands from the old vector<RenderCommand> with void* payloads
+// against the packed CommandStream. Both dispatch loops mirror the renderers: switch on the type,
+// resolve the GfxObject and look the resource up in a flat table.
+namespace {
+    const uint32_t s_NUM_COMMANDS = 300000;
+    const uint32_t s_NUM_OBJECTS = 4096;
+    const uint32_t s_NUM_FRAMES = 50;
+
+    struct Backend {
+        std::vector<uint32_t> resources = std::vector<uint32_t>(s_NUM_OBJECTS + 1);
+        uint64_t checksum = 0;
+
+        void Bind(const dw::GfxObject& object) { checksum += resources[object.id]; }
+        void Draw(uint32_t count, uint32_t startVertex) { checksum += count ^ startVertex; }
+    };
+
+    // Client side data for the old path. Every payload is its own allocation and points at a handle that
+    // lives somewhere else, as in the examples. The allocations are shuffled to look like a heap that has
+    // been in use for a while
+    struct LegacyFrame {
+        std::vector<std::unique_ptr<dw::GfxObject>> objects;
+        std::vector<std::unique_ptr<dw::BindVertexBufferCommandData>> vertexBufferData;
+        std::vector<std::unique_ptr<dw::BindConstantBufferCommandData>> constantBufferData;
+        std::vector<std::unique_ptr<dw::DrawCommandData>> drawData;
+        std::vector<dw::RenderCommand> commands;
+    };
+
+    void DispatchLegacy(const std::vector<dw::RenderCommand>& commands, Backend& backend) {
+        for (const dw::RenderCommand& command : commands) {
+            switch (command.type) {
+                case dw::BIND_VERTEX_BUFFER:
+                    backend.Bind(*static_cast<dw::BindVertexBufferCommandData*>(command.data)->object);
+                    break;
+                case dw::BIND_CONSTANT_BUFFER:
+                    backend.Bind(*static_cast<dw::BindConstantBufferCommandData*>(command.data)->object);
+                    break;
+                case dw::DRAW: {
+                    const dw::DrawCommandData* data = static_cast<dw::DrawCommandData*>(command.data);
+                    backend.Draw(data->count, data->startVertex);
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+    }
+
+    void DispatchStream(const dw::CommandStream& commands, Backend& backend) {
+        for (const dw::CommandStream::Header* command = commands.Begin(); command != commands.End(); command = dw::CommandStream::Next(command)) {
+            switch (command->type) {
+                case dw::BIND_VERTEX_BUFFER:
+                    backend.Bind(dw::CommandStream::Payload<dw::BindVertexBufferCommand>(command).object);
+                    break;
+                case dw::BIND_CONSTANT_BUFFER:
+                    backend.Bind(dw::CommandStream::Payload<dw::BindConstantBufferCommand>(command).object);
+                    break;
+                case dw::DRAW: {
+                    const dw::DrawCommand& data = dw::CommandStream::Payload<dw::DrawCommand>(command);
+                    backend.Draw(data.count, data.startVertex);
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+    }
+
+    template <typename Function>
+    double MeasureMilliseconds(Function&& function) {
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t frame = 0; frame < s_NUM_FRAMES; ++frame) {
+            function();
+        }
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / s_NUM_FRAMES;
+    }
+}
+
+int main() {
+    std::mt19937 random(1337);
+    std::uniform_int_distribution<uint32_t> objectDistribution(1, s_NUM_OBJECTS);
+
+    // Same frame for both paths: bind constants, bind vertices, draw
+    LegacyFrame legacy;
+    for (uint32_t id = 1; id <= s_NUM_OBJECTS; ++id) {
+        legacy.objects.push_back(std::make_unique<dw::GfxObject>(id));
+    }
+    std::shuffle(legacy.objects.begin(), legacy.objects.end(), random);
+
+    const uint32_t numDraws = s_NUM_COMMANDS / 3;
+    for (uint32_t i = 0; i < numDraws; ++i) {
+        legacy.constantBufferData.push_back(std::make_unique<dw::BindConstantBufferCommandData>());
+        legacy.vertexBufferData.push_back(std::make_unique<dw::BindVertexBufferCommandData>());
+        legacy.drawData.push_back(std::make_unique<dw::DrawCommandData>());
+    }
+    std::shuffle(legacy.constantBufferData.begin(), legacy.constantBufferData.end(), random);
+    std::shuffle(legacy.vertexBufferData.begin(), legacy.vertexBufferData.end(), random);
+    std::shuffle(legacy.drawData.begin(), legacy.drawData.end(), random);
+
+    dw::CommandStream stream;
+    for (uint32_t i = 0; i < numDraws; ++i) {
+        dw::GfxObject* constantBuffer = legacy.objects[objectDistribution(random) - 1].get();
+        dw::GfxObject* vertexBuffer = legacy.objects[objectDistribution(random) - 1].get();
+        const uint32_t count = 3 * (i % 64 + 1);
+
+        *legacy.constantBufferData[i] = { constantBuffer };
+        *legacy.vertexBufferData[i] = { vertexBuffer };
+        *legacy.drawData[i] = { count, 0 };
+        legacy.commands.push_back({ dw::BIND_CONSTANT_BUFFER, legacy.constantBufferData[i].get() });
+        legacy.commands.push_back({ dw::BIND_VERTEX_BUFFER, legacy.vertexBufferData[i].get() });
+        legacy.commands.push_back({ dw::DRAW, legacy.drawData[i].get() });
+
+        stream.BindConstantBuffer(*constantBuffer);
+        stream.BindVertexBuffer(*vertexBuffer);
+        stream.Draw(count, 0);
+    }
+
+    Backend legacyBackend;
+    Backend streamBackend;
+    DispatchLegacy(legacy.commands, legacyBackend); // Warm up
+    DispatchStream(stream, streamBackend);
+
+    const double legacyTime = MeasureMilliseconds([&] { DispatchLegacy(legacy.commands, legacyBackend); });
+    const double streamTime = MeasureMilliseconds([&] { DispatchStream(stream, streamBackend); });
+
+    // Repacking the old commands into a reused stream, as RenderEngine::Render(vector) does every frame
+    const std::vector<dw::RenderCommand>& source = legacy.commands;
+    const double recordTime = MeasureMilliseconds([&] {
+        stream.Reset();
+        for (size_t i = 0; i + 2 < source.size(); i += 3) {
+            stream.BindConstantBuffer(*static_cast<dw::BindConstantBufferCommandData*>(source[i].data)->object);
+            stream.BindVertexBuffer(*static_cast<dw::BindVertexBufferCommandData*>(source[i + 1].data)->object);
+            const dw::DrawCommandData* draw = static_cast<dw::DrawCommandData*>(source[i + 2].data);
+            stream.Draw(draw->count, draw->startVertex);
+        }
+    });
+
+    if (legacyBackend.checksum != streamBackend.checksum) {
+        std::cerr << "Dispatch mismatch, the paths saw different commands\n";
+        return 1;
+    }
+
+    std::cout << stream.GetCommandCount() << " commands, " << stream.GetSize() << " bytes packed\n";
+    std::cout << "vector<RenderCommand> dispatch: " << legacyTime << " ms/frame (" << legacyTime * 1e6 / stream.GetCommandCount() << " ns/command)\n";
+    std::cout << "CommandStream dispatch:         " << streamTime << " ms/frame (" << streamTime * 1e6 / stream.GetCommandCount() << " ns/command)\n";
+    std::cout << "Repacking vector<RenderCommand>: " << recordTime << " ms/frame\n";
+    std::cout << "Dispatch speedup: " << legacyTime / streamTime << "x\n";
+    return 0;
+}
@@ -0,0 +1,362 @@
+#include "utils/textureencoder.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <utility>
+#include <vector>
+
+// Encodes a procedural texture to every BC format at every quality tier, on one thread with every kernel set
+// the build and CPU support and then on all hardware threads. Checks the kernel sets agree byte for byte,
+// decodes the blocks to check the error the encoder estimates and reports the throughput per core, which is
+// what sizes the budget for textures built at runtime.
+namespace {
+    const uint32_t s_SIZE = 1024;
+    const uint32_t s_NUM_RUNS = 3;
+    const double s_MAX_ERROR_DIFFERENCE = 0.01; // How far the decoded rms error may be off the estimate
+
+    // The two subset partitions of the BC7 specification, a set bit puts the texel in the second subset, and
+    // the texel of the second subset whose index drops its highest bit
+    const uint16_t s_BC7_PARTITIONS2[64] = {
+        0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80, 0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+        0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE, 0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+        0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A, 0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+        0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C, 0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22
+    };
+    const uint8_t s_BC7_ANCHORS2[64] = {
+        15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+        15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+        15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6,
+        6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15
+    };
+    const uint32_t s_BC7_WEIGHTS2[4] = { 0, 21, 43, 64 };
+    const uint32_t s_BC7_WEIGHTS3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+    const uint32_t s_BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    using Texels = uint8_t[16][4];
+
+    // Reads the fields of a BC7 block lowest bit first
+    class BitReader {
+    public:
+        explicit BitReader(const uint8_t* block) : m_block(block) {}
+
+        uint32_t Read(uint32_t bits) {
+            uint32_t value = 0;
+            for (uint32_t i = 0; i < bits; ++i, ++m_bit) {
+                value |= static_cast<uint32_t>((m_block[m_bit >> 3] >> (m_bit & 7)) & 1) << i;
+            }
+            return value;
+        }
+
+    private:
+        const uint8_t* m_block;
+        uint32_t m_bit = 0;
+    };
+
+    uint32_t LoadUint16(const uint8_t* block) {
+        return block[0] | block[1] << 8;
+    }
+
+    // Four colors if color0 > color1, otherwise three and transparent black. isFourColors forces the first,
+    // as BC3 does
+    void DecodeBc1(const uint8_t* block, bool isFourColors, Texels& texels) {
+        uint32_t colors[2] = { LoadUint16(block), LoadUint16(block + 2) };
+        uint32_t palette[4][4] = {};
+        for (uint32_t e = 0; e < 2; ++e) {
+            const uint32_t r = (colors[e] >> 11) & 31, g = (colors[e] >> 5) & 63, b = colors[e] & 31;
+            palette[e][0] = r << 3 | r >> 2;
+            palette[e][1] = g << 2 | g >> 4;
+            palette[e][2] = b << 3 | b >> 2;
+            palette[e][3] = 255;
+        }
+        for (uint32_t c = 0; c < 3; ++c) {
+            if (isFourColors || colors[0] > colors[1]) {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+            } else {
+                palette[2][c] = (palette[0][c] + palette[1][c] + 1) / 2;
+            }
+        }
+        palette[2][3] = 255;
+        palette[3][3] = isFourColors || colors[0] > colors[1] ? 255 : 0;
+        const uint32_t indices = LoadUint16(block + 4) | LoadUint16(block + 6) << 16;
+        for (uint32_t t = 0; t < 16; ++t) {
+            for (uint32_t c = 0; c < 4; ++c) {
+                texels[t][c] = static_cast<uint8_t>(palette[(indices >> (t * 2)) & 3][c]);
+            }
+        }
+    }
+
+    // Eight values if red0 > red1, otherwise six and 0 and 255. Writes channel of the texels
+    void DecodeBc4(const uint8_t* block, uint32_t channel, Texels& texels) {
+        const uint32_t values[2] = { block[0], block[1] };
+        uint32_t palette[8] = { values[0], values[1] };
+        if (values[0] > values[1]) {
+            for (uint32_t i = 2; i < 8; ++i) {
+                palette[i] = ((8 - i) * values[0] + (i - 1) * values[1] + 3) / 7;
+            }
+        } else {
+            for (uint32_t i = 2; i < 6; ++i) {
+                palette[i] = ((6 - i) * values[0] + (i - 1) * values[1] + 2) / 5;
+            }
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+        uint64_t indices = 0;
+        for (uint32_t i = 0; i < 6; ++i) {
+            indices |= static_cast<uint64_t>(block[2 + i]) << (i * 8);
+        }
+        for (uint32_t t = 0; t < 16; ++t) {
+            texels[t][channel] = static_cast<uint8_t>(palette[(indices >> (t * 3)) & 7]);
+        }
+    }
+
+    uint32_t Interpolate(uint32_t low, uint32_t high, uint32_t weight) {
+        return ((64 - weight) * low + weight * high + 32) >> 6;
+    }
+
+    // Modes 1, 5 and 6, the ones the encoder writes. Returns false for the others
+    bool DecodeBc7(const uint8_t* block, Texels& texels) {
+        BitReader bits(block);
+        uint32_t mode = 0;
+        while (mode < 8 && bits.Read(1) == 0) {
+            ++mode;
+        }
+        if (mode == 1) {
+            const uint32_t partition = bits.Read(6);
+            uint32_t ends[2][2][3];
+            for (uint32_t c = 0; c < 3; ++c) {
+                for (uint32_t s = 0; s < 2; ++s) {
+                    ends[s][0][c] = bits.Read(6);
+                    ends[s][1][c] = bits.Read(6);
+                }
+            }
+            for (uint32_t s = 0; s < 2; ++s) {
+                const uint32_t pbit = bits.Read(1);
+                for (uint32_t e = 0; e < 2; ++e) {
+                    for (uint32_t c = 0; c < 3; ++c) {
+                        const uint32_t value = ends[s][e][c] << 1 | pbit;
+                        ends[s][e][c] = value << 1 | value >> 6;
+                    }
+                }
+            }
+            for (uint32_t t = 0; t < 16; ++t) {
+                const uint32_t subset = (s_BC7_PARTITIONS2[partition] >> t) & 1;
+                const bool isAnchor = t == 0 || t == s_BC7_ANCHORS2[partition];
+                const uint32_t index = bits.Read(isAnchor ? 2 : 3);
+                for (uint32_t c = 0; c < 3; ++c) {
+                    texels[t][c] = static_cast<uint8_t>(Interpolate(ends[subset][0][c], ends[subset][1][c], s_BC7_WEIGHTS3[index]));
+                }
+                texels[t][3] = 255;
+            }
+            return true;
+        }
+        if (mode == 5) {
+            const uint32_t rotation = bits.Read(2);
+            uint32_t ends[2][4];
+            for (uint32_t c = 0; c < 3; ++c) {
+                for (uint32_t e = 0; e < 2; ++e) {
+                    const uint32_t value = bits.Read(7);
+                    ends[e][c] = value << 1 | value >> 6;
+                }
+            }
+            ends[0][3] = bits.Read(8);
+            ends[1][3] = bits.Read(8);
+            for (uint32_t t = 0; t < 16; ++t) {
+                const uint32_t index = bits.Read(t == 0 ? 1 : 2);
+                for (uint32_t c = 0; c < 3; ++c) {
+                    texels[t][c] = static_cast<uint8_t>(Interpolate(ends[0][c], ends[1][c], s_BC7_WEIGHTS2[index]));
+                }
+            }
+            for (uint32_t t = 0; t < 16; ++t) {
+                const uint32_t index = bits.Read(t == 0 ? 1 : 2);
+                texels[t][3] = static_cast<uint8_t>(Interpolate(ends[0][3], ends[1][3], s_BC7_WEIGHTS2[index]));
+                if (rotation != 0) {
+                    std::swap(texels[t][3], texels[t][rotation - 1]);
+                }
+            }
+            return true;
+        }
+        if (mode == 6) {
+            uint32_t ends[2][4];
+            for (uint32_t c = 0; c < 4; ++c) {
+                ends[0][c] = bits.Read(7) << 1;
+                ends[1][c] = bits.Read(7) << 1;
+            }
+            for (uint32_t e = 0; e < 2; ++e) {
+                const uint32_t pbit = bits.Read(1);
+                for (uint32_t c = 0; c < 4; ++c) {
+                    ends[e][c] |= pbit;
+                }
+            }
+            for (uint32_t t = 0; t < 16; ++t) {
+                const uint32_t index = bits.Read(t == 0 ? 3 : 4);
+                for (uint32_t c = 0; c < 4; ++c) {
+                    texels[t][c] = static_cast<uint8_t>(Interpolate(ends[0][c], ends[1][c], s_BC7_WEIGHTS4[index]));
+                }
+            }
+            return true;
+        }
+        return false;
+    }
+
+    bool DecodeBlock(const uint8_t* block, dw::TextureFormat format, Texels& texels) {
+        std::memset(texels, 0, sizeof(Texels));
+        switch (format) {
+            case dw::TEXTURE_FORMAT_BC1:
+                DecodeBc1(block, false, texels);
+                return true;
+            case dw::TEXTURE_FORMAT_BC3:
+                DecodeBc1(block + 8, true, texels);
+                DecodeBc4(block, 3, texels);
+                return true;
+            case dw::TEXTURE_FORMAT_BC4:
+                DecodeBc4(block, 0, texels);
+                return true;
+            case dw::TEXTURE_FORMAT_BC5:
+                DecodeBc4(block, 0, texels);
+                DecodeBc4(block + 8, 1, texels);
+                return true;
+            case dw::TEXTURE_FORMAT_BC7:
+                return DecodeBc7(block, texels);
+            default:
+                return false;
+        }
+    }
+
+    // Root mean square difference of the decoded blocks over the channels the format keeps. BC1 texels with
+    // alpha below 128 have to decode transparent and their color doesn't count, as for the encoder. Negative
+    // if a block can't be decoded or gets the transparency wrong
+    double MeasureError(const std::vector<uint8_t>& texels, dw::TextureFormat format, const std::vector<uint8_t>& blocks) {
+        const uint32_t channels = format == dw::TEXTURE_FORMAT_BC4 ? 1 : (format == dw::TEXTURE_FORMAT_BC5 ? 2 : (format == dw::TEXTURE_FORMAT_BC1 ? 3 : 4));
+        const uint32_t blockSize = dw::GetTextureFormatSize(format);
+        const uint32_t blocksX = s_SIZE / 4;
+        double error = 0.0;
+        Texels decoded;
+        for (uint32_t blockY = 0; blockY < s_SIZE / 4; ++blockY) {
+            for (uint32_t blockX = 0; blockX < blocksX; ++blockX) {
+                if (!DecodeBlock(&blocks[(static_cast<size_t>(blockY) * blocksX + blockX) * blockSize], format, decoded)) {
+                    return -1.0;
+                }
+                for (uint32_t t = 0; t < 16; ++t) {
+                    const uint8_t* texel = &texels[((static_cast<size_t>(blockY) * 4 + t / 4) * s_SIZE + blockX * 4 + t % 4) * 4];
+                    if (format == dw::TEXTURE_FORMAT_BC1 && (texel[3] < 128) != (decoded[t][3] == 0)) {
+                        return -1.0;
+                    }
+                    if (format == dw::TEXTURE_FORMAT_BC1 && texel[3] < 128) {
+                        continue;
+                    }
+                    for (uint32_t c = 0; c < channels; ++c) {
+                        const double difference = static_cast<double>(decoded[t][c]) - texel[c];
+                        error += difference * difference;
+                    }
+                }
+            }
+        }
+        return std::sqrt(error / (static_cast<double>(s_SIZE) * s_SIZE * channels));
+    }
+
+    const char* GetQualityName(dw::TextureEncoder::Quality quality) {
+        switch (quality) {
+            case dw::TextureEncoder::QUALITY_FAST: return "fast";
+            case dw::TextureEncoder::QUALITY_NORMAL: return "normal";
+            case dw::TextureEncoder::QUALITY_HIGH: return "high";
+        }
+        return "unknown";
+    }
+
+    // Milliseconds per encode
+    double Time(const dw::TextureEncoder& encoder, const std::vector<uint8_t>& texels, dw::TextureFormat format, std::vector<uint8_t>& blocks) {
+        encoder.Encode(texels.data(), s_SIZE, s_SIZE, format, blocks.data()); // Warm up
+
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t run = 0; run < s_NUM_RUNS; ++run) {
+            encoder.Encode(texels.data(), s_SIZE, s_SIZE, format, blocks.data());
+        }
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / s_NUM_RUNS;
+    }
+
+    void PrintThroughput(const char* name, double milliseconds, uint32_t cores) {
+        const double megapixels = static_cast<double>(s_SIZE) * s_SIZE / 1e6;
+        std::cout << "    " << name << ": " << milliseconds << " ms, " << megapixels / milliseconds * 1e3 << " MP/s, "
+                  << megapixels / milliseconds * 1e3 / cores << " MP/s per core\n";
+    }
+}
+
+int main() {
+    // Smooth gradients, hard edged shapes and noise, with a cut out disc and an alpha ramp
+    std::mt19937 random(1337);
+    std::uniform_int_distribution<int> noise(-12, 12);
+    std::vector<uint8_t> texels(static_cast<size_t>(s_SIZE) * s_SIZE * 4);
+    for (uint32_t y = 0; y < s_SIZE; ++y) {
+        for (uint32_t x = 0; x < s_SIZE; ++x) {
+            const float u = static_cast<float>(x) / s_SIZE, v = static_cast<float>(y) / s_SIZE;
+            const bool isStripe = ((x / 48) + (y / 80)) % 3 == 0;
+            float color[4] = { 255.0f * u, 255.0f * (0.5f + 0.5f * std::sin(v * 20.0f)), isStripe ? 230.0f : 40.0f + 100.0f * v, 255.0f };
+            const float dx = u - 0.7f, dy = v - 0.3f;
+            if (dx * dx + dy * dy < 0.02f) {
+                color[3] = 0.0f;
+            } else if (v > 0.8f) {
+                color[3] = 255.0f * (1.0f - u);
+            }
+            uint8_t* texel = &texels[(static_cast<size_t>(y) * s_SIZE + x) * 4];
+            for (uint32_t c = 0; c < 4; ++c) {
+                const float value = color[c] + (c < 3 ? noise(random) : 0);
+                texel[c] = static_cast<uint8_t>(value < 0.0f ? 0.0f : (value > 255.0f ? 255.0f : value));
+            }
+        }
+    }
+
+    const dw::TextureFormat formats[] = { dw::TEXTURE_FORMAT_BC1, dw::TEXTURE_FORMAT_BC3, dw::TEXTURE_FORMAT_BC4,
+                                          dw::TEXTURE_FORMAT_BC5, dw::TEXTURE_FORMAT_BC7 };
+    const char* formatNames[] = { "BC1", "BC3", "BC4", "BC5", "BC7" };
+    const dw::TextureEncoder all(dw::TextureEncoder::QUALITY_NORMAL);
+    std::cout << s_SIZE << "x" << s_SIZE << " RGBA8 texels, " << all.GetNumThreads() << " hardware threads\n";
+
+    dw::TextureDescription description;
+    description.width = s_SIZE;
+    description.height = s_SIZE;
+    for (uint32_t f = 0; f < sizeof(formats) / sizeof(formats[0]); ++f) {
+        description.format = formats[f];
+        for (uint32_t q = dw::TextureEncoder::QUALITY_FAST; q <= dw::TextureEncoder::QUALITY_HIGH; ++q) {
+            const dw::TextureEncoder::Quality quality = static_cast<dw::TextureEncoder::Quality>(q);
+            std::cout << "  " << formatNames[f] << " " << GetQualityName(quality) << "\n";
+
+            std::vector<uint8_t> reference;
+            for (uint32_t set = dw::KERNELS_SCALAR; set <= static_cast<uint32_t>(dw::GetBestKernelSet()); ++set) {
+                const dw::TextureEncoder encoder(quality, 1, static_cast<dw::KernelSet>(set));
+                std::vector<uint8_t> blocks(description.GetLevelSize(0));
+                PrintThroughput(dw::GetKernelSetName(encoder.GetKernelSet()), Time(encoder, texels, formats[f], blocks), 1);
+
+                if (reference.empty()) {
+                    reference = blocks;
+                } else if (blocks != reference) {
+                    std::cerr << "Kernel set output differs from the scalar kernels\n";
+                    return 1;
+                }
+            }
+
+            const dw::TextureEncoder encoder(quality);
+            std::vector<uint8_t> blocks(description.GetLevelSize(0));
+            const std::string name = std::string(dw::GetKernelSetName(encoder.GetKernelSet())) + ", " + std::to_string(encoder.GetNumThreads()) + " threads";
+            PrintThroughput(name.c_str(), Time(encoder, texels, formats[f], blocks), encoder.GetNumThreads());
+            if (blocks != reference) {
+                std::cerr << "Encoding on several threads differs from one thread\n";
+                return 1;
+            }
+
+            float estimatedError = 0.0f;
+            encoder.Encode(texels.data(), s_SIZE, s_SIZE, formats[f], blocks.data(), &estimatedError);
+            const double rmsError = MeasureError(texels, formats[f], blocks);
+            std::cout << "    rms error " << rmsError << ", estimated " << estimatedError << "\n";
+            if (rmsError < 0.0 || std::fabs(rmsError - estimatedError) > s_MAX_ERROR_DIFFERENCE) {
+                std::cerr << "Decoded blocks don't match the error the encoder estimates\n";
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include "utils/vertexpacker.h"
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Packs a large float mesh with every kernel set the build and CPU support, checks they agree byte for byte
+// and reports the throughput and the quantization error of each packed format.
+namespace {
+    const uint32_t s_NUM_VERTICES = 1 << 20;
+    const uint32_t s_NUM_RUNS = 20;
+
+    void PrintError(const char* name, const dw::QuantizationError& error) {
+        std::cout << "    " << name << " max " << error.max << ", rms " << error.rms << "\n";
+    }
+}
+
+int main() {
+    std::mt19937 random(1337);
+    std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::normal_distribution<float> direction;
+
+    std::vector<float> positions(s_NUM_VERTICES * 3);
+    std::vector<float> normals(s_NUM_VERTICES * 3);
+    std::vector<float> colors(s_NUM_VERTICES * 4);
+    std::vector<float> uvs(s_NUM_VERTICES * 2);
+    for (float& value : positions) {
+        value = position(random);
+    }
+    for (uint32_t i = 0; i < s_NUM_VERTICES; ++i) {
+        const float x = direction(random), y = direction(random), z = direction(random);
+        const float length = std::sqrt(x * x + y * y + z * z);
+        normals[i * 3 + 0] = x / length;
+        normals[i * 3 + 1] = y / length;
+        normals[i * 3 + 2] = z / length;
+    }
+    for (float& value : colors) {
+        value = unit(random);
+    }
+    for (float& value : uvs) {
+        value = unit(random);
+    }
+
+    const dw::VertexStreams streams = { positions.data(), normals.data(), colors.data(), uvs.data(), s_NUM_VERTICES };
+    const dw::VertexPackFormat halfFormat;
+    dw::VertexPackFormat snormFormat;
+    snormFormat.position = dw::VERTEX_FORMAT_SNORM16X4;
+    snormFormat.uv = dw::VERTEX_FORMAT_UNORM16X2;
+
+    std::cout << s_NUM_VERTICES << " vertices of float position, normal, color and uv (48 bytes each)\n";
+    for (const dw::VertexPackFormat& format : { halfFormat, snormFormat }) {
+        const dw::VertexLayout layout = dw::VertexPacker(format).GetLayout(streams);
+        std::cout << (format.position == dw::VERTEX_FORMAT_HALF4 ? "half positions and uvs" : "snorm16 positions, unorm16 uvs")
+                  << ", " << layout.stride << " bytes per vertex\n";
+
+        std::vector<uint8_t> reference;
+        for (uint32_t set = dw::KERNELS_SCALAR; set <= static_cast<uint32_t>(dw::GetBestKernelSet()); ++set) {
+            const dw::VertexPacker packer(format, static_cast<dw::KernelSet>(set));
+            std::vector<uint8_t> packed(static_cast<size_t>(s_NUM_VERTICES) * layout.stride);
+            packer.Pack(streams, packed.data()); // Warm up
+
+            const auto start = std::chrono::steady_clock::now();
+            for (uint32_t run = 0; run < s_NUM_RUNS; ++run) {
+                packer.Pack(streams, packed.data());
+            }
+            const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            const double milliseconds = elapsed.count() / s_NUM_RUNS;
+
+            std::cout << "  " << dw::GetKernelSetName(packer.GetKernelSet()) << ": " << milliseconds << " ms ("
+                      << s_NUM_VERTICES / milliseconds / 1e3 << " M vertices/s)\n";
+
+            if (reference.empty()) {
+                reference = packed;
+            } else if (packed != reference) {
+                std::cerr << "Kernel set output differs from the scalar kernels\n";
+                return 1;
+            }
+        }
+
+        const dw::PackReport report = dw::VertexPacker(format).Pack(streams, reference.data(), true);
+        PrintError("position (units)", report.position);
+        PrintError("normal (degrees)", report.normal);
+        PrintError("color", report.color);
+        PrintError("uv", report.uv);
+    }
+    return 0;
+}
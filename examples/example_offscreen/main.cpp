@@ -0,0 +1,134 @@
+#include "direwolf/renderengine.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// Renders a cube on a floor with the backends that run on the CPU, without a window, and writes each
+// frame to a PPM image in the working directory
+namespace {
+    const uint32_t WIDTH = 640;
+    const uint32_t HEIGHT = 480;
+    const uint32_t NUM_FRAMES = 8;
+
+    struct StandardVertex {
+        glm::vec4 position;
+        glm::vec4 color;
+    };
+
+    struct ShaderData {
+        glm::mat4 model;
+        glm::mat4 view;
+        glm::mat4 proj;
+    };
+
+    void _AddQuad(std::vector<StandardVertex>& vertices, const glm::vec3 corners[4], const glm::vec4& color) {
+        const int order[6] = { 0, 1, 2, 0, 2, 3 };
+        for (int corner : order) {
+            vertices.push_back({ glm::vec4(corners[corner], 1.0f), color });
+        }
+    }
+
+    std::vector<StandardVertex> _CreateScene() {
+        std::vector<StandardVertex> vertices;
+        // Each face of the cube is colored by its normal
+        for (int axis = 0; axis < 3; ++axis) {
+            for (float side : { -1.0f, 1.0f }) {
+                glm::vec3 normal(0.0f);
+                normal[axis] = side;
+                const glm::vec3 u = glm::vec3(normal.y, normal.z, normal.x);
+                const glm::vec3 v = glm::cross(normal, u);
+                const glm::vec3 corners[4] = { normal - u - v, normal + u - v, normal + u + v, normal - u + v };
+                _AddQuad(vertices, corners, glm::vec4(glm::abs(normal) * 0.8f + 0.2f, 1.0f));
+            }
+        }
+        const glm::vec3 floor[4] = { { -4.0f, -1.0f, -4.0f }, { -4.0f, -1.0f, 4.0f }, { 4.0f, -1.0f, 4.0f }, { 4.0f, -1.0f, -4.0f } };
+        _AddQuad(vertices, floor, glm::vec4(0.6f, 0.6f, 0.6f, 1.0f));
+        return vertices;
+    }
+
+    bool _WritePPM(const std::string& path, const std::vector<uint32_t>& pixels, uint32_t width, uint32_t height) {
+        FILE* file = std::fopen(path.c_str(), "wb");
+        if (!file) {
+            return false;
+        }
+        std::fprintf(file, "P6\n%u %u\n255\n", width, height);
+        for (uint32_t pixel : pixels) {
+            const unsigned char rgb[3] = { static_cast<unsigned char>(pixel), static_cast<unsigned char>(pixel >> 8), static_cast<unsigned char>(pixel >> 16) };
+            std::fwrite(rgb, 1, sizeof(rgb), file);
+        }
+        return std::fclose(file) == 0;
+    }
+
+    bool _Render(dw::RendererType rendererType, dw::BackendType backendType, const std::string& name) {
+        dw::InitData initData { rendererType, backendType };
+        dw::PlatformData platformData;
+        platformData.width = WIDTH;
+        platformData.height = HEIGHT;
+        dw::RenderEngine renderEngine(platformData, initData);
+        if (!renderEngine.IsInitialized()) {
+            std::cerr << name << " isn't built into this library\n";
+            return false;
+        }
+
+        const std::vector<StandardVertex> vertices = _CreateScene();
+        const uint32_t numVertices = static_cast<uint32_t>(vertices.size());
+        dw::GfxObject vertexBuffer;
+        renderEngine.CreateVertexBuffer(vertexBuffer, numVertices);
+        std::memcpy(renderEngine.MapVertexBuffer(vertexBuffer), vertices.data(), vertices.size() * sizeof(StandardVertex));
+        renderEngine.UnmapVertexBuffer(vertexBuffer);
+
+        // The CPU backends ignore the shaders and run the standard program, the pipeline state only has to exist
+        dw::GfxObject pipeline;
+        renderEngine.CreatePipelineState(pipeline, dw::PipelineState());
+
+        ShaderData shaderData;
+        shaderData.model = glm::mat4(1.0f);
+        shaderData.view = glm::lookAt(glm::vec3(4, 3, 5), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+        shaderData.proj = glm::perspective(glm::radians(45.0f), static_cast<float>(WIDTH) / static_cast<float>(HEIGHT), 0.1f, 100.0f);
+        dw::GfxObject constantBuffer;
+        renderEngine.CreateConstantBuffer(constantBuffer, sizeof(shaderData));
+
+        dw::CommandStream renderCommands;
+        for (uint32_t frame = 0; frame < NUM_FRAMES; ++frame) {
+            shaderData.model = glm::rotate(glm::mat4(1.0f), frame * 0.1f, glm::vec3(0.0f, 1.0f, 0.0f));
+            renderCommands.Reset();
+            renderCommands.UpdateConstantBuffer(constantBuffer, &shaderData, sizeof(shaderData));
+            renderCommands.BindPipelineState(pipeline);
+            renderCommands.BindConstantBuffer(constantBuffer);
+            renderCommands.BindVertexBuffer(vertexBuffer);
+            renderCommands.Draw(numVertices, 0);
+            renderEngine.Render(renderCommands);
+        }
+
+        std::vector<uint32_t> pixels;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        if (!renderEngine.ReadColorBuffer(pixels, width, height) || !_WritePPM(name + ".ppm", pixels, width, height)) {
+            std::cerr << "Failed to save the frame of " << name << "\n";
+            return false;
+        }
+        std::cout << "Wrote " << name << ".ppm";
+        const dw::FrameStats stats = renderEngine.GetFrameStats();
+        if (stats.megaRaysPerSecond > 0.0) {
+            std::cout << ", traced " << stats.megaRaysPerSecond << " Mrays/s";
+        }
+        std::cout << "\n";
+
+        renderEngine.DestroyConstantBuffer(constantBuffer);
+        renderEngine.DestroyPipelineState(pipeline);
+        renderEngine.DestroyVertexBuffer(vertexBuffer);
+        return true;
+    }
+}
+
+int main() {
+    std::cout << "Offscreen example running\n";
+    const bool rasterized = _Render(dw::RendererType::RASTERIZER, dw::BackendType::SOFTWARE, "software");
+    const bool traced = _Render(dw::RendererType::RAYTRACER, dw::BackendType::SOFTWARE, "raytracer");
+    return rasterized && traced ? 0 : 1;
+}
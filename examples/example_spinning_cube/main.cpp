@@ -1,4 +1,7 @@
 #include "direwolf/renderengine.h"
+#include "shaderreloader.h"
+#include "utils/meshoptimizer.h"
+#include "utils/shaderloader.h"
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <iostream>
@@ -7,6 +10,7 @@
 #include "glm/gtx/string_cast.hpp"
 
 #include <chrono>
+#include <string>
 
 #if defined(_WIN32)
   #define GLFW_EXPOSE_NATIVE_WIN32
@@ -27,46 +31,6 @@ namespace {
         0.0f, 1.0f, 0.0f, 1.0f
     };
 
-    // Taken from opengl-tutorial
-    const GLfloat colorData[] = {
-        0.583f, 0.771f, 0.014f, 1.0f,
-        0.609f, 0.115f, 0.436f, 1.0f,
-        0.327f, 0.483f, 0.844f, 1.0f,
-        0.822f, 0.569f, 0.201f, 1.0f,
-        0.435f, 0.602f, 0.223f, 1.0f,
-        0.310f, 0.747f, 0.185f, 1.0f,
-        0.597f, 0.770f, 0.761f, 1.0f,
-        0.559f, 0.436f, 0.730f, 1.0f,
-        0.359f, 0.583f, 0.152f, 1.0f,
-        0.483f, 0.596f, 0.789f, 1.0f,
-        0.559f, 0.861f, 0.639f, 1.0f,
-        0.195f, 0.548f, 0.859f, 1.0f,
-        0.014f, 0.184f, 0.576f, 1.0f,
-        0.771f, 0.328f, 0.970f, 1.0f,
-        0.406f, 0.615f, 0.116f, 1.0f,
-        0.676f, 0.977f, 0.133f, 1.0f,
-        0.971f, 0.572f, 0.833f, 1.0f,
-        0.140f, 0.616f, 0.489f, 1.0f,
-        0.997f, 0.513f, 0.064f, 1.0f,
-        0.945f, 0.719f, 0.592f, 1.0f,
-        0.543f, 0.021f, 0.978f, 1.0f,
-        0.279f, 0.317f, 0.505f, 1.0f,
-        0.167f, 0.620f, 0.077f, 1.0f,
-        0.347f, 0.857f, 0.137f, 1.0f,
-        0.055f, 0.953f, 0.042f, 1.0f,
-        0.714f, 0.505f, 0.345f, 1.0f,
-        0.783f, 0.290f, 0.734f, 1.0f,
-        0.722f, 0.645f, 0.174f, 1.0f,
-        0.302f, 0.455f, 0.848f, 1.0f,
-        0.225f, 0.587f, 0.040f, 1.0f,
-        0.517f, 0.713f, 0.338f, 1.0f,
-        0.053f, 0.959f, 0.120f, 1.0f,
-        0.393f, 0.621f, 0.362f, 1.0f,
-        0.673f, 0.211f, 0.457f, 1.0f,
-        0.820f, 0.883f, 0.371f, 1.0f,
-        0.982f, 0.099f, 0.879f, 1.0f
-    };
-
     const GLfloat positionData[] = {
         -1.0f,-1.0f,-1.0f, 1.0f,
         -1.0f,-1.0f, 1.0f, 1.0f,
@@ -146,6 +110,7 @@ int main() {
 
     // Setup renderer
     dw::InitData initData { dw::RendererType::RASTERIZER, dw::BackendType::OPENGL };
+    initData.shaderCacheDirectory = "shadercache"; // Compiled programs, reused by the next run
     dw::PlatformData platformData = { _GetGlfwNativeWindowhandle(s_window) };
     auto renderEngine = std::make_unique<dw::RenderEngine>(platformData, initData);
 
@@ -170,10 +135,10 @@ int main() {
     };
 
     std::vector<StandardVertex> vertexData;
-    // Convert raw data
+    // Convert raw data, the color follows from the position so the corners shared by several faces are identical
     for (size_t i = 0; i < sizeof(positionData) / sizeof(float); i += VERTEX_LAYOUT) {
         glm::vec4 position = glm::vec4(positionData[i + 0], positionData[i + 1], positionData[i + 2], positionData[i + 3]);
-        glm::vec4 color = glm::vec4(colorData[i + 0], colorData[i + 1], colorData[i + 2], colorData[i + 3]);
+        glm::vec4 color = glm::vec4(glm::vec3(position) * 0.5f + 0.5f, 1.0f);
         StandardVertex vertex { position, color };
         vertexData.push_back(vertex);
     }
@@ -185,13 +150,53 @@ int main() {
     // std::cerr << "SIZE OF POS DATA " << sizeof(positionData) << std::endl;
     // std::cerr << "SIZE OF VECTOR ETC " << vertexData.size() * sizeof(StandardVertex) << std::endl;
 
-    // Vertex data
+    // Merge the duplicated corners, then order the triangles for the vertex cache and the vertices for fetching
+    std::vector<uint16_t> indexData(numVertices);
+    std::vector<StandardVertex> uniqueVertices(numVertices);
+    uint32_t numUniqueVertices = dw::mesh::GenerateIndexBuffer(indexData.data(), uniqueVertices.data(), vertexData.data(), numVertices, sizeof(StandardVertex));
+    dw::mesh::OptimizeVertexCache(indexData.data(), indexData.data(), numVertices, numUniqueVertices);
+    dw::mesh::OptimizeOverdraw(indexData.data(), indexData.data(), numVertices, uniqueVertices.data(), numUniqueVertices, sizeof(StandardVertex));
+    numUniqueVertices = dw::mesh::OptimizeVertexFetch(vertexData.data(), indexData.data(), numVertices, uniqueVertices.data(), numUniqueVertices, sizeof(StandardVertex));
+    const uint32_t numIndices = numVertices;
+
+    // Vertex data, 16 bytes per vertex instead of the 32 of the standard layout. w of the position reads as 1
+    struct CompactVertex {
+        float position[3];
+        uint8_t color[4];
+    };
+    const dw::VertexLayout compactLayout = dw::VertexLayout().Add(0, dw::VERTEX_FORMAT_FLOAT3).Add(1, dw::VERTEX_FORMAT_UNORM8X4);
+
     dw::GfxObject vertexBuffer;
-    renderEngine->CreateVertexBuffer(vertexBuffer, numVertices);
-    void* vb = renderEngine->MapVertexBuffer(vertexBuffer);
-    std::memcpy(vb, vertexData.data(), vertexData.size() * sizeof(StandardVertex));
+    renderEngine->CreateVertexBuffer(vertexBuffer, numUniqueVertices, compactLayout);
+    CompactVertex* vb = static_cast<CompactVertex*>(renderEngine->MapVertexBuffer(vertexBuffer));
+    for (uint32_t i = 0; i < numUniqueVertices; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            vb[i].position[c] = vertexData[i].position[c];
+        }
+        for (int c = 0; c < 4; ++c) {
+            vb[i].color[c] = static_cast<uint8_t>(vertexData[i].color[c] * 255.0f + 0.5f);
+        }
+    }
     renderEngine->UnmapVertexBuffer(vertexBuffer);
 
+    // Index data
+    dw::GfxObject indexBuffer;
+    renderEngine->CreateIndexBuffer(indexBuffer, numIndices, dw::INDEX_FORMAT_UINT16);
+    void* ib = renderEngine->MapIndexBuffer(indexBuffer);
+    std::memcpy(ib, indexData.data(), numIndices * sizeof(uint16_t));
+    renderEngine->UnmapIndexBuffer(indexBuffer);
+
+    // Shaders, read relative to the working directory, so run the example from its build folder. Saving
+    // changes to them while the example runs swaps in the rebuilt pipeline
+    dw::ShaderLoader shaderLoader;
+    dw::ShaderReloader shaderReloader(*renderEngine, shaderLoader);
+    dw::GfxObject pipeline;
+    if (!shaderReloader.CreatePipelineState(pipeline, "../../examples/example_spinning_cube/standard.vertex",
+                                            "../../examples/example_spinning_cube/standard.fragment")) {
+        std::cerr << "Failed to create the pipeline state\n";
+        return 1;
+    }
+
     // Set up constant buffer
     dw::GfxObject constantBuffer;
     renderEngine->CreateConstantBuffer(constantBuffer, sizeof(shaderData));
@@ -199,18 +204,8 @@ int main() {
     std::memcpy(cb, &shaderData, sizeof(shaderData));
     renderEngine->UnmapConstantBuffer(constantBuffer);
 
-    // Define the rendering commands (per frame)
-    std::vector<dw::RenderCommand> renderCommands;
-    // Data needed for the bind vertex buffer command (the handle) - so the renderer can look up the associated resource
-    dw::BindVertexBufferCommandData vCommandData = { &vertexBuffer };
-    // Data needed for the draw command (count and start vertex for now)
-    dw::DrawCommandData drawCommand = { numVertices, /*offset=*/0 };
-    dw::BindConstantBufferCommandData cCommandData = { &constantBuffer };
-
-    // Give the per-frame commands to the render queue.
-    renderCommands.push_back({ dw::BIND_CONSTANT_BUFFER, static_cast<void *>(&cCommandData)});
-    renderCommands.push_back({ dw::BIND_VERTEX_BUFFER, static_cast<void*>(&vCommandData) });
-    renderCommands.push_back({ dw::DRAW, static_cast<void*>(&drawCommand) });
+    // The per-frame commands, rerecorded every frame since they carry the new constants
+    dw::CommandStream renderCommands;
 
     // "Game loop"
     auto lastTime = std::chrono::high_resolution_clock::now();
@@ -221,10 +216,15 @@ int main() {
         shaderData.model = glm::rotate(shaderData.model, 0.01f * deltaTime.count() * 35.0f, glm::vec3(0.0f, 1.0f, 0.0f));
         lastTime = currentTime;
 
-        // Render
-        void* cb = renderEngine->MapConstantBuffer(constantBuffer);
-        std::memcpy(cb, &shaderData, sizeof(shaderData));
-        renderEngine->UnmapConstantBuffer(constantBuffer);
+        // Render, the constants are copied into the stream and written to the buffer right before the frame
+        shaderReloader.Update();
+        renderCommands.Reset();
+        renderCommands.UpdateConstantBuffer(constantBuffer, &shaderData, sizeof(shaderData));
+        renderCommands.BindPipelineState(pipeline);
+        renderCommands.BindConstantBuffer(constantBuffer);
+        renderCommands.BindVertexBuffer(vertexBuffer);
+        renderCommands.BindIndexBuffer(indexBuffer);
+        renderCommands.DrawIndexed(numIndices, /*startIndex=*/0, /*baseVertex=*/0);
         renderEngine->Render(renderCommands);
 
         // Window events
@@ -1,6 +1,8 @@
 #include "direwolf/renderengine.h"
+#include "utils/shaderloader.h"
 
 #include <iostream>
+#include <string>
 #include "GLFW/glfw3.h"
 
 #if defined(_WIN32)
@@ -71,16 +73,30 @@ int main() {
     // Give the data back to the engine
     renderEngine->UnmapVertexBuffer(vertexBuffer);
 
-    // Define the rendering commands (per frame)
-    std::vector<dw::RenderCommand> renderCommands;
-    // Data needed for the bind vertex buffer command (the handle) - so the renderer can look up the associated resource
-    dw::BindVertexBufferCommandData vCommandData = { &vertexBuffer };
-    // Data needed for the draw command (count and start vertex for now)
-    dw::DrawCommandData drawCommand = { 3, 0 };
+    // Create the pipeline state from the example's shaders, read relative to the working directory, so run
+    // the example from its build folder
+    dw::ShaderLoader shaderLoader;
+    dw::ShaderSource vertexShader, fragmentShader;
+    if (!shaderLoader.Load("../../examples/example_triangle/standard.vertex", vertexShader) ||
+        !shaderLoader.Load("../../examples/example_triangle/standard.fragment", fragmentShader)) {
+        std::cerr << "Failed to read the shaders\n";
+        return 1;
+    }
+    dw::PipelineState pipelineState;
+    pipelineState.vertexShader = vertexShader.text.c_str();
+    pipelineState.fragmentShader = fragmentShader.text.c_str();
+    dw::GfxObject pipeline;
+    if (!renderEngine->CreatePipelineState(pipeline, pipelineState)) {
+        std::cerr << "Failed to create the pipeline state\n";
+        return 1;
+    }
 
-    // Give the per-frame commands to the render queue.
-    renderCommands.push_back({ dw::BIND_VERTEX_BUFFER, static_cast<void*>(&vCommandData) });
-    renderCommands.push_back({ dw::DRAW, static_cast<void*>(&drawCommand) });
+    // Record the per-frame commands once, the stream holds copies of the handles and can be replayed every frame
+    dw::CommandStream renderCommands;
+    renderCommands.BindPipelineState(pipeline);
+    renderCommands.BindVertexBuffer(vertexBuffer);
+    // Vertex count and start vertex
+    renderCommands.Draw(3, 0);
 
     while (true) {
         // Dispatch render commands for a frame
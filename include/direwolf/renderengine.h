@@ -1,7 +1,13 @@
 #pragma once
 
+#include <functional>
 #include <memory>
 #include "irenderer.h"
+#include "commandstream.h"
+#include "renderqueue.h"
+#include "parallelcommandrecorder.h"
+#include "renderthread.h"
+#include "utils/handlepool.h"
 #include "common/config.h"
 
 namespace dw {
@@ -11,25 +17,103 @@ public:
     RenderEngine(const PlatformData& platformData, const InitData& initData);
     ~RenderEngine();
 
-    bool CreateConstantBuffer(const GfxObject& object, uint32_t size) const;
+    /* Resources are named by handles from the engine. Create writes a new handle to object, which is left
+       invalid on failure. Using a handle after Destroy is detected and ignored */
+    bool CreateConstantBuffer(GfxObject& object, uint32_t size);
     void* MapConstantBuffer(const GfxObject& object) const;
     void UnmapConstantBuffer(const GfxObject& object) const;
+    void DestroyConstantBuffer(const GfxObject& object);
 
-    /* Creates a vertex buffer resource */
-    bool CreateVertexBuffer(const GfxObject& object, uint32_t count) const;
-    /* Get a vertex buffer to fill with data */
+    /* Creates a vertex buffer of count elements laid out as described by layout */
+    bool CreateVertexBuffer(GfxObject& object, uint32_t count, const VertexLayout& layout = VertexLayout::Standard());
+    /* Get a vertex buffer to fill with data, count * layout.stride bytes */
     void* MapVertexBuffer(const GfxObject& object);
     /* Give back the data to the renderer that uploads it to the GPU */
     void UnmapVertexBuffer(const GfxObject& object);
+    void DestroyVertexBuffer(const GfxObject& object);
+
+    /* Creates an index buffer of count 16 or 32 bit indices, Map hands out count * GetIndexSize(format) bytes */
+    bool CreateIndexBuffer(GfxObject& object, uint32_t count, IndexFormat format);
+    void* MapIndexBuffer(const GfxObject& object);
+    void UnmapIndexBuffer(const GfxObject& object);
+    void DestroyIndexBuffer(const GfxObject& object);
+
+    /* Creates a 2D texture or texture array. data is empty or holds description.layers * description.mipLevels
+       pointers to tightly packed texels, all levels of the first layer, then of the next one. The texels are
+       copied before returning, uploads larger than the per frame budget are spread over several frames */
+    bool CreateTexture(GfxObject& object, const TextureDescription& description, const std::vector<void*>& data = {});
+    /* Replaces one level of one layer, data is copied before returning */
+    bool UpdateTexture(const GfxObject& object, uint32_t layer, uint32_t level, const void* data);
+    /* Frees the levels finer than level, or makes them resident again with undefined texels. Draws sample the
+       resident levels only, and only those that aren't waiting for texels to upload */
+    bool SetTextureFirstLevel(const GfxObject& object, uint32_t level);
+    void DestroyTexture(const GfxObject& object);
+    bool CreateSamplerState(GfxObject& object, const SamplerDescription& description);
+    void DestroySamplerState(const GfxObject& object);
 
     /* Creates a pipeline state resource - should contain shader, blendstate, depth state, rasterizer state */
-    bool CreatePipelineState(const GfxObject& object, const PipelineState& pipelineState) const;
-    /* Dispatch the rendering commands that covers one frame*/
-    void Render(const std::vector<RenderCommand>& commandBuffer) const;
+    bool CreatePipelineState(GfxObject& object, const PipelineState& pipelineState);
+    void DestroyPipelineState(const GfxObject& object);
+    /* Whether draws with the pipeline state are rendered, false until an asynchronous create has finished building it */
+    bool IsPipelineStateReady(const GfxObject& object) const;
+    /* Rebuilds a pipeline state with new shaders, asynchronously if pipelineState asks for it. Frames keep
+       drawing with the previous shaders until the new ones are built, or for good if building them fails.
+       False on backends that can't rebuild pipeline states */
+    bool UpdatePipelineState(const GfxObject& object, const PipelineState& pipelineState);
+    /* Dispatch the rendering commands that covers one frame. With threadedRendering the commands are copied
+       and rendered later, the call only waits for a free frame slot. Buffer updates recorded in the stream are
+       applied before the frame's first command, per-frame data should go there rather than through Map */
+    void Render(const CommandStream& commands) const;
+    /* Same as above, the commands are packed into a CommandStream owned by the engine first. The repacking
+       takes several times as long as the dispatch every frame, 16 to 24 ns per command against 3.6 to 3.8 ns
+       for dispatching the stream in benchmark_commandstream, record into a CommandStream instead */
+    [[deprecated("Record the frame into a CommandStream instead")]]
+    void Render(const std::vector<RenderCommand>& commandBuffer);
+    /* Sorts the queued draws by key and dispatches them with redundant binds removed. With instanceBatching
+       runs of the same mesh are drawn instanced from an engine owned instance buffer */
+    void Render(RenderQueue& queue);
+    /* Merges the streams recorded on worker threads in job order and dispatches them */
+    void Render(const ParallelCommandRecorder& recorder);
+    /* Waits until the render thread has submitted every queued frame, no-op without threadedRendering */
+    void Flush() const;
+    /* Issued and skipped state changes of the last rendered frame, and the ray tracer's throughput */
+    FrameStats GetFrameStats() const;
+    /* Copies the color buffer of the last rendered frame as RGBA8 texels, rows top to bottom. Waits for the
+       queued frames with threadedRendering. False if the backend can't read it back, the OpenGL one can't */
+    bool ReadColorBuffer(std::vector<uint32_t>& pixels, uint32_t& width, uint32_t& height) const;
+    /* False if the requested backend couldn't be set up. Every Create fails and nothing is rendered then */
+    bool IsInitialized() const { return m_renderer != nullptr; }
 
 private:
-    void _SetupRasterizer(const PlatformData& platformData, const BackendType& type);
+    void _SetupRasterizer(const PlatformData& platformData, const InitData& initData);
+    void _SetupRaytracer(const PlatformData& platformData);
+    /* Initializes the backend that was set up, and drops it if it can't run here */
+    void _Initialize(const RendererCaps& caps, const PlatformData& platformData);
+    /* Copies the data of every update command into its buffer, runs on the thread rendering the frame. Updates
+       past the end of the buffer they were created with are logged and skipped */
+    void _ApplyUpdates(const CommandStream& commands) const;
+    /* Runs task on the render thread if there is one, otherwise right away */
+    void _Execute(const std::function<void()>& task) const;
+    /* Logs and returns false for handles that were never created or already destroyed */
+    bool _IsAlive(const GfxObject& object, const char* operation) const;
+    /* Logs and returns false for layouts the backends can't set up */
+    bool _IsValid(const VertexLayout& layout) const;
+    /* Logs and returns false for textures without texels or with data for a different number of levels */
+    bool _IsValid(const TextureDescription& description, const std::vector<void*>& data) const;
+    /* Hands out a handle and frees it again if the renderer fails to create the resource */
+    bool _Create(GfxObject& object, const std::function<bool(const GfxObject&)>& create);
+    /* Grows the instance buffer to hold count instances, returns false if it couldn't be created */
+    bool _ReserveInstances(uint32_t count);
     std::unique_ptr<IRenderer> m_renderer;
+    std::unique_ptr<RenderThread> m_renderThread;
+    HandleAllocator m_handles;
+    HandleArray<uint64_t> m_bufferSizes; // Bytes of the constant and vertex buffers, used on the render thread only
+    CommandStream m_commandStream;
+
+    bool m_instanceBatching = false;
+    GfxObject m_instanceBuffer;
+    uint32_t m_instanceCapacity = 0;
+    std::vector<InstanceData> m_instances;
 };
 
 }  // namespace dw
@@ -0,0 +1,209 @@
+#pragma once
+
+#include "irenderer.h"
+#include "utils/logger.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace dw {
+
+// Payloads written inline into a CommandStream. Resources are stored by value so replaying a command
+// never leaves the stream.
+struct BindPipelineStateCommand {
+    GfxObject object;
+};
+
+struct BindVertexBufferCommand {
+    GfxObject object;
+};
+
+struct BindConstantBufferCommand {
+    GfxObject object;
+};
+
+struct BindIndexBufferCommand {
+    GfxObject object;
+};
+
+struct BindTexturesCommand {
+    static const uint32_t s_MAX_SLOTS = 8;
+
+    uint32_t startSlot;
+    uint32_t count;
+    GfxObject objects[s_MAX_SLOTS];
+
+    /* Whether startSlot and count stay within the slots, also checked when replaying hand written commands */
+    static bool IsRangeValid(uint32_t startSlot, uint32_t count) { return startSlot <= s_MAX_SLOTS && count <= s_MAX_SLOTS - startSlot; }
+};
+
+// Samplers are bound to the texture slots of the same number
+struct BindSamplersCommand {
+    uint32_t startSlot;
+    uint32_t count;
+    GfxObject objects[BindTexturesCommand::s_MAX_SLOTS];
+};
+
+struct DrawCommand {
+    uint32_t count;
+    uint32_t startVertex;
+};
+
+struct DrawIndexedCommand {
+    uint32_t count;
+    uint32_t startIndex;
+    int32_t baseVertex;
+};
+
+struct DrawInstancedCommand {
+    uint32_t count;
+    uint32_t startVertex;
+    uint32_t instanceCount;
+    uint32_t startInstance;
+    GfxObject instanceBuffer;
+};
+
+// Copies data into a buffer, the size bytes follow the payload in the stream. RenderEngine applies every
+// update of a frame before its first command runs, so a buffer holds one content per frame. discard leaves
+// the rest of a vertex buffer undefined, so data rewritten every frame doesn't wait for the previous frames.
+struct UpdateBufferCommand {
+    GfxObject object;
+    uint32_t offset;
+    uint32_t size;
+    bool discard;
+};
+
+// Linear stream of fixed-layout commands. Each command is a Header directly followed by its payload,
+// padded so every header and payload starts on an 8 byte boundary. The storage is kept between frames,
+// Reset only rewinds the write position.
+class CommandStream {
+public:
+    static const uint32_t s_ALIGNMENT = 8;
+
+    struct Header {
+        RenderCommandType type;
+        uint32_t size; // Bytes to the next header, payload and padding included
+    };
+    static_assert(sizeof(Header) % s_ALIGNMENT == 0, "Payloads must start aligned right after the header");
+
+    /* Writes a command with its payload copied inline and returns the stored payload. dataSize bytes of data
+       are copied after the payload, read them back with PayloadData */
+    template <typename T>
+    T& Write(RenderCommandType type, const T& payload, const void* data = nullptr, uint32_t dataSize = 0) {
+        static_assert(std::is_trivially_copyable<T>::value, "Command payloads are copied as raw bytes");
+        static_assert(alignof(T) <= s_ALIGNMENT, "Command payloads can't be aligned beyond s_ALIGNMENT");
+
+        const uint32_t size = static_cast<uint32_t>(sizeof(Header) + AlignUp(sizeof(T)) + AlignUp(dataSize));
+        uint8_t* command = allocate(size);
+        Header* header = reinterpret_cast<Header*>(command);
+        header->type = type;
+        header->size = size;
+        if (dataSize > 0) {
+            std::memcpy(command + sizeof(Header) + AlignUp(sizeof(T)), data, dataSize);
+        }
+        return *new (command + sizeof(Header)) T(payload);
+    }
+
+    void BindPipelineState(const GfxObject& object) { Write(BIND_PIPELINE_STATE, BindPipelineStateCommand{ object }); }
+    void BindVertexBuffer(const GfxObject& object) { Write(BIND_VERTEX_BUFFER, BindVertexBufferCommand{ object }); }
+    void BindConstantBuffer(const GfxObject& object) { Write(BIND_CONSTANT_BUFFER, BindConstantBufferCommand{ object }); }
+    void BindIndexBuffer(const GfxObject& object) { Write(BIND_INDEX_BUFFER, BindIndexBufferCommand{ object }); }
+    void BindTextures(uint32_t startSlot, const GfxObject* objects, uint32_t count) {
+        if (!BindTexturesCommand::IsRangeValid(startSlot, count)) {
+            LOGE("Binding " + std::to_string(count) + " textures from slot " + std::to_string(startSlot) + " goes past the last slot, dropping the bind");
+            return;
+        }
+        BindTexturesCommand& command = Write(BIND_TEXTURES, BindTexturesCommand{ startSlot, count, {} });
+        std::copy(objects, objects + count, command.objects);
+    }
+    void BindSamplers(uint32_t startSlot, const GfxObject* objects, uint32_t count) {
+        if (!BindTexturesCommand::IsRangeValid(startSlot, count)) {
+            LOGE("Binding " + std::to_string(count) + " samplers from slot " + std::to_string(startSlot) + " goes past the last slot, dropping the bind");
+            return;
+        }
+        BindSamplersCommand& command = Write(BIND_SAMPLERS, BindSamplersCommand{ startSlot, count, {} });
+        std::copy(objects, objects + count, command.objects);
+    }
+    void Draw(uint32_t count, uint32_t startVertex) { Write(DRAW, DrawCommand{ count, startVertex }); }
+    void DrawIndexed(uint32_t count, uint32_t startIndex, int32_t baseVertex = 0) { Write(DRAW_INDEXED, DrawIndexedCommand{ count, startIndex, baseVertex }); }
+    void DrawInstanced(uint32_t count, uint32_t startVertex, uint32_t instanceCount, uint32_t startInstance, const GfxObject& instanceBuffer) {
+        Write(DRAW_INSTANCED, DrawInstancedCommand{ count, startVertex, instanceCount, startInstance, instanceBuffer });
+    }
+    void UpdateConstantBuffer(const GfxObject& object, const void* data, uint32_t size, uint32_t offset = 0) {
+        Write(UPDATE_CONSTANT_BUFFER, UpdateBufferCommand{ object, offset, size, false }, data, size);
+    }
+    void UpdateVertexBuffer(const GfxObject& object, const void* data, uint32_t size, uint32_t offset = 0, bool discard = false) {
+        Write(UPDATE_VERTEX_BUFFER, UpdateBufferCommand{ object, offset, size, discard }, data, size);
+    }
+
+    /* Copies all commands of another stream to the end of this one */
+    void Append(const CommandStream& other) {
+        if (other.m_size == 0) {
+            return;
+        }
+        reserve(m_size + other.m_size);
+        std::copy(other.m_data.data(), other.m_data.data() + other.m_size, m_data.data() + m_size);
+        m_size += other.m_size;
+        m_commandCount += other.m_commandCount;
+    }
+
+    /* Forgets all commands but keeps the storage for the next frame */
+    void Reset() {
+        m_size = 0;
+        m_commandCount = 0;
+    }
+
+    /* Iteration: for (auto* command = stream.Begin(); command != stream.End(); command = CommandStream::Next(command)) */
+    const Header* Begin() const { return reinterpret_cast<const Header*>(m_data.data()); }
+    const Header* End() const { return reinterpret_cast<const Header*>(m_data.data() + m_size); }
+
+    static const Header* Next(const Header* header) {
+        return reinterpret_cast<const Header*>(reinterpret_cast<const uint8_t*>(header) + header->size);
+    }
+
+    template <typename T>
+    static const T& Payload(const Header* header) {
+        assert(header->size >= sizeof(Header) + sizeof(T) && "Command payload is smaller than the requested type");
+        return *reinterpret_cast<const T*>(reinterpret_cast<const uint8_t*>(header) + sizeof(Header));
+    }
+
+    /* Bytes written after a payload of type T */
+    template <typename T>
+    static const void* PayloadData(const Header* header) {
+        return reinterpret_cast<const uint8_t*>(header) + sizeof(Header) + AlignUp(sizeof(T));
+    }
+
+    uint32_t GetCommandCount() const { return m_commandCount; }
+    size_t GetSize() const { return m_size; }
+    size_t GetCapacity() const { return m_data.size(); }
+    bool IsEmpty() const { return m_size == 0; }
+
+    static size_t AlignUp(size_t size) { return (size + s_ALIGNMENT - 1) & ~static_cast<size_t>(s_ALIGNMENT - 1); }
+
+private:
+    void reserve(size_t size) {
+        if (size > m_data.size()) {
+            // Grow geometrically, std::vector storage is aligned for any fundamental type
+            m_data.resize(std::max(m_data.size() * 2, size));
+        }
+    }
+
+    uint8_t* allocate(uint32_t size) {
+        reserve(m_size + size);
+        uint8_t* command = m_data.data() + m_size;
+        m_size += size;
+        ++m_commandCount;
+        return command;
+    }
+
+    std::vector<uint8_t> m_data;
+    size_t m_size = 0;
+    uint32_t m_commandCount = 0;
+};
+
+} // namespace dw
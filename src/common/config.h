@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 namespace dw {
 
 enum BackendType {
@@ -7,7 +9,8 @@ enum BackendType {
     OPENGL,
     VULKAN,
     D3D11,
-    D3D12
+    D3D12,
+    SOFTWARE
 };
 
 enum RendererType {
@@ -17,11 +20,25 @@ enum RendererType {
 
 struct PlatformData {
     void* windowHandle = nullptr;
+    // Size of the offscreen framebuffer for backends without a window, 0 lets the backend decide
+    uint32_t width = 0;
+    uint32_t height = 0;
 };
 
 struct InitData {
     RendererType rendererType;
     BackendType backendType;
+    // Renderer calls run on an engine owned thread and Render returns without waiting for submission
+    bool threadedRendering = false;
+    // Frames that can be queued for the render thread before Render blocks
+    uint32_t frameQueueDepth = 2;
+    // Render(RenderQueue&) merges runs of draws that only differ in their instance data into instanced draws
+    bool instanceBatching = false;
+    // Directory where compiled shader programs are kept between runs to skip compiling them at the next start,
+    // null keeps them in memory only. Entries of other drivers or driver versions are ignored and replaced
+    const char* shaderCacheDirectory = nullptr;
+    // Texel bytes uploaded per frame at most, larger uploads are spread over several frames
+    uint32_t textureUploadBudget = 8 * 1024 * 1024;
 };
 
 } // namespace dw
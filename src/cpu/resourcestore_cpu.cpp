@@ -0,0 +1,132 @@
+#include "resourcestore_cpu.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <string>
+
+#include "utils/logger.h"
+#include "utils/vertexformat.h"
+
+namespace dw {
+
+bool ResourceStoreCPU::CreateConstantBuffer(const GfxObject& object, uint32_t size) {
+    LOGD("Creating constant buffer with size " + std::to_string(size));
+    m_constantBuffers.Insert(object, std::vector<float>((size + sizeof(float) - 1) / sizeof(float), 0.0f));
+    return true;
+}
+
+bool ResourceStoreCPU::CreateVertexBuffer(const GfxObject& object, uint32_t count, const VertexLayout& layout) {
+    VertexBuffer vertexBuffer;
+    vertexBuffer.vertices.resize(count * s_VERTEX_STRIDE, 0.0f);
+    if (layout != VertexLayout::Standard()) {
+        vertexBuffer.packed.resize(count * layout.stride, 0);
+    }
+    vertexBuffer.layout = layout;
+    vertexBuffer.count = count;
+    m_vertexBuffers.Insert(object, std::move(vertexBuffer));
+    return true;
+}
+
+bool ResourceStoreCPU::CreateIndexBuffer(const GfxObject& object, uint32_t count, IndexFormat format) {
+    IndexBuffer indexBuffer;
+    indexBuffer.data.resize(count * GetIndexSize(format));
+    indexBuffer.format = format;
+    m_indexBuffers.Insert(object, std::move(indexBuffer));
+    return true;
+}
+
+bool ResourceStoreCPU::CreatePipelineState(const GfxObject& object) {
+    m_pipelines.Insert(object, Pipeline());
+    return true;
+}
+
+void* ResourceStoreCPU::MapConstantBuffer(const GfxObject& object) {
+    auto* constBuffer = m_constantBuffers.Find(object);
+    assert(constBuffer && "Failed to find requested constant buffer");
+    return constBuffer->data();
+}
+
+void* ResourceStoreCPU::MapVertexBuffer(const GfxObject& object) {
+    auto* vertexBuffer = m_vertexBuffers.Find(object);
+    assert(vertexBuffer && "Failed to find requested vertex buffer");
+    return vertexBuffer->packed.empty() ? static_cast<void*>(vertexBuffer->vertices.data()) : vertexBuffer->packed.data();
+}
+
+void* ResourceStoreCPU::MapIndexBuffer(const GfxObject& object) {
+    auto* indexBuffer = m_indexBuffers.Find(object);
+    assert(indexBuffer && "Failed to find requested index buffer");
+    return indexBuffer->data.data();
+}
+
+void ResourceStoreCPU::UnmapVertexBuffer(const GfxObject& object) {
+    auto* vertexBuffer = m_vertexBuffers.Find(object);
+    assert(vertexBuffer && "Failed to find requested vertex buffer");
+    if (!vertexBuffer->packed.empty()) {
+        DecodeVertices(vertexBuffer->layout, vertexBuffer->packed.data(), vertexBuffer->count, vertexBuffer->vertices.data());
+    }
+}
+
+void ResourceStoreCPU::DestroyConstantBuffer(const GfxObject& object) {
+    m_constantBuffers.Erase(object);
+}
+
+void ResourceStoreCPU::DestroyVertexBuffer(const GfxObject& object) {
+    m_vertexBuffers.Erase(object);
+}
+
+void ResourceStoreCPU::DestroyIndexBuffer(const GfxObject& object) {
+    m_indexBuffers.Erase(object);
+}
+
+void ResourceStoreCPU::DestroyPipelineState(const GfxObject& object) {
+    m_pipelines.Erase(object);
+}
+
+void ResourceStoreCPU::ResetBindings() {
+    m_boundVertexBuffer = nullptr;
+    m_boundConstantBuffer = nullptr;
+    m_boundIndexBuffer = nullptr;
+    m_isPipelineStateBound = false;
+}
+
+void ResourceStoreCPU::BindConstantBuffer(const GfxObject& object) {
+    m_boundConstantBuffer = m_constantBuffers.Find(object);
+    assert(m_boundConstantBuffer && "Failed to find requested constant buffer");
+}
+
+void ResourceStoreCPU::BindVertexBuffer(const GfxObject& object) {
+    auto* vertexBuffer = m_vertexBuffers.Find(object);
+    assert(vertexBuffer && "Failed to find requested vertex buffer");
+    m_boundVertexBuffer = vertexBuffer ? &vertexBuffer->vertices : nullptr;
+}
+
+void ResourceStoreCPU::BindIndexBuffer(const GfxObject& object) {
+    m_boundIndexBuffer = m_indexBuffers.Find(object);
+    assert(m_boundIndexBuffer && "Failed to find requested index buffer");
+}
+
+void ResourceStoreCPU::BindPipelineState(const GfxObject& object) {
+    m_isPipelineStateBound = m_pipelines.Find(object) != nullptr;
+    assert(m_isPipelineStateBound && "Failed to find requested pipeline state");
+}
+
+uint32_t ResourceStoreCPU::ReadIndex(const IndexBuffer& indexBuffer, uint32_t index) {
+    if (indexBuffer.format == INDEX_FORMAT_UINT16) {
+        uint16_t value;
+        std::memcpy(&value, indexBuffer.data.data() + index * sizeof(uint16_t), sizeof(value));
+        return value;
+    }
+    uint32_t value;
+    std::memcpy(&value, indexBuffer.data.data() + index * sizeof(uint32_t), sizeof(value));
+    return value;
+}
+
+uint32_t PackColor(const Vec4& color) {
+    const auto toByte = [](float value) {
+        return static_cast<uint32_t>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+    };
+    return toByte(color.x) | (toByte(color.y) << 8) | (toByte(color.z) << 16) | (toByte(color.w) << 24);
+}
+
+}  // namespace dw
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "irenderer.h"
+#include "utils/handlepool.h"
+#include "utils/vecmath.h"
+#include <cstdint>
+#include <vector>
+
+namespace dw {
+
+// Resources of the CPU backends and what the command stream has bound of them. Draws read vertices in the
+// standard layout, { vec4 position; vec4 color; } like the OpenGL backend, buffers of other layouts are
+// written to a packed copy and expanded on Unmap. Pipeline states only have to exist to be bound, like
+// OpenGL without a program nothing is drawn without one.
+class ResourceStoreCPU {
+public:
+    static const uint32_t s_VERTEX_STRIDE = 8; // Floats per expanded vertex
+
+    struct VertexBuffer {
+        std::vector<float> vertices;
+        std::vector<uint8_t> packed;
+        VertexLayout layout;
+        uint32_t count = 0;
+    };
+
+    struct IndexBuffer {
+        std::vector<uint8_t> data;
+        IndexFormat format = INDEX_FORMAT_UINT16;
+    };
+
+    bool CreateConstantBuffer(const GfxObject& object, uint32_t size);
+    bool CreateVertexBuffer(const GfxObject& object, uint32_t count, const VertexLayout& layout);
+    bool CreateIndexBuffer(const GfxObject& object, uint32_t count, IndexFormat format);
+    bool CreatePipelineState(const GfxObject& object);
+
+    void* MapConstantBuffer(const GfxObject& object);
+    void* MapVertexBuffer(const GfxObject& object);
+    void* MapIndexBuffer(const GfxObject& object);
+    void UnmapVertexBuffer(const GfxObject& object);
+
+    void DestroyConstantBuffer(const GfxObject& object);
+    void DestroyVertexBuffer(const GfxObject& object);
+    void DestroyIndexBuffer(const GfxObject& object);
+    void DestroyPipelineState(const GfxObject& object);
+
+    /* Forgets the bound resources. Buffers may have been created or destroyed since the last frame, which
+       moves the storage around, so this has to run before every frame is replayed */
+    void ResetBindings();
+    void BindConstantBuffer(const GfxObject& object);
+    void BindVertexBuffer(const GfxObject& object);
+    void BindIndexBuffer(const GfxObject& object);
+    void BindPipelineState(const GfxObject& object);
+
+    /* Null if nothing is bound */
+    const std::vector<float>* GetBoundConstants() const { return m_boundConstantBuffer; }
+    const std::vector<float>* GetBoundVertices() const { return m_boundVertexBuffer; }
+    const IndexBuffer* GetBoundIndexBuffer() const { return m_boundIndexBuffer; }
+    bool IsPipelineStateBound() const { return m_isPipelineStateBound; }
+    /* Instance buffers are expanded like vertex buffers, offset from location 0 and color from location 1 */
+    const VertexBuffer* FindVertexBuffer(const GfxObject& object) const { return m_vertexBuffers.Find(object); }
+
+    static uint32_t ReadIndex(const IndexBuffer& indexBuffer, uint32_t index);
+
+private:
+    // Nothing the CPU backends read
+    struct Pipeline {};
+
+    HandleArray<VertexBuffer> m_vertexBuffers;
+    HandleArray<std::vector<float>> m_constantBuffers;
+    HandleArray<IndexBuffer> m_indexBuffers;
+    HandleArray<Pipeline> m_pipelines;
+    const std::vector<float>* m_boundVertexBuffer = nullptr;
+    const std::vector<float>* m_boundConstantBuffer = nullptr;
+    const IndexBuffer* m_boundIndexBuffer = nullptr;
+    bool m_isPipelineStateBound = false;
+};
+
+/* Texel of the RGBA8 color buffers of the CPU backends, channels clamped to [0, 1] */
+uint32_t PackColor(const Vec4& color);
+
+}  // namespace dw
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <vector>
 
 namespace dw {
@@ -11,7 +14,189 @@ enum RenderCommandType {
     BIND_INDEX_BUFFER,
     BIND_TEXTURES,
     BIND_SAMPLERS,
-    DRAW
+    DRAW,
+    DRAW_INSTANCED,
+    DRAW_INDEXED,
+    UPDATE_CONSTANT_BUFFER,
+    UPDATE_VERTEX_BUFFER
+};
+
+enum IndexFormat {
+    INDEX_FORMAT_UINT16,
+    INDEX_FORMAT_UINT32
+};
+
+inline uint32_t GetIndexSize(IndexFormat format) { return format == INDEX_FORMAT_UINT16 ? 2 : 4; }
+
+// Vertex attribute formats. NORM formats are integers read as floats in [0, 1] or [-1, 1], the 10:10:10:2 formats
+// pack x, y, z and w from the low bits up into a single 32 bit word. Attributes with fewer than four components
+// read 0 for the missing y and z and 1 for w.
+enum VertexFormat {
+    VERTEX_FORMAT_FLOAT2,
+    VERTEX_FORMAT_FLOAT3,
+    VERTEX_FORMAT_FLOAT4,
+    VERTEX_FORMAT_HALF2,
+    VERTEX_FORMAT_HALF4,
+    VERTEX_FORMAT_UNORM8X4,
+    VERTEX_FORMAT_SNORM8X4,
+    VERTEX_FORMAT_UNORM16X2,
+    VERTEX_FORMAT_UNORM16X4,
+    VERTEX_FORMAT_SNORM16X2,
+    VERTEX_FORMAT_SNORM16X4,
+    VERTEX_FORMAT_UNORM10_10_10_2,
+    VERTEX_FORMAT_SNORM10_10_10_2
+};
+
+inline uint32_t GetVertexFormatSize(VertexFormat format) {
+    switch (format) {
+        case VERTEX_FORMAT_FLOAT2: return 8;
+        case VERTEX_FORMAT_FLOAT3: return 12;
+        case VERTEX_FORMAT_FLOAT4: return 16;
+        case VERTEX_FORMAT_HALF4:
+        case VERTEX_FORMAT_UNORM16X4:
+        case VERTEX_FORMAT_SNORM16X4: return 8;
+        default: return 4;
+    }
+}
+
+struct VertexAttribute {
+    uint32_t location;
+    VertexFormat format;
+    uint32_t offset;
+};
+
+// Interleaved layout of the elements of a vertex buffer. The standard program reads the position from location 0
+// and the color from location 1, locations 2 and 3 are taken by the instance data.
+struct VertexLayout {
+    static const uint32_t s_MAX_ATTRIBUTES = 8;
+
+    VertexAttribute attributes[s_MAX_ATTRIBUTES] = {};
+    uint32_t attributeCount = 0;
+    uint32_t stride = 0;
+
+    /* Appends an attribute right after the previous one and grows the stride to match */
+    VertexLayout& Add(uint32_t location, VertexFormat format) {
+        if (attributeCount < s_MAX_ATTRIBUTES) {
+            attributes[attributeCount++] = { location, format, stride };
+            stride += GetVertexFormatSize(format);
+        }
+        return *this;
+    }
+
+    bool operator==(const VertexLayout& rhs) const {
+        if (attributeCount != rhs.attributeCount || stride != rhs.stride) {
+            return false;
+        }
+        for (uint32_t i = 0; i < attributeCount; ++i) {
+            const VertexAttribute& a = attributes[i];
+            const VertexAttribute& b = rhs.attributes[i];
+            if (a.location != b.location || a.format != b.format || a.offset != b.offset) {
+                return false;
+            }
+        }
+        return true;
+    }
+    bool operator!=(const VertexLayout& rhs) const { return !(*this == rhs); }
+
+    /* { vec4 position; vec4 color; }, 32 bytes. Also the layout of instance buffers */
+    static VertexLayout Standard() { return VertexLayout().Add(0, VERTEX_FORMAT_FLOAT4).Add(1, VERTEX_FORMAT_FLOAT4); }
+};
+
+// Texel formats, SRGB formats are decoded to linear when sampled. The BC formats are compressed in blocks of
+// 4x4 texels, BC1 and BC4 in 8 bytes and the others in 16. BC4 holds red only, BC5 red and green
+enum TextureFormat {
+    TEXTURE_FORMAT_R8,
+    TEXTURE_FORMAT_RG8,
+    TEXTURE_FORMAT_RGBA8,
+    TEXTURE_FORMAT_RGBA8_SRGB,
+    TEXTURE_FORMAT_RGBA16F,
+    TEXTURE_FORMAT_RGBA32F,
+    TEXTURE_FORMAT_BC1,
+    TEXTURE_FORMAT_BC1_SRGB,
+    TEXTURE_FORMAT_BC3,
+    TEXTURE_FORMAT_BC3_SRGB,
+    TEXTURE_FORMAT_BC7,
+    TEXTURE_FORMAT_BC7_SRGB,
+    TEXTURE_FORMAT_BC4,
+    TEXTURE_FORMAT_BC5
+};
+
+inline bool IsTextureFormatCompressed(TextureFormat format) {
+    return format >= TEXTURE_FORMAT_BC1;
+}
+
+/* Bytes of a texel, or of a block of compressed formats */
+inline uint32_t GetTextureFormatSize(TextureFormat format) {
+    switch (format) {
+        case TEXTURE_FORMAT_R8: return 1;
+        case TEXTURE_FORMAT_RG8: return 2;
+        case TEXTURE_FORMAT_RGBA16F: return 8;
+        case TEXTURE_FORMAT_RGBA32F: return 16;
+        case TEXTURE_FORMAT_BC1: return 8;
+        case TEXTURE_FORMAT_BC1_SRGB: return 8;
+        case TEXTURE_FORMAT_BC3: return 16;
+        case TEXTURE_FORMAT_BC3_SRGB: return 16;
+        case TEXTURE_FORMAT_BC7: return 16;
+        case TEXTURE_FORMAT_BC7_SRGB: return 16;
+        case TEXTURE_FORMAT_BC4: return 8;
+        case TEXTURE_FORMAT_BC5: return 16;
+        default: return 4;
+    }
+}
+
+/* Texels on a side of a block, 1 for uncompressed formats */
+inline uint32_t GetTextureFormatBlockExtent(TextureFormat format) {
+    return IsTextureFormatCompressed(format) ? 4 : 1;
+}
+
+/* Levels of a full mip chain down to 1x1 */
+inline uint32_t GetMipLevelCount(uint32_t width, uint32_t height) {
+    uint32_t levels = 1;
+    for (uint32_t size = width > height ? width : height; size > 1; size >>= 1) {
+        ++levels;
+    }
+    return levels;
+}
+
+inline uint32_t GetMipLevelSize(uint32_t size, uint32_t level) {
+    return (size >> level) > 0 ? size >> level : 1;
+}
+
+// 2D texture, or 2D texture array with more than one layer
+struct TextureDescription {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t layers = 1;
+    uint32_t mipLevels = 1;
+    TextureFormat format = TEXTURE_FORMAT_RGBA8;
+
+    /* Tightly packed bytes of one layer of a level, partial blocks at the edges take a whole block */
+    size_t GetLevelSize(uint32_t level) const {
+        const uint32_t extent = GetTextureFormatBlockExtent(format);
+        const size_t blocksX = (GetMipLevelSize(width, level) + extent - 1) / extent;
+        const size_t blocksY = (GetMipLevelSize(height, level) + extent - 1) / extent;
+        return blocksX * blocksY * GetTextureFormatSize(format);
+    }
+};
+
+enum SamplerFilter {
+    SAMPLER_FILTER_NEAREST,
+    SAMPLER_FILTER_LINEAR
+};
+
+enum SamplerAddressMode {
+    SAMPLER_ADDRESS_REPEAT,
+    SAMPLER_ADDRESS_MIRRORED_REPEAT,
+    SAMPLER_ADDRESS_CLAMP_TO_EDGE
+};
+
+struct SamplerDescription {
+    SamplerFilter minFilter = SAMPLER_FILTER_LINEAR;
+    SamplerFilter magFilter = SAMPLER_FILTER_LINEAR;
+    SamplerFilter mipFilter = SAMPLER_FILTER_LINEAR;
+    SamplerAddressMode addressU = SAMPLER_ADDRESS_REPEAT;
+    SamplerAddressMode addressV = SAMPLER_ADDRESS_REPEAT;
+    float maxAnisotropy = 1.0f; // Clamped to what the device supports, 1 turns anisotropic filtering off
 };
 
 // Handle for each renderer resource.
@@ -28,7 +213,7 @@ struct GfxObject {
     uint32_t id;
 };
 
-// Generic render command
+// Generic render command, see CommandStream for the packed form the renderers consume
 struct RenderCommand {
     RenderCommandType type;
     void* data;
@@ -47,37 +232,100 @@ struct BindPipelineStateCommandData {
     GfxObject* object;
 };
 
+struct BindIndexBufferCommandData {
+    GfxObject* object;
+};
+
+// Binds count textures or samplers to the consecutive slots from startSlot
+struct BindTexturesCommandData {
+    GfxObject* objects;
+    uint32_t count;
+    uint32_t startSlot;
+};
+
+struct BindSamplersCommandData {
+    GfxObject* objects;
+    uint32_t count;
+    uint32_t startSlot;
+};
+
 struct DrawCommandData {
     uint32_t count;
     uint32_t startVertex;
     // TODO: Topology
 };
 
+// Reads count indices from startIndex of the bound index buffer, baseVertex is added to every index
+struct DrawIndexedCommandData {
+    uint32_t count;
+    uint32_t startIndex;
+    int32_t baseVertex;
+};
+
+// instanceCount instances of the vertex range, instance i reads element startInstance + i of the instance buffer
+struct DrawInstancedCommandData {
+    uint32_t count;
+    uint32_t startVertex;
+    uint32_t instanceCount;
+    uint32_t startInstance;
+    GfxObject* instanceBuffer;
+};
+
+// Element of an instance buffer, which is a vertex buffer read once per instance at attribute locations 2
+// and 3. The standard program adds offset to the model space position and multiplies the vertex color.
+struct InstanceData {
+    float offset[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    float color[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+};
+
+// Per frame counters of the state changes a backend sent to the API and the redundant ones it dropped
+struct FrameStats {
+    uint32_t issuedCalls = 0;
+    uint32_t skippedCalls = 0;
+    uint32_t skippedDraws = 0; // Draws dropped because their pipeline state was still compiling
+    double megaRaysPerSecond = 0.0; // Rays the ray tracer traced per second during the frame, in millions
+};
+
 struct RendererCaps {
-    void* allocator;
-    bool debug;
+    void* allocator = nullptr;
+    bool debug = false;
+    const char* shaderCacheDirectory = nullptr; // See InitData
+    uint32_t textureUploadBudget = 0;           // See InitData
 };
 
 struct PlatformData;
 struct InitData;
-struct TextureDescription {};
-struct SamplerDescription {};
-// TODO: 
+class CommandStream;
+// Precompiled shader code for backends that don't take source, i.e SPIR-V for Vulkan
+struct ShaderBytecode {
+    const void* data = nullptr;
+    size_t size = 0;
+};
+
+// Shaders of a pipeline. OpenGL builds it from the GLSL sources, Vulkan from the SPIR-V bytecode and the CPU
+// backends, which only run the standard program, ignore both.
+// In GLSL, a sampler uniform named textureN reads the texture and sampler bound to slot N.
 struct PipelineState {
-    char* vertexShader;
-    char* fragmentShader;
+    const char* vertexShader = nullptr;
+    const char* fragmentShader = nullptr;
+    ShaderBytecode vertexBytecode;
+    ShaderBytecode fragmentBytecode;
+    // Create returns before the shaders are built, draws with the pipeline are skipped until it's ready
+    bool asynchronous = false;
 };
 
 class IRenderer {
 public:
     virtual ~IRenderer() = default;
 
-    virtual void Initialize(const RendererCaps& caps, const PlatformData& platformData) = 0;
+    /* Returns false if the backend can't run here, nothing else may be called on it then */
+    virtual bool Initialize(const RendererCaps& caps, const PlatformData& platformData) = 0;
 
     virtual bool CreateConstantBuffer(const GfxObject& object, uint32_t count) = 0;
-    virtual bool CreateVertexBuffer(const GfxObject& object, uint32_t count) = 0;
-    virtual bool CreateIndexBuffer(const GfxObject& object, uint32_t count) = 0;
+    virtual bool CreateVertexBuffer(const GfxObject& object, uint32_t count, const VertexLayout& layout) = 0;
+    virtual bool CreateIndexBuffer(const GfxObject& object, uint32_t count, IndexFormat format) = 0;
     virtual bool CreatePipelineState(const GfxObject& object, const PipelineState& state) = 0;
+    /* data holds the texels of every level of every layer, layer by layer, or is empty to leave them undefined */
     virtual bool CreateTexture(const GfxObject& object, const TextureDescription& description, const std::vector<void*>& data) = 0;
     virtual bool CreateSamplerState(const GfxObject& object, const SamplerDescription& description) = 0;
 
@@ -86,8 +334,18 @@ public:
     virtual void* MapIndexBuffer(const GfxObject& handle) = 0;
     virtual void UnmapConstantBuffer(const GfxObject& handle) = 0;
     virtual void UnmapVertexBuffer(const GfxObject& handle) = 0;
-    virtual void UnmapIndexBuffer(const GfxObject& handle, uint32_t count) = 0;
+    virtual void UnmapIndexBuffer(const GfxObject& handle) = 0;
+    /* Copies size bytes of data to offset. With discard the rest of the buffer is undefined afterwards, which lets
+       backends hand out fresh storage instead of waiting for queued draws that still read the buffer */
+    virtual void UpdateVertexBuffer(const GfxObject& handle, uint32_t offset, uint32_t size, const void* data, bool /*discard*/) {
+        uint8_t* mapped = static_cast<uint8_t*>(MapVertexBuffer(handle));
+        if (mapped) {
+            std::memcpy(mapped + offset, data, size);
+            UnmapVertexBuffer(handle);
+        }
+    }
 
+    virtual void DestroyConstantBuffer(const GfxObject& handle) = 0;
     virtual void DestroyVertexBuffer(const GfxObject& handle) = 0;
     virtual void DestroyIndexBuffer(const GfxObject& handle) = 0;
     virtual void DestroyTexture(const GfxObject& handle) = 0;
@@ -95,7 +353,23 @@ public:
     virtual void DestroySamplerState(const GfxObject& hanele) = 0;
 
     // Actual rendering commands that operate on updated and ready resources.
-    virtual void Render(const std::vector<RenderCommand>& commandBuffer) = 0;
+    virtual void Render(const CommandStream& commands) = 0;
+    /* False while an asynchronously created pipeline state is still being built, or if building it failed */
+    virtual bool IsPipelineStateReady(const GfxObject& /*object*/) { return true; }
+    /* Replaces the shaders of a pipeline state. The previous ones stay in use until the new ones are built,
+       backends that can't rebuild pipelines return false */
+    virtual bool UpdatePipelineState(const GfxObject& /*handle*/, const PipelineState& /*state*/) { return false; }
+    /* Replaces the texels of one level of one layer, data is copied before returning */
+    virtual bool UpdateTexture(const GfxObject& /*handle*/, uint32_t /*layer*/, uint32_t /*level*/, const void* /*data*/) { return false; }
+    /* Keeps the levels from level on and frees the finer ones, which can't be updated or sampled until the first
+       level is moved back. Levels that become resident again have undefined texels until they're updated */
+    virtual bool SetTextureFirstLevel(const GfxObject& /*handle*/, uint32_t /*level*/) { return false; }
+
+    // Counters since the start of the last Render, backends without state filtering report nothing
+    virtual FrameStats GetFrameStats() const { return {}; }
+    /* Copies the color buffer of the last rendered frame as RGBA8 texels, rows top to bottom. False on backends
+       that can't read it back */
+    virtual bool ReadColorBuffer(std::vector<uint32_t>& /*pixels*/, uint32_t& /*width*/, uint32_t& /*height*/) { return false; }
 };
 
 } // namespace dw
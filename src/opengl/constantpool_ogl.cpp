@@ -0,0 +1,128 @@
+#include "constantpool_ogl.h"
+#include "utils/logger.h"
+
+#include <algorithm>
+#include <cassert>
+#include <string>
+
+namespace {
+    const GLsizeiptr s_PAGE_SIZE = 64 * 1024;
+
+    GLintptr AlignUp(GLintptr value, GLintptr alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+namespace dw {
+
+ConstantPoolOGL::~ConstantPoolOGL() {
+    for (Page& page : m_pages) {
+        glDeleteBuffers(1, &page.buffer);
+    }
+}
+
+void ConstantPoolOGL::Initialize(GLintptr alignment) {
+    assert(alignment > 0 && "Invalid constant pool alignment");
+    m_alignment = alignment;
+}
+
+ConstantPoolOGL::Allocation ConstantPoolOGL::Allocate(GLsizeiptr size) {
+    const GLsizeiptr alignedSize = AlignUp(size, m_alignment);
+    Allocation allocation;
+    for (uint32_t pageIndex = 0; pageIndex < m_pages.size(); ++pageIndex) {
+        if (allocateFromPage(pageIndex, alignedSize, allocation)) {
+            allocation.size = size;
+            return allocation;
+        }
+    }
+
+    // Blocks larger than a page get a page of their own
+    Page page;
+    page.size = std::max(s_PAGE_SIZE, alignedSize);
+    page.freeRanges.push_back(Range{ 0, page.size });
+    page.shadow.resize(page.size);
+    glGenBuffers(1, &page.buffer);
+    if (!page.buffer) {
+        LOGE("Failed to create constant pool page of " + std::to_string(page.size) + " bytes");
+        return allocation;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, page.buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, page.size, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    LOGD("Created constant pool page " + std::to_string(m_pages.size()) + " of " + std::to_string(page.size) + " bytes");
+
+    m_pages.push_back(std::move(page));
+    const bool allocated = allocateFromPage(static_cast<uint32_t>(m_pages.size() - 1), alignedSize, allocation);
+    assert(allocated && "Fresh constant pool page too small");
+    (void)allocated;
+    allocation.size = size;
+    return allocation;
+}
+
+void ConstantPoolOGL::Free(const Allocation& allocation) {
+    assert(allocation.page < m_pages.size() && m_pages[allocation.page].buffer == allocation.buffer && "Freeing a block this pool didn't allocate");
+    std::vector<Range>& freeRanges = m_pages[allocation.page].freeRanges;
+    const Range range{ allocation.offset, AlignUp(allocation.size, m_alignment) };
+
+    auto next = std::lower_bound(freeRanges.begin(), freeRanges.end(), range.offset, [](const Range& free, GLintptr offset) {
+        return free.offset < offset;
+    });
+    auto inserted = freeRanges.insert(next, range);
+
+    // Merge with the following and then the preceding free range
+    auto following = inserted + 1;
+    if (following != freeRanges.end() && inserted->offset + inserted->size == following->offset) {
+        inserted->size += following->size;
+        freeRanges.erase(following);
+    }
+    if (inserted != freeRanges.begin()) {
+        auto preceding = inserted - 1;
+        if (preceding->offset + preceding->size == inserted->offset) {
+            preceding->size += inserted->size;
+            freeRanges.erase(inserted);
+        }
+    }
+}
+
+void ConstantPoolOGL::Upload(const Allocation& allocation, const void* data) {
+    assert(allocation.page < m_pages.size() && m_pages[allocation.page].buffer == allocation.buffer && "Uploading to a block this pool didn't allocate");
+    Page& page = m_pages[allocation.page];
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    std::copy(bytes, bytes + allocation.size, page.shadow.begin() + allocation.offset);
+    page.isDirty = true;
+}
+
+void ConstantPoolOGL::Flush() {
+    for (Page& page : m_pages) {
+        if (!page.isDirty) {
+            continue;
+        }
+        // A sub data write would have to wait for the queued draws reading the page, new storage doesn't
+        glBindBuffer(GL_COPY_WRITE_BUFFER, page.buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, page.size, page.shadow.data(), GL_DYNAMIC_DRAW);
+        page.isDirty = false;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+bool ConstantPoolOGL::allocateFromPage(uint32_t pageIndex, GLsizeiptr size, Allocation& allocation) {
+    Page& page = m_pages[pageIndex];
+    for (auto range = page.freeRanges.begin(); range != page.freeRanges.end(); ++range) {
+        if (range->size < size) {
+            continue;
+        }
+        allocation.buffer = page.buffer;
+        allocation.offset = range->offset;
+        allocation.page = pageIndex;
+
+        range->offset += size;
+        range->size -= size;
+        if (range->size == 0) {
+            page.freeRanges.erase(range);
+        }
+        return true;
+    }
+    return false;
+}
+
+}  // namespace dw
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#if defined(_WIN32)
+  #include <GL/glew.h>
+#elif defined(__APPLE__)
+  #include <OpenGL/gl3.h>
+  #include <OpenGL/glext.h>
+#elif defined(__linux__)
+  #include <GL/glew.h>
+#endif
+
+namespace dw {
+
+// Suballocates constant blocks from a few large uniform buffers instead of one buffer object per constant
+// buffer. Blocks start at multiples of GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT so they can be bound directly
+// with glBindBufferRange. Uploads only land in a CPU copy of their page, Flush then re-specifies every
+// written page as a whole. glBufferData orphans the old storage, so draws still queued keep reading the
+// previous contents instead of stalling or seeing the new ones. Pages are written through
+// GL_COPY_WRITE_BUFFER, which leaves the uniform buffer bindings alone, and are kept until the pool is destroyed.
+class ConstantPoolOGL {
+public:
+    struct Allocation {
+        GLuint buffer = 0;
+        GLintptr offset = 0;
+        GLsizeiptr size = 0;
+        uint32_t page = 0;
+    };
+
+    ~ConstantPoolOGL();
+
+    void Initialize(GLintptr alignment);
+
+    /* Returns an allocation with buffer 0 if no page could be created */
+    Allocation Allocate(GLsizeiptr size);
+    void Free(const Allocation& allocation);
+    /* Writes allocation.size bytes of data to the block, visible to draws issued after the next Flush */
+    void Upload(const Allocation& allocation, const void* data);
+    /* Re-specifies the pages written since the last call, once before each frame */
+    void Flush();
+
+    uint32_t GetPageCount() const { return static_cast<uint32_t>(m_pages.size()); }
+
+private:
+    struct Range {
+        GLintptr offset;
+        GLsizeiptr size;
+    };
+
+    // Free ranges are kept sorted by offset so neighbours can be merged on Free
+    struct Page {
+        GLuint buffer;
+        GLsizeiptr size;
+        std::vector<Range> freeRanges;
+        std::vector<uint8_t> shadow;
+        bool isDirty = false;
+    };
+
+    bool allocateFromPage(uint32_t pageIndex, GLsizeiptr size, Allocation& allocation);
+
+    std::vector<Page> m_pages;
+    GLintptr m_alignment = 256;
+};
+
+}  // namespace dw
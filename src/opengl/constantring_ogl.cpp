@@ -0,0 +1,122 @@
+#include "constantring_ogl.h"
+#include "utils/logger.h"
+
+#include <cassert>
+#include <cstring>
+#include <string>
+
+namespace {
+    const GLuint64 s_FENCE_TIMEOUT_NS = 1000000000; // Only used to log a warning, we keep waiting afterwards
+
+    GLintptr AlignUp(GLintptr value, GLintptr alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+namespace dw {
+
+bool ConstantRingOGL::IsSupported() {
+#if defined(__APPLE__)
+    return false; // macOS stops at GL 4.1
+#else
+    return GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+#endif
+}
+
+ConstantRingOGL::~ConstantRingOGL() {
+    destroyStorage();
+}
+
+bool ConstantRingOGL::Initialize(GLsizeiptr regionSize, GLintptr alignment) {
+    assert(alignment > 0 && "Invalid constant ring alignment");
+    m_alignment = alignment;
+    return createStorage(AlignUp(regionSize, m_alignment));
+}
+
+void ConstantRingOGL::BeginFrame() {
+    GLsync& fence = m_fences[m_region];
+    if (fence) {
+        // Normally long signaled, the GPU is at most s_NUM_REGIONS - 1 frames behind
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        while (result == GL_TIMEOUT_EXPIRED) {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, s_FENCE_TIMEOUT_NS);
+            if (result == GL_TIMEOUT_EXPIRED) {
+                LOGW("Still waiting for the GPU to release constant ring region " + std::to_string(m_region));
+            }
+        }
+        assert(result != GL_WAIT_FAILED && "Waiting on constant ring fence failed");
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+    m_offset = 0;
+    ++m_epoch;
+}
+
+bool ConstantRingOGL::Write(const void* data, GLsizeiptr size, GLintptr& offset) {
+    if (m_offset + size > m_regionSize) {
+        // Fresh storage has no pending GPU reads, so the frame simply continues at the start of the region
+        GLsizeiptr regionSize = m_regionSize * 2;
+        while (regionSize < size) {
+            regionSize *= 2;
+        }
+        LOGW("Constant ring region full, growing to " + std::to_string(regionSize) + " bytes");
+        if (!createStorage(regionSize)) {
+            return false;
+        }
+        ++m_epoch;
+    }
+
+    offset = m_region * m_regionSize + m_offset;
+    std::memcpy(m_mapped + offset, data, size);
+    m_offset = AlignUp(m_offset + size, m_alignment);
+    return true;
+}
+
+void ConstantRingOGL::EndFrame() {
+    assert(!m_fences[m_region] && "Constant ring region fenced twice");
+    m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_region = (m_region + 1) % s_NUM_REGIONS;
+}
+
+// The current storage is only replaced once the new one is mapped, a failed grow leaves the ring as it was
+bool ConstantRingOGL::createStorage(GLsizeiptr regionSize) {
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const GLsizeiptr totalSize = regionSize * s_NUM_REGIONS;
+
+    GLuint buffer = 0;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferStorage(GL_UNIFORM_BUFFER, totalSize, nullptr, flags);
+    uint8_t* mapped = static_cast<uint8_t*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, totalSize, flags));
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    if (!mapped) {
+        LOGE("Failed to persistently map constant ring of " + std::to_string(totalSize) + " bytes");
+        glDeleteBuffers(1, &buffer);
+        return false;
+    }
+    destroyStorage();
+    m_buffer = buffer;
+    m_mapped = mapped;
+    m_regionSize = regionSize;
+    m_offset = 0;
+    LOGD("Created constant ring with " + std::to_string(s_NUM_REGIONS) + " regions of " + std::to_string(regionSize) + " bytes");
+    return true;
+}
+
+void ConstantRingOGL::destroyStorage() {
+    for (GLsync& fence : m_fences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    if (m_buffer) {
+        // Deleting unmaps the buffer, GL keeps the storage alive until queued draws are done reading it
+        glDeleteBuffers(1, &m_buffer);
+        m_buffer = 0;
+        m_mapped = nullptr;
+    }
+}
+
+}  // namespace dw
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(_WIN32)
+  #include <GL/glew.h>
+#elif defined(__APPLE__)
+  #include <OpenGL/gl3.h>
+  #include <OpenGL/glext.h>
+#elif defined(__linux__)
+  #include <GL/glew.h>
+#endif
+
+namespace dw {
+
+// Uniform buffer created once with glBufferStorage and kept persistently and coherently mapped. It is
+// split into one region per frame in flight, a frame writes the constants it binds into its region and
+// the region is fenced when the frame is submitted. A region is only reused once its fence has signaled,
+// so writing never stalls on the GPU and costs no driver calls.
+// Offsets returned by Write stay valid until the epoch changes, which happens every frame and whenever
+// the storage had to grow. Growing replaces the buffer and leaves GL_UNIFORM_BUFFER bound to 0.
+class ConstantRingOGL {
+public:
+    /* True if the context has glBufferStorage (GL 4.4 or ARB_buffer_storage) */
+    static bool IsSupported();
+
+    ~ConstantRingOGL();
+
+    /* Creates the storage with regionSize bytes per frame, blocks are aligned to alignment */
+    bool Initialize(GLsizeiptr regionSize, GLintptr alignment);
+
+    /* Waits until the GPU is done with the region of this frame and rewinds it */
+    void BeginFrame();
+    /* Copies size bytes into the current region and writes their offset to offset. Grows the storage when the
+       region is full, returns false and keeps the current storage if that fails */
+    bool Write(const void* data, GLsizeiptr size, GLintptr& offset);
+    /* Fences the current region and moves on to the next one */
+    void EndFrame();
+
+    GLuint GetBuffer() const { return m_buffer; }
+    uint64_t GetEpoch() const { return m_epoch; }
+
+private:
+    static const uint32_t s_NUM_REGIONS = 3;
+
+    bool createStorage(GLsizeiptr regionSize);
+    void destroyStorage();
+
+    GLuint m_buffer = 0;
+    uint8_t* m_mapped = nullptr;
+    GLsizeiptr m_regionSize = 0;
+    GLintptr m_alignment = 256;
+    GLsync m_fences[s_NUM_REGIONS] = {};
+    uint32_t m_region = 0;
+    GLintptr m_offset = 0;
+    uint64_t m_epoch = 1;
+};
+
+}  // namespace dw
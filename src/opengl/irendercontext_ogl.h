@@ -1,11 +1,21 @@
 #pragma once
 
+#include <memory>
+
 namespace dw {
 
 class IRenderContextOGL {
 public:
     virtual ~IRenderContextOGL() = default;
     virtual void SwapBuffers() const = 0;
+    /* False if setting up the context failed, no GL function may be called then */
+    virtual bool IsValid() const { return true; }
+
+    /* Context sharing objects with this one, for use on another thread. Null where the platform can't create one */
+    virtual std::unique_ptr<IRenderContextOGL> CreateSharedContext() const { return nullptr; }
+    /* Binds the context to the calling thread, or unbinds whatever context it has */
+    virtual bool MakeCurrent() const { return false; }
+    virtual void ReleaseCurrent() const {}
 };
 
-} // namespace dw
\ No newline at end of file
+} // namespace dw
@@ -0,0 +1,230 @@
+#if defined(__linux__)
+
+#include "rendercontext_ogl_egl.h"
+#include "common/config.h"
+
+#include <GL/glew.h>
+#include <EGL/eglext.h>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    const uint32_t s_DEFAULT_WIDTH = 1024;
+    const uint32_t s_DEFAULT_HEIGHT = 768;
+
+    // Same version as the windows context
+    const EGLint s_CONTEXT_ATTRIBUTES[] = {
+        EGL_CONTEXT_MAJOR_VERSION,       4,
+        EGL_CONTEXT_MINOR_VERSION,       0,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+
+    bool HasExtension(const char* extensions, const char* extension) {
+        if (!extensions) {
+            return false;
+        }
+        const size_t length = std::strlen(extension);
+        for (const char* start = std::strstr(extensions, extension); start; start = std::strstr(start + length, extension)) {
+            if ((start == extensions || start[-1] == ' ') && (start[length] == ' ' || start[length] == '\0')) {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+namespace dw {
+
+RenderContextEGL::RenderContextEGL(const PlatformData& platformData) {
+    std::cout << "Direwolf: Setting up headless EGL render context\n";
+    m_width = platformData.width ? platformData.width : s_DEFAULT_WIDTH;
+    m_height = platformData.height ? platformData.height : s_DEFAULT_HEIGHT;
+
+    if (!createDisplay()) {
+        std::cerr << "DireWolf: Failed to initialize an EGL display" << std::endl;
+        return;
+    }
+
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        std::cerr << "DireWolf: EGL display does not support desktop OpenGL" << std::endl;
+        return;
+    }
+
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE,    m_isSurfaceless ? 0 : EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE,        8,
+        EGL_GREEN_SIZE,      8,
+        EGL_BLUE_SIZE,       8,
+        EGL_ALPHA_SIZE,      8,
+        EGL_DEPTH_SIZE,      24,
+        EGL_STENCIL_SIZE,    8,
+        EGL_NONE
+    };
+
+    EGLConfig config;
+    EGLint numConfigs = 0;
+    if (!eglChooseConfig(m_display, configAttributes, &config, 1, &numConfigs) || numConfigs == 0) {
+        std::cerr << "DireWolf: Failed to find a matching EGL config" << std::endl;
+        return;
+    }
+    m_config = config;
+
+    m_context = eglCreateContext(m_display, config, EGL_NO_CONTEXT, s_CONTEXT_ATTRIBUTES);
+    if (m_context == EGL_NO_CONTEXT) {
+        std::cerr << "DireWolf: Failed to initialize OpenGL Context" << std::endl;
+        return;
+    }
+
+    if (!m_isSurfaceless) {
+        const EGLint surfaceAttributes[] = {
+            EGL_WIDTH,  static_cast<EGLint>(m_width),
+            EGL_HEIGHT, static_cast<EGLint>(m_height),
+            EGL_NONE
+        };
+        m_surface = eglCreatePbufferSurface(m_display, config, surfaceAttributes);
+        if (m_surface == EGL_NO_SURFACE) {
+            std::cerr << "DireWolf: Failed to create pbuffer surface" << std::endl;
+            return;
+        }
+    }
+    if (!eglMakeCurrent(m_display, m_surface, m_surface, m_context)) {
+        std::cerr << "DireWolf: Failed to make the OpenGL context current" << std::endl;
+        return;
+    }
+
+    // GLEW only needs the context here, the GLX part of glewInit fails without an X display.
+    // With glvnd the entry points it resolves dispatch to whichever context is current, EGL included.
+    glewExperimental = GL_TRUE;
+    if (glewContextInit() != GLEW_OK) {
+        std::cerr << "DireWolf: Failed to initialize extensions" << std::endl;
+        return;
+    }
+
+    if (m_isSurfaceless && !createOffscreenFramebuffer()) {
+        std::cerr << "DireWolf: Offscreen framebuffer is incomplete" << std::endl;
+        return;
+    }
+    m_isValid = true;
+
+    auto vendorString = static_cast<const unsigned char*>(glGetString(GL_RENDERER));
+    auto versionString = static_cast<const unsigned char*>(glGetString(GL_VERSION));
+    std::cout << "DireWolf: Successfully set up " << (m_isSurfaceless ? "surfaceless" : "pbuffer") << " OpenGL context with GPU " << vendorString << std::endl;
+    std::cout << "DireWolf: Running OpenGL version " << versionString << std::endl;
+}
+
+RenderContextEGL::RenderContextEGL(const RenderContextEGL& mainContext, EGLContext context, EGLSurface surface)
+    : m_display(mainContext.m_display), m_config(mainContext.m_config), m_context(context), m_surface(surface),
+      m_isSurfaceless(mainContext.m_isSurfaceless), m_isShared(true), m_isValid(true) {}
+
+RenderContextEGL::~RenderContextEGL() {
+    if (m_isShared) {
+        // Must not be current on any thread anymore, the display belongs to the main context
+        if (m_surface != EGL_NO_SURFACE) {
+            eglDestroySurface(m_display, m_surface);
+        }
+        eglDestroyContext(m_display, m_context);
+        return;
+    }
+
+    if (m_framebuffer) {
+        glDeleteFramebuffers(1, &m_framebuffer);
+        glDeleteRenderbuffers(2, m_renderbuffers);
+    }
+
+    if (m_display != EGL_NO_DISPLAY) {
+        eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (m_surface != EGL_NO_SURFACE) {
+            eglDestroySurface(m_display, m_surface);
+        }
+        if (m_context != EGL_NO_CONTEXT) {
+            eglDestroyContext(m_display, m_context);
+        }
+        eglTerminate(m_display);
+    }
+}
+
+void RenderContextEGL::SwapBuffers() const {
+    if (m_isSurfaceless) {
+        // Nothing to present, just make sure the frame gets submitted
+        glFlush();
+    } else {
+        eglSwapBuffers(m_display, m_surface);
+    }
+}
+
+std::unique_ptr<IRenderContextOGL> RenderContextEGL::CreateSharedContext() const {
+    if (!m_isValid) {
+        return nullptr;
+    }
+    const EGLContext context = eglCreateContext(m_display, m_config, m_context, s_CONTEXT_ATTRIBUTES);
+    if (context == EGL_NO_CONTEXT) {
+        return nullptr;
+    }
+
+    EGLSurface surface = EGL_NO_SURFACE;
+    if (!m_isSurfaceless) {
+        const EGLint surfaceAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        surface = eglCreatePbufferSurface(m_display, m_config, surfaceAttributes);
+        if (surface == EGL_NO_SURFACE) {
+            eglDestroyContext(m_display, context);
+            return nullptr;
+        }
+    }
+    return std::unique_ptr<IRenderContextOGL>(new RenderContextEGL(*this, context, surface));
+}
+
+bool RenderContextEGL::MakeCurrent() const {
+    return eglMakeCurrent(m_display, m_surface, m_surface, m_context) == EGL_TRUE;
+}
+
+void RenderContextEGL::ReleaseCurrent() const {
+    eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+
+bool RenderContextEGL::createDisplay() {
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (HasExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+        auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (getPlatformDisplay) {
+            m_display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        }
+    }
+
+    EGLint major, minor;
+    if (m_display != EGL_NO_DISPLAY && eglInitialize(m_display, &major, &minor)) {
+        m_isSurfaceless = HasExtension(eglQueryString(m_display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+        if (m_isSurfaceless) {
+            return true;
+        }
+        eglTerminate(m_display);
+    }
+
+    m_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    return m_display != EGL_NO_DISPLAY && eglInitialize(m_display, &major, &minor);
+}
+
+bool RenderContextEGL::createOffscreenFramebuffer() {
+    glGenRenderbuffers(2, m_renderbuffers);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_renderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, m_width, m_height);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_renderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_width, m_height);
+
+    glGenFramebuffers(1, &m_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_renderbuffers[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_renderbuffers[1]);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        return false;
+    }
+
+    // There is no default framebuffer to take the size from
+    glViewport(0, 0, m_width, m_height);
+    return true;
+}
+
+}  // namespace dw
+
+#endif
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <EGL/egl.h>
+#include <cstdint>
+#include "opengl/irendercontext_ogl.h"
+
+namespace dw {
+
+struct PlatformData;
+
+// Headless context for Linux servers. Prefers a surfaceless Mesa display rendering into an offscreen
+// framebuffer object, and falls back to a pbuffer surface on the default display. Shared contexts only
+// render into a 1x1 pbuffer, if they need a surface at all, and leave the display to the main context.
+class RenderContextEGL final : public IRenderContextOGL {
+public:
+    RenderContextEGL(const PlatformData& platformData);
+
+    virtual ~RenderContextEGL() override;
+    virtual void SwapBuffers() const override;
+    virtual bool IsValid() const override { return m_isValid; }
+
+    virtual std::unique_ptr<IRenderContextOGL> CreateSharedContext() const override;
+    virtual bool MakeCurrent() const override;
+    virtual void ReleaseCurrent() const override;
+
+private:
+    RenderContextEGL(const RenderContextEGL& mainContext, EGLContext context, EGLSurface surface);
+
+    bool createDisplay();
+    bool createOffscreenFramebuffer();
+
+    EGLDisplay m_display = EGL_NO_DISPLAY;
+    EGLConfig m_config = nullptr;
+    EGLContext m_context = EGL_NO_CONTEXT;
+    EGLSurface m_surface = EGL_NO_SURFACE;
+    bool m_isSurfaceless = false;
+    bool m_isShared = false;
+    bool m_isValid = false;
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    uint32_t m_framebuffer = 0;
+    uint32_t m_renderbuffers[2] = {};
+};
+
+}  // namespace dw
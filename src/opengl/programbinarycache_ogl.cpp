@@ -0,0 +1,178 @@
+#include "programbinarycache_ogl.h"
+#include "utils/hash.h"
+#include "utils/logger.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace dw {
+
+namespace {
+    const uint32_t s_FILE_MAGIC = 0x42505744; // "DWPB"
+    const uint32_t s_FILE_VERSION = 2;
+
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t driverHash;
+        uint64_t sourceHash;
+        uint64_t binaryHash; // Catches truncated or half written files
+        uint32_t binaryFormat;
+        uint32_t binarySize;
+        float buildMilliseconds;
+        uint32_t sourceSize; // The sources follow the binary
+    };
+
+    uint64_t HashString(const GLubyte* string, uint64_t hash) {
+        const char* text = string ? reinterpret_cast<const char*>(string) : "";
+        return HashFnv1a(text, std::char_traits<char>::length(text) + 1, hash);
+    }
+}
+
+bool ProgramBinaryCacheOGL::IsSupported() {
+#if defined(__APPLE__)
+    const bool hasProgramBinary = true; // Core in 4.1, but usually without any binary format
+#else
+    const bool hasProgramBinary = GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary;
+#endif
+    if (!hasProgramBinary) {
+        return false;
+    }
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    return formatCount > 0;
+}
+
+bool ProgramBinaryCacheOGL::Initialize(const char* directory) {
+    if (!directory || !*directory) {
+        return false;
+    }
+    if (!IsSupported()) {
+        LOGW("Program binaries aren't supported by the driver, the program cache stays in memory");
+        return false;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        LOGW("Can't create the program cache directory " + std::string(directory) + ": " + error.message());
+        return false;
+    }
+
+    uint64_t driverHash = s_FNV1A_OFFSET_BASIS;
+    driverHash = HashString(glGetString(GL_VENDOR), driverHash);
+    driverHash = HashString(glGetString(GL_RENDERER), driverHash);
+    driverHash = HashString(glGetString(GL_VERSION), driverHash);
+    m_driverHash = driverHash;
+    m_directory = directory;
+    LOGI("Caching program binaries in " + m_directory);
+    return true;
+}
+
+GLuint ProgramBinaryCacheOGL::Load(uint64_t hash, const std::string& sources) {
+    if (!IsEnabled()) {
+        return 0;
+    }
+    const auto start = std::chrono::steady_clock::now();
+
+    std::ifstream file(getPath(hash), std::ios::binary | std::ios::ate);
+    const std::streamoff fileSize = file ? static_cast<std::streamoff>(file.tellg()) : 0;
+    file.seekg(0);
+    FileHeader header = {};
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != s_FILE_MAGIC || header.version != s_FILE_VERSION ||
+        header.driverHash != m_driverHash || header.sourceHash != hash || header.sourceSize != sources.size()) {
+        ++m_stats.misses;
+        return 0;
+    }
+    // The size comes from disk, a corrupt one mustn't turn into a huge allocation
+    if (header.binarySize > fileSize - static_cast<std::streamoff>(sizeof(header) + header.sourceSize)) {
+        ++m_stats.misses;
+        return 0;
+    }
+    std::vector<char> binary(header.binarySize);
+    std::string entrySources(header.sourceSize, '\0');
+    if (!file.read(binary.data(), binary.size()) || HashFnv1a(binary.data(), binary.size()) != header.binaryHash
+        || !file.read(&entrySources[0], entrySources.size()) || entrySources != sources) {
+        ++m_stats.misses;
+        return 0;
+    }
+
+    const GLuint program = glCreateProgram();
+    glProgramBinary(program, header.binaryFormat, binary.data(), static_cast<GLsizei>(binary.size()));
+    GLint status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE) {
+        // An unknown format raises GL_INVALID_ENUM, don't leave it for the next error check
+        while (glGetError() != GL_NO_ERROR) {}
+        LOGW("Driver rejected the cached program " + getPath(hash) + ", compiling from source");
+        glDeleteProgram(program);
+        ++m_stats.rejected;
+        return 0;
+    }
+
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    ++m_stats.hits;
+    m_stats.loadMilliseconds += elapsed.count();
+    m_stats.savedMilliseconds += header.buildMilliseconds - elapsed.count();
+    return program;
+}
+
+// Written to a temporary file first, so a crash or a second instance never leaves a torn entry behind
+void ProgramBinaryCacheOGL::Store(uint64_t hash, const std::string& sources, GLuint program, double buildMilliseconds) const {
+    if (!IsEnabled()) {
+        return;
+    }
+
+    GLint size = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+    if (size <= 0) {
+        return;
+    }
+    std::vector<char> binary(size);
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program, size, &written, &format, binary.data());
+    if (written <= 0) {
+        return;
+    }
+    binary.resize(written);
+
+    FileHeader header = {};
+    header.magic = s_FILE_MAGIC;
+    header.version = s_FILE_VERSION;
+    header.driverHash = m_driverHash;
+    header.sourceHash = hash;
+    header.binaryHash = HashFnv1a(binary.data(), binary.size());
+    header.binaryFormat = format;
+    header.binarySize = static_cast<uint32_t>(binary.size());
+    header.buildMilliseconds = static_cast<float>(buildMilliseconds);
+    header.sourceSize = static_cast<uint32_t>(sources.size());
+
+    const std::string path = getPath(hash);
+    const std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), binary.size());
+        file.write(sources.data(), sources.size());
+        if (!file) {
+            LOGW("Failed to write the program cache entry " + temporaryPath);
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error) {
+        std::filesystem::remove(temporaryPath, error);
+    }
+}
+
+std::string ProgramBinaryCacheOGL::getPath(uint64_t hash) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(hash));
+    return (std::filesystem::path(m_directory) / name).string();
+}
+
+}  // namespace dw
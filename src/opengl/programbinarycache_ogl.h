@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#if defined(_WIN32)
+  #include <GL/glew.h>
+#elif defined(__APPLE__)
+  #include <OpenGL/gl3.h>
+  #include <OpenGL/glext.h>
+#elif defined(__linux__)
+  #include <GL/glew.h>
+#endif
+
+namespace dw {
+
+// Keeps linked programs on disk as glGetProgramBinary blobs, one file per source hash. Every file records
+// the driver it was made by (vendor, renderer and version), entries of another driver count as misses and
+// are overwritten by the next Store. The driver may still refuse a binary it made itself, e.g. after an
+// update that kept the version string, so Load has to be followed by a compile from source when it fails.
+// The hash alone could collide, every file also keeps the sources and an entry only hits if they match.
+class ProgramBinaryCacheOGL {
+public:
+    struct Stats {
+        uint32_t hits = 0;
+        uint32_t misses = 0;   // No entry, or one of another driver or other sources
+        uint32_t rejected = 0; // Entries the driver refused
+        double loadMilliseconds = 0.0;
+        // Build time recorded in the entries that were hit minus the time it took to load them
+        double savedMilliseconds = 0.0;
+    };
+
+    /* True if the context can retrieve program binaries (GL 4.1 or ARB_get_program_binary) in some format */
+    static bool IsSupported();
+
+    /* Creates directory if needed. Returns false and leaves the cache disabled if it can't be used */
+    bool Initialize(const char* directory);
+    bool IsEnabled() const { return !m_directory.empty(); }
+
+    /* Returns a linked program made from the entry of hash, 0 on a miss or if the driver rejected it. sources is
+       what the program is built from, see ProgramCacheOGL::JoinSources */
+    GLuint Load(uint64_t hash, const std::string& sources);
+    /* Writes the binary of a program linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT. buildMilliseconds is what
+       compiling and linking cost, a later hit is credited with it */
+    void Store(uint64_t hash, const std::string& sources, GLuint program, double buildMilliseconds) const;
+
+    const Stats& GetStats() const { return m_stats; }
+
+private:
+    std::string getPath(uint64_t hash) const;
+
+    std::string m_directory;
+    uint64_t m_driverHash = 0;
+    Stats m_stats;
+};
+
+}  // namespace dw
@@ -0,0 +1,172 @@
+#include "programcache_ogl.h"
+#include "utils/hash.h"
+#include "utils/logger.h"
+
+#include <cassert>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace dw {
+
+ProgramCacheOGL::~ProgramCacheOGL() {
+    if (m_binaryCache.IsEnabled()) {
+        const ProgramBinaryCacheOGL::Stats& stats = m_binaryCache.GetStats();
+        const uint32_t lookups = stats.hits + stats.misses + stats.rejected;
+        LOGI("Program binary cache: " + std::to_string(stats.hits) + " of " + std::to_string(lookups) + " programs loaded from disk ("
+             + std::to_string(stats.rejected) + " rejected) in " + std::to_string(stats.loadMilliseconds) + " ms, "
+             + std::to_string(stats.savedMilliseconds) + " ms faster than compiling");
+    }
+    for (auto& entry : m_programs) {
+        glDeleteProgram(entry.second.program);
+    }
+}
+
+void ProgramCacheOGL::Initialize(const IRenderContextOGL& context, GLuint constantBufferSlot, const char* binaryCacheDirectory) {
+    m_constantBufferSlot = constantBufferSlot;
+    m_binaryCache.Initialize(binaryCacheDirectory);
+    m_compiler.Initialize(context, m_binaryCache.IsEnabled());
+}
+
+// The terminating zero of the vertex source is hashed as well, so moving text between the stages changes the hash
+uint64_t ProgramCacheOGL::Hash(const char* vertexSource, const char* fragmentSource) {
+    const uint64_t hash = HashFnv1a(vertexSource, std::strlen(vertexSource) + 1);
+    return HashFnv1a(fragmentSource, std::strlen(fragmentSource), hash);
+}
+
+std::string ProgramCacheOGL::JoinSources(const char* vertexSource, const char* fragmentSource) {
+    std::string sources(vertexSource);
+    sources.push_back('\0');
+    sources.append(fragmentSource);
+    return sources;
+}
+
+bool ProgramCacheOGL::Acquire(uint64_t hash, const char* vertexSource, const char* fragmentSource, bool asynchronous) {
+    std::string sources = JoinSources(vertexSource, fragmentSource);
+    auto it = m_programs.find(hash);
+    if (it != m_programs.end()) {
+        if (it->second.sources != sources) {
+            LOGE("Shader sources collide with the hash of a cached program, can't build them");
+            return false;
+        }
+        if (it->second.status == PROGRAM_FAILED) {
+            return false;
+        }
+        ++it->second.references;
+        return true;
+    }
+
+    Program program;
+    program.references = 1;
+    GLuint linked = m_binaryCache.Load(hash, sources);
+    program.sources = std::move(sources);
+    if (!linked && asynchronous) {
+        m_compiler.Submit(hash, vertexSource, fragmentSource);
+        m_programs.emplace(hash, std::move(program));
+        return true;
+    }
+    if (!linked) {
+        const auto start = std::chrono::steady_clock::now();
+        linked = ShaderCompilerOGL::Build(vertexSource, fragmentSource, m_binaryCache.IsEnabled());
+        if (!linked) {
+            return false;
+        }
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        m_binaryCache.Store(hash, program.sources, linked, elapsed.count());
+    }
+    setReady(program, linked);
+    m_programs.emplace(hash, std::move(program));
+    return true;
+}
+
+bool ProgramCacheOGL::Release(uint64_t hash) {
+    auto it = m_programs.find(hash);
+    assert(it != m_programs.end() && "Releasing a program that isn't in the cache");
+    if (it == m_programs.end() || --it->second.references > 0 || it->second.status == PROGRAM_BUILDING) {
+        return false;
+    }
+    const GLuint program = it->second.program;
+    glDeleteProgram(program);
+    m_programs.erase(it);
+    return program != 0;
+}
+
+GLuint ProgramCacheOGL::GetProgram(uint64_t hash) const {
+    auto it = m_programs.find(hash);
+    return it != m_programs.end() ? it->second.program : 0;
+}
+
+bool ProgramCacheOGL::HasFailed(uint64_t hash) const {
+    auto it = m_programs.find(hash);
+    return it != m_programs.end() && it->second.status == PROGRAM_FAILED;
+}
+
+void ProgramCacheOGL::Update() {
+    m_finished.clear();
+    m_compiler.Poll(m_finished);
+    for (const ShaderCompilerOGL::Result& result : m_finished) {
+        auto it = m_programs.find(result.hash);
+        assert(it != m_programs.end() && "Finished build of a program that isn't in the cache");
+        Program& program = it->second;
+        if (result.program) {
+            m_binaryCache.Store(result.hash, program.sources, result.program, result.buildMilliseconds);
+            setReady(program, result.program);
+        } else {
+            program.status = PROGRAM_FAILED;
+        }
+
+        // Every pipeline using it was destroyed while it was being built
+        if (program.references == 0) {
+            glDeleteProgram(program.program);
+            m_programs.erase(it);
+        }
+    }
+}
+
+// Uniform block bindings aren't part of a program binary, they're reset by glProgramBinary like by a link
+void ProgramCacheOGL::setReady(Program& program, GLuint linked) const {
+    // Programs without constants don't have the block
+    const GLuint blockIndex = glGetUniformBlockIndex(linked, "ShaderConstants");
+    if (blockIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(linked, blockIndex, m_constantBufferSlot);
+    }
+    bindSamplerUnits(linked);
+    program.program = linked;
+    program.status = PROGRAM_READY;
+    LOGD("Program " + std::to_string(linked) + " ready, " + std::to_string(m_programs.size()) + " in the cache");
+}
+
+// Sampler uniforms named textureN read from texture slot N, like the block binding the units aren't part of a binary
+void ProgramCacheOGL::bindSamplerUnits(GLuint linked) const {
+    GLint uniformCount = 0;
+    glGetProgramiv(linked, GL_ACTIVE_UNIFORMS, &uniformCount);
+    GLint previous = 0;
+    bool bound = false;
+    for (GLint i = 0; i < uniformCount; ++i) {
+        char name[64];
+        GLint size = 0;
+        GLenum type = GL_NONE;
+        glGetActiveUniform(linked, static_cast<GLuint>(i), sizeof(name), nullptr, &size, &type, name);
+        if (type != GL_SAMPLER_2D && type != GL_SAMPLER_2D_ARRAY) {
+            continue;
+        }
+        if (std::strncmp(name, "texture", 7) != 0 || !std::isdigit(static_cast<unsigned char>(name[7]))) {
+            LOGW("Sampler " + std::string(name) + " isn't named textureN, it reads from slot 0");
+            continue;
+        }
+        // glProgramUniform needs GL 4.1, the program is made current for the call instead
+        if (!bound) {
+            glGetIntegerv(GL_CURRENT_PROGRAM, &previous);
+            glUseProgram(linked);
+            bound = true;
+        }
+        glUniform1i(glGetUniformLocation(linked, name), std::atoi(name + 7));
+    }
+    if (bound) {
+        glUseProgram(static_cast<GLuint>(previous));
+    }
+}
+
+}  // namespace dw
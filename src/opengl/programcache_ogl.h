@@ -0,0 +1,81 @@
+#pragma once
+
+#include "opengl/irendercontext_ogl.h"
+#include "opengl/programbinarycache_ogl.h"
+#include "opengl/shadercompiler_ogl.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_WIN32)
+  #include <GL/glew.h>
+#elif defined(__APPLE__)
+  #include <OpenGL/gl3.h>
+  #include <OpenGL/glext.h>
+#elif defined(__linux__)
+  #include <GL/glew.h>
+#endif
+
+namespace dw {
+
+// Compiles and links each distinct vertex/fragment source pair once. Programs are keyed by a hash of both
+// sources, pipeline states with the same shaders share one program, which is reference counted and deleted
+// with the last of them. Each program keeps its sources, so a hash collision fails the build instead of
+// handing out the program of other shaders. The ShaderConstants block of every program is bound to the constant buffer slot and
+// sampler uniforms named textureN to texture slot N.
+// With a binary cache directory, programs are loaded from their binaries of an earlier run when possible
+// and the binaries of newly compiled ones are saved. Asynchronous builds go through the ShaderCompilerOGL
+// and only show up in GetProgram once Update found them done.
+class ProgramCacheOGL {
+public:
+    ~ProgramCacheOGL();
+
+    /* binaryCacheDirectory may be null to only cache in memory */
+    void Initialize(const IRenderContextOGL& context, GLuint constantBufferSlot, const char* binaryCacheDirectory);
+
+    static uint64_t Hash(const char* vertexSource, const char* fragmentSource);
+    /* Both sources in one string, the zero between them keeps text moved across the stages apart */
+    static std::string JoinSources(const char* vertexSource, const char* fragmentSource);
+    /* Adds a reference to the program of hash, building it from the sources on first use. Returns false if the
+       build failed, or an earlier one of the same sources did. Synchronous builds are done on return, unless an
+       asynchronous build of the same sources is still running */
+    bool Acquire(uint64_t hash, const char* vertexSource, const char* fragmentSource, bool asynchronous);
+    /* Returns true if that was the last reference and a linked program was deleted */
+    bool Release(uint64_t hash);
+    /* The linked program, 0 while it's still being built or if building it failed */
+    GLuint GetProgram(uint64_t hash) const;
+    bool HasFailed(uint64_t hash) const;
+    /* Picks up the asynchronous builds that finished, called once per frame and when polling a pipeline */
+    void Update();
+
+    uint32_t GetProgramCount() const { return static_cast<uint32_t>(m_programs.size()); }
+    ShaderCompilerOGL::Mode GetCompilerMode() const { return m_compiler.GetMode(); }
+    const ProgramBinaryCacheOGL::Stats& GetBinaryCacheStats() const { return m_binaryCache.GetStats(); }
+
+private:
+    enum ProgramStatus {
+        PROGRAM_BUILDING,
+        PROGRAM_READY,
+        PROGRAM_FAILED
+    };
+
+    // Building programs stay in the map without references, Update deletes them once they are done
+    struct Program {
+        GLuint program = 0;
+        uint32_t references = 0;
+        ProgramStatus status = PROGRAM_BUILDING;
+        std::string sources; // Compared on every hit, the key is only a hash
+    };
+
+    void setReady(Program& program, GLuint linked) const;
+    void bindSamplerUnits(GLuint linked) const;
+
+    std::unordered_map<uint64_t, Program> m_programs;
+    ProgramBinaryCacheOGL m_binaryCache;
+    ShaderCompilerOGL m_compiler;
+    std::vector<ShaderCompilerOGL::Result> m_finished; // Reused by Update
+    GLuint m_constantBufferSlot = 0;
+};
+
+}  // namespace dw
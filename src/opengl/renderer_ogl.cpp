@@ -6,22 +6,142 @@
   #include "platform/rendercontext_ogl_win.h"
 #elif defined(__APPLE__)
   #include "platform/rendercontext_ogl_osx.h"
+#elif defined(__linux__)
+  #include "platform/rendercontext_ogl_egl.h"
 #endif
 
 #include <string>
 #include <iostream>
 #include <vector>
+#include <algorithm>
+#include <cstring>
 #include <cassert>
 
-// TODO: I just put stuff here meanwhile
-#include "opengl_utils.h"
 #include "utils/logger.h"
 
 #define BUFFER_OFFSET(i) (static_cast<uint8_t*>(nullptr) + i)
 
 namespace {
-    GLuint s_HARDCODED_PROGRAM_REMOVE_ME;
     GLuint s_BUFFER_SLOT = 1; // Arbitrary, per constant buffer
+    const GLsizeiptr s_CONSTANT_RING_REGION_SIZE = 64 * 1024; // Grows on demand
+    const GLuint s_INSTANCE_OFFSET_LOCATION = 2;
+    const GLuint s_INSTANCE_COLOR_LOCATION = 3;
+    const GLsizei s_INSTANCE_STRIDE = sizeof(dw::InstanceData);
+
+    struct AttributeFormat {
+        GLint size;
+        GLenum type;
+        GLboolean normalized;
+    };
+
+    // Before GL 4.2 snorm attributes are converted with (2c + 1) / (2^b - 1), which is off by half a step from the
+    // max(c / (2^(b-1) - 1), -1) the other backends use
+    AttributeFormat GetAttributeFormat(dw::VertexFormat format) {
+        switch (format) {
+            case dw::VERTEX_FORMAT_FLOAT2: return { 2, GL_FLOAT, GL_FALSE };
+            case dw::VERTEX_FORMAT_FLOAT3: return { 3, GL_FLOAT, GL_FALSE };
+            case dw::VERTEX_FORMAT_FLOAT4: return { 4, GL_FLOAT, GL_FALSE };
+            case dw::VERTEX_FORMAT_HALF2: return { 2, GL_HALF_FLOAT, GL_FALSE };
+            case dw::VERTEX_FORMAT_HALF4: return { 4, GL_HALF_FLOAT, GL_FALSE };
+            case dw::VERTEX_FORMAT_UNORM8X4: return { 4, GL_UNSIGNED_BYTE, GL_TRUE };
+            case dw::VERTEX_FORMAT_SNORM8X4: return { 4, GL_BYTE, GL_TRUE };
+            case dw::VERTEX_FORMAT_UNORM16X2: return { 2, GL_UNSIGNED_SHORT, GL_TRUE };
+            case dw::VERTEX_FORMAT_UNORM16X4: return { 4, GL_UNSIGNED_SHORT, GL_TRUE };
+            case dw::VERTEX_FORMAT_SNORM16X2: return { 2, GL_SHORT, GL_TRUE };
+            case dw::VERTEX_FORMAT_SNORM16X4: return { 4, GL_SHORT, GL_TRUE };
+            case dw::VERTEX_FORMAT_UNORM10_10_10_2: return { 4, GL_UNSIGNED_INT_2_10_10_10_REV, GL_TRUE };
+            case dw::VERTEX_FORMAT_SNORM10_10_10_2: return { 4, GL_INT_2_10_10_10_REV, GL_TRUE };
+        }
+        return { 4, GL_FLOAT, GL_FALSE };
+    }
+
+    // Compressed formats have neither format nor type, their texels go to the driver as they are
+    struct GLTextureFormat {
+        GLenum internalFormat;
+        GLenum format;
+        GLenum type;
+    };
+
+    GLTextureFormat GetTextureFormat(dw::TextureFormat format) {
+        switch (format) {
+            case dw::TEXTURE_FORMAT_R8: return { GL_R8, GL_RED, GL_UNSIGNED_BYTE };
+            case dw::TEXTURE_FORMAT_RG8: return { GL_RG8, GL_RG, GL_UNSIGNED_BYTE };
+            case dw::TEXTURE_FORMAT_RGBA8: return { GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE };
+            case dw::TEXTURE_FORMAT_RGBA8_SRGB: return { GL_SRGB8_ALPHA8, GL_RGBA, GL_UNSIGNED_BYTE };
+            case dw::TEXTURE_FORMAT_RGBA16F: return { GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT };
+            case dw::TEXTURE_FORMAT_RGBA32F: return { GL_RGBA32F, GL_RGBA, GL_FLOAT };
+            case dw::TEXTURE_FORMAT_BC1: return { GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, GL_NONE, GL_NONE };
+            case dw::TEXTURE_FORMAT_BC1_SRGB: return { GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT, GL_NONE, GL_NONE };
+            case dw::TEXTURE_FORMAT_BC3: return { GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, GL_NONE, GL_NONE };
+            case dw::TEXTURE_FORMAT_BC3_SRGB: return { GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT, GL_NONE, GL_NONE };
+            case dw::TEXTURE_FORMAT_BC7: return { GL_COMPRESSED_RGBA_BPTC_UNORM, GL_NONE, GL_NONE };
+            case dw::TEXTURE_FORMAT_BC7_SRGB: return { GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM, GL_NONE, GL_NONE };
+            case dw::TEXTURE_FORMAT_BC4: return { GL_COMPRESSED_RED_RGTC1, GL_NONE, GL_NONE };
+            case dw::TEXTURE_FORMAT_BC5: return { GL_COMPRESSED_RG_RGTC2, GL_NONE, GL_NONE };
+        }
+        return { GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE };
+    }
+
+    // S3TC never made it into core, macOS has it but stops short of BPTC. RGTC is core since 3.0
+    bool IsTextureFormatSupported(dw::TextureFormat format) {
+#if defined(__APPLE__)
+        return format != dw::TEXTURE_FORMAT_BC7 && format != dw::TEXTURE_FORMAT_BC7_SRGB;
+#else
+        switch (format) {
+            case dw::TEXTURE_FORMAT_BC1:
+            case dw::TEXTURE_FORMAT_BC3:
+                return GLEW_EXT_texture_compression_s3tc;
+            case dw::TEXTURE_FORMAT_BC1_SRGB:
+            case dw::TEXTURE_FORMAT_BC3_SRGB:
+                return GLEW_EXT_texture_compression_s3tc && GLEW_EXT_texture_sRGB;
+            case dw::TEXTURE_FORMAT_BC7:
+            case dw::TEXTURE_FORMAT_BC7_SRGB:
+                return GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc;
+            default:
+                return true;
+        }
+#endif
+    }
+
+    bool IsTextureStorageSupported() {
+#if defined(__APPLE__)
+        return false; // macOS stops at GL 4.1
+#else
+        return GLEW_VERSION_4_2 || GLEW_ARB_texture_storage;
+#endif
+    }
+
+    bool IsCopyImageSupported() {
+#if defined(__APPLE__)
+        return false;
+#else
+        return GLEW_VERSION_4_3 || GLEW_ARB_copy_image;
+#endif
+    }
+
+    bool IsAnisotropicFilteringSupported() {
+#if defined(__APPLE__)
+        return true;
+#else
+        return GLEW_EXT_texture_filter_anisotropic || GLEW_ARB_texture_filter_anisotropic;
+#endif
+    }
+
+    GLint GetMinFilter(const dw::SamplerDescription& description) {
+        if (description.minFilter == dw::SAMPLER_FILTER_NEAREST) {
+            return description.mipFilter == dw::SAMPLER_FILTER_NEAREST ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST_MIPMAP_LINEAR;
+        }
+        return description.mipFilter == dw::SAMPLER_FILTER_NEAREST ? GL_LINEAR_MIPMAP_NEAREST : GL_LINEAR_MIPMAP_LINEAR;
+    }
+
+    GLint GetAddressMode(dw::SamplerAddressMode mode) {
+        switch (mode) {
+            case dw::SAMPLER_ADDRESS_REPEAT: return GL_REPEAT;
+            case dw::SAMPLER_ADDRESS_MIRRORED_REPEAT: return GL_MIRRORED_REPEAT;
+            case dw::SAMPLER_ADDRESS_CLAMP_TO_EDGE: return GL_CLAMP_TO_EDGE;
+        }
+        return GL_REPEAT;
+    }
 
     void CheckOpenGLError(const char *stmt, const char *fname, int line) {
         GLenum err = glGetError();
@@ -47,7 +167,7 @@ namespace {
 
 namespace dw {
 
-void RendererOGL::Initialize(const RendererCaps& caps, const PlatformData& platformData) {
+bool RendererOGL::Initialize(const RendererCaps& caps, const PlatformData& platformData) {
     LOGD("Initializing OpenGL Renderer");
 
     // Initialize render context
@@ -55,10 +175,14 @@ void RendererOGL::Initialize(const RendererCaps& caps, const PlatformData& platf
     m_renderContext = std::make_unique<RenderContextWin>(platformData);
 #elif defined(__APPLE__)
     m_renderContext = std::make_unique<RenderContextOSX>(platformData);
+#elif defined(__linux__)
+    m_renderContext = std::make_unique<RenderContextEGL>(platformData);
 #endif
-
-    // Load all static resources
-    s_HARDCODED_PROGRAM_REMOVE_ME = opengl::utils::LoadShader("../../examples/example_spinning_cube/standard.vertex", "../../examples/example_spinning_cube/standard.fragment");
+    if (!m_renderContext->IsValid()) {
+        LOGE("Failed to create an OpenGL context");
+        m_renderContext.reset();
+        return false;
+    }
 
     // Enable depth test
     glEnable(GL_DEPTH_TEST);
@@ -66,129 +190,872 @@ void RendererOGL::Initialize(const RendererCaps& caps, const PlatformData& platf
     glDepthFunc(GL_LESS);
     glClearColor(0.0f, 0.0f, 0.4f, 0.0f); // Display ugly green color
 
-    const uint8_t blockIndex = glGetUniformBlockIndex(s_HARDCODED_PROGRAM_REMOVE_ME, "ShaderConstants");
-    GL_CHECK(glUniformBlockBinding(s_HARDCODED_PROGRAM_REMOVE_ME, blockIndex, s_BUFFER_SLOT));
+    m_programCache.Initialize(*m_renderContext, s_BUFFER_SLOT, caps.shaderCacheDirectory);
 
-    // TODO: Part of creating the pipeline state
-    GL_CHECK(glUseProgram(s_HARDCODED_PROGRAM_REMOVE_ME));
+    GLint alignment = 0;
+    GL_CHECK(glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment));
+    alignment = std::max(alignment, 1);
+    if (ConstantRingOGL::IsSupported()) {
+        m_useConstantRing = m_constantRing.Initialize(s_CONSTANT_RING_REGION_SIZE, alignment);
+    }
+    if (!m_useConstantRing) {
+        LOGW("ARB_buffer_storage not available, constant pool pages are re-specified in frames after they were written");
+        m_constantPool.Initialize(alignment);
+    }
+    if (!m_textureUploader.Initialize(caps.textureUploadBudget)) {
+        LOGW("Texture uploads go straight from client memory");
+    }
+    return true;
 }
 
 bool RendererOGL::CreateConstantBuffer(const GfxObject& object, uint32_t size) {
-    GLuint constantBuffer;
-    GL_CHECK(glGenBuffers(1, &constantBuffer));
-    LOGD("Creating constant buffer with id " + std::to_string(constantBuffer) + " and size " + std::to_string(size));
+    ConstantBuffer constantBuffer;
+    constantBuffer.data.resize(size);
+    if (!m_useConstantRing) {
+        constantBuffer.block = m_constantPool.Allocate(size);
+        if (!constantBuffer.block.buffer) {
+            return false;
+        }
+    }
+    LOGD("Creating constant buffer with size " + std::to_string(size));
 
-    GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, constantBuffer));
-    GL_CHECK(glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW));
-    m_constantBuffers.emplace(object, constantBuffer);
+    m_constantBuffers.Insert(object, std::move(constantBuffer));
     return true;
 }
 
-// TODO: How to handle vertex layout? Right now only support single float4:position/color
-bool RendererOGL::CreateVertexBuffer(const GfxObject& object, uint32_t count) {
+bool RendererOGL::CreateVertexBuffer(const GfxObject& object, uint32_t count, const VertexLayout& layout) {
     GLuint vao;
     GL_CHECK(glGenVertexArrays(1, &vao));
-    GL_CHECK(glBindVertexArray(vao));
+    bindVertexArray(vao);
 
-    const uint32_t elementSize = 4 * sizeof(float) * 2; // TODO/hack. This is an assumption, i.e size of each struct { vec4 position; vec4 color; }
-    const uint32_t byteSize = count * elementSize;
+    const uint32_t byteSize = count * layout.stride;
 
     GLuint vertexBuffer;
     GL_CHECK(glGenBuffers(1, &vertexBuffer));
-    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer));
+    bindArrayBuffer(vertexBuffer);
     GL_CHECK(glBufferData(GL_ARRAY_BUFFER, byteSize, nullptr, GL_STATIC_DRAW));
 
-    GL_CHECK(glEnableVertexAttribArray(0));
-    GL_CHECK(glEnableVertexAttribArray(1));
-    GL_CHECK(glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, elementSize, BUFFER_OFFSET(0)));
-    GL_CHECK(glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, elementSize, BUFFER_OFFSET(sizeof(float) * 4)));
+    for (uint32_t i = 0; i < layout.attributeCount; ++i) {
+        const VertexAttribute& attribute = layout.attributes[i];
+        const AttributeFormat format = GetAttributeFormat(attribute.format);
+        GL_CHECK(glEnableVertexAttribArray(attribute.location));
+        GL_CHECK(glVertexAttribPointer(attribute.location, format.size, format.type, format.normalized, layout.stride, BUFFER_OFFSET(attribute.offset)));
+    }
+    GL_CHECK(glVertexAttribDivisor(s_INSTANCE_OFFSET_LOCATION, 1));
+    GL_CHECK(glVertexAttribDivisor(s_INSTANCE_COLOR_LOCATION, 1));
 
-    m_vertexBuffers.emplace(object, vertexBuffer);
+    VertexBuffer buffer;
+    buffer.vertexArray = vao;
+    buffer.buffer = vertexBuffer;
+    buffer.size = byteSize;
+    m_vertexBuffers.Insert(object, buffer);
     return true;
 }
 
+// Index buffers are created and written through GL_COPY_WRITE_BUFFER, binding GL_ELEMENT_ARRAY_BUFFER would
+// change the element buffer of whatever VAO is bound
+bool RendererOGL::CreateIndexBuffer(const GfxObject& object, uint32_t count, IndexFormat format) {
+    IndexBuffer indexBuffer;
+    indexBuffer.format = format;
+    GL_CHECK(glGenBuffers(1, &indexBuffer.buffer));
+    GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer.buffer));
+    GL_CHECK(glBufferData(GL_COPY_WRITE_BUFFER, count * GetIndexSize(format), nullptr, GL_STATIC_DRAW));
+    GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+    m_indexBuffers.Insert(object, indexBuffer);
+    return true;
+}
+
+void* RendererOGL::MapIndexBuffer(const GfxObject& object) {
+    auto* indexBuffer = m_indexBuffers.Find(object);
+    assert(indexBuffer && "Failed to find requested index buffer");
+    GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer->buffer));
+    return glMapBuffer(GL_COPY_WRITE_BUFFER, GL_WRITE_ONLY);
+}
+
+void RendererOGL::UnmapIndexBuffer(const GfxObject& object) {
+    auto* indexBuffer = m_indexBuffers.Find(object);
+    assert(indexBuffer && "Failed to find requested index buffer");
+    GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer->buffer));
+    GL_CHECK(glUnmapBuffer(GL_COPY_WRITE_BUFFER));
+    GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+}
+
+void RendererOGL::DestroyIndexBuffer(const GfxObject& object) {
+    auto* indexBuffer = m_indexBuffers.Find(object);
+    assert(indexBuffer && "Destroying unknown or already destroyed index buffer");
+    if (!indexBuffer) {
+        return;
+    }
+
+    // VAOs other than the bound one keep the storage alive under a name that may be reused
+    m_vertexBuffers.ForEach([deleted = indexBuffer->buffer](VertexBuffer& mesh) {
+        if (mesh.indexBuffer == deleted) {
+            mesh.indexBuffer = 0;
+        }
+    });
+    GL_CHECK(glDeleteBuffers(1, &indexBuffer->buffer));
+    if (m_stateCache.indexBufferObject == object) {
+        m_stateCache.indexBufferObject = GfxObject();
+    }
+    m_indexBuffers.Erase(object);
+}
+
 void* RendererOGL::MapConstantBuffer(const GfxObject& object) {
-    const auto constBufferIt = m_constantBuffers.find(object);
-    //LOGD("Mapping const buffer with id " + std::to_string(constBufferIt->second));
-    assert(constBufferIt != m_constantBuffers.end() && "Failed to find requested constant buffer");
-    GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, constBufferIt->second));
-    void* mappedBuffer = glMapBuffer(GL_UNIFORM_BUFFER, GL_WRITE_ONLY);
-    return mappedBuffer;
+    auto* constBuffer = m_constantBuffers.Find(object);
+    assert(constBuffer && "Failed to find requested constant buffer");
+    return constBuffer->data.data();
 }
 
 void RendererOGL::UnmapConstantBuffer(const GfxObject& object) {
-    const auto constBufferIt = m_constantBuffers.find(object);
-    //LOGD("Unmapping const buffer with id " + std::to_string(constBufferIt->second));
-    assert(constBufferIt != m_constantBuffers.end() && "Failed to find requested constant buffer");
-    GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, constBufferIt->second));
-    GL_CHECK(glUnmapBuffer(GL_UNIFORM_BUFFER));
+    auto* constBuffer = m_constantBuffers.Find(object);
+    assert(constBuffer && "Failed to find requested constant buffer");
+    if (m_useConstantRing) {
+        return; // Picked up by the next bind
+    }
+
+    m_constantPool.Upload(constBuffer->block, constBuffer->data.data());
 }
 
 void* RendererOGL::MapVertexBuffer(const GfxObject& object) {
     LOGD("Mapping vertex buffer");
-    const auto vertexBufferIt = m_vertexBuffers.find(object);
-    assert(vertexBufferIt != m_vertexBuffers.end() && "Failed to find requested vertex buffer");
-    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vertexBufferIt->second));
+    auto* vertexBuffer = m_vertexBuffers.Find(object);
+    assert(vertexBuffer && "Failed to find requested vertex buffer");
+    bindArrayBuffer(vertexBuffer->buffer);
     void *result = glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
     return result;
 }
 
 void RendererOGL::UnmapVertexBuffer(const GfxObject& object) {
     LOGD("Unmapping vertex buffer");
-    const auto vertexBufferIt = m_vertexBuffers.find(object);
-    assert(vertexBufferIt != m_vertexBuffers.end() && "Failed to find requested vertex buffer");
-    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vertexBufferIt->second));
+    auto* vertexBuffer = m_vertexBuffers.Find(object);
+    assert(vertexBuffer && "Failed to find requested vertex buffer");
+    bindArrayBuffer(vertexBuffer->buffer);
     GL_CHECK(glUnmapBuffer(GL_ARRAY_BUFFER));
 }
 
+// Mapping or writing a buffer that queued draws still read waits for them. A discarding update orphans the storage
+// instead, the buffer switches to GL_STREAM_DRAW since it's rewritten every frame from then on. Other updates
+// invalidate their range, which drivers serve from a staging copy rather than a sync point.
+void RendererOGL::UpdateVertexBuffer(const GfxObject& object, uint32_t offset, uint32_t size, const void* data, bool discard) {
+    auto* vertexBuffer = m_vertexBuffers.Find(object);
+    assert(vertexBuffer && offset + size <= vertexBuffer->size && "Updating past the end of the vertex buffer");
+    if (!vertexBuffer || size == 0) {
+        return;
+    }
+    bindArrayBuffer(vertexBuffer->buffer);
+    if (discard) {
+        GL_CHECK(glBufferData(GL_ARRAY_BUFFER, vertexBuffer->size, nullptr, GL_STREAM_DRAW));
+        GL_CHECK(glBufferSubData(GL_ARRAY_BUFFER, offset, size, data));
+        return;
+    }
+    void* mapped = glMapBufferRange(GL_ARRAY_BUFFER, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+    if (mapped) {
+        std::memcpy(mapped, data, size);
+        GL_CHECK(glUnmapBuffer(GL_ARRAY_BUFFER));
+    }
+}
+
+void RendererOGL::DestroyConstantBuffer(const GfxObject& object) {
+    auto* constBuffer = m_constantBuffers.Find(object);
+    assert(constBuffer && "Destroying unknown or already destroyed constant buffer");
+    if (!constBuffer) {
+        return;
+    }
+
+    for (uint32_t slot = 0; slot < s_MAX_UNIFORM_BUFFER_SLOTS; ++slot) {
+        if (m_stateCache.constantBufferObjects[slot] == object) {
+            m_stateCache.constantBufferObjects[slot] = GfxObject();
+        }
+    }
+
+    // The pool page stays alive and bound, a later block at the same offset is bound with its own size
+    if (constBuffer->block.buffer) {
+        m_constantPool.Free(constBuffer->block);
+    }
+    m_constantBuffers.Erase(object);
+}
+
+void RendererOGL::DestroyVertexBuffer(const GfxObject& object) {
+    auto* vertexBuffer = m_vertexBuffers.Find(object);
+    assert(vertexBuffer && "Destroying unknown or already destroyed vertex buffer");
+    if (!vertexBuffer) {
+        return;
+    }
+
+    // VAOs still reading it as instance data keep the storage alive, but the name may be reused
+    m_vertexBuffers.ForEach([deleted = vertexBuffer->buffer](VertexBuffer& mesh) {
+        if (mesh.instanceBuffer == deleted) {
+            mesh.startInstance = UINT32_MAX;
+        }
+    });
+
+    GL_CHECK(glDeleteVertexArrays(1, &vertexBuffer->vertexArray));
+    GL_CHECK(glDeleteBuffers(1, &vertexBuffer->buffer));
+    if (m_stateCache.vertexArray == vertexBuffer->vertexArray) {
+        m_stateCache.vertexArray = 0;
+        m_stateCache.vertexBufferObject = GfxObject();
+    }
+    if (m_stateCache.arrayBuffer == vertexBuffer->buffer) {
+        m_stateCache.arrayBuffer = 0;
+    }
+    m_vertexBuffers.Erase(object);
+}
+
 bool RendererOGL::CreatePipelineState(const GfxObject& object, const PipelineState& pipelineState) {
-    // TODO: Create program state here which includes the shader
-    return false;
+    if (!pipelineState.vertexShader || !pipelineState.fragmentShader) {
+        LOGE("OpenGL pipelines need GLSL source in vertexShader and fragmentShader");
+        return false;
+    }
+
+    Pipeline pipeline;
+    pipeline.programHash = ProgramCacheOGL::Hash(pipelineState.vertexShader, pipelineState.fragmentShader);
+    if (!m_programCache.Acquire(pipeline.programHash, pipelineState.vertexShader, pipelineState.fragmentShader, pipelineState.asynchronous)) {
+        return false;
+    }
+    pipeline.program = m_programCache.GetProgram(pipeline.programHash);
+    m_pipelines.Insert(object, pipeline);
+    return true;
+}
+
+// Immutable storage where available, so the driver can skip completeness checks. Levels are allocated up front and
+// filled by the uploader
+bool RendererOGL::CreateTexture(const GfxObject& object, const TextureDescription& description, const std::vector<void*>& data) {
+    if (!IsTextureFormatSupported(description.format)) {
+        LOGE("Texture format " + std::to_string(description.format) + " isn't supported by this device");
+        return false;
+    }
+
+    Texture texture;
+    texture.target = description.layers > 1 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+    texture.description = description;
+    allocateTexture(texture);
+    LOGD("Creating " + std::to_string(description.width) + "x" + std::to_string(description.height) + " texture with "
+         + std::to_string(description.layers) + " layers and " + std::to_string(description.mipLevels) + " levels");
+
+    m_textures.Insert(object, texture);
+    for (size_t i = 0; i < data.size(); ++i) {
+        UpdateTexture(object, static_cast<uint32_t>(i / description.mipLevels), static_cast<uint32_t>(i % description.mipLevels), data[i]);
+    }
+    return true;
+}
+
+bool RendererOGL::UpdateTexture(const GfxObject& object, uint32_t layer, uint32_t level, const void* data) {
+    auto* texture = m_textures.Find(object);
+    assert(texture && "Failed to find requested texture");
+    if (!texture || !data || layer >= texture->description.layers || level >= texture->description.mipLevels) {
+        return false;
+    }
+    if (level < texture->firstLevel) {
+        LOGW("Level " + std::to_string(level) + " of texture isn't resident, the first one is " + std::to_string(texture->firstLevel));
+        return false;
+    }
+
+    const TextureDescription& description = texture->description;
+    const GLTextureFormat format = GetTextureFormat(description.format);
+    TextureUploaderOGL::Destination destination;
+    destination.texture = texture->texture;
+    destination.target = texture->target;
+    destination.layer = layer;
+    destination.level = level - texture->storageLevel;
+    destination.width = GetMipLevelSize(description.width, level);
+    destination.height = GetMipLevelSize(description.height, level);
+    destination.format = format.format;
+    destination.type = format.type;
+    destination.compressedFormat = IsTextureFormatCompressed(description.format) ? format.internalFormat : GL_NONE;
+    destination.pixelSize = GetTextureFormatSize(description.format);
+    activeTexture(TextureUploaderOGL::s_TEXTURE_UNIT);
+    m_textureUploader.Enqueue(destination, data);
+    updateBaseLevel(*texture);
+    return true;
+}
+
+// Storage of the levels that stay resident is copied into a texture of the new size, which replaces the old one.
+// Without copy_image there's no way to keep the levels on the GPU, the storage stays and only sampling is limited
+bool RendererOGL::SetTextureFirstLevel(const GfxObject& object, uint32_t level) {
+    auto* texture = m_textures.Find(object);
+    assert(texture && "Failed to find requested texture");
+    if (!texture || level >= texture->description.mipLevels) {
+        return false;
+    }
+    if (level == texture->firstLevel) {
+        return true;
+    }
+    if (!IsCopyImageSupported()) {
+        texture->firstLevel = level;
+        updateBaseLevel(*texture);
+        return true;
+    }
+
+    const Texture previous = *texture;
+    texture->firstLevel = level;
+    texture->storageLevel = level;
+    allocateTexture(*texture);
+    const TextureDescription& description = texture->description;
+    for (uint32_t copied = std::max(level, previous.firstLevel); copied < description.mipLevels; ++copied) {
+        GL_CHECK(glCopyImageSubData(previous.texture, previous.target, copied - previous.storageLevel, 0, 0, 0,
+                                    texture->texture, texture->target, copied - level, 0, 0, 0,
+                                    GetMipLevelSize(description.width, copied), GetMipLevelSize(description.height, copied), description.layers));
+    }
+    // Bands of levels still in the queue go to the new texture, the copies above already hold the ones issued
+    m_textureUploader.Move(previous.texture, texture->texture, static_cast<int32_t>(previous.storageLevel) - static_cast<int32_t>(level));
+    unbindTexture(previous.texture);
+    GL_CHECK(glDeleteTextures(1, &previous.texture));
+    updateBaseLevel(*texture);
+    return true;
+}
+
+void RendererOGL::DestroyTexture(const GfxObject& object) {
+    auto* texture = m_textures.Find(object);
+    assert(texture && "Destroying unknown or already destroyed texture");
+    if (!texture) {
+        return;
+    }
+
+    // Deleting unbinds the texture from every unit, its name may be handed out again
+    m_textureUploader.Cancel(texture->texture);
+    GL_CHECK(glDeleteTextures(1, &texture->texture));
+    unbindTexture(texture->texture);
+    m_textures.Erase(object);
+}
+
+bool RendererOGL::CreateSamplerState(const GfxObject& object, const SamplerDescription& description) {
+    GLuint sampler = 0;
+    GL_CHECK(glGenSamplers(1, &sampler));
+    GL_CHECK(glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, GetMinFilter(description)));
+    GL_CHECK(glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, description.magFilter == SAMPLER_FILTER_NEAREST ? GL_NEAREST : GL_LINEAR));
+    GL_CHECK(glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, GetAddressMode(description.addressU)));
+    GL_CHECK(glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, GetAddressMode(description.addressV)));
+    if (description.maxAnisotropy > 1.0f && IsAnisotropicFilteringSupported()) {
+        GLfloat maxAnisotropy = 1.0f;
+        GL_CHECK(glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy));
+        GL_CHECK(glSamplerParameterf(sampler, GL_TEXTURE_MAX_ANISOTROPY_EXT, std::min(description.maxAnisotropy, maxAnisotropy)));
+    }
+    m_samplers.Insert(object, sampler);
+    return true;
+}
+
+void RendererOGL::DestroySamplerState(const GfxObject& object) {
+    auto* sampler = m_samplers.Find(object);
+    assert(sampler && "Destroying unknown or already destroyed sampler state");
+    if (!sampler) {
+        return;
+    }
+
+    GL_CHECK(glDeleteSamplers(1, sampler));
+    for (uint32_t slot = 0; slot < s_MAX_TEXTURE_SLOTS; ++slot) {
+        if (m_stateCache.samplers[slot] == *sampler) {
+            m_stateCache.samplers[slot] = 0;
+            m_stateCache.samplerObjects[slot] = GfxObject();
+        }
+    }
+    m_samplers.Erase(object);
+}
+
+bool RendererOGL::IsPipelineStateReady(const GfxObject& object) {
+    auto* pipeline = m_pipelines.Find(object);
+    assert(pipeline && "Failed to find requested pipeline state");
+    if (!pipeline) {
+        return false;
+    }
+    if (!pipeline->program) {
+        m_programCache.Update();
+        pipeline->program = m_programCache.GetProgram(pipeline->programHash);
+    }
+    return pipeline->program != 0;
+}
+
+void RendererOGL::DestroyPipelineState(const GfxObject& object) {
+    auto* pipeline = m_pipelines.Find(object);
+    assert(pipeline && "Destroying unknown or already destroyed pipeline state");
+    if (!pipeline) {
+        return;
+    }
+
+    releaseProgram(pipeline->programHash, pipeline->program);
+    if (pipeline->pendingHash) {
+        m_programCache.Release(pipeline->pendingHash);
+        --m_numPendingPipelines;
+    }
+    m_pipelines.Erase(object);
+}
+
+// The new program is only swapped in at the start of a frame, frames already queued draw with the old one
+bool RendererOGL::UpdatePipelineState(const GfxObject& object, const PipelineState& pipelineState) {
+    auto* pipeline = m_pipelines.Find(object);
+    assert(pipeline && "Failed to find requested pipeline state");
+    assert(pipelineState.vertexShader && pipelineState.fragmentShader && "Pipeline state without shader sources");
+    if (!pipeline || !pipelineState.vertexShader || !pipelineState.fragmentShader) {
+        return false;
+    }
+
+    const uint64_t hash = ProgramCacheOGL::Hash(pipelineState.vertexShader, pipelineState.fragmentShader);
+    if (hash == pipeline->pendingHash) {
+        return true;
+    }
+    // A newer update replaces one that is still being built
+    if (pipeline->pendingHash) {
+        m_programCache.Release(pipeline->pendingHash);
+        pipeline->pendingHash = 0;
+        --m_numPendingPipelines;
+    }
+    if (hash == pipeline->programHash) {
+        return true;
+    }
+    if (!m_programCache.Acquire(hash, pipelineState.vertexShader, pipelineState.fragmentShader, pipelineState.asynchronous)) {
+        return false;
+    }
+    pipeline->pendingHash = hash;
+    ++m_numPendingPipelines;
+    return true;
 }
 
-void RendererOGL::Render(const std::vector<RenderCommand>& commandBuffer) {
+void RendererOGL::Render(const CommandStream& commands) {
+    m_frameStats = {};
+    m_isPipelineReady = true;
+    m_programCache.Update();
+    swapPendingPrograms();
+    // Handles can be destroyed and reused between frames, so only the GL bindings are trusted across frames
+    m_stateCache.vertexBufferObject = GfxObject();
+    m_stateCache.indexBufferObject = GfxObject();
+    std::fill_n(m_stateCache.constantBufferObjects, s_MAX_UNIFORM_BUFFER_SLOTS, GfxObject());
+    std::fill_n(m_stateCache.textureObjects, s_MAX_TEXTURE_SLOTS, GfxObject());
+    std::fill_n(m_stateCache.samplerObjects, s_MAX_TEXTURE_SLOTS, GfxObject());
+
+    // Issued before the frame's draws, the copies of this frame's budget are done by the time they sample
+    if (m_textureUploader.GetQueuedBytes() > 0) {
+        activeTexture(TextureUploaderOGL::s_TEXTURE_UNIT);
+        m_textureUploader.Update();
+        // Levels that were waiting for these uploads can be sampled from now
+        const std::vector<GLuint>& completed = m_textureUploader.GetCompleted();
+        if (!completed.empty()) {
+            m_textures.ForEach([&](Texture& texture) {
+                if (std::find(completed.begin(), completed.end(), texture.texture) != completed.end()) {
+                    updateBaseLevel(texture);
+                }
+            });
+        }
+    }
+
+    if (m_useConstantRing) {
+        m_constantRing.BeginFrame();
+    } else {
+        m_constantPool.Flush();
+    }
+
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // TODO: Separate clear command?
-    for (const RenderCommand& command : commandBuffer) {
-        switch (command.type) {
+    for (const CommandStream::Header* command = commands.Begin(); command != commands.End(); command = CommandStream::Next(command)) {
+        switch (command->type) {
             case BIND_VERTEX_BUFFER:
-                bindVertexBuffer(static_cast<BindVertexBufferCommandData*>(command.data));
+                bindVertexBuffer(CommandStream::Payload<BindVertexBufferCommand>(command));
                 break;
             case BIND_PIPELINE_STATE:
-                bindPipelineState(static_cast<BindPipelineStateCommandData*>(command.data));
+                bindPipelineState(CommandStream::Payload<BindPipelineStateCommand>(command));
                 break;
             case BIND_CONSTANT_BUFFER:
-                bindConstantBuffer(static_cast<BindConstantBufferCommandData*>(command.data), 0);
+                bindConstantBuffer(CommandStream::Payload<BindConstantBufferCommand>(command), 0);
+                break;
+            case BIND_INDEX_BUFFER:
+                bindIndexBuffer(CommandStream::Payload<BindIndexBufferCommand>(command));
+                break;
+            case BIND_TEXTURES:
+                bindTextures(CommandStream::Payload<BindTexturesCommand>(command));
+                break;
+            case BIND_SAMPLERS:
+                bindSamplers(CommandStream::Payload<BindSamplersCommand>(command));
                 break;
             case DRAW:
-                draw(static_cast<DrawCommandData*>(command.data));
+                draw(CommandStream::Payload<DrawCommand>(command));
+                break;
+            case DRAW_INSTANCED:
+                drawInstanced(CommandStream::Payload<DrawInstancedCommand>(command));
                 break;
+            case DRAW_INDEXED:
+                drawIndexed(CommandStream::Payload<DrawIndexedCommand>(command));
+                break;
+            case UPDATE_CONSTANT_BUFFER:
+            case UPDATE_VERTEX_BUFFER:
+                break; // Applied by RenderEngine before the frame
             default:
                 std::cerr << "Unsupported rendering command!" << std::endl;
         }
     }
+
+    if (m_useConstantRing) {
+        m_constantRing.EndFrame();
+    }
     m_renderContext->SwapBuffers();
 }
 
-void RendererOGL::bindPipelineState(BindPipelineStateCommandData* data) const {
-    LOGD("Binding pipeline state");
-    // TODO: Bind all PSO states. Hardcode our only program for now
-    //glUseProgram(s_HARDCODED_PROGRAM_REMOVE_ME);
+// Pipeline states only hold the program so far, pipelines sharing shaders share the program and the bind is skipped.
+// Draws are dropped until the next pipeline bind if the program is still being built
+void RendererOGL::bindPipelineState(const BindPipelineStateCommand& data) {
+    auto* pipeline = m_pipelines.Find(data.object);
+    assert(pipeline && "Failed to find requested pipeline state");
+    if (!pipeline) {
+        return;
+    }
+    if (!pipeline->program) {
+        pipeline->program = m_programCache.GetProgram(pipeline->programHash);
+    }
+    m_isPipelineReady = pipeline->program != 0;
+    if (m_isPipelineReady) {
+        useProgram(pipeline->program);
+    }
+}
+
+// A deleted program stays in use until another one is bound, but its name may be handed out again
+void RendererOGL::releaseProgram(uint64_t hash, GLuint program) {
+    if (m_programCache.Release(hash) && m_stateCache.program == program) {
+        m_stateCache.program = 0;
+    }
 }
 
-void RendererOGL::bindConstantBuffer(BindConstantBufferCommandData* data, uint8_t slot) const {
-    const auto constBufferIt = m_constantBuffers.find(*data->object);
-    assert(constBufferIt != m_constantBuffers.end() && slot == 0 && "Failed to find requested constant buffer");
-    GL_CHECK(glBindBufferBase(GL_UNIFORM_BUFFER, s_BUFFER_SLOT, constBufferIt->second));
+void RendererOGL::swapPendingPrograms() {
+    if (m_numPendingPipelines == 0) {
+        return;
+    }
+    m_pipelines.ForEach([this](Pipeline& pipeline) {
+        if (!pipeline.pendingHash) {
+            return;
+        }
+        const GLuint program = m_programCache.GetProgram(pipeline.pendingHash);
+        if (program) {
+            releaseProgram(pipeline.programHash, pipeline.program);
+            pipeline.program = program;
+            pipeline.programHash = pipeline.pendingHash;
+        } else if (m_programCache.HasFailed(pipeline.pendingHash)) {
+            LOGW("Updated shaders of a pipeline state failed to build, keeping the previous ones");
+            m_programCache.Release(pipeline.pendingHash);
+        } else {
+            return;
+        }
+        pipeline.pendingHash = 0;
+        --m_numPendingPipelines;
+    });
+}
+
+// An invalid handle unbinds the slot
+void RendererOGL::bindTextures(const BindTexturesCommand& data) {
+    if (!BindTexturesCommand::IsRangeValid(data.startSlot, data.count)) {
+        LOGE("Texture bind goes past the last slot, skipping it");
+        return;
+    }
+    for (uint32_t i = 0; i < data.count; ++i) {
+        const uint32_t slot = data.startSlot + i;
+        if (m_stateCache.textureObjects[slot] == data.objects[i] && data.objects[i].IsValid()) {
+            ++m_frameStats.skippedCalls;
+            continue;
+        }
+        auto* texture = m_textures.Find(data.objects[i]);
+        assert((texture || !data.objects[i].IsValid()) && "Failed to find requested texture");
+        const GLuint name = texture ? texture->texture : 0;
+        m_stateCache.textureObjects[slot] = data.objects[i];
+        if (m_stateCache.textures[slot] == name) {
+            ++m_frameStats.skippedCalls;
+            continue;
+        }
+        activeTexture(slot);
+        GL_CHECK(glBindTexture(texture ? texture->target : GL_TEXTURE_2D, name));
+        m_stateCache.textures[slot] = name;
+        ++m_frameStats.issuedCalls;
+    }
 }
 
-void RendererOGL::bindVertexBuffer(BindVertexBufferCommandData* data) const {
-    const auto vertexBufferIt = m_vertexBuffers.find(*data->object);
-    assert(vertexBufferIt != m_vertexBuffers.end() && "Failed to find requested vertex buffer");
-    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vertexBufferIt->second));
+// Sampler bindings don't depend on the active unit
+void RendererOGL::bindSamplers(const BindSamplersCommand& data) {
+    if (!BindTexturesCommand::IsRangeValid(data.startSlot, data.count)) {
+        LOGE("Sampler bind goes past the last slot, skipping it");
+        return;
+    }
+    for (uint32_t i = 0; i < data.count; ++i) {
+        const uint32_t slot = data.startSlot + i;
+        if (m_stateCache.samplerObjects[slot] == data.objects[i] && data.objects[i].IsValid()) {
+            ++m_frameStats.skippedCalls;
+            continue;
+        }
+        auto* sampler = m_samplers.Find(data.objects[i]);
+        assert((sampler || !data.objects[i].IsValid()) && "Failed to find requested sampler state");
+        const GLuint name = sampler ? *sampler : 0;
+        m_stateCache.samplerObjects[slot] = data.objects[i];
+        if (m_stateCache.samplers[slot] == name) {
+            ++m_frameStats.skippedCalls;
+            continue;
+        }
+        GL_CHECK(glBindSampler(slot, name));
+        m_stateCache.samplers[slot] = name;
+        ++m_frameStats.issuedCalls;
+    }
+}
+
+void RendererOGL::bindConstantBuffer(const BindConstantBufferCommand& data, uint8_t slot) {
+    assert(slot == 0 && "Only one constant buffer slot supported");
+    if (m_stateCache.constantBufferObjects[s_BUFFER_SLOT] == data.object) {
+        ++m_frameStats.skippedCalls;
+        return;
+    }
+
+    auto* constBuffer = m_constantBuffers.Find(data.object);
+    assert(constBuffer && "Failed to find requested constant buffer");
+    const GLsizeiptr size = constBuffer->data.size();
+    if (!m_useConstantRing) {
+        bindUniformBufferRange(s_BUFFER_SLOT, constBuffer->block.buffer, constBuffer->block.offset, size);
+        m_stateCache.constantBufferObjects[s_BUFFER_SLOT] = data.object;
+        return;
+    }
+
+    // Copied once per frame, binding the same buffer again in this frame reuses the copy
+    const uint64_t epoch = m_constantRing.GetEpoch();
+    if (constBuffer->ringEpoch != epoch) {
+        if (!m_constantRing.Write(constBuffer->data.data(), size, constBuffer->ringOffset)) {
+            LOGE("Failed to write constant buffer to the constant ring, skipping the bind");
+            return;
+        }
+        if (m_constantRing.GetEpoch() != epoch) {
+            resetUniformBufferCache(); // The ring grew into a new buffer, the old bindings are gone
+        }
+        constBuffer->ringEpoch = m_constantRing.GetEpoch();
+    }
+    bindUniformBufferRange(s_BUFFER_SLOT, m_constantRing.GetBuffer(), constBuffer->ringOffset, size);
+    m_stateCache.constantBufferObjects[s_BUFFER_SLOT] = data.object;
+}
+
+// The VAO holds the attribute setup and buffer of each vertex buffer, binding it is all a draw needs
+void RendererOGL::bindVertexBuffer(const BindVertexBufferCommand& data) {
+    if (m_stateCache.vertexBufferObject == data.object) {
+        ++m_frameStats.skippedCalls;
+        return;
+    }
+
+    auto* vertexBuffer = m_vertexBuffers.Find(data.object);
+    assert(vertexBuffer && "Failed to find requested vertex buffer");
+    bindVertexArray(vertexBuffer->vertexArray);
+    m_stateCache.vertexBufferObject = data.object;
+}
+
+// The index buffer may be bound before the vertex buffer, so it's only attached to the VAO when drawing
+void RendererOGL::bindIndexBuffer(const BindIndexBufferCommand& data) {
+    m_stateCache.indexBufferObject = data.object;
+}
+
+void RendererOGL::draw(const DrawCommand& data) {
+    if (!m_isPipelineReady) {
+        ++m_frameStats.skippedDraws;
+        return;
+    }
+    auto* vertexBuffer = m_vertexBuffers.Find(m_stateCache.vertexBufferObject);
+    if (vertexBuffer) {
+        attachInstances(*vertexBuffer, 0, 0);
+    }
+    GL_CHECK(glDrawArrays(GL_TRIANGLES, data.startVertex, data.count));
+}
+
+void RendererOGL::drawInstanced(const DrawInstancedCommand& data) {
+    if (!m_isPipelineReady) {
+        ++m_frameStats.skippedDraws;
+        return;
+    }
+    auto* vertexBuffer = m_vertexBuffers.Find(m_stateCache.vertexBufferObject);
+    assert(vertexBuffer && "Instanced draw without a bound vertex buffer");
+    auto* instanceBuffer = m_vertexBuffers.Find(data.instanceBuffer);
+    if (!vertexBuffer || !instanceBuffer) {
+        LOGW("Skipping instanced draw without a valid instance buffer");
+        return;
+    }
+    attachInstances(*vertexBuffer, instanceBuffer->buffer, data.startInstance);
+    GL_CHECK(glDrawArraysInstanced(GL_TRIANGLES, data.startVertex, data.count, data.instanceCount));
+}
+
+void RendererOGL::useProgram(GLuint program) {
+    if (m_stateCache.program == program) {
+        ++m_frameStats.skippedCalls;
+        return;
+    }
+    GL_CHECK(glUseProgram(program));
+    m_stateCache.program = program;
+    ++m_frameStats.issuedCalls;
+}
+
+void RendererOGL::activeTexture(GLuint unit) {
+    if (m_stateCache.activeTextureUnit == unit) {
+        return;
+    }
+    GL_CHECK(glActiveTexture(GL_TEXTURE0 + unit));
+    m_stateCache.activeTextureUnit = unit;
+}
+
+// Storage for the levels from storageLevel on, sampled from the first of them
+void RendererOGL::allocateTexture(Texture& texture) {
+    const TextureDescription& description = texture.description;
+    const GLTextureFormat format = GetTextureFormat(description.format);
+    const GLsizei levels = static_cast<GLsizei>(description.mipLevels - texture.storageLevel);
+    const GLsizei width = static_cast<GLsizei>(GetMipLevelSize(description.width, texture.storageLevel));
+    const GLsizei height = static_cast<GLsizei>(GetMipLevelSize(description.height, texture.storageLevel));
+    const GLsizei layers = static_cast<GLsizei>(description.layers);
+
+    GL_CHECK(glGenTextures(1, &texture.texture));
+    activeTexture(TextureUploaderOGL::s_TEXTURE_UNIT);
+    GL_CHECK(glBindTexture(texture.target, texture.texture));
+    if (IsTextureStorageSupported()) {
+        if (texture.target == GL_TEXTURE_2D_ARRAY) {
+            GL_CHECK(glTexStorage3D(texture.target, levels, format.internalFormat, width, height, layers));
+        } else {
+            GL_CHECK(glTexStorage2D(texture.target, levels, format.internalFormat, width, height));
+        }
+    } else {
+        for (GLsizei level = 0; level < levels; ++level) {
+            const GLsizei levelWidth = static_cast<GLsizei>(GetMipLevelSize(width, level));
+            const GLsizei levelHeight = static_cast<GLsizei>(GetMipLevelSize(height, level));
+            const GLsizei levelSize = static_cast<GLsizei>(description.GetLevelSize(texture.storageLevel + level) * description.layers);
+            if (IsTextureFormatCompressed(description.format) && texture.target == GL_TEXTURE_2D_ARRAY) {
+                GL_CHECK(glCompressedTexImage3D(texture.target, level, format.internalFormat, levelWidth, levelHeight, layers, 0, levelSize, nullptr));
+            } else if (IsTextureFormatCompressed(description.format)) {
+                GL_CHECK(glCompressedTexImage2D(texture.target, level, format.internalFormat, levelWidth, levelHeight, 0, levelSize, nullptr));
+            } else if (texture.target == GL_TEXTURE_2D_ARRAY) {
+                GL_CHECK(glTexImage3D(texture.target, level, format.internalFormat, levelWidth, levelHeight, layers, 0, format.format, format.type, nullptr));
+            } else {
+                GL_CHECK(glTexImage2D(texture.target, level, format.internalFormat, levelWidth, levelHeight, 0, format.format, format.type, nullptr));
+            }
+        }
+    }
+    // Textures sampled with fewer levels than the filter asks for would be incomplete
+    GL_CHECK(glTexParameteri(texture.target, GL_TEXTURE_MAX_LEVEL, levels - 1));
+    texture.baseLevel = 0;
+}
+
+// Sampling starts below the finest resident level that still has texels queued, draws fall back to the coarser
+// levels instead of reading what the uploader hasn't written yet
+void RendererOGL::updateBaseLevel(Texture& texture) {
+    const uint32_t levels = texture.description.mipLevels - texture.storageLevel;
+    const uint32_t queued = m_textureUploader.GetQueuedLevels(texture.texture);
+    uint32_t baseLevel = texture.firstLevel - texture.storageLevel;
+    for (uint32_t level = baseLevel; level < levels; ++level) {
+        if (queued & (1u << level)) {
+            baseLevel = level + 1;
+        }
+    }
+    baseLevel = std::min(baseLevel, levels - 1);
+    if (baseLevel == texture.baseLevel) {
+        return;
+    }
+    activeTexture(TextureUploaderOGL::s_TEXTURE_UNIT);
+    GL_CHECK(glBindTexture(texture.target, texture.texture));
+    GL_CHECK(glTexParameteri(texture.target, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(baseLevel)));
+    texture.baseLevel = baseLevel;
+}
+
+// Forgets the slots a deleted texture was bound to, its name may be handed out again
+void RendererOGL::unbindTexture(GLuint texture) {
+    for (uint32_t slot = 0; slot < s_MAX_TEXTURE_SLOTS; ++slot) {
+        if (m_stateCache.textures[slot] == texture) {
+            m_stateCache.textures[slot] = 0;
+            m_stateCache.textureObjects[slot] = GfxObject();
+        }
+    }
+}
+
+void RendererOGL::bindVertexArray(GLuint vertexArray) {
+    if (m_stateCache.vertexArray == vertexArray) {
+        ++m_frameStats.skippedCalls;
+        return;
+    }
+    GL_CHECK(glBindVertexArray(vertexArray));
+    m_stateCache.vertexArray = vertexArray;
+    ++m_frameStats.issuedCalls;
+}
+
+void RendererOGL::bindArrayBuffer(GLuint buffer) {
+    if (m_stateCache.arrayBuffer == buffer) {
+        ++m_frameStats.skippedCalls;
+        return;
+    }
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, buffer));
+    m_stateCache.arrayBuffer = buffer;
+    ++m_frameStats.issuedCalls;
+}
+
+void RendererOGL::drawIndexed(const DrawIndexedCommand& data) {
+    if (!m_isPipelineReady) {
+        ++m_frameStats.skippedDraws;
+        return;
+    }
+    auto* vertexBuffer = m_vertexBuffers.Find(m_stateCache.vertexBufferObject);
+    auto* indexBuffer = m_indexBuffers.Find(m_stateCache.indexBufferObject);
+    assert(vertexBuffer && indexBuffer && "Indexed draw without a bound vertex and index buffer");
+    if (!vertexBuffer || !indexBuffer) {
+        return;
+    }
+
+    if (vertexBuffer->indexBuffer != indexBuffer->buffer) {
+        GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer->buffer));
+        vertexBuffer->indexBuffer = indexBuffer->buffer;
+        ++m_frameStats.issuedCalls;
+    } else {
+        ++m_frameStats.skippedCalls;
+    }
+    attachInstances(*vertexBuffer, 0, 0);
+
+    const GLenum type = indexBuffer->format == INDEX_FORMAT_UINT16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    const size_t offset = static_cast<size_t>(data.startIndex) * GetIndexSize(indexBuffer->format);
+    GL_CHECK(glDrawElementsBaseVertex(GL_TRIANGLES, data.count, type, BUFFER_OFFSET(offset), data.baseVertex));
+}
+
+// Expects the VAO of vertexBuffer to be bound. Starting at an instance offsets the attribute pointers instead
+// of using glDrawArraysInstancedBaseInstance, which needs GL 4.2. Draws without instance data read the generic
+// values of the instance attributes, which are context state, not VAO state. GL leaves them undefined after a
+// draw with the arrays enabled, so they are set again whenever the arrays are disabled or an instanced draw ran
+void RendererOGL::attachInstances(VertexBuffer& vertexBuffer, GLuint instanceBuffer, uint32_t startInstance) {
+    if (!instanceBuffer) {
+        if (vertexBuffer.instanceBuffer) {
+            GL_CHECK(glDisableVertexAttribArray(s_INSTANCE_OFFSET_LOCATION));
+            GL_CHECK(glDisableVertexAttribArray(s_INSTANCE_COLOR_LOCATION));
+            vertexBuffer.instanceBuffer = 0;
+            m_stateCache.hasInstanceDefaults = false;
+        }
+        if (m_stateCache.hasInstanceDefaults) {
+            ++m_frameStats.skippedCalls;
+            return;
+        }
+        const InstanceData defaultInstance;
+        GL_CHECK(glVertexAttrib4fv(s_INSTANCE_OFFSET_LOCATION, defaultInstance.offset));
+        GL_CHECK(glVertexAttrib4fv(s_INSTANCE_COLOR_LOCATION, defaultInstance.color));
+        m_stateCache.hasInstanceDefaults = true;
+        ++m_frameStats.issuedCalls;
+        return;
+    }
+
+    m_stateCache.hasInstanceDefaults = false;
+    if (vertexBuffer.instanceBuffer == instanceBuffer && vertexBuffer.startInstance == startInstance) {
+        ++m_frameStats.skippedCalls;
+        return;
+    }
+    if (!vertexBuffer.instanceBuffer) {
+        GL_CHECK(glEnableVertexAttribArray(s_INSTANCE_OFFSET_LOCATION));
+        GL_CHECK(glEnableVertexAttribArray(s_INSTANCE_COLOR_LOCATION));
+    }
+    const size_t offset = static_cast<size_t>(startInstance) * s_INSTANCE_STRIDE;
+    bindArrayBuffer(instanceBuffer);
+    GL_CHECK(glVertexAttribPointer(s_INSTANCE_OFFSET_LOCATION, 4, GL_FLOAT, GL_FALSE, s_INSTANCE_STRIDE, BUFFER_OFFSET(offset)));
+    GL_CHECK(glVertexAttribPointer(s_INSTANCE_COLOR_LOCATION, 4, GL_FLOAT, GL_FALSE, s_INSTANCE_STRIDE, BUFFER_OFFSET(offset + sizeof(float) * 4)));
+    vertexBuffer.instanceBuffer = instanceBuffer;
+    vertexBuffer.startInstance = startInstance;
+    ++m_frameStats.issuedCalls;
+}
+
+void RendererOGL::bindUniformBufferRange(uint32_t slot, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+    assert(slot < s_MAX_UNIFORM_BUFFER_SLOTS && "Uniform buffer slot out of range");
+    UniformBufferRange& range = m_stateCache.uniformBufferSlots[slot];
+    if (range.buffer == buffer && range.offset == offset && range.size == size) {
+        ++m_frameStats.skippedCalls;
+        return;
+    }
+    GL_CHECK(glBindBufferRange(GL_UNIFORM_BUFFER, slot, buffer, offset, size));
+    range = UniformBufferRange{ buffer, offset, size };
+    ++m_frameStats.issuedCalls;
 }
 
-void RendererOGL::draw(DrawCommandData* data) const {
-    GL_CHECK(glDrawArrays(GL_TRIANGLES, data->startVertex, data->count));
+void RendererOGL::resetUniformBufferCache() {
+    std::fill_n(m_stateCache.uniformBufferSlots, s_MAX_UNIFORM_BUFFER_SLOTS, UniformBufferRange());
+    std::fill_n(m_stateCache.constantBufferObjects, s_MAX_UNIFORM_BUFFER_SLOTS, GfxObject());
 }
 
 }  // namespace dw
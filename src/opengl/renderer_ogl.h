@@ -1,15 +1,23 @@
 #pragma once
 
 #include "irenderer.h"
+#include "commandstream.h"
+#include "utils/handlepool.h"
+#include "opengl/constantpool_ogl.h"
+#include "opengl/constantring_ogl.h"
+#include "opengl/programcache_ogl.h"
+#include "opengl/textureuploader_ogl.h"
 #include "opengl/irendercontext_ogl.h"
-#include <map>
 #include <memory>
+#include <vector>
 
 #if defined(_WIN32)
   #include <GL/glew.h>
 #elif defined(__APPLE__)
   #include <OpenGL/gl3.h>
   #include <OpenGL/glext.h>
+#elif defined(__linux__)
+  #include <GL/glew.h>
 #endif
 
 namespace dw {
@@ -19,40 +27,150 @@ struct InitData;
 
 class RendererOGL final : public IRenderer {
 public:
-    virtual void Initialize(const RendererCaps& caps, const PlatformData& data) override;
+    virtual bool Initialize(const RendererCaps& caps, const PlatformData& data) override;
 
     virtual bool CreateConstantBuffer(const GfxObject& object, uint32_t size) override;
-    virtual bool CreateVertexBuffer(const GfxObject& object, uint32_t count) override;
-    virtual bool CreateIndexBuffer(const GfxObject& object, uint32_t count) override { return false; }
+    virtual bool CreateVertexBuffer(const GfxObject& object, uint32_t count, const VertexLayout& layout) override;
+    virtual bool CreateIndexBuffer(const GfxObject& object, uint32_t count, IndexFormat format) override;
     virtual bool CreatePipelineState(const GfxObject& object, const PipelineState& state) override;
-    virtual bool CreateSamplerState(const GfxObject& object, const SamplerDescription& description) override { return false; }
-    virtual bool CreateTexture(const GfxObject& object, const TextureDescription& description, const std::vector<void*>& data) override { return false; }
+    virtual bool CreateSamplerState(const GfxObject& object, const SamplerDescription& description) override;
+    virtual bool CreateTexture(const GfxObject& object, const TextureDescription& description, const std::vector<void*>& data) override;
 
     virtual void* MapConstantBuffer(const GfxObject& handle) override;
     virtual void* MapVertexBuffer(const GfxObject& handle) override;
-    virtual void* MapIndexBuffer(const GfxObject& handle) override { return nullptr; };
+    virtual void* MapIndexBuffer(const GfxObject& handle) override;
     virtual void UnmapVertexBuffer(const GfxObject& handle) override;
-    virtual void UnmapIndexBuffer(const GfxObject& handle, const uint32_t count) override {};
+    virtual void UpdateVertexBuffer(const GfxObject& handle, uint32_t offset, uint32_t size, const void* data, bool discard) override;
+    virtual void UnmapIndexBuffer(const GfxObject& handle) override;
     virtual void UnmapConstantBuffer(const GfxObject& handle) override;
 
-    virtual void DestroyVertexBuffer(const GfxObject& handle) override {};
-    virtual void DestroyIndexBuffer(const GfxObject& handle) override {};
-    virtual void DestroyTexture(const GfxObject& handle) override {};
-    virtual void DestroyPipelineState(const GfxObject& handle) override {};
-    virtual void DestroySamplerState(const GfxObject& hanele) override {};
+    virtual void DestroyConstantBuffer(const GfxObject& handle) override;
+    virtual void DestroyVertexBuffer(const GfxObject& handle) override;
+    virtual void DestroyIndexBuffer(const GfxObject& handle) override;
+    virtual void DestroyTexture(const GfxObject& handle) override;
+    virtual void DestroyPipelineState(const GfxObject& handle) override;
+    virtual void DestroySamplerState(const GfxObject& handle) override;
 
     // Actual rendering commands that operate on updated and ready resources.
-    virtual void Render(const std::vector<RenderCommand>& commandBuffer) override;
+    virtual void Render(const CommandStream& commands) override;
+    virtual bool IsPipelineStateReady(const GfxObject& handle) override;
+    virtual bool UpdatePipelineState(const GfxObject& handle, const PipelineState& state) override;
+    virtual bool UpdateTexture(const GfxObject& handle, uint32_t layer, uint32_t level, const void* data) override;
+    virtual bool SetTextureFirstLevel(const GfxObject& handle, uint32_t level) override;
+    virtual FrameStats GetFrameStats() const override { return m_frameStats; }
 
 private:
-    void bindConstantBuffer(BindConstantBufferCommandData* data, uint8_t slot) const;
-    void bindVertexBuffer(BindVertexBufferCommandData* data) const;
-    void bindPipelineState(BindPipelineStateCommandData* data) const;
-    void draw(DrawCommandData* data) const;
+    static const uint32_t s_MAX_UNIFORM_BUFFER_SLOTS = 16;
+    static const uint32_t s_MAX_TEXTURE_SLOTS = BindTexturesCommand::s_MAX_SLOTS;
+
+    // Map hands out the CPU copy, so updating constants never touches GL. The copy is uploaded when the
+    // buffer is bound, into the constant ring or, without ARB_buffer_storage, into its pool block at Unmap.
+    struct ConstantBuffer {
+        std::vector<uint8_t> data;
+        ConstantPoolOGL::Allocation block; // Only without the constant ring
+        GLintptr ringOffset = 0;
+        uint64_t ringEpoch = 0;  // Ring epoch ringOffset belongs to, stale offsets are written again
+    };
+
+    // Instance attributes are set up on the VAO of the drawn mesh, instanceBuffer is what they currently
+    // read from or 0 while they are disabled and the generic defaults apply. The element array binding is
+    // VAO state as well, indexBuffer mirrors it.
+    struct VertexBuffer {
+        GLuint vertexArray = 0;
+        GLuint buffer = 0;
+        GLsizeiptr size = 0;
+        GLuint instanceBuffer = 0;
+        uint32_t startInstance = 0;
+        GLuint indexBuffer = 0;
+    };
+
+    struct IndexBuffer {
+        GLuint buffer = 0;
+        IndexFormat format = INDEX_FORMAT_UINT16;
+    };
+
+    struct Pipeline {
+        GLuint program = 0; // 0 until the program cache has it built
+        uint64_t programHash = 0; // Key in the program cache
+        uint64_t pendingHash = 0; // Program replacing it once built, 0 if there is no update
+    };
+
+    // Texels are undefined until the uploader got to them. Levels are numbered like in the description, the GL
+    // texture only has storage from storageLevel on and its levels are numbered from there
+    struct Texture {
+        GLuint texture = 0;
+        GLenum target = GL_TEXTURE_2D;
+        TextureDescription description;
+        uint32_t firstLevel = 0; // First resident level
+        uint32_t storageLevel = 0; // Equal to firstLevel unless the storage can't shrink
+        uint32_t baseLevel = 0; // GL_TEXTURE_BASE_LEVEL
+    };
+
+    struct UniformBufferRange {
+        GLuint buffer = 0;
+        GLintptr offset = 0;
+        GLsizeiptr size = 0;
+    };
+
+    // Mirror of the GL bindings this renderer changes, so calls that wouldn't change anything are dropped
+    struct StateCache {
+        GLuint program = 0;
+        GLuint vertexArray = 0;
+        GLuint arrayBuffer = 0;
+        UniformBufferRange uniformBufferSlots[s_MAX_UNIFORM_BUFFER_SLOTS];
+        GLuint activeTextureUnit = 0;
+        GLuint textures[s_MAX_TEXTURE_SLOTS] = {};
+        GLuint samplers[s_MAX_TEXTURE_SLOTS] = {};
+        bool hasInstanceDefaults = false; // Current generic values of the instance attributes, undefined after a draw reads the arrays
+
+        // Last bound objects, a repeated bind skips the resource lookup as well
+        GfxObject vertexBufferObject;
+        GfxObject indexBufferObject; // Attached to the VAO at the next indexed draw
+        GfxObject constantBufferObjects[s_MAX_UNIFORM_BUFFER_SLOTS];
+        GfxObject textureObjects[s_MAX_TEXTURE_SLOTS];
+        GfxObject samplerObjects[s_MAX_TEXTURE_SLOTS];
+    };
+
+    void bindConstantBuffer(const BindConstantBufferCommand& data, uint8_t slot);
+    void bindVertexBuffer(const BindVertexBufferCommand& data);
+    void bindIndexBuffer(const BindIndexBufferCommand& data);
+    void bindPipelineState(const BindPipelineStateCommand& data);
+    void bindTextures(const BindTexturesCommand& data);
+    void bindSamplers(const BindSamplersCommand& data);
+    void draw(const DrawCommand& data);
+    void drawInstanced(const DrawInstancedCommand& data);
+    void drawIndexed(const DrawIndexedCommand& data);
+
+    void releaseProgram(uint64_t hash, GLuint program);
+    void swapPendingPrograms();
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vertexArray);
+    void bindArrayBuffer(GLuint buffer);
+    void activeTexture(GLuint unit);
+    void allocateTexture(Texture& texture);
+    void updateBaseLevel(Texture& texture);
+    void unbindTexture(GLuint texture);
+    void attachInstances(VertexBuffer& vertexBuffer, GLuint instanceBuffer, uint32_t startInstance);
+    void bindUniformBufferRange(uint32_t slot, GLuint buffer, GLintptr offset, GLsizeiptr size);
+    void resetUniformBufferCache();
 
-    std::map<GfxObject, GLuint> m_vertexBuffers;
-    std::map<GfxObject, GLuint> m_constantBuffers;
+    HandleArray<VertexBuffer> m_vertexBuffers;
+    HandleArray<IndexBuffer> m_indexBuffers;
+    HandleArray<ConstantBuffer> m_constantBuffers;
+    HandleArray<Pipeline> m_pipelines;
+    HandleArray<Texture> m_textures;
+    HandleArray<GLuint> m_samplers;
     std::unique_ptr<IRenderContextOGL> m_renderContext;
+    // Declared after the context, they have to be released while the context lives
+    ConstantRingOGL m_constantRing;
+    ConstantPoolOGL m_constantPool;
+    ProgramCacheOGL m_programCache;
+    TextureUploaderOGL m_textureUploader;
+    bool m_useConstantRing = false;
+    bool m_isPipelineReady = true; // False while the bound pipeline is still being built
+    uint32_t m_numPendingPipelines = 0;
+    StateCache m_stateCache;
+    FrameStats m_frameStats;
 };
 
 }  // namespace dw
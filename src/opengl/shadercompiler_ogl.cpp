@@ -0,0 +1,244 @@
+#include "shadercompiler_ogl.h"
+#include "utils/logger.h"
+
+#include <future>
+
+namespace dw {
+
+namespace {
+    // Compiles without asking for the result, which would wait for the driver
+    GLuint CreateShader(GLenum type, const char* source) {
+        const GLuint shader = glCreateShader(type);
+        glShaderSource(shader, 1, &source, nullptr);
+        glCompileShader(shader);
+        return shader;
+    }
+
+    GLuint CreateProgram(GLuint vertexShader, GLuint fragmentShader, bool retrievable) {
+        const GLuint program = glCreateProgram();
+        glAttachShader(program, vertexShader);
+        glAttachShader(program, fragmentShader);
+        if (retrievable) {
+            glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+        glLinkProgram(program);
+        return program;
+    }
+
+    bool CheckShader(GLuint shader, const char* stage) {
+        GLint status = GL_FALSE;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+        if (status == GL_TRUE) {
+            return true;
+        }
+        GLint logLength = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
+        std::vector<char> log(std::max(logLength, 1));
+        glGetShaderInfoLog(shader, static_cast<GLsizei>(log.size()), nullptr, log.data());
+        LOGE(std::string(stage) + " shader failed to compile: " + log.data());
+        return false;
+    }
+
+    bool CheckProgram(GLuint program) {
+        GLint status = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        if (status == GL_TRUE) {
+            return true;
+        }
+        GLint logLength = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
+        std::vector<char> log(std::max(logLength, 1));
+        glGetProgramInfoLog(program, static_cast<GLsizei>(log.size()), nullptr, log.data());
+        LOGE(std::string("Program failed to link: ") + log.data());
+        return false;
+    }
+
+    // A failed compile fails the link as well, only its own log is of interest then
+    bool CheckBuild(GLuint program, GLuint vertexShader, GLuint fragmentShader) {
+        const bool isVertexCompiled = CheckShader(vertexShader, "Vertex");
+        const bool isFragmentCompiled = CheckShader(fragmentShader, "Fragment");
+        return isVertexCompiled && isFragmentCompiled && CheckProgram(program);
+    }
+
+    double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+GLuint ShaderCompilerOGL::Build(const char* vertexSource, const char* fragmentSource, bool retrievable) {
+    const GLuint vertexShader = CreateShader(GL_VERTEX_SHADER, vertexSource);
+    const GLuint fragmentShader = CreateShader(GL_FRAGMENT_SHADER, fragmentSource);
+    GLuint program = CreateProgram(vertexShader, fragmentShader, retrievable);
+    if (!CheckBuild(program, vertexShader, fragmentShader)) {
+        glDeleteProgram(program);
+        program = 0;
+    }
+    // Flagged for deletion, they go away with the program
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    return program;
+}
+
+ShaderCompilerOGL::~ShaderCompilerOGL() {
+    if (m_worker.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_isStopping = true;
+        }
+        m_wakeUp.notify_one();
+        m_worker.join();
+        m_pending.insert(m_pending.end(), m_workerDone.begin(), m_workerDone.end());
+    }
+
+    // Builds nobody picked up, the driver may still be working on them
+    for (const Pending& pending : m_pending) {
+        if (pending.fence) {
+            glDeleteSync(pending.fence);
+        }
+        glDeleteShader(pending.vertexShader);
+        glDeleteShader(pending.fragmentShader);
+        glDeleteProgram(pending.program);
+    }
+    for (const Result& result : m_finished) {
+        glDeleteProgram(result.program);
+    }
+}
+
+void ShaderCompilerOGL::Initialize(const IRenderContextOGL& context, bool retrievable) {
+    m_retrievable = retrievable;
+
+#if !defined(__APPLE__)
+    if (GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile) {
+        // Let the driver pick the number of threads
+        if (GLEW_KHR_parallel_shader_compile) {
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+        } else {
+            glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+        }
+        m_mode = MODE_PARALLEL_EXTENSION;
+        LOGI("Compiling shaders in parallel through KHR_parallel_shader_compile");
+        return;
+    }
+#endif
+
+    m_workerContext = context.CreateSharedContext();
+    if (m_workerContext) {
+        // The worker reports whether it got its context before any job is submitted
+        std::promise<bool> isCurrent;
+        std::future<bool> workerReady = isCurrent.get_future();
+        m_worker = std::thread([this, &isCurrent] {
+            const bool hasContext = m_workerContext->MakeCurrent();
+            isCurrent.set_value(hasContext);
+            if (hasContext) {
+                workerLoop();
+                m_workerContext->ReleaseCurrent();
+            }
+        });
+        if (workerReady.get()) {
+            m_mode = MODE_WORKER_THREAD;
+            LOGI("Compiling shaders on a worker thread with a shared context");
+            return;
+        }
+        m_worker.join();
+        m_workerContext.reset();
+    }
+    LOGW("No parallel shader compilation available, pipelines are built when created");
+}
+
+void ShaderCompilerOGL::Submit(uint64_t hash, const char* vertexSource, const char* fragmentSource) {
+    const Clock::time_point start = Clock::now();
+    switch (m_mode) {
+        case MODE_PARALLEL_EXTENSION: {
+            Pending pending = { hash, 0, 0, 0, nullptr, start };
+            pending.vertexShader = CreateShader(GL_VERTEX_SHADER, vertexSource);
+            pending.fragmentShader = CreateShader(GL_FRAGMENT_SHADER, fragmentSource);
+            pending.program = CreateProgram(pending.vertexShader, pending.fragmentShader, m_retrievable);
+            m_pending.push_back(pending);
+            break;
+        }
+        case MODE_WORKER_THREAD: {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_jobs.push_back(Job{ hash, vertexSource, fragmentSource, start });
+            }
+            m_wakeUp.notify_one();
+            break;
+        }
+        default: {
+            const GLuint program = Build(vertexSource, fragmentSource, m_retrievable);
+            m_finished.push_back(Result{ hash, program, MillisecondsSince(start) });
+        }
+    }
+}
+
+void ShaderCompilerOGL::Poll(std::vector<Result>& finished) {
+    finished.insert(finished.end(), m_finished.begin(), m_finished.end());
+    m_finished.clear();
+
+    if (m_mode == MODE_WORKER_THREAD) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending.insert(m_pending.end(), m_workerDone.begin(), m_workerDone.end());
+        m_workerDone.clear();
+    }
+
+    // Hands out the result of a program that is done building and returns true, false while it still builds
+    auto tryFinish = [&](Pending& pending) {
+        if (pending.fence) {
+            const GLenum status = glClientWaitSync(pending.fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+                return false;
+            }
+            glDeleteSync(pending.fence);
+        } else if (pending.vertexShader) {
+            GLint isComplete = GL_FALSE;
+            glGetProgramiv(pending.program, GL_COMPLETION_STATUS_KHR, &isComplete);
+            if (!isComplete) {
+                return false;
+            }
+            if (!CheckBuild(pending.program, pending.vertexShader, pending.fragmentShader)) {
+                glDeleteProgram(pending.program);
+                pending.program = 0;
+            }
+            glDeleteShader(pending.vertexShader);
+            glDeleteShader(pending.fragmentShader);
+        }
+        finished.push_back(Result{ pending.hash, pending.program, MillisecondsSince(pending.start) });
+        return true;
+    };
+    size_t numPending = 0;
+    for (size_t i = 0; i < m_pending.size(); ++i) {
+        if (!tryFinish(m_pending[i])) {
+            m_pending[numPending++] = m_pending[i];
+        }
+    }
+    m_pending.erase(m_pending.begin() + numPending, m_pending.end());
+}
+
+// Runs with the shared context current. The fence is only signaled once the driver is done with the program,
+// flushing makes sure it gets there
+void ShaderCompilerOGL::workerLoop() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeUp.wait(lock, [this] { return m_isStopping || !m_jobs.empty(); });
+            if (m_isStopping) {
+                return;
+            }
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        Pending done = { job.hash, 0, 0, 0, nullptr, job.start };
+        done.program = Build(job.vertexSource.c_str(), job.fragmentSource.c_str(), m_retrievable);
+        if (done.program) {
+            done.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+        glFlush();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_workerDone.push_back(done);
+    }
+}
+
+}  // namespace dw
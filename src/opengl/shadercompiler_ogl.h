@@ -0,0 +1,94 @@
+#pragma once
+
+#include "opengl/irendercontext_ogl.h"
+#include <condition_variable>
+#include <cstdint>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+  #include <GL/glew.h>
+#elif defined(__APPLE__)
+  #include <OpenGL/gl3.h>
+  #include <OpenGL/glext.h>
+#elif defined(__linux__)
+  #include <GL/glew.h>
+#endif
+
+namespace dw {
+
+// Builds programs without making the render thread wait for the driver. With KHR_parallel_shader_compile
+// (or the ARB version) the driver compiles on its own threads and completion is polled through
+// GL_COMPLETION_STATUS, no status or log is queried before it's set. Otherwise a worker thread with a shared
+// context compiles and links, and fences every program so it's only handed out once the render thread can
+// see it. Without a shared context, Submit builds the program right away.
+class ShaderCompilerOGL {
+public:
+    enum Mode {
+        MODE_SYNCHRONOUS,
+        MODE_PARALLEL_EXTENSION,
+        MODE_WORKER_THREAD
+    };
+
+    struct Result {
+        uint64_t hash;
+        GLuint program;           // 0 if it failed to compile or link, the log has been written
+        double buildMilliseconds; // Wall time from Submit until the program was found done
+    };
+
+    /* Compiles and links on the calling thread, returns 0 and logs the errors on failure */
+    static GLuint Build(const char* vertexSource, const char* fragmentSource, bool retrievable);
+
+    ~ShaderCompilerOGL();
+
+    /* retrievable sets GL_PROGRAM_BINARY_RETRIEVABLE_HINT on every program */
+    void Initialize(const IRenderContextOGL& context, bool retrievable);
+    Mode GetMode() const { return m_mode; }
+
+    /* Starts building a program, reported under hash by a later Poll */
+    void Submit(uint64_t hash, const char* vertexSource, const char* fragmentSource);
+    /* Appends the builds that finished since the last call */
+    void Poll(std::vector<Result>& finished);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // Build running in the driver, or done by the worker and waiting for its fence
+    struct Pending {
+        uint64_t hash;
+        GLuint program;
+        GLuint vertexShader;   // Only with the parallel extension, kept for the logs
+        GLuint fragmentShader;
+        GLsync fence;          // Only with the worker
+        Clock::time_point start;
+    };
+
+    struct Job {
+        uint64_t hash;
+        std::string vertexSource;
+        std::string fragmentSource;
+        Clock::time_point start;
+    };
+
+    void workerLoop();
+
+    Mode m_mode = MODE_SYNCHRONOUS;
+    bool m_retrievable = false;
+    std::vector<Pending> m_pending;
+    std::vector<Result> m_finished; // Synchronous builds until the next Poll
+
+    std::unique_ptr<IRenderContextOGL> m_workerContext;
+    std::thread m_worker;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    std::deque<Job> m_jobs;         // Guarded by m_mutex
+    std::vector<Pending> m_workerDone; // Guarded by m_mutex
+    bool m_isStopping = false;      // Guarded by m_mutex
+};
+
+}  // namespace dw
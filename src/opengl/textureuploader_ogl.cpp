@@ -0,0 +1,237 @@
+#include "textureuploader_ogl.h"
+#include "utils/logger.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <string>
+
+namespace {
+    const GLintptr s_COPY_ALIGNMENT = 16;
+
+    GLintptr AlignUp(GLintptr value, GLintptr alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // Rows of texels, or of blocks for compressed textures
+    uint32_t GetRowExtent(const dw::TextureUploaderOGL::Destination& destination) {
+        return destination.compressedFormat != GL_NONE ? 4 : 1;
+    }
+
+    size_t GetRowSize(const dw::TextureUploaderOGL::Destination& destination) {
+        const uint32_t extent = GetRowExtent(destination);
+        return static_cast<size_t>((destination.width + extent - 1) / extent) * destination.pixelSize;
+    }
+
+    uint32_t GetRowCount(const dw::TextureUploaderOGL::Destination& destination) {
+        const uint32_t extent = GetRowExtent(destination);
+        return (destination.height + extent - 1) / extent;
+    }
+
+    bool IsBufferStorageSupported() {
+#if defined(__APPLE__)
+        return false; // macOS stops at GL 4.1
+#else
+        return GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+#endif
+    }
+}
+
+namespace dw {
+
+TextureUploaderOGL::~TextureUploaderOGL() {
+    for (GLsync& fence : m_fences) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+    if (m_buffer) {
+        glDeleteBuffers(1, &m_buffer);
+    }
+}
+
+bool TextureUploaderOGL::Initialize(GLsizeiptr bytesPerFrame) {
+    assert(bytesPerFrame > 0 && "Texture uploads need a budget");
+    m_regionSize = AlignUp(bytesPerFrame, s_COPY_ALIGNMENT);
+    const GLsizeiptr totalSize = m_regionSize * s_NUM_REGIONS;
+
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffer);
+    if (IsBufferStorageSupported()) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, totalSize, nullptr, flags);
+        m_mapped = static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, totalSize, flags));
+    } else {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, totalSize, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    // Rows are tightly packed in the queue and in the regions
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    if (IsBufferStorageSupported() && !m_mapped) {
+        LOGE("Failed to persistently map texture upload buffer of " + std::to_string(totalSize) + " bytes");
+        glDeleteBuffers(1, &m_buffer);
+        m_buffer = 0;
+        return false;
+    }
+    LOGD("Created texture upload buffer with " + std::to_string(s_NUM_REGIONS) + " regions of " + std::to_string(m_regionSize) + " bytes");
+    return true;
+}
+
+void TextureUploaderOGL::Enqueue(const Destination& destination, const void* texels) {
+    // Texels still queued for the level would be overwritten anyway
+    cancel([&](const Destination& queued) {
+        return queued.texture == destination.texture && queued.layer == destination.layer && queued.level == destination.level;
+    });
+
+    const size_t rowSize = GetRowSize(destination);
+    if (!m_buffer || rowSize > static_cast<size_t>(m_regionSize)) {
+        LOGW("Uploading " + std::to_string(destination.width) + "x" + std::to_string(destination.height)
+             + " texture level from client memory, a row doesn't fit the upload budget");
+        issue({ destination, 0, GetRowCount(destination), 0 }, texels);
+        return;
+    }
+
+    Upload upload;
+    upload.destination = destination;
+    const uint8_t* bytes = static_cast<const uint8_t*>(texels);
+    upload.texels.assign(bytes, bytes + rowSize * GetRowCount(destination));
+    m_queuedBytes += upload.texels.size();
+    m_queue.push_back(std::move(upload));
+}
+
+void TextureUploaderOGL::Cancel(GLuint texture) {
+    cancel([texture](const Destination& queued) { return queued.texture == texture; });
+}
+
+void TextureUploaderOGL::cancel(const std::function<bool(const Destination&)>& matches) {
+    auto end = std::remove_if(m_queue.begin(), m_queue.end(), [&](const Upload& upload) {
+        const Destination& destination = upload.destination;
+        if (matches(destination)) {
+            m_queuedBytes -= upload.texels.size() - upload.nextRow * GetRowSize(destination);
+            return true;
+        }
+        return false;
+    });
+    m_queue.erase(end, m_queue.end());
+}
+
+void TextureUploaderOGL::Move(GLuint texture, GLuint replacement, int32_t levelOffset) {
+    cancel([&](const Destination& queued) {
+        return queued.texture == texture && static_cast<int32_t>(queued.level) + levelOffset < 0;
+    });
+    for (Upload& upload : m_queue) {
+        if (upload.destination.texture == texture) {
+            upload.destination.texture = replacement;
+            upload.destination.level = static_cast<uint32_t>(static_cast<int32_t>(upload.destination.level) + levelOffset);
+        }
+    }
+}
+
+uint32_t TextureUploaderOGL::GetQueuedLevels(GLuint texture) const {
+    uint32_t levels = 0;
+    for (const Upload& upload : m_queue) {
+        if (upload.destination.texture == texture) {
+            levels |= 1u << upload.destination.level;
+        }
+    }
+    return levels;
+}
+
+void TextureUploaderOGL::Update() {
+    m_uploadedBytes = 0;
+    m_completed.clear();
+    if (m_queue.empty() || !isRegionFree()) {
+        return;
+    }
+
+    const GLintptr regionStart = m_region * m_regionSize;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffer);
+    uint8_t* region = m_mapped ? m_mapped + regionStart : static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, regionStart, m_regionSize,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+    if (!region) {
+        LOGE("Failed to map texture upload region");
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return;
+    }
+
+    // Copy as many rows as fit, a level that doesn't fit entirely continues in the next frame
+    m_copies.clear();
+    GLintptr used = 0;
+    while (!m_queue.empty()) {
+        Upload& upload = m_queue.front();
+        const size_t rowSize = GetRowSize(upload.destination);
+        const size_t rowsLeft = GetRowCount(upload.destination) - upload.nextRow;
+        const uint32_t rowCount = static_cast<uint32_t>(std::min(rowsLeft, static_cast<size_t>(m_regionSize - used) / rowSize));
+        if (rowCount == 0) {
+            break;
+        }
+
+        const size_t size = rowCount * rowSize;
+        std::memcpy(region + used, upload.texels.data() + upload.nextRow * rowSize, size);
+        m_copies.push_back({ upload.destination, upload.nextRow, rowCount, regionStart + used });
+        used = AlignUp(used + size, s_COPY_ALIGNMENT);
+        m_uploadedBytes += size;
+        m_queuedBytes -= size;
+
+        upload.nextRow += rowCount;
+        if (upload.nextRow < GetRowCount(upload.destination)) {
+            break;
+        }
+        m_completed.push_back(upload.destination.texture);
+        m_queue.pop_front();
+    }
+    if (!m_mapped) {
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+
+    // With a pixel unpack buffer bound, the pointer is an offset into it
+    for (const Copy& copy : m_copies) {
+        issue(copy, reinterpret_cast<const void*>(copy.offset));
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_region = (m_region + 1) % s_NUM_REGIONS;
+}
+
+bool TextureUploaderOGL::isRegionFree() {
+    GLsync& fence = m_fences[m_region];
+    if (!fence) {
+        return true;
+    }
+    const GLenum result = glClientWaitSync(fence, 0, 0);
+    assert(result != GL_WAIT_FAILED && "Waiting on texture upload fence failed");
+    if (result == GL_TIMEOUT_EXPIRED) {
+        return false;
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+    return true;
+}
+
+void TextureUploaderOGL::issue(const Copy& copy, const void* pixels) const {
+    const Destination& destination = copy.destination;
+    glBindTexture(destination.target, destination.texture);
+    if (destination.compressedFormat != GL_NONE) {
+        // Bands start on a block row, only the last one may end inside a partial block
+        const uint32_t y = copy.firstRow * 4;
+        const uint32_t height = std::min(copy.rowCount * 4, destination.height - y);
+        const GLsizei size = static_cast<GLsizei>(copy.rowCount * GetRowSize(destination));
+        if (destination.target == GL_TEXTURE_2D_ARRAY) {
+            glCompressedTexSubImage3D(destination.target, destination.level, 0, y, destination.layer, destination.width, height, 1,
+                                      destination.compressedFormat, size, pixels);
+        } else {
+            glCompressedTexSubImage2D(destination.target, destination.level, 0, y, destination.width, height,
+                                      destination.compressedFormat, size, pixels);
+        }
+    } else if (destination.target == GL_TEXTURE_2D_ARRAY) {
+        glTexSubImage3D(destination.target, destination.level, 0, copy.firstRow, destination.layer, destination.width, copy.rowCount, 1,
+                        destination.format, destination.type, pixels);
+    } else {
+        glTexSubImage2D(destination.target, destination.level, 0, copy.firstRow, destination.width, copy.rowCount,
+                        destination.format, destination.type, pixels);
+    }
+}
+
+}  // namespace dw
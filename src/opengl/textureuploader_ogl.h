@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+#if defined(_WIN32)
+  #include <GL/glew.h>
+#elif defined(__APPLE__)
+  #include <OpenGL/gl3.h>
+  #include <OpenGL/glext.h>
+#elif defined(__linux__)
+  #include <GL/glew.h>
+#endif
+
+namespace dw {
+
+// Streams texels to textures through a pixel unpack buffer, so glTexSubImage copies from memory the GPU
+// reads on its own time instead of from client memory the driver has to copy first. Like the constant ring the
+// buffer is split into one region per frame in flight, fenced once the frame's copies are issued. Uploads
+// are queued with a copy of their texels and moved into the region at Update until the frame's byte budget is
+// used up, levels larger than that go over several frames in bands of rows. Update never waits for the GPU:
+// if the next region is still being read, the queue simply waits for the next frame.
+// Textures are bound to s_TEXTURE_UNIT for the copies, which has to be the active unit when calling Enqueue
+// and Update.
+class TextureUploaderOGL {
+public:
+    static const GLuint s_TEXTURE_UNIT = 8; // Past the slots draws bind textures to
+
+    // One level of one layer of a texture, in the texture's pixel format and type. Compressed texels are
+    // uploaded as they are, in rows of 4x4 blocks
+    struct Destination {
+        GLuint texture = 0;
+        GLenum target = GL_TEXTURE_2D; // GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY
+        uint32_t layer = 0;
+        uint32_t level = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        GLenum format = GL_RGBA;
+        GLenum type = GL_UNSIGNED_BYTE;
+        GLenum compressedFormat = GL_NONE; // Internal format of compressed textures
+        uint32_t pixelSize = 4; // Bytes of a block when compressed
+    };
+
+    ~TextureUploaderOGL();
+
+    /* Creates a region of bytesPerFrame bytes for every frame in flight */
+    bool Initialize(GLsizeiptr bytesPerFrame);
+
+    /* Copies the tightly packed texels of destination and queues them, replacing queued texels of the same level */
+    void Enqueue(const Destination& destination, const void* texels);
+    /* Drops the queued uploads to a texture that is about to be deleted */
+    void Cancel(GLuint texture);
+    /* Sends the queued uploads of a texture to the one replacing it, whose level numbers are levelOffset
+       higher. Uploads to levels the replacement doesn't have are dropped */
+    void Move(GLuint texture, GLuint replacement, int32_t levelOffset);
+    /* Bit N is set if level N of the texture still has queued texels */
+    uint32_t GetQueuedLevels(GLuint texture) const;
+    /* Issues the copies of this frame and fences its region, called once per frame */
+    void Update();
+
+    size_t GetQueuedBytes() const { return m_queuedBytes; }
+    size_t GetUploadedBytes() const { return m_uploadedBytes; } // During the last Update
+    const std::vector<GLuint>& GetCompleted() const { return m_completed; } // Textures a level finished uploading to during the last Update
+
+private:
+    static const uint32_t s_NUM_REGIONS = 3;
+
+    struct Upload {
+        Destination destination;
+        std::vector<uint8_t> texels;
+        uint32_t nextRow = 0;
+    };
+
+    // A band of rows copied into the region, issued once the copying is done
+    struct Copy {
+        Destination destination;
+        uint32_t firstRow = 0;
+        uint32_t rowCount = 0;
+        GLintptr offset = 0;
+    };
+
+    void cancel(const std::function<bool(const Destination&)>& matches);
+    bool isRegionFree();
+    void issue(const Copy& copy, const void* pixels) const;
+
+    GLuint m_buffer = 0;
+    uint8_t* m_mapped = nullptr; // Only with persistent mapping
+    GLsizeiptr m_regionSize = 0;
+    GLsync m_fences[s_NUM_REGIONS] = {};
+    uint32_t m_region = 0;
+
+    std::deque<Upload> m_queue;
+    std::vector<Copy> m_copies; // Reused by Update
+    std::vector<GLuint> m_completed;
+    size_t m_queuedBytes = 0;
+    size_t m_uploadedBytes = 0;
+};
+
+}  // namespace dw
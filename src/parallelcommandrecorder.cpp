@@ -0,0 +1,26 @@
+#include "parallelcommandrecorder.h"
+
+namespace dw {
+
+ParallelCommandRecorder::ParallelCommandRecorder(uint32_t numThreads) : m_threadPool(numThreads) {}
+
+void ParallelCommandRecorder::Record(uint32_t numJobs, const std::function<void(uint32_t, CommandStream&)>& record) {
+    if (m_streams.size() < numJobs) {
+        m_streams.resize(numJobs);
+    }
+    m_numJobs = numJobs;
+
+    m_threadPool.ParallelFor(numJobs, [this, &record](uint32_t job) {
+        CommandStream& stream = m_streams[job];
+        stream.Reset();
+        record(job, stream);
+    });
+}
+
+void ParallelCommandRecorder::Merge(CommandStream& out) const {
+    for (uint32_t job = 0; job < m_numJobs; ++job) {
+        out.Append(m_streams[job]);
+    }
+}
+
+} // namespace dw
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "commandstream.h"
+#include "utils/threadpool.h"
+#include <functional>
+#include <vector>
+
+namespace dw {
+
+// Spreads command recording over a pool of threads. Work is split into jobs, i.e ranges of objects, and
+// every job records into a CommandStream of its own so no locking is needed while recording. Merge then
+// appends the streams in job order, which keeps the result identical whatever thread ran which job.
+// The streams are kept between frames so steady state recording doesn't allocate.
+class ParallelCommandRecorder {
+public:
+    /* Creates a recorder with numThreads threads, or one per hardware thread if numThreads is 0 */
+    explicit ParallelCommandRecorder(uint32_t numThreads = 0);
+
+    /* Runs record(job, stream) for every job in [0, numJobs) on the pool and blocks until all are recorded */
+    void Record(uint32_t numJobs, const std::function<void(uint32_t, CommandStream&)>& record);
+    /* Appends the streams of the last Record call to out, in job order */
+    void Merge(CommandStream& out) const;
+
+    uint32_t GetNumThreads() const { return m_threadPool.GetNumThreads(); }
+
+private:
+    ThreadPool m_threadPool;
+    std::vector<CommandStream> m_streams;
+    uint32_t m_numJobs = 0;
+};
+
+} // namespace dw
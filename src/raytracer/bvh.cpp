@@ -0,0 +1,276 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace {
+    const uint32_t s_NUM_BINS = 12;
+    const uint32_t s_MAX_LEAF_SIZE = 2;
+    const uint32_t s_STACK_SIZE = 64;
+    // Traversal holds at most one sibling per level plus the node itself, so this depth always fits the stack
+    const uint32_t s_MAX_DEPTH = s_STACK_SIZE - 1;
+    const float s_INFINITY = std::numeric_limits<float>::infinity();
+
+    struct Bounds {
+        dw::Vec3 min = { s_INFINITY, s_INFINITY, s_INFINITY };
+        dw::Vec3 max = { -s_INFINITY, -s_INFINITY, -s_INFINITY };
+
+        void Grow(const dw::Vec3& point) { min = dw::Min(min, point); max = dw::Max(max, point); }
+        void Grow(const Bounds& bounds) { min = dw::Min(min, bounds.min); max = dw::Max(max, bounds.max); }
+        float HalfArea() const {
+            const dw::Vec3 extent = max - min;
+            return extent.x < 0.0f ? 0.0f : extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+        }
+    };
+
+    // Slab test, returns the entry distance or infinity on miss
+    float IntersectBounds(const dw::Ray& ray, const dw::Vec3& boundsMin, const dw::Vec3& boundsMax, float maxT) {
+        const float tx1 = (boundsMin.x - ray.origin.x) * ray.invDirection.x;
+        const float tx2 = (boundsMax.x - ray.origin.x) * ray.invDirection.x;
+        float tMin = std::min(tx1, tx2);
+        float tMax = std::max(tx1, tx2);
+        const float ty1 = (boundsMin.y - ray.origin.y) * ray.invDirection.y;
+        const float ty2 = (boundsMax.y - ray.origin.y) * ray.invDirection.y;
+        tMin = std::max(tMin, std::min(ty1, ty2));
+        tMax = std::min(tMax, std::max(ty1, ty2));
+        const float tz1 = (boundsMin.z - ray.origin.z) * ray.invDirection.z;
+        const float tz2 = (boundsMax.z - ray.origin.z) * ray.invDirection.z;
+        tMin = std::max(tMin, std::min(tz1, tz2));
+        tMax = std::min(tMax, std::max(tz1, tz2));
+        return (tMax >= tMin && tMax > 0.0f && tMin < maxT) ? tMin : s_INFINITY;
+    }
+}
+
+namespace dw {
+
+void BVH::Build(const std::vector<BVHTriangle>& triangles) {
+    m_triangles = &triangles;
+    m_nodes.clear();
+    m_indices.resize(triangles.size());
+    if (triangles.empty()) {
+        return;
+    }
+
+    std::vector<Vec3> centroids(triangles.size());
+    for (uint32_t i = 0; i < triangles.size(); ++i) {
+        const BVHTriangle& triangle = triangles[i];
+        centroids[i] = triangle.v0 + (triangle.edge1 + triangle.edge2) * (1.0f / 3.0f);
+        m_indices[i] = i;
+    }
+
+    // A binary tree never has more than 2n - 1 nodes, reserving keeps node references stable
+    m_nodes.reserve(triangles.size() * 2);
+    m_nodes.push_back({ {}, 0, {}, static_cast<uint32_t>(triangles.size()) });
+    updateBounds(m_nodes[0]);
+    subdivide(0, 0, centroids);
+}
+
+void BVH::updateBounds(Node& node) const {
+    Bounds bounds;
+    for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; ++i) {
+        const BVHTriangle& triangle = (*m_triangles)[m_indices[i]];
+        bounds.Grow(triangle.v0);
+        bounds.Grow(triangle.v0 + triangle.edge1);
+        bounds.Grow(triangle.v0 + triangle.edge2);
+    }
+    node.boundsMin = bounds.min;
+    node.boundsMax = bounds.max;
+}
+
+void BVH::subdivide(uint32_t nodeIndex, uint32_t depth, const std::vector<Vec3>& centroids) {
+    Node& node = m_nodes[nodeIndex];
+    if (node.count <= s_MAX_LEAF_SIZE || depth >= s_MAX_DEPTH) {
+        return;
+    }
+
+    const uint32_t first = node.leftOrFirst;
+    const uint32_t last = first + node.count;
+    Bounds centroidBounds;
+    for (uint32_t i = first; i < last; ++i) {
+        centroidBounds.Grow(centroids[m_indices[i]]);
+    }
+
+    // Find the cheapest split plane among the bin boundaries of all three axes
+    float bestCost = s_INFINITY;
+    int bestAxis = -1;
+    uint32_t bestSplit = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+        const float axisMin = centroidBounds.min[axis];
+        const float extent = centroidBounds.max[axis] - axisMin;
+        if (extent <= 0.0f) {
+            continue;
+        }
+
+        Bounds binBounds[s_NUM_BINS];
+        uint32_t binCounts[s_NUM_BINS] = {};
+        const float scale = s_NUM_BINS / extent;
+        for (uint32_t i = first; i < last; ++i) {
+            const BVHTriangle& triangle = (*m_triangles)[m_indices[i]];
+            const uint32_t bin = std::min(s_NUM_BINS - 1, static_cast<uint32_t>((centroids[m_indices[i]][axis] - axisMin) * scale));
+            ++binCounts[bin];
+            binBounds[bin].Grow(triangle.v0);
+            binBounds[bin].Grow(triangle.v0 + triangle.edge1);
+            binBounds[bin].Grow(triangle.v0 + triangle.edge2);
+        }
+
+        float leftAreas[s_NUM_BINS - 1];
+        uint32_t leftCounts[s_NUM_BINS - 1];
+        Bounds leftBounds;
+        uint32_t leftCount = 0;
+        for (uint32_t i = 0; i < s_NUM_BINS - 1; ++i) {
+            leftBounds.Grow(binBounds[i]);
+            leftCount += binCounts[i];
+            leftAreas[i] = leftBounds.HalfArea();
+            leftCounts[i] = leftCount;
+        }
+
+        Bounds rightBounds;
+        uint32_t rightCount = 0;
+        for (uint32_t i = s_NUM_BINS - 1; i > 0; --i) {
+            rightBounds.Grow(binBounds[i]);
+            rightCount += binCounts[i];
+            const float cost = leftCounts[i - 1] * leftAreas[i - 1] + rightCount * rightBounds.HalfArea();
+            if (leftCounts[i - 1] > 0 && rightCount > 0 && cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = i;
+            }
+        }
+    }
+
+    Bounds nodeBounds;
+    nodeBounds.min = node.boundsMin;
+    nodeBounds.max = node.boundsMax;
+    if (bestAxis < 0 || bestCost >= node.count * nodeBounds.HalfArea()) {
+        return;
+    }
+
+    const float axisMin = centroidBounds.min[bestAxis];
+    const float scale = s_NUM_BINS / (centroidBounds.max[bestAxis] - axisMin);
+    const auto middle = std::partition(m_indices.begin() + first, m_indices.begin() + last, [&](uint32_t index) {
+        return std::min(s_NUM_BINS - 1, static_cast<uint32_t>((centroids[index][bestAxis] - axisMin) * scale)) < bestSplit;
+    });
+    const uint32_t leftCount = static_cast<uint32_t>(middle - m_indices.begin()) - first;
+    if (leftCount == 0 || leftCount == node.count) {
+        return;
+    }
+
+    const uint32_t leftIndex = static_cast<uint32_t>(m_nodes.size());
+    m_nodes.push_back({ {}, first, {}, leftCount });
+    m_nodes.push_back({ {}, first + leftCount, {}, node.count - leftCount });
+    updateBounds(m_nodes[leftIndex]);
+    updateBounds(m_nodes[leftIndex + 1]);
+    node.leftOrFirst = leftIndex;
+    node.count = 0;
+
+    subdivide(leftIndex, depth + 1, centroids);
+    subdivide(leftIndex + 1, depth + 1, centroids);
+}
+
+bool BVH::intersectTriangle(const Ray& ray, uint32_t triangleIndex, float maxT, RayHit& hit) const {
+    // Moller-Trumbore
+    const BVHTriangle& triangle = (*m_triangles)[triangleIndex];
+    const Vec3 p = Cross(ray.direction, triangle.edge2);
+    const float determinant = Dot(triangle.edge1, p);
+    if (std::fabs(determinant) < 1e-9f) {
+        return false;
+    }
+
+    const float invDeterminant = 1.0f / determinant;
+    const Vec3 s = ray.origin - triangle.v0;
+    const float u = Dot(s, p) * invDeterminant;
+    if (u < 0.0f || u > 1.0f) {
+        return false;
+    }
+
+    const Vec3 q = Cross(s, triangle.edge1);
+    const float v = Dot(ray.direction, q) * invDeterminant;
+    if (v < 0.0f || u + v > 1.0f) {
+        return false;
+    }
+
+    const float t = Dot(triangle.edge2, q) * invDeterminant;
+    if (t <= 0.0f || t >= maxT) {
+        return false;
+    }
+
+    hit = { t, u, v, triangleIndex };
+    return true;
+}
+
+bool BVH::Intersect(const Ray& ray, float maxT, RayHit& hit) const {
+    if (m_nodes.empty()) {
+        return false;
+    }
+
+    bool isHit = false;
+    uint32_t stack[s_STACK_SIZE];
+    uint32_t stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        const Node& node = m_nodes[stack[--stackSize]];
+        if (IntersectBounds(ray, node.boundsMin, node.boundsMax, maxT) == s_INFINITY) {
+            continue;
+        }
+
+        if (node.count > 0) {
+            for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; ++i) {
+                if (intersectTriangle(ray, m_indices[i], maxT, hit)) {
+                    maxT = hit.t;
+                    isHit = true;
+                }
+            }
+            continue;
+        }
+
+        // Visit the closer child first so maxT shrinks as early as possible
+        uint32_t nearChild = node.leftOrFirst;
+        uint32_t farChild = node.leftOrFirst + 1;
+        const float nearDistance = IntersectBounds(ray, m_nodes[nearChild].boundsMin, m_nodes[nearChild].boundsMax, maxT);
+        const float farDistance = IntersectBounds(ray, m_nodes[farChild].boundsMin, m_nodes[farChild].boundsMax, maxT);
+        if (farDistance < nearDistance) {
+            std::swap(nearChild, farChild);
+        }
+        assert(stackSize + 2 <= s_STACK_SIZE && "BVH deeper than the traversal stack");
+        stack[stackSize++] = farChild;
+        stack[stackSize++] = nearChild;
+    }
+
+    return isHit;
+}
+
+bool BVH::IsOccluded(const Ray& ray, float maxT) const {
+    if (m_nodes.empty()) {
+        return false;
+    }
+
+    RayHit hit;
+    uint32_t stack[s_STACK_SIZE];
+    uint32_t stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        const Node& node = m_nodes[stack[--stackSize]];
+        if (IntersectBounds(ray, node.boundsMin, node.boundsMax, maxT) == s_INFINITY) {
+            continue;
+        }
+
+        if (node.count > 0) {
+            for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; ++i) {
+                if (intersectTriangle(ray, m_indices[i], maxT, hit)) {
+                    return true;
+                }
+            }
+        } else {
+            assert(stackSize + 2 <= s_STACK_SIZE && "BVH deeper than the traversal stack");
+            stack[stackSize++] = node.leftOrFirst + 1;
+            stack[stackSize++] = node.leftOrFirst;
+        }
+    }
+
+    return false;
+}
+
+} // namespace dw
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "utils/vecmath.h"
+#include <cstdint>
+#include <vector>
+
+namespace dw {
+
+struct Ray {
+    Ray(const Vec3& origin, const Vec3& direction)
+        : origin(origin), direction(direction), invDirection({ 1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z }) {}
+
+    Vec3 origin;
+    Vec3 direction;
+    Vec3 invDirection;
+};
+
+// Triangle stored as a vertex and two edges, which is what the intersection test wants
+struct BVHTriangle {
+    Vec3 v0;
+    Vec3 edge1;
+    Vec3 edge2;
+};
+
+struct RayHit {
+    float t;
+    float u, v; // Barycentrics of vertex 1 and 2
+    uint32_t triangle;
+};
+
+// Bounding volume hierarchy over a triangle soup, built with binned SAH into a flat node array.
+// Leaves reference a range in a triangle index list so the triangles themselves are never reordered.
+// The depth is capped to what the fixed traversal stack holds, nodes at the cap stay leaves whatever their size.
+class BVH {
+public:
+    void Build(const std::vector<BVHTriangle>& triangles);
+
+    /* Finds the closest hit within [0, maxT), returns false on miss */
+    bool Intersect(const Ray& ray, float maxT, RayHit& hit) const;
+    /* Any hit test for shadow rays */
+    bool IsOccluded(const Ray& ray, float maxT) const;
+
+    uint32_t GetNodeCount() const { return static_cast<uint32_t>(m_nodes.size()); }
+
+private:
+    struct Node {
+        Vec3 boundsMin;
+        uint32_t leftOrFirst; // Left child for inner nodes (right is left + 1), first triangle for leaves
+        Vec3 boundsMax;
+        uint32_t count;       // 0 for inner nodes
+    };
+
+    void subdivide(uint32_t nodeIndex, uint32_t depth, const std::vector<Vec3>& centroids);
+    void updateBounds(Node& node) const;
+    bool intersectTriangle(const Ray& ray, uint32_t triangle, float maxT, RayHit& hit) const;
+
+    const std::vector<BVHTriangle>* m_triangles = nullptr;
+    std::vector<uint32_t> m_indices;
+    std::vector<Node> m_nodes;
+};
+
+} // namespace dw
@@ -0,0 +1,254 @@
+#include "renderer_rt.h"
+#include "common/config.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <string>
+
+#include "utils/logger.h"
+
+namespace {
+    const uint32_t s_DEFAULT_WIDTH = 1024;
+    const uint32_t s_DEFAULT_HEIGHT = 768;
+    const uint32_t s_TILE_SIZE = 16;
+    const uint32_t s_VERTEX_STRIDE = dw::ResourceStoreCPU::s_VERTEX_STRIDE;
+    const uint32_t s_STATS_INTERVAL = 60; // Frames between throughput reports
+    const uint32_t s_CLEAR_COLOR = 0x00660000; // RGBA8 (0.0, 0.0, 0.4, 0.0), same as the rasterizers
+    const float s_AMBIENT = 0.3f;
+    const float s_SHADOW_EPSILON = 1e-3f;
+    const dw::Vec3 s_LIGHT_DIRECTION = dw::Normalize({ 0.4f, 1.0f, 0.6f }); // Towards the light
+
+
+    dw::Vec3 Unproject(const dw::Mat4& invViewProj, float x, float y, float z) {
+        const dw::Vec4 point = invViewProj * dw::Vec4{ x, y, z, 1.0f };
+        return point.xyz() * (1.0f / point.w);
+    }
+}
+
+namespace dw {
+
+bool RendererRT::Initialize(const RendererCaps& /*caps*/, const PlatformData& platformData) {
+    LOGD("Initializing ray tracer");
+
+    m_width = platformData.width ? platformData.width : s_DEFAULT_WIDTH;
+    m_height = platformData.height ? platformData.height : s_DEFAULT_HEIGHT;
+    m_tilesX = (m_width + s_TILE_SIZE - 1) / s_TILE_SIZE;
+    m_tilesY = (m_height + s_TILE_SIZE - 1) / s_TILE_SIZE;
+    m_colorBuffer.resize(m_width * m_height, s_CLEAR_COLOR);
+    m_viewProj = Mat4::Identity();
+
+    m_threadPool = std::make_unique<ThreadPool>();
+    LOGI("Ray tracer running " + std::to_string(m_width) + "x" + std::to_string(m_height) + " on " + std::to_string(m_threadPool->GetNumThreads()) + " threads");
+    return true;
+}
+
+void RendererRT::Render(const CommandStream& commands) {
+    m_resources.ResetBindings();
+    m_triangles.clear();
+    m_triangleColors.clear();
+
+    for (const CommandStream::Header* command = commands.Begin(); command != commands.End(); command = CommandStream::Next(command)) {
+        switch (command->type) {
+            case BIND_VERTEX_BUFFER:
+                m_resources.BindVertexBuffer(CommandStream::Payload<BindVertexBufferCommand>(command).object);
+                break;
+            case BIND_PIPELINE_STATE:
+                m_resources.BindPipelineState(CommandStream::Payload<BindPipelineStateCommand>(command).object);
+                break;
+            case BIND_CONSTANT_BUFFER:
+                m_resources.BindConstantBuffer(CommandStream::Payload<BindConstantBufferCommand>(command).object);
+                break;
+            case BIND_INDEX_BUFFER:
+                m_resources.BindIndexBuffer(CommandStream::Payload<BindIndexBufferCommand>(command).object);
+                break;
+            case DRAW:
+                draw(CommandStream::Payload<DrawCommand>(command));
+                break;
+            case DRAW_INSTANCED:
+                drawInstanced(CommandStream::Payload<DrawInstancedCommand>(command));
+                break;
+            case DRAW_INDEXED:
+                drawIndexed(CommandStream::Payload<DrawIndexedCommand>(command));
+                break;
+            case UPDATE_CONSTANT_BUFFER:
+            case UPDATE_VERTEX_BUFFER:
+                break; // Applied by RenderEngine before the frame
+            default:
+                std::cerr << "Unsupported rendering command!" << std::endl;
+        }
+    }
+
+    m_bvh.Build(m_triangles);
+
+    const Mat4 invViewProj = Inverse(m_viewProj);
+    std::atomic<uint64_t> numRays{ 0 };
+    const auto start = std::chrono::steady_clock::now();
+    m_threadPool->ParallelFor(m_tilesX * m_tilesY, [this, &invViewProj, &numRays](uint32_t tileIndex) {
+        numRays += traceTile(tileIndex, invViewProj);
+    });
+    const std::chrono::duration<double> traceTime = std::chrono::steady_clock::now() - start;
+
+    m_megaRaysPerSecond = numRays / traceTime.count() * 1e-6;
+    m_statsRays += numRays;
+    m_statsSeconds += traceTime.count();
+    if (++m_statsFrames == s_STATS_INTERVAL) {
+        LOGI("Ray tracer: " + std::to_string(m_statsRays / m_statsSeconds * 1e-6) + " Mrays/s over " + std::to_string(m_statsFrames) + " frames, "
+             + std::to_string(m_triangles.size()) + " triangles in " + std::to_string(m_bvh.GetNodeCount()) + " BVH nodes");
+        m_statsRays = 0;
+        m_statsSeconds = 0.0;
+        m_statsFrames = 0;
+    }
+}
+
+bool RendererRT::ReadColorBuffer(std::vector<uint32_t>& pixels, uint32_t& width, uint32_t& height) {
+    pixels = m_colorBuffer;
+    width = m_width;
+    height = m_height;
+    return true;
+}
+
+FrameStats RendererRT::GetFrameStats() const {
+    FrameStats stats;
+    stats.megaRaysPerSecond = m_megaRaysPerSecond;
+    return stats;
+}
+
+void RendererRT::draw(const DrawCommand& data) {
+    drawVertices(data.count, data.startVertex, InstanceData());
+}
+
+void RendererRT::drawInstanced(const DrawInstancedCommand& data) {
+    const auto* instanceBuffer = m_resources.FindVertexBuffer(data.instanceBuffer);
+    if (!instanceBuffer) {
+        LOGW("Skipping instanced draw without a valid instance buffer");
+        return;
+    }
+    assert((data.startInstance + data.instanceCount) * s_VERTEX_STRIDE <= instanceBuffer->vertices.size() && "Draw outside of instance buffer");
+
+    const InstanceData* instances = reinterpret_cast<const InstanceData*>(instanceBuffer->vertices.data()) + data.startInstance;
+    for (uint32_t i = 0; i < data.instanceCount; ++i) {
+        drawVertices(data.count, data.startVertex, instances[i]);
+    }
+}
+
+void RendererRT::drawIndexed(const DrawIndexedCommand& data) {
+    if (!m_resources.IsPipelineStateBound()) {
+        return;
+    }
+    const std::vector<float>* vertexBuffer = m_resources.GetBoundVertices();
+    const ResourceStoreCPU::IndexBuffer* indexBuffer = m_resources.GetBoundIndexBuffer();
+    assert(vertexBuffer && indexBuffer && "Indexed draw without a bound vertex and index buffer");
+    assert((data.startIndex + data.count) * GetIndexSize(indexBuffer->format) <= indexBuffer->data.size() && "Draw outside of index buffer");
+
+    const Mat4 model = readConstants();
+    for (uint32_t i = 0; i + 2 < data.count; i += 3) {
+        const float* vertices[3];
+        for (uint32_t corner = 0; corner < 3; ++corner) {
+            const int64_t vertex = static_cast<int64_t>(ResourceStoreCPU::ReadIndex(*indexBuffer, data.startIndex + i + corner)) + data.baseVertex;
+            assert(vertex >= 0 && static_cast<size_t>(vertex + 1) * s_VERTEX_STRIDE <= vertexBuffer->size() && "Draw outside of vertex buffer");
+            vertices[corner] = vertexBuffer->data() + vertex * s_VERTEX_STRIDE;
+        }
+        addTriangle(model, vertices, InstanceData());
+    }
+}
+
+void RendererRT::drawVertices(uint32_t count, uint32_t startVertex, const InstanceData& instance) {
+    if (!m_resources.IsPipelineStateBound()) {
+        return;
+    }
+    const std::vector<float>* vertexBuffer = m_resources.GetBoundVertices();
+    assert(vertexBuffer && "Draw without a bound vertex buffer");
+    assert((startVertex + count) * s_VERTEX_STRIDE <= vertexBuffer->size() && "Draw outside of vertex buffer");
+
+    const Mat4 model = readConstants();
+    const float* first = vertexBuffer->data() + startVertex * s_VERTEX_STRIDE;
+    for (uint32_t i = 0; i + 2 < count; i += 3) {
+        const float* vertices[3] = { first + i * s_VERTEX_STRIDE, first + (i + 1) * s_VERTEX_STRIDE, first + (i + 2) * s_VERTEX_STRIDE };
+        addTriangle(model, vertices, instance);
+    }
+}
+
+// Constant layout of the standard program: { mat4 model; mat4 view; mat4 proj; }, the camera of the last draw wins
+Mat4 RendererRT::readConstants() {
+    Mat4 model = Mat4::Identity();
+    const std::vector<float>* constantBuffer = m_resources.GetBoundConstants();
+    if (constantBuffer && constantBuffer->size() >= 48) {
+        const float* constants = constantBuffer->data();
+        Mat4 view, proj;
+        std::copy(constants, constants + 16, model.m);
+        std::copy(constants + 16, constants + 32, view.m);
+        std::copy(constants + 32, constants + 48, proj.m);
+        m_viewProj = proj * view;
+    }
+    return model;
+}
+
+void RendererRT::addTriangle(const Mat4& model, const float* const vertices[3], const InstanceData& instance) {
+    const float* offset = instance.offset;
+    const float* tint = instance.color;
+    Vec3 positions[3];
+    for (uint32_t corner = 0; corner < 3; ++corner) {
+        const float* vertex = vertices[corner];
+        positions[corner] = (model * Vec4{ vertex[0] + offset[0], vertex[1] + offset[1], vertex[2] + offset[2], 1.0f }).xyz();
+        m_triangleColors.push_back({ vertex[4] * tint[0], vertex[5] * tint[1], vertex[6] * tint[2], vertex[7] * tint[3] });
+    }
+    m_triangles.push_back({ positions[0], positions[1] - positions[0], positions[2] - positions[0] });
+}
+
+uint64_t RendererRT::traceTile(uint32_t tileIndex, const Mat4& invViewProj) {
+    const uint32_t tileMinX = (tileIndex % m_tilesX) * s_TILE_SIZE;
+    const uint32_t tileMinY = (tileIndex / m_tilesX) * s_TILE_SIZE;
+    const uint32_t tileMaxX = std::min(tileMinX + s_TILE_SIZE, m_width);
+    const uint32_t tileMaxY = std::min(tileMinY + s_TILE_SIZE, m_height);
+    uint64_t numRays = 0;
+
+    for (uint32_t y = tileMinY; y < tileMaxY; ++y) {
+        for (uint32_t x = tileMinX; x < tileMaxX; ++x) {
+            const float ndcX = (x + 0.5f) / m_width * 2.0f - 1.0f;
+            const float ndcY = 1.0f - (y + 0.5f) / m_height * 2.0f;
+            const Vec3 nearPoint = Unproject(invViewProj, ndcX, ndcY, -1.0f);
+            const Vec3 farPoint = Unproject(invViewProj, ndcX, ndcY, 1.0f);
+            const Vec3 toFar = farPoint - nearPoint;
+            const float maxT = std::sqrt(Dot(toFar, toFar));
+
+            const Ray primaryRay(nearPoint, toFar * (1.0f / maxT));
+            RayHit hit;
+            ++numRays;
+            if (!m_bvh.Intersect(primaryRay, maxT, hit)) {
+                m_colorBuffer[y * m_width + x] = s_CLEAR_COLOR;
+                continue;
+            }
+
+            const BVHTriangle& triangle = m_triangles[hit.triangle];
+            const Vec4* colors = &m_triangleColors[hit.triangle * 3];
+            const Vec4 color = colors[0] * (1.0f - hit.u - hit.v) + colors[1] * hit.u + colors[2] * hit.v;
+
+            Vec3 normal = Normalize(Cross(triangle.edge1, triangle.edge2));
+            if (Dot(normal, primaryRay.direction) > 0.0f) {
+                normal = normal * -1.0f;
+            }
+
+            float lighting = s_AMBIENT;
+            const float lambert = Dot(normal, s_LIGHT_DIRECTION);
+            if (lambert > 0.0f) {
+                const Vec3 hitPoint = primaryRay.origin + primaryRay.direction * hit.t + normal * s_SHADOW_EPSILON;
+                ++numRays;
+                if (!m_bvh.IsOccluded(Ray(hitPoint, s_LIGHT_DIRECTION), std::numeric_limits<float>::infinity())) {
+                    lighting += (1.0f - s_AMBIENT) * lambert;
+                }
+            }
+
+            const Vec4 litColor = { color.x * lighting, color.y * lighting, color.z * lighting, color.w };
+            m_colorBuffer[y * m_width + x] = PackColor(litColor);
+        }
+    }
+
+    return numRays;
+}
+
+}  // namespace dw
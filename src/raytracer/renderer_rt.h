@@ -0,0 +1,85 @@
+#pragma once
+
+#include "irenderer.h"
+#include "commandstream.h"
+#include "cpu/resourcestore_cpu.h"
+#include "raytracer/bvh.h"
+#include "utils/threadpool.h"
+#include <memory>
+
+namespace dw {
+
+struct PlatformData;
+struct InitData;
+
+// CPU ray tracer fed by the same resources and command buffers as the rasterizers. Replaying the
+// commands gathers the drawn triangles in world space, using the model matrix of the bound constant
+// buffer ({ mat4 model; mat4 view; mat4 proj; } like the standard program), a BVH is then built over
+// them and every pixel traces a primary ray plus a shadow ray towards a fixed directional light.
+// Like the software rasterizer, draws need a bound pipeline state but its shaders are ignored.
+// Instanced draws add one copy of the triangles per instance.
+class RendererRT final : public IRenderer {
+public:
+    virtual bool Initialize(const RendererCaps& /*caps*/, const PlatformData& data) override;
+
+    virtual bool CreateConstantBuffer(const GfxObject& object, uint32_t size) override { return m_resources.CreateConstantBuffer(object, size); }
+    virtual bool CreateVertexBuffer(const GfxObject& object, uint32_t count, const VertexLayout& layout) override { return m_resources.CreateVertexBuffer(object, count, layout); }
+    virtual bool CreateIndexBuffer(const GfxObject& object, uint32_t count, IndexFormat format) override { return m_resources.CreateIndexBuffer(object, count, format); }
+    virtual bool CreatePipelineState(const GfxObject& object, const PipelineState& /*state*/) override { return m_resources.CreatePipelineState(object); }
+    virtual bool CreateSamplerState(const GfxObject& /*object*/, const SamplerDescription& /*description*/) override { return false; }
+    virtual bool CreateTexture(const GfxObject& /*object*/, const TextureDescription& /*description*/, const std::vector<void*>& /*data*/) override { return false; }
+
+    virtual void* MapConstantBuffer(const GfxObject& handle) override { return m_resources.MapConstantBuffer(handle); }
+    virtual void* MapVertexBuffer(const GfxObject& handle) override { return m_resources.MapVertexBuffer(handle); }
+    virtual void* MapIndexBuffer(const GfxObject& handle) override { return m_resources.MapIndexBuffer(handle); }
+    virtual void UnmapVertexBuffer(const GfxObject& handle) override { m_resources.UnmapVertexBuffer(handle); }
+    virtual void UnmapIndexBuffer(const GfxObject& /*handle*/) override {};
+    virtual void UnmapConstantBuffer(const GfxObject& /*handle*/) override {};
+
+    virtual void DestroyConstantBuffer(const GfxObject& handle) override { m_resources.DestroyConstantBuffer(handle); }
+    virtual void DestroyVertexBuffer(const GfxObject& handle) override { m_resources.DestroyVertexBuffer(handle); }
+    virtual void DestroyIndexBuffer(const GfxObject& handle) override { m_resources.DestroyIndexBuffer(handle); }
+    virtual void DestroyTexture(const GfxObject& /*handle*/) override {};
+    virtual void DestroyPipelineState(const GfxObject& handle) override { m_resources.DestroyPipelineState(handle); }
+    virtual void DestroySamplerState(const GfxObject& /*handle*/) override {};
+
+    // Actual rendering commands that operate on updated and ready resources.
+    virtual void Render(const CommandStream& commands) override;
+
+    virtual bool ReadColorBuffer(std::vector<uint32_t>& pixels, uint32_t& width, uint32_t& height) override;
+    virtual FrameStats GetFrameStats() const override;
+
+private:
+    void draw(const DrawCommand& data);
+    void drawInstanced(const DrawInstancedCommand& data);
+    void drawIndexed(const DrawIndexedCommand& data);
+    void drawVertices(uint32_t count, uint32_t startVertex, const InstanceData& instance);
+
+    Mat4 readConstants();
+    void addTriangle(const Mat4& model, const float* const vertices[3], const InstanceData& instance);
+
+    uint64_t traceTile(uint32_t tileIndex, const Mat4& invViewProj);
+
+    ResourceStoreCPU m_resources;
+
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    uint32_t m_tilesX = 0;
+    uint32_t m_tilesY = 0;
+    std::vector<uint32_t> m_colorBuffer;
+
+    // Scene gathered from the draws of the current frame
+    std::vector<BVHTriangle> m_triangles;
+    std::vector<Vec4> m_triangleColors; // Three per triangle
+    Mat4 m_viewProj;
+    BVH m_bvh;
+
+    double m_megaRaysPerSecond = 0.0;
+    uint64_t m_statsRays = 0;
+    double m_statsSeconds = 0.0;
+    uint32_t m_statsFrames = 0;
+
+    std::unique_ptr<ThreadPool> m_threadPool;
+};
+
+}  // namespace dw
@@ -1,8 +1,21 @@
 #include "direwolf/renderengine.h"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
-// TODO: Build definitions should decide what we include and build
-#include "opengl/renderer_ogl.h"
+#include <string>
+#if defined(DW_OPENGL_ENABLED)
+  #include "opengl/renderer_ogl.h"
+#endif
+#if defined(DW_SOFTWARE_ENABLED)
+  #include "software/renderer_sw.h"
+#endif
+#if defined(DW_RAYTRACER_ENABLED)
+  #include "raytracer/renderer_rt.h"
+#endif
+#if defined(DW_VULKAN_ENABLED)
+  #include "vulkan/renderer_vk.h"
+#endif
 #include "utils/logger.h"
 
 namespace dw {
@@ -11,70 +24,486 @@ RenderEngine::RenderEngine(const PlatformData& platformData, const InitData& ini
 // TODO: How to non-IDE detect Release/Debug mode? We want DW_DEBUG or equivalent 
     Logger::Init(Logger::DEBUG, "");
     LOGD("Setting up DireWolf!");
+    m_instanceBatching = initData.instanceBatching;
 
-    switch(initData.rendererType) {
-        case RASTERIZER:
-            _SetupRasterizer(platformData, initData.backendType);
-            break;
-        case RAYTRACER:
-            std::cerr << "Not implemented yet\n";
-            break;
-        default:
-            std::cerr << "Unknown renderer type\n";
+    if (initData.threadedRendering) {
+        LOGI("Rendering on a dedicated thread with " + std::to_string(initData.frameQueueDepth) + " queued frames");
+        m_renderThread = std::make_unique<RenderThread>(initData.frameQueueDepth);
     }
+
+    // The context has to be created on the thread that will use it
+    _Execute([&] {
+        switch(initData.rendererType) {
+            case RASTERIZER:
+                _SetupRasterizer(platformData, initData);
+                break;
+            case RAYTRACER:
+                _SetupRaytracer(platformData);
+                break;
+            default:
+                std::cerr << "Unknown renderer type\n";
+        }
+    });
 }
 
 RenderEngine::~RenderEngine() {
+    if (m_instanceBuffer.IsValid()) {
+        DestroyVertexBuffer(m_instanceBuffer);
+    }
+    _Execute([this] { m_renderer.reset(); });
+    m_renderThread.reset();
     Logger::Destroy();
 }
 
-bool RenderEngine::CreateConstantBuffer(const GfxObject& object, uint32_t size) const {
-    return m_renderer->CreateConstantBuffer(object, size);
+bool RenderEngine::CreateConstantBuffer(GfxObject& object, uint32_t size) {
+    return _Create(object, [&](const GfxObject& handle) {
+        if (!m_renderer->CreateConstantBuffer(handle, size)) {
+            return false;
+        }
+        m_bufferSizes.Insert(handle, size);
+        return true;
+    });
 }
 
 void* RenderEngine::MapConstantBuffer(const GfxObject& object) const {
-    return m_renderer->MapConstantBuffer(object);
+    if (!_IsAlive(object, "MapConstantBuffer")) {
+        return nullptr;
+    }
+    void* result = nullptr;
+    _Execute([&] { result = m_renderer->MapConstantBuffer(object); });
+    return result;
 }
 
 void RenderEngine::UnmapConstantBuffer(const GfxObject& object) const {
-    m_renderer->UnmapConstantBuffer(object);
+    if (_IsAlive(object, "UnmapConstantBuffer")) {
+        _Execute([&] { m_renderer->UnmapConstantBuffer(object); });
+    }
 }
 
-bool RenderEngine::CreateVertexBuffer(const GfxObject& object, uint32_t count) const {
-    return m_renderer->CreateVertexBuffer(object, count);
+void RenderEngine::DestroyConstantBuffer(const GfxObject& object) {
+    if (_IsAlive(object, "DestroyConstantBuffer")) {
+        _Execute([&] {
+            m_renderer->DestroyConstantBuffer(object);
+            m_bufferSizes.Erase(object);
+        });
+        m_handles.Free(object);
+    }
+}
+
+bool RenderEngine::CreateVertexBuffer(GfxObject& object, uint32_t count, const VertexLayout& layout) {
+    if (!_IsValid(layout)) {
+        object = GfxObject();
+        return false;
+    }
+    return _Create(object, [&](const GfxObject& handle) {
+        if (!m_renderer->CreateVertexBuffer(handle, count, layout)) {
+            return false;
+        }
+        m_bufferSizes.Insert(handle, static_cast<uint64_t>(count) * layout.stride);
+        return true;
+    });
 }
 
 void* RenderEngine::MapVertexBuffer(const GfxObject& object) {
-    return m_renderer->MapVertexBuffer(object);
+    if (!_IsAlive(object, "MapVertexBuffer")) {
+        return nullptr;
+    }
+    void* result = nullptr;
+    _Execute([&] { result = m_renderer->MapVertexBuffer(object); });
+    return result;
 }
 
 void RenderEngine::UnmapVertexBuffer(const GfxObject& object) {
-    m_renderer->UnmapVertexBuffer(object);
+    if (_IsAlive(object, "UnmapVertexBuffer")) {
+        _Execute([&] { m_renderer->UnmapVertexBuffer(object); });
+    }
+}
+
+void RenderEngine::DestroyVertexBuffer(const GfxObject& object) {
+    if (_IsAlive(object, "DestroyVertexBuffer")) {
+        _Execute([&] {
+            m_renderer->DestroyVertexBuffer(object);
+            m_bufferSizes.Erase(object);
+        });
+        m_handles.Free(object);
+    }
+}
+
+bool RenderEngine::CreateIndexBuffer(GfxObject& object, uint32_t count, IndexFormat format) {
+    return _Create(object, [&](const GfxObject& handle) { return m_renderer->CreateIndexBuffer(handle, count, format); });
+}
+
+void* RenderEngine::MapIndexBuffer(const GfxObject& object) {
+    if (!_IsAlive(object, "MapIndexBuffer")) {
+        return nullptr;
+    }
+    void* result = nullptr;
+    _Execute([&] { result = m_renderer->MapIndexBuffer(object); });
+    return result;
+}
+
+void RenderEngine::UnmapIndexBuffer(const GfxObject& object) {
+    if (_IsAlive(object, "UnmapIndexBuffer")) {
+        _Execute([&] { m_renderer->UnmapIndexBuffer(object); });
+    }
+}
+
+void RenderEngine::DestroyIndexBuffer(const GfxObject& object) {
+    if (_IsAlive(object, "DestroyIndexBuffer")) {
+        _Execute([&] { m_renderer->DestroyIndexBuffer(object); });
+        m_handles.Free(object);
+    }
+}
+
+bool RenderEngine::CreatePipelineState(GfxObject& object, const PipelineState& pipelineState) {
+    return _Create(object, [&](const GfxObject& handle) { return m_renderer->CreatePipelineState(handle, pipelineState); });
+}
+
+void RenderEngine::DestroyPipelineState(const GfxObject& object) {
+    if (_IsAlive(object, "DestroyPipelineState")) {
+        _Execute([&] { m_renderer->DestroyPipelineState(object); });
+        m_handles.Free(object);
+    }
+}
+
+bool RenderEngine::CreateTexture(GfxObject& object, const TextureDescription& description, const std::vector<void*>& data) {
+    if (!_IsValid(description, data)) {
+        object = GfxObject();
+        return false;
+    }
+    return _Create(object, [&](const GfxObject& handle) { return m_renderer->CreateTexture(handle, description, data); });
+}
+
+bool RenderEngine::UpdateTexture(const GfxObject& object, uint32_t layer, uint32_t level, const void* data) {
+    if (!_IsAlive(object, "UpdateTexture")) {
+        return false;
+    }
+    bool result = false;
+    _Execute([&] { result = m_renderer->UpdateTexture(object, layer, level, data); });
+    return result;
+}
+
+bool RenderEngine::SetTextureFirstLevel(const GfxObject& object, uint32_t level) {
+    if (!_IsAlive(object, "SetTextureFirstLevel")) {
+        return false;
+    }
+    bool result = false;
+    _Execute([&] { result = m_renderer->SetTextureFirstLevel(object, level); });
+    return result;
+}
+
+void RenderEngine::DestroyTexture(const GfxObject& object) {
+    if (_IsAlive(object, "DestroyTexture")) {
+        _Execute([&] { m_renderer->DestroyTexture(object); });
+        m_handles.Free(object);
+    }
+}
+
+bool RenderEngine::CreateSamplerState(GfxObject& object, const SamplerDescription& description) {
+    return _Create(object, [&](const GfxObject& handle) { return m_renderer->CreateSamplerState(handle, description); });
+}
+
+void RenderEngine::DestroySamplerState(const GfxObject& object) {
+    if (_IsAlive(object, "DestroySamplerState")) {
+        _Execute([&] { m_renderer->DestroySamplerState(object); });
+        m_handles.Free(object);
+    }
+}
+
+bool RenderEngine::IsPipelineStateReady(const GfxObject& object) const {
+    if (!_IsAlive(object, "IsPipelineStateReady")) {
+        return false;
+    }
+    bool isReady = false;
+    _Execute([&] { isReady = m_renderer->IsPipelineStateReady(object); });
+    return isReady;
+}
+
+bool RenderEngine::UpdatePipelineState(const GfxObject& object, const PipelineState& pipelineState) {
+    if (!_IsAlive(object, "UpdatePipelineState")) {
+        return false;
+    }
+    bool result = false;
+    _Execute([&] { result = m_renderer->UpdatePipelineState(object, pipelineState); });
+    return result;
 }
 
-bool RenderEngine::CreatePipelineState(const GfxObject& object, const PipelineState& pipelineState) const {
-    return m_renderer->CreatePipelineState(object, pipelineState);
+void RenderEngine::Render(const CommandStream& commands) const {
+    if (!m_renderer) {
+        return;
+    }
+    if (m_renderThread) {
+        m_renderThread->SubmitFrame(commands, [this](const CommandStream& frame) {
+            _ApplyUpdates(frame);
+            m_renderer->Render(frame);
+        });
+    } else {
+        _ApplyUpdates(commands);
+        m_renderer->Render(commands);
+    }
+}
+
+void RenderEngine::Flush() const {
+    if (m_renderThread) {
+        m_renderThread->Flush();
+    }
+}
+
+FrameStats RenderEngine::GetFrameStats() const {
+    FrameStats stats;
+    if (m_renderer) {
+        _Execute([&] { stats = m_renderer->GetFrameStats(); });
+    }
+    return stats;
+}
+
+bool RenderEngine::ReadColorBuffer(std::vector<uint32_t>& pixels, uint32_t& width, uint32_t& height) const {
+    bool result = false;
+    if (m_renderer) {
+        _Execute([&] { result = m_renderer->ReadColorBuffer(pixels, width, height); });
+    }
+    return result;
+}
+
+void RenderEngine::Render(const std::vector<RenderCommand>& commandBuffer) {
+    m_commandStream.Reset();
+    for (const RenderCommand& command : commandBuffer) {
+        switch (command.type) {
+            case BIND_VERTEX_BUFFER:
+                m_commandStream.BindVertexBuffer(*static_cast<BindVertexBufferCommandData*>(command.data)->object);
+                break;
+            case BIND_PIPELINE_STATE:
+                m_commandStream.BindPipelineState(*static_cast<BindPipelineStateCommandData*>(command.data)->object);
+                break;
+            case BIND_CONSTANT_BUFFER:
+                m_commandStream.BindConstantBuffer(*static_cast<BindConstantBufferCommandData*>(command.data)->object);
+                break;
+            case BIND_INDEX_BUFFER:
+                m_commandStream.BindIndexBuffer(*static_cast<BindIndexBufferCommandData*>(command.data)->object);
+                break;
+            case BIND_TEXTURES: {
+                const BindTexturesCommandData* data = static_cast<BindTexturesCommandData*>(command.data);
+                m_commandStream.BindTextures(data->startSlot, data->objects, data->count);
+                break;
+            }
+            case BIND_SAMPLERS: {
+                const BindSamplersCommandData* data = static_cast<BindSamplersCommandData*>(command.data);
+                m_commandStream.BindSamplers(data->startSlot, data->objects, data->count);
+                break;
+            }
+            case DRAW: {
+                const DrawCommandData* data = static_cast<DrawCommandData*>(command.data);
+                m_commandStream.Draw(data->count, data->startVertex);
+                break;
+            }
+            case DRAW_INDEXED: {
+                const DrawIndexedCommandData* data = static_cast<DrawIndexedCommandData*>(command.data);
+                m_commandStream.DrawIndexed(data->count, data->startIndex, data->baseVertex);
+                break;
+            }
+            case DRAW_INSTANCED: {
+                const DrawInstancedCommandData* data = static_cast<DrawInstancedCommandData*>(command.data);
+                m_commandStream.DrawInstanced(data->count, data->startVertex, data->instanceCount, data->startInstance, *data->instanceBuffer);
+                break;
+            }
+            default:
+                std::cerr << "Unsupported rendering command!" << std::endl;
+        }
+    }
+    Render(m_commandStream);
 }
 
-void RenderEngine::Render(const std::vector<RenderCommand>& commandBuffer) const {
-    return m_renderer->Render(commandBuffer);
+void RenderEngine::Render(RenderQueue& queue) {
+    queue.Sort();
+    m_commandStream.Reset();
+    if (!m_instanceBatching || !_ReserveInstances(queue.GetDrawCount())) {
+        queue.Write(m_commandStream);
+        Render(m_commandStream);
+        return;
+    }
+
+    m_instances.clear();
+    queue.WriteInstanced(m_commandStream, m_instanceBuffer, m_instances);
+    // InstanceData has the layout of one vertex buffer element
+    static_assert(sizeof(InstanceData) == 8 * sizeof(float), "Instance data must match the vertex buffer element size");
+    // Travels with the frame instead of a synchronous map, so queued frames don't have to be rendered first
+    if (!m_instances.empty()) {
+        m_commandStream.UpdateVertexBuffer(m_instanceBuffer, m_instances.data(), static_cast<uint32_t>(m_instances.size() * sizeof(InstanceData)), 0, true);
+    }
+    Render(m_commandStream);
 }
 
-void RenderEngine::_SetupRasterizer(const PlatformData& platformData, const BackendType& type) {
+void RenderEngine::Render(const ParallelCommandRecorder& recorder) {
+    m_commandStream.Reset();
+    recorder.Merge(m_commandStream);
+    Render(m_commandStream);
+}
+
+void RenderEngine::_SetupRasterizer(const PlatformData& platformData, const InitData& initData) {
     LOGI("Initializing rasterizer");
     RendererCaps caps = {};
-    switch (type) {
+    caps.shaderCacheDirectory = initData.shaderCacheDirectory;
+    caps.textureUploadBudget = initData.textureUploadBudget;
+    switch (initData.backendType) {
+#if defined(DW_OPENGL_ENABLED)
         case OPENGL:
             m_renderer = std::make_unique<RendererOGL>();
-            m_renderer->Initialize(caps, platformData);
             break;
+#endif
+#if defined(DW_SOFTWARE_ENABLED)
+        case SOFTWARE:
+            m_renderer = std::make_unique<RendererSW>();
+            break;
+#endif
+#if defined(DW_VULKAN_ENABLED)
         case VULKAN:
-            // TODO: Callbam
-            std::cerr << "No vulkan renderer implemented yet!\n";
+            m_renderer = std::make_unique<RendererVK>();
             break;
+#endif
         default:
             std::cerr << "What are you doing\n";
     }
+    _Initialize(caps, platformData);
+}
+
+void RenderEngine::_SetupRaytracer(const PlatformData& platformData) {
+    LOGI("Initializing ray tracer");
+#if defined(DW_RAYTRACER_ENABLED)
+    RendererCaps caps = {};
+    m_renderer = std::make_unique<RendererRT>();
+    _Initialize(caps, platformData);
+#else
+    std::cerr << "DireWolf was built without the ray tracer\n";
+#endif
+}
+
+void RenderEngine::_Initialize(const RendererCaps& caps, const PlatformData& platformData) {
+    if (m_renderer && !m_renderer->Initialize(caps, platformData)) {
+        LOGE("Failed to initialize the renderer backend, nothing will be rendered");
+        m_renderer.reset();
+    }
+}
+
+bool RenderEngine::_IsAlive(const GfxObject& object, const char* operation) const {
+    if (!m_handles.IsAlive(object)) {
+        LOGE(std::string(operation) + " called with a stale or invalid handle " + std::to_string(object.id));
+        return false;
+    }
+    return true;
+}
+
+bool RenderEngine::_IsValid(const VertexLayout& layout) const {
+    if (layout.attributeCount == 0 || layout.attributeCount > VertexLayout::s_MAX_ATTRIBUTES || layout.stride == 0) {
+        LOGE("Vertex layout needs between 1 and " + std::to_string(VertexLayout::s_MAX_ATTRIBUTES) + " attributes and a stride");
+        return false;
+    }
+    uint32_t usedLocations = 0;
+    for (uint32_t i = 0; i < layout.attributeCount; ++i) {
+        const VertexAttribute& attribute = layout.attributes[i];
+        if (attribute.location == 2 || attribute.location == 3 || attribute.location >= 16) {
+            LOGE("Vertex attribute location " + std::to_string(attribute.location) + " is reserved or out of range");
+            return false;
+        }
+        if (usedLocations & (1u << attribute.location)) {
+            LOGE("Vertex attribute location " + std::to_string(attribute.location) + " is used twice");
+            return false;
+        }
+        usedLocations |= 1u << attribute.location;
+        if (attribute.offset % 4 != 0 || attribute.offset + GetVertexFormatSize(attribute.format) > layout.stride) {
+            LOGE("Vertex attribute at offset " + std::to_string(attribute.offset) + " is misaligned or crosses the stride");
+            return false;
+        }
+    }
+    if (layout.stride % 4 != 0) {
+        LOGE("Vertex stride " + std::to_string(layout.stride) + " must be a multiple of 4");
+        return false;
+    }
+    return true;
+}
+
+bool RenderEngine::_IsValid(const TextureDescription& description, const std::vector<void*>& data) const {
+    if (description.width == 0 || description.height == 0 || description.layers == 0 || description.mipLevels == 0) {
+        LOGE("Texture needs a size, at least one layer and one mip level");
+        return false;
+    }
+    const uint32_t maxLevels = GetMipLevelCount(description.width, description.height);
+    if (description.mipLevels > maxLevels) {
+        LOGE("Texture of " + std::to_string(description.width) + "x" + std::to_string(description.height) + " has at most "
+             + std::to_string(maxLevels) + " mip levels");
+        return false;
+    }
+    if (!data.empty() && data.size() != static_cast<size_t>(description.layers) * description.mipLevels) {
+        LOGE("Texture data has " + std::to_string(data.size()) + " levels, expected one per mip level of every layer");
+        return false;
+    }
+    return true;
+}
+
+bool RenderEngine::_Create(GfxObject& object, const std::function<bool(const GfxObject&)>& create) {
+    if (!m_renderer) {
+        object = GfxObject();
+        return false;
+    }
+    const GfxObject handle = m_handles.Allocate();
+    bool result = false;
+    _Execute([&] { result = create(handle); });
+    if (!result) {
+        m_handles.Free(handle);
+        object = GfxObject();
+        return false;
+    }
+    object = handle;
+    return true;
+}
+
+bool RenderEngine::_ReserveInstances(uint32_t count) {
+    if (count <= m_instanceCapacity) {
+        return true;
+    }
+    if (m_instanceBuffer.IsValid()) {
+        DestroyVertexBuffer(m_instanceBuffer);
+    }
+
+    // Grow geometrically so a slowly growing scene doesn't recreate the buffer every frame
+    m_instanceCapacity = std::max(count, m_instanceCapacity * 2);
+    if (!CreateVertexBuffer(m_instanceBuffer, m_instanceCapacity)) {
+        LOGE("Failed to create an instance buffer for " + std::to_string(m_instanceCapacity) + " instances, drawing without batching");
+        m_instanceCapacity = 0;
+        return false;
+    }
+    return true;
+}
+
+void RenderEngine::_ApplyUpdates(const CommandStream& commands) const {
+    for (const CommandStream::Header* command = commands.Begin(); command != commands.End(); command = CommandStream::Next(command)) {
+        if (command->type != UPDATE_CONSTANT_BUFFER && command->type != UPDATE_VERTEX_BUFFER) {
+            continue;
+        }
+        const UpdateBufferCommand& update = CommandStream::Payload<UpdateBufferCommand>(command);
+        const void* data = CommandStream::PayloadData<UpdateBufferCommand>(command);
+        const uint64_t* bufferSize = m_bufferSizes.Find(update.object);
+        if (!bufferSize || static_cast<uint64_t>(update.offset) + update.size > *bufferSize) {
+            LOGE("Buffer update of " + std::to_string(update.size) + " bytes at offset " + std::to_string(update.offset) + " doesn't fit the buffer, skipping it");
+            continue;
+        }
+        if (command->type == UPDATE_CONSTANT_BUFFER) {
+            uint8_t* mapped = static_cast<uint8_t*>(m_renderer->MapConstantBuffer(update.object));
+            if (mapped) {
+                std::memcpy(mapped + update.offset, data, update.size);
+                m_renderer->UnmapConstantBuffer(update.object);
+            }
+        } else {
+            m_renderer->UpdateVertexBuffer(update.object, update.offset, update.size, data, update.discard);
+        }
+    }
+}
+
+void RenderEngine::_Execute(const std::function<void()>& task) const {
+    if (m_renderThread) {
+        m_renderThread->Execute(task);
+    } else {
+        task();
+    }
 }
 
 }  // namespace dw
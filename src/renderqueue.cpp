@@ -0,0 +1,134 @@
+#include "renderqueue.h"
+#include "commandstream.h"
+
+#include <algorithm>
+
+namespace {
+    const uint32_t s_DEPTH_BITS = 24;
+    const uint32_t s_RADIX_BITS = 8;
+    const uint32_t s_RADIX_SIZE = 1 << s_RADIX_BITS;
+    const uint32_t s_NUM_PASSES = 64 / s_RADIX_BITS;
+}
+
+namespace dw {
+
+uint64_t RenderQueue::MakeKey(uint8_t layer, uint16_t pipeline, uint16_t material, float depth) {
+    const float clampedDepth = std::min(std::max(depth, 0.0f), 1.0f);
+    // In double, 2^24 - 1 + 0.5 rounds up to 2^24 in float and a depth of 1 would spill into the material
+    const uint64_t quantizedDepth = static_cast<uint64_t>(clampedDepth * static_cast<double>((1 << s_DEPTH_BITS) - 1) + 0.5);
+    return (static_cast<uint64_t>(layer) << 56) | (static_cast<uint64_t>(pipeline) << 40) | (static_cast<uint64_t>(material) << 24) | quantizedDepth;
+}
+
+void RenderQueue::Submit(uint64_t key, const QueuedDraw& draw) {
+    m_items.push_back({ key, static_cast<uint32_t>(m_draws.size()) });
+    m_draws.push_back(draw);
+}
+
+void RenderQueue::Sort() {
+    const size_t count = m_items.size();
+    m_scratch.resize(count);
+
+    // One histogram per byte, all gathered in a single read of the keys
+    uint32_t histograms[s_NUM_PASSES][s_RADIX_SIZE] = {};
+    for (const SortItem& item : m_items) {
+        for (uint32_t pass = 0; pass < s_NUM_PASSES; ++pass) {
+            ++histograms[pass][(item.key >> (pass * s_RADIX_BITS)) & (s_RADIX_SIZE - 1)];
+        }
+    }
+
+    for (uint32_t pass = 0; pass < s_NUM_PASSES; ++pass) {
+        uint32_t* histogram = histograms[pass];
+        const uint32_t shift = pass * s_RADIX_BITS;
+
+        // Keys rarely use all 64 bits, a byte that is the same for every key leaves the order as is
+        if (count == 0 || histogram[(m_items[0].key >> shift) & (s_RADIX_SIZE - 1)] == count) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t digit = 0; digit < s_RADIX_SIZE; ++digit) {
+            const uint32_t digitCount = histogram[digit];
+            histogram[digit] = offset;
+            offset += digitCount;
+        }
+        for (const SortItem& item : m_items) {
+            m_scratch[histogram[(item.key >> shift) & (s_RADIX_SIZE - 1)]++] = item;
+        }
+        m_items.swap(m_scratch);
+    }
+}
+
+void RenderQueue::Write(CommandStream& stream) const {
+    BoundState bound;
+    for (const SortItem& item : m_items) {
+        const QueuedDraw& draw = m_draws[item.index];
+        writeBinds(stream, draw, bound);
+        writeDraw(stream, draw);
+    }
+}
+
+void RenderQueue::WriteInstanced(CommandStream& stream, const GfxObject& instanceBuffer, std::vector<InstanceData>& instances) const {
+    BoundState bound;
+    for (size_t first = 0; first < m_items.size();) {
+        const QueuedDraw& draw = m_draws[m_items[first].index];
+
+        // The sort already put draws sharing a pipeline and material next to each other
+        size_t last = first + 1;
+        while (last < m_items.size() && !draw.indexBuffer.IsValid()) {
+            const QueuedDraw& next = m_draws[m_items[last].index];
+            if (next.pipelineState != draw.pipelineState || next.vertexBuffer != draw.vertexBuffer || next.constantBuffer != draw.constantBuffer
+                || next.indexBuffer.IsValid() || next.count != draw.count || next.startVertex != draw.startVertex) {
+                break;
+            }
+            ++last;
+        }
+
+        writeBinds(stream, draw, bound);
+        if (draw.indexBuffer.IsValid()) {
+            writeDraw(stream, draw);
+            first = last;
+            continue;
+        }
+        const uint32_t startInstance = static_cast<uint32_t>(instances.size());
+        for (size_t i = first; i < last; ++i) {
+            instances.push_back(m_draws[m_items[i].index].instance);
+        }
+        stream.DrawInstanced(draw.count, draw.startVertex, static_cast<uint32_t>(last - first), startInstance, instanceBuffer);
+        first = last;
+    }
+}
+
+void RenderQueue::writeBinds(CommandStream& stream, const QueuedDraw& draw, BoundState& bound) {
+    if (draw.pipelineState != bound.pipelineState && draw.pipelineState.IsValid()) {
+        stream.BindPipelineState(draw.pipelineState);
+        bound.pipelineState = draw.pipelineState;
+    }
+    if (draw.constantBuffer != bound.constantBuffer && draw.constantBuffer.IsValid()) {
+        stream.BindConstantBuffer(draw.constantBuffer);
+        bound.constantBuffer = draw.constantBuffer;
+    }
+    if (draw.vertexBuffer != bound.vertexBuffer) {
+        stream.BindVertexBuffer(draw.vertexBuffer);
+        bound.vertexBuffer = draw.vertexBuffer;
+        bound.indexBuffer = GfxObject(); // Vertex arrays keep their own index buffer in OpenGL, bind it again
+    }
+    if (draw.indexBuffer != bound.indexBuffer && draw.indexBuffer.IsValid()) {
+        stream.BindIndexBuffer(draw.indexBuffer);
+        bound.indexBuffer = draw.indexBuffer;
+    }
+}
+
+void RenderQueue::writeDraw(CommandStream& stream, const QueuedDraw& draw) {
+    if (draw.indexBuffer.IsValid()) {
+        stream.DrawIndexed(draw.count, draw.startIndex, draw.baseVertex);
+    } else {
+        stream.Draw(draw.count, draw.startVertex);
+    }
+}
+
+void RenderQueue::Clear() {
+    m_draws.clear();
+    m_items.clear();
+}
+
+} // namespace dw
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "irenderer.h"
+#include <cstdint>
+#include <vector>
+
+namespace dw {
+
+class CommandStream;
+
+// Everything needed to replay a draw on its own, the queue decides which binds are actually emitted.
+// instance is only used by WriteInstanced, Write draws every copy with the default instance data.
+// With an index buffer count indices are drawn from startIndex offset by baseVertex, startVertex is unused.
+struct QueuedDraw {
+    GfxObject pipelineState;
+    GfxObject vertexBuffer;
+    GfxObject constantBuffer;
+    uint32_t count;
+    uint32_t startVertex;
+    InstanceData instance;
+    GfxObject indexBuffer;
+    uint32_t startIndex = 0;
+    int32_t baseVertex = 0;
+};
+
+// Collects draws in any order and sorts them by a 64-bit key before they are written to a CommandStream.
+// Key layout, most significant first:
+//   [63..56] layer     8 bits, i.e opaque before transparent
+//   [55..40] pipeline 16 bits
+//   [39..24] material 16 bits
+//   [23..0]  depth    24 bits
+// so draws sharing a pipeline, then a material, end up next to each other and the redundant binds
+// between them are dropped.
+class RenderQueue {
+public:
+    /* Builds a key from its fields, depth is clamped to [0, 1]. Pass 1 - depth for back to front */
+    static uint64_t MakeKey(uint8_t layer, uint16_t pipeline, uint16_t material, float depth);
+
+    void Submit(uint64_t key, const QueuedDraw& draw);
+    /* Stable LSD radix sort of the submitted draws by key */
+    void Sort();
+    /* Writes the draws in their current order, binding only what changed since the previous draw */
+    void Write(CommandStream& stream) const;
+    /* Like Write, but consecutive draws of the same pipeline, buffers and vertex range become one DRAW_INSTANCED.
+       Their instance data is appended to instances, which the caller uploads to instanceBuffer before rendering.
+       The constant buffer is part of the match, objects only batch if they share one and differ by instance data
+       alone, draws with a constant buffer per object are never merged. There is no indexed instanced draw, indexed
+       draws are written one by one like Write does */
+    void WriteInstanced(CommandStream& stream, const GfxObject& instanceBuffer, std::vector<InstanceData>& instances) const;
+    /* Forgets all draws but keeps the storage for the next frame */
+    void Clear();
+
+    uint32_t GetDrawCount() const { return static_cast<uint32_t>(m_items.size()); }
+
+private:
+    struct BoundState {
+        GfxObject pipelineState;
+        GfxObject vertexBuffer;
+        GfxObject constantBuffer;
+        GfxObject indexBuffer;
+    };
+
+    static void writeBinds(CommandStream& stream, const QueuedDraw& draw, BoundState& bound);
+    static void writeDraw(CommandStream& stream, const QueuedDraw& draw);
+
+    struct SortItem {
+        uint64_t key;
+        uint32_t index; // Into m_draws
+    };
+
+    std::vector<QueuedDraw> m_draws;
+    std::vector<SortItem> m_items;
+    std::vector<SortItem> m_scratch;
+};
+
+} // namespace dw
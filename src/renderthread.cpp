@@ -0,0 +1,92 @@
+#include "renderthread.h"
+
+#include <algorithm>
+#include <future>
+
+namespace dw {
+
+RenderThread::RenderThread(uint32_t frameQueueDepth) : m_frames(std::max(1u, frameQueueDepth)) {
+    m_thread = std::thread(&RenderThread::threadLoop, this);
+}
+
+RenderThread::~RenderThread() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isShuttingDown = true;
+    }
+    m_taskCondition.notify_one();
+    m_thread.join();
+}
+
+void RenderThread::Execute(const std::function<void()>& task) {
+    // Waits on this task alone, frames submitted after it from other threads don't hold the caller up
+    std::promise<void> done;
+    std::future<void> finished = done.get_future();
+    push([&task, &done] {
+        task();
+        done.set_value();
+    });
+    finished.wait();
+}
+
+void RenderThread::SubmitFrame(const CommandStream& commands, const std::function<void(const CommandStream&)>& render) {
+    uint32_t frame;
+    {
+        // Wait for the oldest frame to be rendered when the queue is full
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_doneCondition.wait(lock, [this] { return m_framesInFlight < m_frames.size(); });
+        frame = m_nextFrame;
+        m_nextFrame = (m_nextFrame + 1) % m_frames.size();
+        ++m_framesInFlight;
+    }
+
+    // The slot is ours until its task finishes, the stream keeps its storage between frames
+    m_frames[frame].Reset();
+    m_frames[frame].Append(commands);
+
+    push([this, frame, render] {
+        render(m_frames[frame]);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        --m_framesInFlight;
+    });
+}
+
+void RenderThread::Flush() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    const uint64_t target = m_queuedTasks;
+    m_doneCondition.wait(lock, [this, target] { return m_finishedTasks >= target; });
+}
+
+void RenderThread::push(std::function<void()>&& task) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+        ++m_queuedTasks;
+    }
+    m_taskCondition.notify_one();
+}
+
+void RenderThread::threadLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_taskCondition.wait(lock, [this] { return !m_tasks.empty() || m_isShuttingDown; });
+            if (m_tasks.empty()) {
+                return; // Shutting down with nothing left to do
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+
+        task();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_finishedTasks;
+        }
+        m_doneCondition.notify_all();
+    }
+}
+
+} // namespace dw
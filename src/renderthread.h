@@ -0,0 +1,54 @@
+#pragma once
+
+#include "commandstream.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dw {
+
+// Thread owning all renderer calls when RenderEngine runs in threaded mode. Tasks run in the order they
+// were queued, so resource calls made after a frame see that frame submitted first. Frames are copied
+// into one of frameQueueDepth slots and rendered asynchronously, the caller only blocks when every slot
+// is still waiting to be rendered.
+class RenderThread {
+public:
+    explicit RenderThread(uint32_t frameQueueDepth);
+    /* Finishes all queued work before joining */
+    ~RenderThread();
+
+    RenderThread(const RenderThread& thread) = delete;
+    RenderThread& operator= (const RenderThread& thread) = delete;
+
+    /* Runs task on the render thread and waits for it to finish */
+    void Execute(const std::function<void()>& task);
+    /* Copies commands into a free frame slot and queues render(slot) without waiting for it */
+    void SubmitFrame(const CommandStream& commands, const std::function<void(const CommandStream&)>& render);
+    /* Blocks until every queued task and frame has been executed */
+    void Flush();
+
+    uint32_t GetFrameQueueDepth() const { return static_cast<uint32_t>(m_frames.size()); }
+
+private:
+    void threadLoop();
+    void push(std::function<void()>&& task);
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_taskCondition;
+    std::condition_variable m_doneCondition;
+    std::deque<std::function<void()>> m_tasks;
+    uint64_t m_queuedTasks = 0;
+    uint64_t m_finishedTasks = 0;
+
+    std::vector<CommandStream> m_frames;
+    uint32_t m_nextFrame = 0;
+    uint32_t m_framesInFlight = 0;
+    bool m_isShuttingDown = false;
+};
+
+} // namespace dw
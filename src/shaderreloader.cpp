@@ -0,0 +1,101 @@
+#include "shaderreloader.h"
+#include "direwolf/renderengine.h"
+#include "utils/logger.h"
+
+#include <algorithm>
+
+namespace dw {
+
+ShaderReloader::ShaderReloader(RenderEngine& engine, ShaderLoader& loader)
+    : m_engine(engine)
+    , m_loader(loader) {
+    if (!FileWatcher::IsSupported()) {
+        LOGW("Watching files isn't supported on this platform, shaders won't be reloaded");
+    }
+}
+
+bool ShaderReloader::CreatePipelineState(GfxObject& object, const std::string& vertexPath, const std::string& fragmentPath,
+                                         const PipelineState& pipelineState) {
+    Pipeline pipeline;
+    pipeline.vertexPath = vertexPath;
+    pipeline.fragmentPath = fragmentPath;
+    pipeline.state = pipelineState;
+    if (!load(pipeline) || !m_engine.CreatePipelineState(object, getState(pipeline, pipelineState.asynchronous))) {
+        object = GfxObject();
+        return false;
+    }
+
+    for (const std::string& file : pipeline.files) {
+        m_watcher.Watch(file);
+    }
+    pipeline.object = object;
+    m_pipelines.push_back(std::move(pipeline));
+    return true;
+}
+
+void ShaderReloader::DestroyPipelineState(const GfxObject& object) {
+    auto it = std::find_if(m_pipelines.begin(), m_pipelines.end(), [&](const Pipeline& pipeline) { return pipeline.object == object; });
+    if (it != m_pipelines.end()) {
+        m_pipelines.erase(it);
+    }
+    m_engine.DestroyPipelineState(object);
+}
+
+uint32_t ShaderReloader::Update() {
+    m_changed.clear();
+    m_watcher.Poll(m_changed);
+    if (m_changed.empty()) {
+        return 0;
+    }
+    for (const std::string& file : m_changed) {
+        LOGI("Reloading shaders using " + file);
+        m_loader.Invalidate(file);
+    }
+
+    uint32_t updated = 0;
+    for (Pipeline& pipeline : m_pipelines) {
+        if (!usesAny(pipeline, m_changed)) {
+            continue;
+        }
+        // Includes may have been added, watching a file twice is fine
+        if (!load(pipeline)) {
+            continue;
+        }
+        for (const std::string& file : pipeline.files) {
+            m_watcher.Watch(file);
+        }
+        if (m_engine.UpdatePipelineState(pipeline.object, getState(pipeline, true))) {
+            ++updated;
+        }
+    }
+    return updated;
+}
+
+// Leaves the sources in m_vertexSource and m_fragmentSource until the next load
+bool ShaderReloader::load(Pipeline& pipeline) {
+    if (!m_loader.Load(pipeline.vertexPath, m_vertexSource) || !m_loader.Load(pipeline.fragmentPath, m_fragmentSource)) {
+        return false;
+    }
+    pipeline.files = m_vertexSource.files;
+    pipeline.files.insert(pipeline.files.end(), m_fragmentSource.files.begin(), m_fragmentSource.files.end());
+    return true;
+}
+
+PipelineState ShaderReloader::getState(const Pipeline& pipeline, bool asynchronous) const {
+    PipelineState state = pipeline.state;
+    state.vertexShader = m_vertexSource.text.c_str();
+    state.fragmentShader = m_fragmentSource.text.c_str();
+    state.asynchronous = asynchronous;
+    return state;
+}
+
+bool ShaderReloader::usesAny(const Pipeline& pipeline, const std::vector<std::string>& files) const {
+    for (const std::string& file : files) {
+        if (std::find(pipeline.files.begin(), pipeline.files.end(), file) != pipeline.files.end()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace dw
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "irenderer.h"
+#include "utils/filewatcher.h"
+#include "utils/shaderloader.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace dw {
+
+class RenderEngine;
+
+// Creates pipeline states from shader files and rebuilds them when one of the files, or anything they
+// include, changes on disk. Only the pipelines using a changed file are rebuilt, asynchronously, and they keep
+// drawing with the previous shaders until the renderer swaps the new ones in at the start of a frame. Shaders
+// that fail to build are logged and the previous ones stay in use. The loader's include directories apply.
+class ShaderReloader {
+public:
+    ShaderReloader(RenderEngine& engine, ShaderLoader& loader);
+
+    /* Like RenderEngine::CreatePipelineState with the shaders read from the two files */
+    bool CreatePipelineState(GfxObject& object, const std::string& vertexPath, const std::string& fragmentPath,
+                             const PipelineState& pipelineState = PipelineState());
+    void DestroyPipelineState(const GfxObject& object);
+    /* Call once per frame from the thread using the engine. Rereads the files changed since the last call and
+       submits the pipeline rebuilds, returns how many pipelines were updated */
+    uint32_t Update();
+
+private:
+    struct Pipeline {
+        GfxObject object;
+        std::string vertexPath;
+        std::string fragmentPath;
+        PipelineState state; // Without the shader sources
+        std::vector<std::string> files; // Both shaders and their includes
+    };
+
+    bool load(Pipeline& pipeline);
+    /* The pipeline's state with the sources of the last load */
+    PipelineState getState(const Pipeline& pipeline, bool asynchronous) const;
+    bool usesAny(const Pipeline& pipeline, const std::vector<std::string>& files) const;
+
+    RenderEngine& m_engine;
+    ShaderLoader& m_loader;
+    FileWatcher m_watcher;
+    std::vector<Pipeline> m_pipelines;
+    std::vector<std::string> m_changed; // Reused by Update
+    ShaderSource m_vertexSource;
+    ShaderSource m_fragmentSource;
+};
+
+}  // namespace dw
@@ -0,0 +1,439 @@
+#include "renderer_sw.h"
+#include "common/config.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "utils/logger.h"
+
+namespace {
+    const uint32_t s_DEFAULT_WIDTH = 1024;
+    const uint32_t s_DEFAULT_HEIGHT = 768;
+    const uint32_t s_TILE_SIZE = 64;
+    const uint32_t s_VERTEX_STRIDE = dw::ResourceStoreCPU::s_VERTEX_STRIDE;
+    const uint32_t s_VERTICES_PER_JOB = 4096;
+    const uint32_t s_TRIANGLES_PER_JOB = 2048;
+    const uint32_t s_CLEAR_COLOR = 0x00660000; // RGBA8 (0.0, 0.0, 0.4, 0.0), same ugly color as the OpenGL backend
+    const int64_t s_SUBPIXELS = 16; // Vertices snap to 1/16 pixel
+    const float s_GUARD_BAND = 8.0f; // Clipped to |x|, |y| <= s_GUARD_BAND * w, i.e. 3.5 viewports past each side
+    const uint32_t s_NUM_CLIP_PLANES = 5;
+
+    // Positive inside the near plane (z >= -w) and the four guard band planes
+    float PlaneDistance(const dw::Vec4& position, uint32_t plane) {
+        switch (plane) {
+            case 0: return position.z + position.w;
+            case 1: return s_GUARD_BAND * position.w + position.x;
+            case 2: return s_GUARD_BAND * position.w - position.x;
+            case 3: return s_GUARD_BAND * position.w + position.y;
+            default: return s_GUARD_BAND * position.w - position.y;
+        }
+    }
+
+    // Bit i set if the position is outside plane i, or not a number
+    uint32_t GetOutcode(const dw::Vec4& position) {
+        const float band = s_GUARD_BAND * position.w;
+        return (position.z + position.w >= 0.0f ? 0u : 1u) | (band + position.x >= 0.0f ? 0u : 2u) |
+               (band - position.x >= 0.0f ? 0u : 4u) | (band + position.y >= 0.0f ? 0u : 8u) |
+               (band - position.y >= 0.0f ? 0u : 16u);
+    }
+
+    // Clamps to [-limit, limit], NaN ends up at -limit
+    float Clamp(float value, float limit) {
+        return value > limit ? limit : (value > -limit ? value : -limit);
+    }
+}
+
+namespace dw {
+
+bool RendererSW::Initialize(const RendererCaps& /*caps*/, const PlatformData& platformData) {
+    LOGD("Initializing software renderer");
+
+    m_width = platformData.width ? platformData.width : s_DEFAULT_WIDTH;
+    m_height = platformData.height ? platformData.height : s_DEFAULT_HEIGHT;
+    m_tilesX = (m_width + s_TILE_SIZE - 1) / s_TILE_SIZE;
+    m_tilesY = (m_height + s_TILE_SIZE - 1) / s_TILE_SIZE;
+
+    m_colorBuffer.resize(m_width * m_height, s_CLEAR_COLOR);
+    m_depthBuffer.resize(m_width * m_height, 1.0f);
+
+    m_threadPool = std::make_unique<ThreadPool>();
+    LOGI("Software renderer running " + std::to_string(m_width) + "x" + std::to_string(m_height) + " on " + std::to_string(m_threadPool->GetNumThreads()) + " threads");
+    return true;
+}
+
+void RendererSW::Render(const CommandStream& commands) {
+    m_resources.ResetBindings();
+    m_numBlocks = 0;
+    m_isLastBlockShared = false;
+
+    // Replaying the commands only transforms and bins, tiles keep submission order in their bins
+    for (const CommandStream::Header* command = commands.Begin(); command != commands.End(); command = CommandStream::Next(command)) {
+        switch (command->type) {
+            case BIND_VERTEX_BUFFER:
+                m_resources.BindVertexBuffer(CommandStream::Payload<BindVertexBufferCommand>(command).object);
+                break;
+            case BIND_PIPELINE_STATE:
+                m_resources.BindPipelineState(CommandStream::Payload<BindPipelineStateCommand>(command).object);
+                break;
+            case BIND_CONSTANT_BUFFER:
+                m_resources.BindConstantBuffer(CommandStream::Payload<BindConstantBufferCommand>(command).object);
+                break;
+            case BIND_INDEX_BUFFER:
+                m_resources.BindIndexBuffer(CommandStream::Payload<BindIndexBufferCommand>(command).object);
+                break;
+            case DRAW:
+                draw(CommandStream::Payload<DrawCommand>(command));
+                break;
+            case DRAW_INSTANCED:
+                drawInstanced(CommandStream::Payload<DrawInstancedCommand>(command));
+                break;
+            case DRAW_INDEXED:
+                drawIndexed(CommandStream::Payload<DrawIndexedCommand>(command));
+                break;
+            case UPDATE_CONSTANT_BUFFER:
+            case UPDATE_VERTEX_BUFFER:
+                break; // Applied by RenderEngine before the frame
+            default:
+                std::cerr << "Unsupported rendering command!" << std::endl;
+        }
+    }
+
+    // Clearing is part of shading a tile, so untouched tiles are cleared in parallel as well
+    m_threadPool->ParallelFor(m_tilesX * m_tilesY, [this](uint32_t tileIndex) { shadeTile(tileIndex); });
+}
+
+bool RendererSW::ReadColorBuffer(std::vector<uint32_t>& pixels, uint32_t& width, uint32_t& height) {
+    pixels = m_colorBuffer;
+    width = m_width;
+    height = m_height;
+    return true;
+}
+
+void RendererSW::draw(const DrawCommand& data) {
+    const InstanceData instance;
+    drawVertices(data.count, data.startVertex, &instance, 1);
+}
+
+void RendererSW::drawInstanced(const DrawInstancedCommand& data) {
+    const auto* instanceBuffer = m_resources.FindVertexBuffer(data.instanceBuffer);
+    if (!instanceBuffer) {
+        LOGW("Skipping instanced draw without a valid instance buffer");
+        return;
+    }
+    assert((data.startInstance + data.instanceCount) * s_VERTEX_STRIDE <= instanceBuffer->vertices.size() && "Draw outside of instance buffer");
+
+    const InstanceData* instances = reinterpret_cast<const InstanceData*>(instanceBuffer->vertices.data()) + data.startInstance;
+    drawVertices(data.count, data.startVertex, instances, data.instanceCount);
+}
+
+// Only the referenced vertex range is transformed, triangles then pick their corners by index
+void RendererSW::drawIndexed(const DrawIndexedCommand& data) {
+    if (!m_resources.IsPipelineStateBound()) {
+        return;
+    }
+    const std::vector<float>* vertexBuffer = m_resources.GetBoundVertices();
+    const ResourceStoreCPU::IndexBuffer* indexBuffer = m_resources.GetBoundIndexBuffer();
+    assert(vertexBuffer && indexBuffer && "Indexed draw without a bound vertex and index buffer");
+    assert((data.startIndex + data.count) * GetIndexSize(indexBuffer->format) <= indexBuffer->data.size() && "Draw outside of index buffer");
+    if (data.count == 0) {
+        return;
+    }
+
+    m_indices.resize(data.count);
+    uint32_t minIndex = UINT32_MAX;
+    uint32_t maxIndex = 0;
+    for (uint32_t i = 0; i < data.count; ++i) {
+        m_indices[i] = ResourceStoreCPU::ReadIndex(*indexBuffer, data.startIndex + i);
+        minIndex = std::min(minIndex, m_indices[i]);
+        maxIndex = std::max(maxIndex, m_indices[i]);
+    }
+    const int64_t firstVertex = static_cast<int64_t>(minIndex) + data.baseVertex;
+    assert(firstVertex >= 0 && static_cast<size_t>(firstVertex + maxIndex - minIndex + 1) * s_VERTEX_STRIDE <= vertexBuffer->size() && "Draw outside of vertex buffer");
+
+    const InstanceData instance;
+    transformVertices(getModelViewProjection(), vertexBuffer->data() + firstVertex * s_VERTEX_STRIDE, maxIndex - minIndex + 1, &instance, 1);
+    setupTriangles(data.count / 3, [this, minIndex](uint32_t triangle, uint32_t corners[3]) {
+        for (uint32_t corner = 0; corner < 3; ++corner) {
+            corners[corner] = m_indices[triangle * 3 + corner] - minIndex;
+        }
+    });
+}
+
+void RendererSW::drawVertices(uint32_t count, uint32_t startVertex, const InstanceData* instances, uint32_t instanceCount) {
+    if (!m_resources.IsPipelineStateBound()) {
+        return;
+    }
+    const std::vector<float>* vertexBuffer = m_resources.GetBoundVertices();
+    assert(vertexBuffer && "Draw without a bound vertex buffer");
+    assert((startVertex + count) * s_VERTEX_STRIDE <= vertexBuffer->size() && "Draw outside of vertex buffer");
+
+    transformVertices(getModelViewProjection(), vertexBuffer->data() + startVertex * s_VERTEX_STRIDE, count, instances, instanceCount);
+    const uint32_t trianglesPerInstance = count / 3;
+    if (trianglesPerInstance == 0) {
+        return;
+    }
+    setupTriangles(trianglesPerInstance * instanceCount, [count, trianglesPerInstance](uint32_t triangle, uint32_t corners[3]) {
+        const uint32_t first = (triangle / trianglesPerInstance) * count + (triangle % trianglesPerInstance) * 3;
+        corners[0] = first;
+        corners[1] = first + 1;
+        corners[2] = first + 2;
+    });
+}
+
+Mat4 RendererSW::getModelViewProjection() const {
+    // Constant layout of the standard program: { mat4 model; mat4 view; mat4 proj; }
+    Mat4 mvp = Mat4::Identity();
+    const std::vector<float>* constantBuffer = m_resources.GetBoundConstants();
+    if (constantBuffer && constantBuffer->size() >= 48) {
+        const float* constants = constantBuffer->data();
+        Mat4 model, view, proj;
+        std::copy(constants, constants + 16, model.m);
+        std::copy(constants + 16, constants + 32, view.m);
+        std::copy(constants + 32, constants + 48, proj.m);
+        mvp = proj * view * model;
+    }
+    return mvp;
+}
+
+void RendererSW::transformVertices(const Mat4& mvp, const float* vertices, uint32_t count, const InstanceData* instances, uint32_t instanceCount) {
+    const uint32_t total = count * instanceCount;
+    m_clipVertices.resize(total);
+
+    const auto transformRange = [this, &mvp, vertices, count, instances, total](uint32_t job) {
+        const uint32_t end = std::min(total, (job + 1) * s_VERTICES_PER_JOB);
+        for (uint32_t i = job * s_VERTICES_PER_JOB; i < end; ++i) {
+            const InstanceData& instance = instances[i / count];
+            const float* offset = instance.offset;
+            const float* tint = instance.color;
+            const float* vertex = vertices + (i % count) * s_VERTEX_STRIDE;
+            const Vec4 position = { vertex[0] + offset[0], vertex[1] + offset[1], vertex[2] + offset[2], 1.0f };
+            m_clipVertices[i] = { mvp * position, { vertex[4] * tint[0], vertex[5] * tint[1], vertex[6] * tint[2], vertex[7] * tint[3] } };
+        }
+    };
+
+    m_threadPool->ParallelFor((total + s_VERTICES_PER_JOB - 1) / s_VERTICES_PER_JOB, transformRange);
+}
+
+template <typename Corners>
+void RendererSW::setupTriangles(uint32_t numTriangles, const Corners& corners) {
+    const auto setupRange = [this, &corners](uint32_t first, uint32_t last, TriangleBlock& block) {
+        for (uint32_t i = first; i < last; ++i) {
+            uint32_t indices[3];
+            corners(i, indices);
+            clipTriangle(m_clipVertices[indices[0]], m_clipVertices[indices[1]], m_clipVertices[indices[2]], block);
+        }
+    };
+
+    // Small draws aren't worth fanning out, they're set up right here into the shared block
+    if (numTriangles <= s_TRIANGLES_PER_JOB) {
+        if (!m_isLastBlockShared) {
+            openBlock(m_numBlocks++);
+            m_isLastBlockShared = true;
+        }
+        setupRange(0, numTriangles, m_blocks[m_numBlocks - 1]);
+        return;
+    }
+
+    const uint32_t numJobs = (numTriangles + s_TRIANGLES_PER_JOB - 1) / s_TRIANGLES_PER_JOB;
+    const uint32_t firstBlock = m_numBlocks;
+    if (m_blocks.size() < firstBlock + numJobs) {
+        m_blocks.resize(firstBlock + numJobs);
+    }
+    m_numBlocks += numJobs;
+    m_isLastBlockShared = false;
+    m_threadPool->ParallelFor(numJobs, [this, numTriangles, firstBlock, &setupRange](uint32_t job) {
+        setupRange(job * s_TRIANGLES_PER_JOB, std::min(numTriangles, (job + 1) * s_TRIANGLES_PER_JOB), openBlock(firstBlock + job));
+    });
+}
+
+RendererSW::TriangleBlock& RendererSW::openBlock(uint32_t index) {
+    if (index >= m_blocks.size()) {
+        m_blocks.resize(index + 1);
+    }
+    TriangleBlock& block = m_blocks[index];
+    block.triangles.clear();
+    block.tileBins.resize(m_tilesX * m_tilesY);
+    for (std::vector<uint32_t>& bin : block.tileBins) {
+        bin.clear();
+    }
+    return block;
+}
+
+// Sutherland-Hodgman against the near plane and the guard band. Everything that survives maps to screen
+// coordinates that fit the subpixel grid, so setup never converts unbounded values
+void RendererSW::clipTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2, TriangleBlock& block) const {
+    const uint32_t outside = GetOutcode(v0.position) | GetOutcode(v1.position) | GetOutcode(v2.position);
+    if (!outside) {
+        setupTriangle(v0, v1, v2, block);
+        return;
+    }
+
+    // Each plane adds at most one vertex
+    ClipVertex polygons[2][3 + s_NUM_CLIP_PLANES] = { { v0, v1, v2 } };
+    uint32_t numVertices = 3;
+    uint32_t current = 0;
+    for (uint32_t plane = 0; plane < s_NUM_CLIP_PLANES && numVertices >= 3; ++plane) {
+        if (!(outside & (1u << plane))) {
+            continue;
+        }
+        const ClipVertex* input = polygons[current];
+        ClipVertex* output = polygons[current ^ 1];
+        uint32_t numOutput = 0;
+        for (uint32_t i = 0; i < numVertices; ++i) {
+            const ClipVertex& from = input[i];
+            const ClipVertex& to = input[(i + 1) % numVertices];
+            const float fromDistance = PlaneDistance(from.position, plane);
+            const float toDistance = PlaneDistance(to.position, plane);
+            if (fromDistance >= 0.0f) {
+                output[numOutput++] = from;
+            }
+            if ((fromDistance >= 0.0f) != (toDistance >= 0.0f)) {
+                // Interpolated from the inside vertex, which keeps the precision when the other one is far out and
+                // gives both triangles of a shared edge the same point
+                const bool isFromInside = fromDistance >= 0.0f;
+                const ClipVertex& inside = isFromInside ? from : to;
+                const ClipVertex& outsideVertex = isFromInside ? to : from;
+                const float insideDistance = isFromInside ? fromDistance : toDistance;
+                const float t = insideDistance / (insideDistance - (isFromInside ? toDistance : fromDistance));
+                output[numOutput++] = { inside.position + (outsideVertex.position - inside.position) * t,
+                                        inside.color + (outsideVertex.color - inside.color) * t };
+            }
+        }
+        numVertices = numOutput;
+        current ^= 1;
+    }
+
+    const ClipVertex* polygon = polygons[current];
+    for (uint32_t vertex = 2; vertex < numVertices; ++vertex) {
+        setupTriangle(polygon[0], polygon[vertex - 1], polygon[vertex], block);
+    }
+}
+
+void RendererSW::setupTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2, TriangleBlock& block) const {
+    const ClipVertex* vertices[3] = { &v0, &v1, &v2 };
+    Triangle triangle;
+    int64_t x[3], y[3];
+
+    // Clipping keeps the coordinates within the guard band, the clamp only guards the conversion against rounding
+    const float limitX = (s_GUARD_BAND + 1.0f) * 0.5f * m_width;
+    const float limitY = (s_GUARD_BAND + 1.0f) * 0.5f * m_height;
+    for (uint32_t i = 0; i < 3; ++i) {
+        const Vec4& position = vertices[i]->position;
+        if (position.w <= 0.0f) {
+            return;
+        }
+        const float invW = 1.0f / position.w;
+        const float screenX = Clamp((position.x * invW * 0.5f + 0.5f) * m_width, limitX);
+        const float screenY = Clamp((0.5f - position.y * invW * 0.5f) * m_height, limitY);
+        x[i] = static_cast<int64_t>(std::floor(screenX * s_SUBPIXELS + 0.5f));
+        y[i] = static_cast<int64_t>(std::floor(screenY * s_SUBPIXELS + 0.5f));
+        triangle.z[i] = position.z * invW * 0.5f + 0.5f;
+        triangle.invW[i] = invW;
+        triangle.colorOverW[i] = vertices[i]->color * invW;
+    }
+
+    // No culling, flipping the edges of clockwise triangles makes every edge function positive inside
+    int64_t area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+    if (area == 0) {
+        return;
+    }
+    const int64_t sign = area > 0 ? 1 : -1;
+    area *= sign;
+    triangle.invArea = 1.0f / static_cast<float>(area);
+    for (uint32_t i = 0; i < 3; ++i) {
+        const uint32_t a = (i + 1) % 3;
+        const uint32_t b = (i + 2) % 3;
+        triangle.edgeA[i] = (y[a] - y[b]) * sign;
+        triangle.edgeB[i] = (x[b] - x[a]) * sign;
+        triangle.edgeC[i] = (x[a] * y[b] - x[b] * y[a]) * sign;
+        // With y pointing down the inside is right of a left edge and below a top edge
+        const bool isTopLeft = triangle.edgeA[i] > 0 || (triangle.edgeA[i] == 0 && triangle.edgeB[i] > 0);
+        triangle.edgeMin[i] = isTopLeft ? 0 : 1;
+    }
+
+    // Pixels whose centers are within the bounds, most small triangles don't contain one and are dropped here
+    const int64_t minX = std::max<int64_t>(std::min({ x[0], x[1], x[2] }), 0);
+    const int64_t minY = std::max<int64_t>(std::min({ y[0], y[1], y[2] }), 0);
+    const int64_t maxX = std::min<int64_t>(std::max({ x[0], x[1], x[2] }), static_cast<int64_t>(m_width) * s_SUBPIXELS - 1);
+    const int64_t maxY = std::min<int64_t>(std::max({ y[0], y[1], y[2] }), static_cast<int64_t>(m_height) * s_SUBPIXELS - 1);
+    triangle.minX = static_cast<int32_t>((minX + s_SUBPIXELS / 2 - 1) / s_SUBPIXELS);
+    triangle.minY = static_cast<int32_t>((minY + s_SUBPIXELS / 2 - 1) / s_SUBPIXELS);
+    triangle.maxX = static_cast<int32_t>((maxX + s_SUBPIXELS / 2) / s_SUBPIXELS) - 1;
+    triangle.maxY = static_cast<int32_t>((maxY + s_SUBPIXELS / 2) / s_SUBPIXELS) - 1;
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) {
+        return;
+    }
+
+    block.triangles.push_back(triangle);
+    binTriangle(triangle, static_cast<uint32_t>(block.triangles.size() - 1), block);
+}
+
+void RendererSW::binTriangle(const Triangle& triangle, uint32_t index, TriangleBlock& block) const {
+    const uint32_t firstTileX = triangle.minX / s_TILE_SIZE;
+    const uint32_t firstTileY = triangle.minY / s_TILE_SIZE;
+    const uint32_t lastTileX = triangle.maxX / s_TILE_SIZE;
+    const uint32_t lastTileY = triangle.maxY / s_TILE_SIZE;
+
+    for (uint32_t tileY = firstTileY; tileY <= lastTileY; ++tileY) {
+        for (uint32_t tileX = firstTileX; tileX <= lastTileX; ++tileX) {
+            block.tileBins[tileY * m_tilesX + tileX].push_back(index);
+        }
+    }
+}
+
+void RendererSW::shadeTile(uint32_t tileIndex) {
+    const int32_t tileMinX = (tileIndex % m_tilesX) * s_TILE_SIZE;
+    const int32_t tileMinY = (tileIndex / m_tilesX) * s_TILE_SIZE;
+    const int32_t tileMaxX = static_cast<int32_t>(std::min(static_cast<uint32_t>(tileMinX) + s_TILE_SIZE, m_width)) - 1;
+    const int32_t tileMaxY = static_cast<int32_t>(std::min(static_cast<uint32_t>(tileMinY) + s_TILE_SIZE, m_height)) - 1;
+
+    for (int32_t y = tileMinY; y <= tileMaxY; ++y) {
+        std::fill_n(&m_colorBuffer[y * m_width + tileMinX], tileMaxX - tileMinX + 1, s_CLEAR_COLOR);
+        std::fill_n(&m_depthBuffer[y * m_width + tileMinX], tileMaxX - tileMinX + 1, 1.0f);
+    }
+
+    for (uint32_t blockIndex = 0; blockIndex < m_numBlocks; ++blockIndex) {
+        const TriangleBlock& block = m_blocks[blockIndex];
+        for (const uint32_t triangleIndex : block.tileBins[tileIndex]) {
+            const Triangle& triangle = block.triangles[triangleIndex];
+            const int32_t minX = std::max(triangle.minX, tileMinX);
+            const int32_t maxX = std::min(triangle.maxX, tileMaxX);
+            const int32_t minY = std::max(triangle.minY, tileMinY);
+            const int32_t maxY = std::min(triangle.maxY, tileMaxY);
+            const int64_t stepX[3] = { triangle.edgeA[0] * s_SUBPIXELS, triangle.edgeA[1] * s_SUBPIXELS, triangle.edgeA[2] * s_SUBPIXELS };
+
+            for (int32_t y = minY; y <= maxY; ++y) {
+                // Pixels are sampled at their center
+                const int64_t sampleY = static_cast<int64_t>(y) * s_SUBPIXELS + s_SUBPIXELS / 2;
+                const int64_t sampleX = static_cast<int64_t>(minX) * s_SUBPIXELS + s_SUBPIXELS / 2;
+                int64_t e0 = triangle.edgeA[0] * sampleX + triangle.edgeB[0] * sampleY + triangle.edgeC[0];
+                int64_t e1 = triangle.edgeA[1] * sampleX + triangle.edgeB[1] * sampleY + triangle.edgeC[1];
+                int64_t e2 = triangle.edgeA[2] * sampleX + triangle.edgeB[2] * sampleY + triangle.edgeC[2];
+
+                for (int32_t x = minX; x <= maxX; ++x) {
+                    if (e0 >= triangle.edgeMin[0] && e1 >= triangle.edgeMin[1] && e2 >= triangle.edgeMin[2]) {
+                        const float b0 = e0 * triangle.invArea;
+                        const float b1 = e1 * triangle.invArea;
+                        const float b2 = e2 * triangle.invArea;
+                        const uint32_t pixel = y * m_width + x;
+                        const float depth = b0 * triangle.z[0] + b1 * triangle.z[1] + b2 * triangle.z[2];
+                        if (depth < m_depthBuffer[pixel]) {
+                            const float w = 1.0f / (b0 * triangle.invW[0] + b1 * triangle.invW[1] + b2 * triangle.invW[2]);
+                            const Vec4 color = (triangle.colorOverW[0] * b0 + triangle.colorOverW[1] * b1 + triangle.colorOverW[2] * b2) * w;
+                            m_depthBuffer[pixel] = depth;
+                            m_colorBuffer[pixel] = PackColor(color);
+                        }
+                    }
+                    e0 += stepX[0];
+                    e1 += stepX[1];
+                    e2 += stepX[2];
+                }
+            }
+        }
+    }
+}
+
+}  // namespace dw
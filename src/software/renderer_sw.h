@@ -0,0 +1,116 @@
+#pragma once
+
+#include "irenderer.h"
+#include "commandstream.h"
+#include "cpu/resourcestore_cpu.h"
+#include "utils/threadpool.h"
+#include "utils/vecmath.h"
+#include <memory>
+
+namespace dw {
+
+struct PlatformData;
+struct InitData;
+
+// Multithreaded tile based software rasterizer. Draws are transformed and binned into screen tiles
+// as the command buffer is replayed, the tiles are then cleared and shaded in parallel at the end of
+// the frame. There is no shader compiler, draws need a bound pipeline state like they need a program in
+// OpenGL, but its shaders are ignored and every draw runs the "standard" program of the examples:
+// position and color read as two vec4 per vertex, transformed by proj * view * model from the bound
+// constant buffer, with perspective correct color interpolation and GL_LESS depth testing.
+// Instanced draws transform every instance in one pass with the instance offset and color applied.
+// Triangles are clipped to a guard band around the viewport and snapped to 1/16 pixel, coverage is
+// decided on exact integer edge functions with the top-left rule so shared edges are drawn once.
+class RendererSW final : public IRenderer {
+public:
+    virtual bool Initialize(const RendererCaps& /*caps*/, const PlatformData& data) override;
+
+    virtual bool CreateConstantBuffer(const GfxObject& object, uint32_t size) override { return m_resources.CreateConstantBuffer(object, size); }
+    virtual bool CreateVertexBuffer(const GfxObject& object, uint32_t count, const VertexLayout& layout) override { return m_resources.CreateVertexBuffer(object, count, layout); }
+    virtual bool CreateIndexBuffer(const GfxObject& object, uint32_t count, IndexFormat format) override { return m_resources.CreateIndexBuffer(object, count, format); }
+    virtual bool CreatePipelineState(const GfxObject& object, const PipelineState& /*state*/) override { return m_resources.CreatePipelineState(object); }
+    virtual bool CreateSamplerState(const GfxObject& /*object*/, const SamplerDescription& /*description*/) override { return false; }
+    virtual bool CreateTexture(const GfxObject& /*object*/, const TextureDescription& /*description*/, const std::vector<void*>& /*data*/) override { return false; }
+
+    virtual void* MapConstantBuffer(const GfxObject& handle) override { return m_resources.MapConstantBuffer(handle); }
+    virtual void* MapVertexBuffer(const GfxObject& handle) override { return m_resources.MapVertexBuffer(handle); }
+    virtual void* MapIndexBuffer(const GfxObject& handle) override { return m_resources.MapIndexBuffer(handle); }
+    virtual void UnmapVertexBuffer(const GfxObject& handle) override { m_resources.UnmapVertexBuffer(handle); }
+    virtual void UnmapIndexBuffer(const GfxObject& /*handle*/) override {};
+    virtual void UnmapConstantBuffer(const GfxObject& /*handle*/) override {};
+
+    virtual void DestroyConstantBuffer(const GfxObject& handle) override { m_resources.DestroyConstantBuffer(handle); }
+    virtual void DestroyVertexBuffer(const GfxObject& handle) override { m_resources.DestroyVertexBuffer(handle); }
+    virtual void DestroyIndexBuffer(const GfxObject& handle) override { m_resources.DestroyIndexBuffer(handle); }
+    virtual void DestroyTexture(const GfxObject& /*handle*/) override {};
+    virtual void DestroyPipelineState(const GfxObject& handle) override { m_resources.DestroyPipelineState(handle); }
+    virtual void DestroySamplerState(const GfxObject& /*handle*/) override {};
+
+    // Actual rendering commands that operate on updated and ready resources.
+    virtual void Render(const CommandStream& commands) override;
+
+    virtual bool ReadColorBuffer(std::vector<uint32_t>& pixels, uint32_t& width, uint32_t& height) override;
+
+private:
+    struct ClipVertex {
+        Vec4 position;
+        Vec4 color;
+    };
+
+    // Screen space triangle with everything the tiles need to rasterize it
+    struct Triangle {
+        int64_t edgeA[3], edgeB[3], edgeC[3]; // Edge functions A * x + B * y + C in subpixels, positive inside
+        int64_t edgeMin[3];                   // 0 for top and left edges, 1 for the others that don't own their pixels
+        float invArea;                        // Turns an edge function into the barycentric of the opposite vertex
+        float z[3];
+        float invW[3];
+        Vec4 colorOverW[3];
+        int32_t minX, minY, maxX, maxY;
+    };
+
+    // Set up triangles and the tiles they touch. Large draws fill several blocks in parallel, one per job, and
+    // consecutive small draws share a block. Tiles walk the blocks in order, so they see their triangles in
+    // submission order without merging the bins of the jobs
+    struct TriangleBlock {
+        std::vector<Triangle> triangles;
+        std::vector<std::vector<uint32_t>> tileBins;
+    };
+
+    void draw(const DrawCommand& data);
+    void drawInstanced(const DrawInstancedCommand& data);
+    void drawIndexed(const DrawIndexedCommand& data);
+    void drawVertices(uint32_t count, uint32_t startVertex, const InstanceData* instances, uint32_t instanceCount);
+
+    Mat4 getModelViewProjection() const;
+    /* Transforms count vertices once per instance, instance i to m_clipVertices[i * count] onwards */
+    void transformVertices(const Mat4& mvp, const float* vertices, uint32_t count, const InstanceData* instances, uint32_t instanceCount);
+    /* Clips, sets up and bins numTriangles triangles, corners(i, indices) writes the m_clipVertices of triangle i */
+    template <typename Corners>
+    void setupTriangles(uint32_t numTriangles, const Corners& corners);
+    /* Empties block number index of this frame for reuse, adding it if the frame has never used that many */
+    TriangleBlock& openBlock(uint32_t index);
+    void clipTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2, TriangleBlock& block) const;
+    void setupTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2, TriangleBlock& block) const;
+    void binTriangle(const Triangle& triangle, uint32_t index, TriangleBlock& block) const;
+    void shadeTile(uint32_t tileIndex);
+
+    ResourceStoreCPU m_resources;
+
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    uint32_t m_tilesX = 0;
+    uint32_t m_tilesY = 0;
+    std::vector<uint32_t> m_colorBuffer;
+    std::vector<float> m_depthBuffer;
+
+    // Per frame scratch memory, kept around to avoid reallocating every frame
+    std::vector<ClipVertex> m_clipVertices;
+    std::vector<uint32_t> m_indices;
+    std::vector<TriangleBlock> m_blocks;
+    uint32_t m_numBlocks = 0;          // Blocks used by this frame
+    bool m_isLastBlockShared = false;  // Whether the last block takes the triangles of small draws
+
+    std::unique_ptr<ThreadPool> m_threadPool;
+};
+
+}  // namespace dw
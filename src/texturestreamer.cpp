@@ -0,0 +1,278 @@
+#include "texturestreamer.h"
+#include "direwolf/renderengine.h"
+#include "utils/logger.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <fstream>
+
+namespace dw {
+
+TextureStreamer::TextureStreamer(RenderEngine& engine, size_t budgetBytes)
+    : m_engine(engine)
+    , m_budgetBytes(budgetBytes) {
+    m_ioThread = std::thread(&TextureStreamer::ioLoop, this);
+}
+
+TextureStreamer::~TextureStreamer() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isStopping = true;
+    }
+    m_wakeUp.notify_one();
+    m_ioThread.join();
+}
+
+bool TextureStreamer::CreateTexture(GfxObject& object, const std::string& path, const TextureDescription& description,
+                                    const std::vector<size_t>& levelOffsets) {
+    Texture texture;
+    texture.path = path;
+    texture.description = description;
+    texture.levelOffsets = levelOffsets;
+    if (texture.levelOffsets.empty()) {
+        size_t offset = 0;
+        for (uint32_t level = 0; level < description.mipLevels; ++level) {
+            texture.levelOffsets.push_back(offset);
+            offset += getLevelBytes(texture, level);
+        }
+    }
+    assert(texture.levelOffsets.size() == description.mipLevels && "Texture files need the offset of every level");
+    texture.tailLevel = description.mipLevels - 1;
+    while (texture.tailLevel > 0 && std::max(GetMipLevelSize(description.width, texture.tailLevel - 1),
+                                             GetMipLevelSize(description.height, texture.tailLevel - 1)) <= s_MIN_RESIDENT_SIZE) {
+        --texture.tailLevel;
+    }
+
+    if (!m_engine.CreateTexture(object, description)) {
+        return false;
+    }
+    texture.object = object;
+    texture.serial = m_nextSerial++;
+    texture.firstLevel = texture.tailLevel;
+    texture.wantedLevel = texture.tailLevel;
+    m_engine.SetTextureFirstLevel(object, texture.tailLevel);
+
+    // The tail is small enough to read right away
+    std::vector<uint8_t> texels;
+    for (uint32_t level = texture.tailLevel; level < description.mipLevels; ++level) {
+        const size_t size = getLevelBytes(texture, level);
+        if (!readLevel(path, texture.levelOffsets[level], size, texels)) {
+            m_engine.DestroyTexture(object);
+            object = GfxObject();
+            return false;
+        }
+        const size_t layerSize = size / description.layers;
+        for (uint32_t layer = 0; layer < description.layers; ++layer) {
+            m_engine.UpdateTexture(object, layer, level, texels.data() + layer * layerSize);
+        }
+        m_residentBytes += size;
+    }
+    LOGD("Streaming " + path + ", levels from " + std::to_string(texture.tailLevel) + " on stay resident");
+    m_textures.emplace(object.id, std::move(texture));
+    return true;
+}
+
+void TextureStreamer::DestroyTexture(const GfxObject& object) {
+    auto it = m_textures.find(object.id);
+    if (it != m_textures.end()) {
+        const Texture& texture = it->second;
+        for (uint32_t level = texture.firstLevel; level < texture.description.mipLevels; ++level) {
+            m_residentBytes -= getLevelBytes(texture, level);
+        }
+        // The read finishes anyway, Update drops it
+        if (texture.isLoading) {
+            m_loadingBytes -= getLevelBytes(texture, texture.firstLevel - 1);
+        }
+        m_textures.erase(it);
+    }
+    m_engine.DestroyTexture(object);
+}
+
+void TextureStreamer::RequestLevel(const GfxObject& object, uint32_t level) {
+    auto it = m_textures.find(object.id);
+    assert(it != m_textures.end() && "Requesting a level of a texture that isn't streamed");
+    if (it != m_textures.end()) {
+        it->second.requestedLevel = std::min(it->second.requestedLevel, level);
+    }
+}
+
+uint32_t TextureStreamer::GetLevelForScreenSize(const TextureDescription& description, float screenWidth, float screenHeight) {
+    if (screenWidth <= 0.0f || screenHeight <= 0.0f) {
+        return description.mipLevels - 1;
+    }
+    // One texel per pixel along the axis that's minified the most
+    const float ratio = std::max(description.width / screenWidth, description.height / screenHeight);
+    const float level = ratio > 1.0f ? std::floor(std::log2(ratio)) : 0.0f;
+    return std::min(static_cast<uint32_t>(level), description.mipLevels - 1);
+}
+
+uint32_t TextureStreamer::Update() {
+    ++m_frame;
+    m_loadedLevels = 0;
+    m_evictedLevels = 0;
+
+    m_finished.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::swap(m_finished, m_loaded);
+    }
+    for (Load& load : m_finished) {
+        finishLoad(load);
+    }
+
+    for (auto& entry : m_textures) {
+        Texture& texture = entry.second;
+        if (texture.requestedLevel != UINT32_MAX) {
+            texture.lastUsedFrame = m_frame;
+            texture.wantedLevel = std::min(texture.requestedLevel, texture.tailLevel);
+        } else {
+            texture.wantedLevel = texture.tailLevel;
+        }
+        texture.requestedLevel = UINT32_MAX;
+    }
+    scheduleLoads();
+    // The budget may have shrunk
+    makeRoom(0);
+    return m_loadedLevels;
+}
+
+TextureStreamer::Stats TextureStreamer::GetStats() const {
+    Stats stats;
+    stats.residentBytes = m_residentBytes;
+    stats.loadingBytes = m_loadingBytes;
+    stats.budgetBytes = m_budgetBytes;
+    stats.pendingLoads = m_pendingLoads;
+    stats.loadedLevels = m_loadedLevels;
+    stats.evictedLevels = m_evictedLevels;
+    stats.averageLatencyMilliseconds = m_latencyCount > 0 ? m_totalLatency / m_latencyCount : 0.0;
+    stats.maxLatencyMilliseconds = m_maxLatency;
+    return stats;
+}
+
+bool TextureStreamer::readLevel(const std::string& path, size_t offset, size_t size, std::vector<uint8_t>& texels) {
+    std::ifstream file(path, std::ios::binary);
+    texels.resize(size);
+    if (!file.seekg(static_cast<std::streamoff>(offset)) || !file.read(reinterpret_cast<char*>(texels.data()), static_cast<std::streamsize>(size))) {
+        LOGE("Failed to read " + std::to_string(size) + " bytes at " + std::to_string(offset) + " from " + path);
+        return false;
+    }
+    return true;
+}
+
+// All layers of the level
+size_t TextureStreamer::getLevelBytes(const Texture& texture, uint32_t level) const {
+    return texture.description.GetLevelSize(level) * texture.description.layers;
+}
+
+void TextureStreamer::finishLoad(Load& load) {
+    --m_pendingLoads;
+    auto it = m_textures.find(load.object.id);
+    if (it == m_textures.end() || it->second.serial != load.serial) {
+        return;
+    }
+    Texture& texture = it->second;
+    texture.isLoading = false;
+    m_loadingBytes -= load.size;
+    if (!load.succeeded) {
+        texture.hasFailed = true;
+        return;
+    }
+
+    m_engine.SetTextureFirstLevel(texture.object, load.level);
+    const size_t layerSize = load.size / texture.description.layers;
+    for (uint32_t layer = 0; layer < texture.description.layers; ++layer) {
+        m_engine.UpdateTexture(texture.object, layer, load.level, load.texels.data() + layer * layerSize);
+    }
+    texture.firstLevel = load.level;
+    m_residentBytes += load.size;
+    ++m_loadedLevels;
+
+    const double latency = std::chrono::duration<double, std::milli>(Clock::now() - load.start).count();
+    m_totalLatency += latency;
+    m_maxLatency = std::max(m_maxLatency, latency);
+    ++m_latencyCount;
+}
+
+void TextureStreamer::scheduleLoads() {
+    m_candidates.clear();
+    for (auto& entry : m_textures) {
+        Texture& texture = entry.second;
+        if (texture.wantedLevel < texture.firstLevel && !texture.isLoading && !texture.hasFailed) {
+            m_candidates.push_back(&texture);
+        }
+    }
+    // The textures missing the most levels look the worst
+    std::sort(m_candidates.begin(), m_candidates.end(), [](const Texture* a, const Texture* b) {
+        return a->firstLevel - a->wantedLevel > b->firstLevel - b->wantedLevel;
+    });
+
+    for (Texture* texture : m_candidates) {
+        const uint32_t level = texture->firstLevel - 1;
+        const size_t size = getLevelBytes(*texture, level);
+        if (!makeRoom(size)) {
+            continue;
+        }
+        texture->isLoading = true;
+        m_loadingBytes += size;
+        ++m_pendingLoads;
+
+        Load load;
+        load.object = texture->object;
+        load.serial = texture->serial;
+        load.level = level;
+        load.path = texture->path;
+        load.offset = texture->levelOffsets[level];
+        load.size = size;
+        load.start = Clock::now();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_requests.push_back(std::move(load));
+        }
+        m_wakeUp.notify_one();
+    }
+}
+
+bool TextureStreamer::makeRoom(size_t bytes) {
+    while (m_residentBytes + m_loadingBytes + bytes > m_budgetBytes) {
+        // Only levels finer than what a texture needs are given up, of the texture used the longest ago
+        Texture* victim = nullptr;
+        for (auto& entry : m_textures) {
+            Texture& texture = entry.second;
+            if (texture.firstLevel < texture.wantedLevel && !texture.isLoading
+                && (!victim || texture.lastUsedFrame < victim->lastUsedFrame)) {
+                victim = &texture;
+            }
+        }
+        if (!victim) {
+            return false;
+        }
+        m_residentBytes -= getLevelBytes(*victim, victim->firstLevel);
+        ++victim->firstLevel;
+        m_engine.SetTextureFirstLevel(victim->object, victim->firstLevel);
+        ++m_evictedLevels;
+    }
+    return true;
+}
+
+void TextureStreamer::ioLoop() {
+    for (;;) {
+        Load load;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeUp.wait(lock, [this] { return m_isStopping || !m_requests.empty(); });
+            if (m_isStopping) {
+                return;
+            }
+            load = std::move(m_requests.front());
+            m_requests.pop_front();
+        }
+
+        load.succeeded = readLevel(load.path, load.offset, load.size, load.texels);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_loaded.push_back(std::move(load));
+    }
+}
+
+}  // namespace dw
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "irenderer.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace dw {
+
+class RenderEngine;
+
+// Keeps the mip levels textures are drawn with resident within a memory budget, reading them from files on an
+// I/O thread. Every frame a texture is used, the finest level it needs is requested, from the screen space size
+// it's drawn at or from sampler feedback read back by the application. Update makes the requested levels resident
+// one level per texture at a time, textures missing the most levels first. When the budget is used up, textures
+// holding levels finer than they need give theirs up, those used the longest ago first. Levels of at most
+// s_MIN_RESIDENT_SIZE texels on a side are read when the texture is created and stay resident, so a texture is
+// never drawn without texels. Files hold each level with all its layers tightly packed.
+class TextureStreamer {
+public:
+    static const uint32_t s_MIN_RESIDENT_SIZE = 64;
+
+    struct Stats {
+        size_t residentBytes = 0;
+        size_t loadingBytes = 0;   // Reserved for the levels being read
+        size_t budgetBytes = 0;
+        uint32_t pendingLoads = 0;
+        uint32_t loadedLevels = 0; // During the last Update
+        uint32_t evictedLevels = 0; // During the last Update
+        double averageLatencyMilliseconds = 0.0; // From scheduling a level to handing it to the engine
+        double maxLatencyMilliseconds = 0.0;
+    };
+
+    TextureStreamer(RenderEngine& engine, size_t budgetBytes);
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer& streamer) = delete;
+    TextureStreamer& operator= (const TextureStreamer& streamer) = delete;
+
+    /* Creates the texture with the levels that always stay resident. levelOffsets holds where each level starts
+       in the file, by default the levels follow each other from the start of the file, finest first */
+    bool CreateTexture(GfxObject& object, const std::string& path, const TextureDescription& description,
+                       const std::vector<size_t>& levelOffsets = {});
+    void DestroyTexture(const GfxObject& object);
+
+    /* Asks for level and the coarser ones of a texture used this frame, the finest level requested counts */
+    void RequestLevel(const GfxObject& object, uint32_t level);
+    /* The finest level sampled when the texture covers screenWidth by screenHeight pixels */
+    static uint32_t GetLevelForScreenSize(const TextureDescription& description, float screenWidth, float screenHeight);
+
+    /* Call once per frame from the thread using the engine. Hands the levels read since the last call to the
+       engine, evicts and schedules reads, returns how many levels were made resident */
+    uint32_t Update();
+
+    void SetBudget(size_t budgetBytes) { m_budgetBytes = budgetBytes; }
+    Stats GetStats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Texture {
+        GfxObject object;
+        uint64_t serial = 0; // Tells apart textures created with a reused handle
+        std::string path;
+        TextureDescription description;
+        std::vector<size_t> levelOffsets;
+        uint32_t firstLevel = 0; // First resident level
+        uint32_t tailLevel = 0; // Levels from here on are always resident
+        uint32_t requestedLevel = UINT32_MAX; // Finest level requested this frame
+        uint32_t wantedLevel = 0; // Finest level requested last frame, the tail level if it wasn't used
+        uint64_t lastUsedFrame = 0;
+        bool isLoading = false; // Reading the level before firstLevel
+        bool hasFailed = false; // Reading a level failed, the texture isn't streamed anymore
+    };
+
+    struct Load {
+        GfxObject object;
+        uint64_t serial;
+        uint32_t level;
+        std::string path;
+        size_t offset;
+        size_t size;
+        Clock::time_point start;
+        std::vector<uint8_t> texels;
+        bool succeeded = false;
+    };
+
+    static bool readLevel(const std::string& path, size_t offset, size_t size, std::vector<uint8_t>& texels);
+    size_t getLevelBytes(const Texture& texture, uint32_t level) const;
+    void finishLoad(Load& load);
+    void scheduleLoads();
+    /* Evicts levels until bytes more fit the budget, false if not enough levels can be evicted */
+    bool makeRoom(size_t bytes);
+    void ioLoop();
+
+    RenderEngine& m_engine;
+    std::unordered_map<uint32_t, Texture> m_textures; // By handle
+    std::vector<Texture*> m_candidates; // Reused by scheduleLoads
+    std::vector<Load> m_finished; // Reused by Update
+    uint64_t m_frame = 0;
+    uint64_t m_nextSerial = 1;
+    size_t m_budgetBytes = 0;
+    size_t m_residentBytes = 0;
+    size_t m_loadingBytes = 0;
+    uint32_t m_pendingLoads = 0;
+    uint32_t m_loadedLevels = 0;
+    uint32_t m_evictedLevels = 0;
+    double m_totalLatency = 0.0;
+    double m_maxLatency = 0.0;
+    uint64_t m_latencyCount = 0;
+
+    std::thread m_ioThread;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    std::deque<Load> m_requests; // Guarded by m_mutex
+    std::vector<Load> m_loaded;  // Guarded by m_mutex
+    bool m_isStopping = false;   // Guarded by m_mutex
+};
+
+}  // namespace dw
@@ -0,0 +1,49 @@
+#include "cpufeatures.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  #include <intrin.h>
+#endif
+
+namespace dw {
+
+bool IsAvx2Supported() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4];
+    __cpuid(info, 1);
+    const bool hasF16c = (info[2] & (1 << 29)) != 0;
+    const bool hasOsxsave = (info[2] & (1 << 27)) != 0;
+    if (!hasF16c || !hasOsxsave || (_xgetbv(0) & 0x6) != 0x6) {
+        return false; // The OS doesn't save the YMM registers
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif defined(__x86_64__) || defined(__i386__)
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c");
+#else
+    return false;
+#endif
+}
+
+KernelSet GetBestKernelSet() {
+#if defined(DW_AVX2_ENABLED)
+    if (IsAvx2Supported()) {
+        return KERNELS_AVX2;
+    }
+#endif
+#if defined(DW_SSE2_ENABLED)
+    return KERNELS_SSE2;
+#else
+    return KERNELS_SCALAR;
+#endif
+}
+
+const char* GetKernelSetName(KernelSet kernels) {
+    switch (kernels) {
+        case KERNELS_SCALAR: return "scalar";
+        case KERNELS_SSE2: return "SSE2";
+        case KERNELS_AVX2: return "AVX2/F16C";
+    }
+    return "unknown";
+}
+
+} // namespace dw
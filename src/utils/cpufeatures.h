@@ -0,0 +1,24 @@
+#pragma once
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define DW_SSE2_ENABLED 1
+#endif
+
+// Instruction sets the SIMD loops of the utils are built for. SSE2 is decided at compile time, AVX2 is
+// compiled in with DIREWOLF_AVX2_ENABLED and only used if the CPU it runs on supports it.
+namespace dw {
+
+// Ordered from narrowest to widest, a set that isn't available falls back to the next narrower one
+enum KernelSet {
+    KERNELS_SCALAR,
+    KERNELS_SSE2,
+    KERNELS_AVX2 // Includes F16C, which every CPU with AVX2 has
+};
+
+/* True if the CPU has AVX2 and F16C and the OS saves the YMM registers */
+bool IsAvx2Supported();
+/* The widest kernel set the build and the CPU support */
+KernelSet GetBestKernelSet();
+const char* GetKernelSetName(KernelSet kernels);
+
+} // namespace dw
@@ -0,0 +1,114 @@
+#include "filewatcher.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#if defined(__linux__)
+  #include <poll.h>
+  #include <sys/eventfd.h>
+  #include <sys/inotify.h>
+  #include <unistd.h>
+#endif
+
+namespace dw {
+
+FileWatcher::FileWatcher() {
+#if defined(__linux__)
+    m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    m_wakeEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_inotify < 0 || m_wakeEvent < 0) {
+        LOGE("Failed to set up inotify, file changes won't be noticed");
+        return;
+    }
+    m_thread = std::thread(&FileWatcher::watchLoop, this);
+#endif
+}
+
+FileWatcher::~FileWatcher() {
+#if defined(__linux__)
+    if (m_thread.joinable()) {
+        const uint64_t wake = 1;
+        (void)write(m_wakeEvent, &wake, sizeof(wake));
+        m_thread.join();
+    }
+    // Closing the inotify descriptor removes its watches
+    if (m_inotify >= 0) {
+        close(m_inotify);
+    }
+    if (m_wakeEvent >= 0) {
+        close(m_wakeEvent);
+    }
+#endif
+}
+
+bool FileWatcher::IsSupported() {
+#if defined(__linux__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool FileWatcher::Watch(const std::string& path) {
+#if defined(__linux__)
+    if (!m_thread.joinable()) {
+        return false;
+    }
+    const std::filesystem::path file = std::filesystem::path(path).lexically_normal();
+    const std::string directory = file.has_parent_path() ? file.parent_path().string() : ".";
+    // Adding a directory again returns its existing descriptor
+    const int descriptor = inotify_add_watch(m_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (descriptor < 0) {
+        LOGW("Can't watch " + directory + " for changes to " + path);
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_directories[descriptor] = directory;
+    m_files.insert(file.generic_string());
+    return true;
+#else
+    return false;
+#endif
+}
+
+void FileWatcher::Poll(std::vector<std::string>& changed) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    changed.insert(changed.end(), m_changed.begin(), m_changed.end());
+    m_changed.clear();
+}
+
+void FileWatcher::watchLoop() {
+#if defined(__linux__)
+    alignas(inotify_event) char buffer[4096];
+    pollfd descriptors[2] = { { m_inotify, POLLIN, 0 }, { m_wakeEvent, POLLIN, 0 } };
+    while (true) {
+        if (poll(descriptors, 2, -1) < 0) {
+            continue; // Interrupted by a signal
+        }
+        if (descriptors[1].revents & POLLIN) {
+            return;
+        }
+
+        ssize_t length = 0;
+        while ((length = read(m_inotify, buffer, sizeof(buffer))) > 0) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (ssize_t offset = 0; offset < length;) {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                offset += sizeof(inotify_event) + event->len;
+
+                auto directory = m_directories.find(event->wd);
+                if (event->len == 0 || directory == m_directories.end()) {
+                    continue;
+                }
+                const std::string path = (std::filesystem::path(directory->second) / event->name).lexically_normal().generic_string();
+                if (m_files.count(path) && std::find(m_changed.begin(), m_changed.end(), path) == m_changed.end()) {
+                    m_changed.push_back(path);
+                }
+            }
+        }
+    }
+#endif
+}
+
+} // namespace dw
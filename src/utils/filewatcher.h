@@ -0,0 +1,43 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace dw {
+
+// Reports changes to watched files, collected by a background thread blocking on inotify. Only Linux is
+// supported so far, elsewhere nothing is ever reported. The directories of the files are watched rather than
+// the files, editors often save by writing a new file and renaming it over the old one, which would end a
+// watch on the file itself. Paths are reported the way they were passed to Watch, lexically normalized.
+class FileWatcher {
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher& watcher) = delete;
+    FileWatcher& operator= (const FileWatcher& watcher) = delete;
+
+    static bool IsSupported();
+
+    /* Starts reporting changes to path, false if its directory can't be watched */
+    bool Watch(const std::string& path);
+    /* Appends the files written or replaced since the last call to changed, each once. Doesn't block */
+    void Poll(std::vector<std::string>& changed);
+
+private:
+    void watchLoop();
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::unordered_map<int, std::string> m_directories; // By watch descriptor
+    std::unordered_set<std::string> m_files;
+    std::vector<std::string> m_changed;
+    int m_inotify = -1;
+    int m_wakeEvent = -1; // Written by the destructor to end the watch loop
+};
+
+} // namespace dw
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "irenderer.h"
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace dw {
+
+// GfxObject ids handed out by the engine are an index into dense per backend arrays plus a generation
+// that is bumped whenever the index is freed, so a handle kept after Destroy no longer matches its slot.
+//   [31..20] generation, never 0 so a live handle is always valid
+//   [19..0]  index
+namespace handle {
+    const uint32_t s_INDEX_BITS = 20;
+    const uint32_t s_INDEX_MASK = (1u << s_INDEX_BITS) - 1;
+    const uint32_t s_GENERATION_MASK = (1u << (32 - s_INDEX_BITS)) - 1;
+
+    inline uint32_t GetIndex(const GfxObject& object) { return object.id & s_INDEX_MASK; }
+    inline uint32_t GetGeneration(const GfxObject& object) { return object.id >> s_INDEX_BITS; }
+    inline GfxObject Make(uint32_t index, uint32_t generation) { return GfxObject((generation << s_INDEX_BITS) | index); }
+}
+
+// Hands out handles, freed indices are reused in LIFO order with the next generation
+class HandleAllocator {
+public:
+    GfxObject Allocate() {
+        uint32_t index;
+        if (!m_freeIndices.empty()) {
+            index = m_freeIndices.back();
+            m_freeIndices.pop_back();
+        } else {
+            index = static_cast<uint32_t>(m_generations.size());
+            assert(index <= handle::s_INDEX_MASK && "Out of handles");
+            m_generations.push_back(1);
+        }
+        return handle::Make(index, m_generations[index]);
+    }
+
+    /* Returns false for handles that aren't alive, i.e already freed */
+    bool Free(const GfxObject& object) {
+        if (!IsAlive(object)) {
+            return false;
+        }
+        const uint32_t index = handle::GetIndex(object);
+        // Generation 0 is reserved for invalid handles, wrap around to 1
+        m_generations[index] = (m_generations[index] % handle::s_GENERATION_MASK) + 1;
+        m_freeIndices.push_back(index);
+        return true;
+    }
+
+    bool IsAlive(const GfxObject& object) const {
+        const uint32_t index = handle::GetIndex(object);
+        return object.IsValid() && index < m_generations.size() && m_generations[index] == handle::GetGeneration(object);
+    }
+
+private:
+    std::vector<uint32_t> m_generations;
+    std::vector<uint32_t> m_freeIndices;
+};
+
+// Dense storage indexed by handle. Each slot remembers the generation it was filled with so lookups with
+// a stale handle fail instead of returning whatever lives in the slot now.
+template <typename T>
+class HandleArray {
+public:
+    T& Insert(const GfxObject& object, T value) {
+        assert(object.IsValid() && "Inserting with an invalid handle");
+        const uint32_t index = handle::GetIndex(object);
+        if (index >= m_values.size()) {
+            m_values.resize(index + 1);
+            m_generations.resize(index + 1, 0);
+        }
+        assert(m_generations[index] == 0 && "Slot already in use, handle was not destroyed");
+        m_generations[index] = handle::GetGeneration(object);
+        m_values[index] = std::move(value);
+        return m_values[index];
+    }
+
+    /* Returns nullptr if nothing was inserted with this exact handle */
+    T* Find(const GfxObject& object) {
+        const uint32_t index = handle::GetIndex(object);
+        if (index >= m_values.size() || m_generations[index] != handle::GetGeneration(object) || !object.IsValid()) {
+            return nullptr;
+        }
+        return &m_values[index];
+    }
+
+    const T* Find(const GfxObject& object) const {
+        return const_cast<HandleArray*>(this)->Find(object);
+    }
+
+    /* Resets the slot to a default value, returns false for stale handles */
+    bool Erase(const GfxObject& object) {
+        T* value = Find(object);
+        if (!value) {
+            return false;
+        }
+        *value = T();
+        m_generations[handle::GetIndex(object)] = 0;
+        return true;
+    }
+
+    /* Calls function(value) for every live slot */
+    template <typename Function>
+    void ForEach(Function&& function) {
+        for (size_t i = 0; i < m_values.size(); ++i) {
+            if (m_generations[i] != 0) {
+                function(m_values[i]);
+            }
+        }
+    }
+
+private:
+    std::vector<T> m_values;
+    std::vector<uint32_t> m_generations; // 0 marks an empty slot
+};
+
+} // namespace dw
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// 64 bit FNV-1a. Not a cryptographic hash, it's for keying caches by content. Pass the previous result
+// as hash to continue over several buffers.
+namespace dw {
+
+const uint64_t s_FNV1A_OFFSET_BASIS = 14695981039346656037ull;
+const uint64_t s_FNV1A_PRIME = 1099511628211ull;
+
+inline uint64_t HashFnv1a(const void* data, size_t size, uint64_t hash = s_FNV1A_OFFSET_BASIS) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * s_FNV1A_PRIME;
+    }
+    return hash;
+}
+
+} // namespace dw
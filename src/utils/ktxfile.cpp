@@ -0,0 +1,175 @@
+#include "ktxfile.h"
+#include "logger.h"
+
+#include <cstring>
+#if defined(_WIN32)
+  #define WIN32_LEAN_AND_MEAN
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+namespace {
+    const uint8_t s_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+    const size_t s_HEADER_SIZE = 80; // Identifier, header and index, followed by the level index
+    const size_t s_LEVEL_INDEX_ENTRY_SIZE = 24;
+
+    // KTX2 stores formats as VkFormat
+    bool GetTextureFormat(uint32_t vkFormat, dw::TextureFormat& format) {
+        switch (vkFormat) {
+            case 9: format = dw::TEXTURE_FORMAT_R8; return true;
+            case 16: format = dw::TEXTURE_FORMAT_RG8; return true;
+            case 37: format = dw::TEXTURE_FORMAT_RGBA8; return true;
+            case 43: format = dw::TEXTURE_FORMAT_RGBA8_SRGB; return true;
+            case 97: format = dw::TEXTURE_FORMAT_RGBA16F; return true;
+            case 109: format = dw::TEXTURE_FORMAT_RGBA32F; return true;
+            case 133: format = dw::TEXTURE_FORMAT_BC1; return true;
+            case 134: format = dw::TEXTURE_FORMAT_BC1_SRGB; return true;
+            case 137: format = dw::TEXTURE_FORMAT_BC3; return true;
+            case 138: format = dw::TEXTURE_FORMAT_BC3_SRGB; return true;
+            case 139: format = dw::TEXTURE_FORMAT_BC4; return true;
+            case 141: format = dw::TEXTURE_FORMAT_BC5; return true;
+            case 145: format = dw::TEXTURE_FORMAT_BC7; return true;
+            case 146: format = dw::TEXTURE_FORMAT_BC7_SRGB; return true;
+            default: return false;
+        }
+    }
+
+    template<typename T>
+    T Read(const uint8_t* data, size_t offset) {
+        T value;
+        std::memcpy(&value, data + offset, sizeof(T));
+        return value;
+    }
+}
+
+namespace dw {
+
+KtxFile::~KtxFile() {
+    Close();
+}
+
+bool KtxFile::Open(const std::string& path) {
+    Close();
+#if defined(_WIN32)
+    m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    LARGE_INTEGER size = {};
+    if (m_file == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_file, &size)) {
+        LOGE("Failed to open " + path);
+        m_file = nullptr;
+        return false;
+    }
+    m_size = static_cast<size_t>(size.QuadPart);
+    m_fileMapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    m_mapping = m_fileMapping ? static_cast<const uint8_t*>(MapViewOfFile(m_fileMapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+#else
+    const int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat status = {};
+    if (file < 0 || fstat(file, &status) != 0) {
+        LOGE("Failed to open " + path);
+        if (file >= 0) {
+            close(file);
+        }
+        return false;
+    }
+    m_size = static_cast<size_t>(status.st_size);
+    // The mapping keeps the file alive
+    void* mapping = m_size > 0 ? mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+    close(file);
+    m_mapping = mapping != MAP_FAILED ? static_cast<const uint8_t*>(mapping) : nullptr;
+#endif
+    if (!m_mapping) {
+        LOGE("Failed to map " + path);
+        Close();
+        return false;
+    }
+    if (!parse(path)) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void KtxFile::Close() {
+#if defined(_WIN32)
+    if (m_mapping) {
+        UnmapViewOfFile(m_mapping);
+    }
+    if (m_fileMapping) {
+        CloseHandle(m_fileMapping);
+    }
+    if (m_file) {
+        CloseHandle(m_file);
+    }
+    m_file = nullptr;
+    m_fileMapping = nullptr;
+#else
+    if (m_mapping) {
+        munmap(const_cast<uint8_t*>(m_mapping), m_size);
+    }
+#endif
+    m_mapping = nullptr;
+    m_size = 0;
+    m_description = TextureDescription();
+    m_data.clear();
+    m_levelOffsets.clear();
+}
+
+bool KtxFile::parse(const std::string& path) {
+    if (m_size < s_HEADER_SIZE || std::memcmp(m_mapping, s_IDENTIFIER, sizeof(s_IDENTIFIER)) != 0) {
+        LOGE(path + " isn't a KTX2 file");
+        return false;
+    }
+    const uint32_t vkFormat = Read<uint32_t>(m_mapping, 12);
+    const uint32_t depth = Read<uint32_t>(m_mapping, 28);
+    const uint32_t layers = Read<uint32_t>(m_mapping, 32);
+    const uint32_t faces = Read<uint32_t>(m_mapping, 36);
+    const uint32_t levels = Read<uint32_t>(m_mapping, 40);
+    const uint32_t supercompression = Read<uint32_t>(m_mapping, 44);
+
+    TextureDescription& description = m_description;
+    if (!GetTextureFormat(vkFormat, description.format)) {
+        LOGE(path + " has VkFormat " + std::to_string(vkFormat) + ", which textures don't support");
+        return false;
+    }
+    if (depth > 0 || faces != 1 || supercompression != 0) {
+        LOGE(path + " is a 3D texture, a cube map or supercompressed, only 2D textures and arrays are supported");
+        return false;
+    }
+    description.width = Read<uint32_t>(m_mapping, 20);
+    description.height = Read<uint32_t>(m_mapping, 24);
+    description.layers = layers > 0 ? layers : 1;
+    // 0 asks the loader to generate the levels, the base level is all there is
+    description.mipLevels = levels > 0 ? levels : 1;
+    if (description.width == 0 || description.height == 0 || description.mipLevels > GetMipLevelCount(description.width, description.height)
+        || m_size < s_HEADER_SIZE + description.mipLevels * s_LEVEL_INDEX_ENTRY_SIZE) {
+        LOGE(path + " has an invalid size or level count");
+        return false;
+    }
+
+    // Levels hold their layers one after the other, tightly packed
+    for (uint32_t level = 0; level < description.mipLevels; ++level) {
+        const size_t entry = s_HEADER_SIZE + level * s_LEVEL_INDEX_ENTRY_SIZE;
+        const uint64_t offset = Read<uint64_t>(m_mapping, entry);
+        const uint64_t length = Read<uint64_t>(m_mapping, entry + 8);
+        if (length != description.GetLevelSize(level) * description.layers || offset > m_size || length > m_size - offset) {
+            LOGE(path + " has " + std::to_string(length) + " bytes at " + std::to_string(offset) + " for level " + std::to_string(level)
+                 + ", expected " + std::to_string(description.GetLevelSize(level) * description.layers) + " within the file");
+            return false;
+        }
+        m_levelOffsets.push_back(static_cast<size_t>(offset));
+    }
+    // The engine only reads through the pointers
+    for (uint32_t layer = 0; layer < description.layers; ++layer) {
+        for (uint32_t level = 0; level < description.mipLevels; ++level) {
+            const uint8_t* texels = m_mapping + m_levelOffsets[level] + layer * description.GetLevelSize(level);
+            m_data.push_back(const_cast<uint8_t*>(texels));
+        }
+    }
+    return true;
+}
+
+} // namespace dw
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "irenderer.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace dw {
+
+// A KTX2 texture file mapped into memory. The texels aren't read or copied, GetData points into the mapping
+// the way RenderEngine::CreateTexture takes them, so the pages are only read in while the engine copies the
+// texels for upload. The file has to stay open until then. Only 2D textures and texture arrays in the formats
+// of TextureFormat are supported, without supercompression.
+class KtxFile {
+public:
+    KtxFile() = default;
+    ~KtxFile();
+
+    KtxFile(const KtxFile& file) = delete;
+    KtxFile& operator= (const KtxFile& file) = delete;
+
+    /* Maps the file and reads its header, logs and returns false if it isn't a KTX2 file this can load */
+    bool Open(const std::string& path);
+    void Close();
+
+    const TextureDescription& GetDescription() const { return m_description; }
+    /* Texels of every level of every layer, all levels of the first layer, then of the next one */
+    const std::vector<void*>& GetData() const { return m_data; }
+    /* Offsets of the levels in the file, each holding all layers, for the TextureStreamer */
+    const std::vector<size_t>& GetLevelOffsets() const { return m_levelOffsets; }
+
+private:
+    bool parse(const std::string& path);
+
+    const uint8_t* m_mapping = nullptr;
+    size_t m_size = 0;
+#if defined(_WIN32)
+    void* m_file = nullptr;
+    void* m_fileMapping = nullptr;
+#endif
+    TextureDescription m_description;
+    std::vector<void*> m_data;
+    std::vector<size_t> m_levelOffsets;
+};
+
+} // namespace dw
@@ -3,6 +3,7 @@
 #include <fstream>
 #include <iostream>
 #include <cassert>
+#include <mutex>
 
 namespace {
     const std::string SEVERITY_MAP[] = {
@@ -16,6 +17,7 @@ namespace {
     std::ofstream s_fileStream;
     dw::Logger::Severity s_minSeverity;
     bool s_isInitialized = false;
+    std::mutex s_streamMutex; // Worker threads log too, e.g. the shader compiler's
 }
 
 namespace dw {
@@ -36,6 +38,7 @@ void Logger::Write(Severity severity, const std::string&& message) {
     assert(s_isInitialized && "You must initialize this class before using this function\n");
 
     if (severity >= s_minSeverity) {
+        std::lock_guard<std::mutex> lock(s_streamMutex);
         std::ostream& stream = s_fileStream.is_open() ? s_fileStream : std::cout;
         stream << "[DW] " << SEVERITY_MAP[severity] << ": " << message << std::endl;
     }
@@ -46,6 +49,7 @@ void Logger::Destroy() {
 
     s_isInitialized = false;
 
+    std::lock_guard<std::mutex> lock(s_streamMutex);
     if (s_fileStream.is_open()) {
         s_fileStream.close();
     }
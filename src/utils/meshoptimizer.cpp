@@ -0,0 +1,307 @@
+#include "meshoptimizer.h"
+#include "vecmath.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+    // Forsyth's tuning, the cache is modelled as LRU with s_CACHE_SIZE entries
+    const uint32_t s_CACHE_SIZE = 32;
+    const float s_CACHE_DECAY_POWER = 1.5f;
+    const float s_LAST_TRIANGLE_SCORE = 0.75f;
+    const float s_VALENCE_BOOST_SCALE = 2.0f;
+    const float s_VALENCE_BOOST_POWER = 0.5f;
+
+    // Triangles that miss on all three vertices in this FIFO start a new overdraw cluster
+    const uint32_t s_CLUSTER_CACHE_SIZE = 16;
+
+    const uint32_t s_INVALID = std::numeric_limits<uint32_t>::max();
+
+    float VertexScore(int32_t cachePosition, uint32_t remainingTriangles) {
+        if (remainingTriangles == 0) {
+            return -1.0f;
+        }
+
+        float score = 0.0f;
+        if (cachePosition >= 0) {
+            // The last triangle's vertices get a fixed score so its neighbours aren't preferred over the rest of the cache
+            if (cachePosition < 3) {
+                score = s_LAST_TRIANGLE_SCORE;
+            } else {
+                const float scale = 1.0f / (s_CACHE_SIZE - 3);
+                score = std::pow(1.0f - (cachePosition - 3) * scale, s_CACHE_DECAY_POWER);
+            }
+        }
+        // Favour vertices with few triangles left so they leave the working set early
+        return score + s_VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingTriangles), -s_VALENCE_BOOST_POWER);
+    }
+
+    dw::Vec3 ReadPosition(const uint8_t* vertices, size_t vertexStride, uint32_t index) {
+        dw::Vec3 position;
+        std::memcpy(&position, vertices + index * vertexStride, sizeof(position));
+        return position;
+    }
+}
+
+namespace dw {
+namespace mesh {
+
+template <typename Index>
+uint32_t GenerateIndexBuffer(Index* outIndices, void* outVertices, const void* vertices, uint32_t vertexCount, size_t vertexSize) {
+    const char* source = static_cast<const char*>(vertices);
+    uint8_t* destination = static_cast<uint8_t*>(outVertices);
+
+    std::unordered_map<std::string_view, uint32_t> uniqueVertices;
+    uniqueVertices.reserve(vertexCount);
+    uint32_t uniqueCount = 0;
+    for (uint32_t i = 0; i < vertexCount; ++i) {
+        const std::string_view vertex(source + i * vertexSize, vertexSize);
+        auto inserted = uniqueVertices.emplace(vertex, uniqueCount);
+        if (inserted.second) {
+            assert(uniqueCount <= std::numeric_limits<Index>::max() && "Too many unique vertices for the index type");
+            std::memcpy(destination + uniqueCount * vertexSize, vertex.data(), vertexSize);
+            ++uniqueCount;
+        }
+        outIndices[i] = static_cast<Index>(inserted.first->second);
+    }
+    return uniqueCount;
+}
+
+template <typename Index>
+void OptimizeVertexCache(Index* outIndices, const Index* indices, uint32_t indexCount, uint32_t vertexCount) {
+    assert(indexCount % 3 == 0 && "Index count must be a multiple of 3");
+    const std::vector<Index> input(indices, indices + indexCount);
+    const uint32_t triangleCount = indexCount / 3;
+
+    // Triangles using each vertex, the first remainingTriangles[v] entries of a vertex are the not yet emitted ones
+    std::vector<uint32_t> remainingTriangles(vertexCount, 0);
+    for (Index index : input) {
+        assert(index < vertexCount && "Index out of range");
+        ++remainingTriangles[index];
+    }
+    std::vector<uint32_t> triangleOffsets(vertexCount + 1, 0);
+    for (uint32_t v = 0; v < vertexCount; ++v) {
+        triangleOffsets[v + 1] = triangleOffsets[v] + remainingTriangles[v];
+    }
+    std::vector<uint32_t> adjacency(indexCount);
+    std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+    for (uint32_t i = 0; i < indexCount; ++i) {
+        adjacency[fill[input[i]]++] = i / 3;
+    }
+
+    std::vector<int32_t> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; ++v) {
+        vertexScores[v] = VertexScore(-1, remainingTriangles[v]);
+    }
+
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<bool> isEmitted(triangleCount, false);
+    uint32_t bestTriangle = s_INVALID;
+    float bestScore = -1.0f;
+    for (uint32_t t = 0; t < triangleCount; ++t) {
+        triangleScores[t] = vertexScores[input[t * 3 + 0]] + vertexScores[input[t * 3 + 1]] + vertexScores[input[t * 3 + 2]];
+        if (triangleScores[t] > bestScore) {
+            bestScore = triangleScores[t];
+            bestTriangle = t;
+        }
+    }
+
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> nextCache;
+    cache.reserve(s_CACHE_SIZE + 3);
+    nextCache.reserve(s_CACHE_SIZE + 3);
+    uint32_t nextUnemitted = 0;
+    for (uint32_t emitted = 0; emitted < triangleCount; ++emitted) {
+        // Nothing in the cache has triangles left, continue with the next one in input order
+        if (bestTriangle == s_INVALID) {
+            while (isEmitted[nextUnemitted]) {
+                ++nextUnemitted;
+            }
+            bestTriangle = nextUnemitted;
+        }
+
+        const Index* triangle = &input[bestTriangle * 3];
+        std::copy(triangle, triangle + 3, outIndices + emitted * 3);
+        isEmitted[bestTriangle] = true;
+
+        nextCache.clear();
+        for (uint32_t corner = 0; corner < 3; ++corner) {
+            const uint32_t vertex = triangle[corner];
+            uint32_t* first = &adjacency[triangleOffsets[vertex]];
+            uint32_t* last = first + remainingTriangles[vertex] - 1;
+            std::iter_swap(std::find(first, last + 1, bestTriangle), last);
+            --remainingTriangles[vertex];
+            nextCache.push_back(vertex);
+        }
+        for (uint32_t vertex : cache) {
+            if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) {
+                nextCache.push_back(vertex);
+            }
+        }
+
+        // Vertices pushed past the end of the cache are rescored once more so they lose their cache bonus
+        for (uint32_t i = 0; i < nextCache.size(); ++i) {
+            const uint32_t vertex = nextCache[i];
+            cachePositions[vertex] = i < s_CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+            vertexScores[vertex] = VertexScore(cachePositions[vertex], remainingTriangles[vertex]);
+        }
+
+        bestTriangle = s_INVALID;
+        bestScore = -1.0f;
+        for (uint32_t vertex : nextCache) {
+            const uint32_t* first = &adjacency[triangleOffsets[vertex]];
+            for (const uint32_t* t = first; t != first + remainingTriangles[vertex]; ++t) {
+                const Index* candidate = &input[*t * 3];
+                const float score = vertexScores[candidate[0]] + vertexScores[candidate[1]] + vertexScores[candidate[2]];
+                triangleScores[*t] = score;
+                if (score > bestScore) {
+                    bestScore = score;
+                    bestTriangle = *t;
+                }
+            }
+        }
+
+        if (nextCache.size() > s_CACHE_SIZE) {
+            nextCache.resize(s_CACHE_SIZE);
+        }
+        cache.swap(nextCache);
+    }
+}
+
+template <typename Index>
+void OptimizeOverdraw(Index* outIndices, const Index* indices, uint32_t indexCount, const void* vertices, uint32_t vertexCount, size_t vertexStride) {
+    assert(indexCount % 3 == 0 && "Index count must be a multiple of 3");
+    const std::vector<Index> input(indices, indices + indexCount);
+    const uint8_t* positions = static_cast<const uint8_t*>(vertices);
+    const uint32_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // Cut the triangle order where the cache starts over, keeping each cluster's vertex reuse intact
+    std::vector<uint32_t> clusterStarts;
+    std::vector<uint32_t> timestamps(vertexCount, 0);
+    uint32_t time = s_CLUSTER_CACHE_SIZE + 1;
+    for (uint32_t t = 0; t < triangleCount; ++t) {
+        uint32_t misses = 0;
+        for (uint32_t corner = 0; corner < 3; ++corner) {
+            const Index vertex = input[t * 3 + corner];
+            assert(vertex < vertexCount && "Index out of range");
+            if (time - timestamps[vertex] > s_CLUSTER_CACHE_SIZE) {
+                timestamps[vertex] = time++;
+                ++misses;
+            }
+        }
+        if (t == 0 || misses == 3) {
+            clusterStarts.push_back(t);
+        }
+    }
+    const uint32_t clusterCount = static_cast<uint32_t>(clusterStarts.size());
+    clusterStarts.push_back(triangleCount);
+
+    // Area weighted centroid and normal per cluster, the cross product's length is twice the triangle area
+    std::vector<Vec3> clusterCentroids(clusterCount);
+    std::vector<Vec3> clusterNormals(clusterCount);
+    Vec3 meshCentroid = { 0.0f, 0.0f, 0.0f };
+    float meshArea = 0.0f;
+    for (uint32_t c = 0; c < clusterCount; ++c) {
+        Vec3 centroid = { 0.0f, 0.0f, 0.0f };
+        Vec3 normal = { 0.0f, 0.0f, 0.0f };
+        float area = 0.0f;
+        for (uint32_t t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t) {
+            const Vec3 p0 = ReadPosition(positions, vertexStride, input[t * 3 + 0]);
+            const Vec3 p1 = ReadPosition(positions, vertexStride, input[t * 3 + 1]);
+            const Vec3 p2 = ReadPosition(positions, vertexStride, input[t * 3 + 2]);
+            const Vec3 weightedNormal = Cross(p1 - p0, p2 - p0);
+            const float triangleArea = std::sqrt(Dot(weightedNormal, weightedNormal));
+            centroid = centroid + (p0 + p1 + p2) * (triangleArea / 3.0f);
+            normal = normal + weightedNormal;
+            area += triangleArea;
+        }
+        meshCentroid = meshCentroid + centroid;
+        meshArea += area;
+        clusterCentroids[c] = area > 0.0f ? centroid * (1.0f / area) : centroid;
+        clusterNormals[c] = Dot(normal, normal) > 0.0f ? Normalize(normal) : normal;
+    }
+    if (meshArea > 0.0f) {
+        meshCentroid = meshCentroid * (1.0f / meshArea);
+    }
+
+    // Clusters facing away from the centre are the likely occluders of a closed mesh, draw them first
+    std::vector<float> sortKeys(clusterCount);
+    std::vector<uint32_t> clusterOrder(clusterCount);
+    for (uint32_t c = 0; c < clusterCount; ++c) {
+        sortKeys[c] = Dot(clusterCentroids[c] - meshCentroid, clusterNormals[c]);
+        clusterOrder[c] = c;
+    }
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&sortKeys](uint32_t a, uint32_t b) {
+        return sortKeys[a] > sortKeys[b];
+    });
+
+    Index* output = outIndices;
+    for (uint32_t c : clusterOrder) {
+        output = std::copy(input.begin() + clusterStarts[c] * 3, input.begin() + clusterStarts[c + 1] * 3, output);
+    }
+}
+
+template <typename Index>
+uint32_t OptimizeVertexFetch(void* outVertices, Index* indices, uint32_t indexCount, const void* vertices, uint32_t vertexCount, size_t vertexSize) {
+    const uint8_t* source = static_cast<const uint8_t*>(vertices);
+    uint8_t* destination = static_cast<uint8_t*>(outVertices);
+    assert(source != destination && "Vertex fetch optimization can't work in place");
+
+    std::vector<uint32_t> remap(vertexCount, s_INVALID);
+    uint32_t nextVertex = 0;
+    for (uint32_t i = 0; i < indexCount; ++i) {
+        const Index index = indices[i];
+        assert(index < vertexCount && "Index out of range");
+        if (remap[index] == s_INVALID) {
+            std::memcpy(destination + nextVertex * vertexSize, source + index * vertexSize, vertexSize);
+            remap[index] = nextVertex++;
+        }
+        indices[i] = static_cast<Index>(remap[index]);
+    }
+    return nextVertex;
+}
+
+template <typename Index>
+float ComputeACMR(const Index* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize) {
+    if (indexCount < 3) {
+        return 0.0f;
+    }
+
+    // A vertex is still cached if fewer than cacheSize misses happened since it was loaded
+    std::vector<uint32_t> timestamps(vertexCount, 0);
+    uint32_t time = cacheSize + 1;
+    uint32_t misses = 0;
+    for (uint32_t i = 0; i < indexCount; ++i) {
+        const Index index = indices[i];
+        assert(index < vertexCount && "Index out of range");
+        if (time - timestamps[index] > cacheSize) {
+            timestamps[index] = time++;
+            ++misses;
+        }
+    }
+    return static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+}
+
+template uint32_t GenerateIndexBuffer<uint16_t>(uint16_t*, void*, const void*, uint32_t, size_t);
+template uint32_t GenerateIndexBuffer<uint32_t>(uint32_t*, void*, const void*, uint32_t, size_t);
+template void OptimizeVertexCache<uint16_t>(uint16_t*, const uint16_t*, uint32_t, uint32_t);
+template void OptimizeVertexCache<uint32_t>(uint32_t*, const uint32_t*, uint32_t, uint32_t);
+template void OptimizeOverdraw<uint16_t>(uint16_t*, const uint16_t*, uint32_t, const void*, uint32_t, size_t);
+template void OptimizeOverdraw<uint32_t>(uint32_t*, const uint32_t*, uint32_t, const void*, uint32_t, size_t);
+template uint32_t OptimizeVertexFetch<uint16_t>(void*, uint16_t*, uint32_t, const void*, uint32_t, size_t);
+template uint32_t OptimizeVertexFetch<uint32_t>(void*, uint32_t*, uint32_t, const void*, uint32_t, size_t);
+template float ComputeACMR<uint16_t>(const uint16_t*, uint32_t, uint32_t, uint32_t);
+template float ComputeACMR<uint32_t>(const uint32_t*, uint32_t, uint32_t, uint32_t);
+
+} // namespace mesh
+} // namespace dw
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Offline mesh preparation for indexed drawing. The usual order is GenerateIndexBuffer, OptimizeVertexCache,
+// OptimizeOverdraw and finally OptimizeVertexFetch, since the last one renumbers the vertices in the order the
+// index buffer references them. Index is uint16_t or uint32_t, output and input index arrays may be the same.
+namespace dw {
+namespace mesh {
+
+/* Merges byte identical vertices. Writes one index per input vertex to outIndices and the unique vertices to
+   outVertices, which needs room for vertexCount vertices. Returns the number of unique vertices */
+template <typename Index>
+uint32_t GenerateIndexBuffer(Index* outIndices, void* outVertices, const void* vertices, uint32_t vertexCount, size_t vertexSize);
+
+/* Reorders the triangles for post transform vertex cache hits (Forsyth, linear speed vertex cache optimisation) */
+template <typename Index>
+void OptimizeVertexCache(Index* outIndices, const Index* indices, uint32_t indexCount, uint32_t vertexCount);
+
+/* Splits the cache optimised triangle order into clusters and draws outward facing clusters first, so the
+   triangles most likely to occlude the rest of the mesh pass the depth test first. Positions are the first
+   three floats of every vertexStride bytes */
+template <typename Index>
+void OptimizeOverdraw(Index* outIndices, const Index* indices, uint32_t indexCount, const void* vertices, uint32_t vertexCount, size_t vertexStride);
+
+/* Reorders the vertices in first use order and renumbers indices in place. Writes the referenced vertices to
+   outVertices and returns their count, unreferenced vertices are dropped */
+template <typename Index>
+uint32_t OptimizeVertexFetch(void* outVertices, Index* indices, uint32_t indexCount, const void* vertices, uint32_t vertexCount, size_t vertexSize);
+
+/* Average cache miss ratio, transformed vertices per triangle of a FIFO cache with cacheSize entries.
+   0.5 is the limit for large regular grids, 3.0 means no reuse at all */
+template <typename Index>
+float ComputeACMR(const Index* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize = 16);
+
+} // namespace mesh
+} // namespace dw
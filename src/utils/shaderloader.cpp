@@ -0,0 +1,183 @@
+#include "shaderloader.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+namespace dw {
+
+namespace {
+    std::string Normalize(const std::string& path) {
+        return std::filesystem::path(path).lexically_normal().generic_string();
+    }
+
+    bool ReadWholeFile(const std::string& path, std::string& text) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) {
+            return false;
+        }
+        const std::streamoff size = file.tellg();
+        if (size < 0) {
+            return false;
+        }
+        text.resize(static_cast<size_t>(size));
+        file.seekg(0);
+        return static_cast<bool>(file.read(&text[0], size));
+    }
+
+    bool IsSpace(char c) {
+        return c == ' ' || c == '\t';
+    }
+
+    // Matches '#' 'include' "name" or <name> at the start of the line [begin, end), skipping blanks
+    bool ParseInclude(const std::string& text, size_t begin, size_t end, std::string& name) {
+        size_t i = begin;
+        while (i < end && IsSpace(text[i])) {
+            ++i;
+        }
+        if (i == end || text[i++] != '#') {
+            return false;
+        }
+        while (i < end && IsSpace(text[i])) {
+            ++i;
+        }
+        const size_t keywordLength = sizeof("include") - 1;
+        if (end - i <= keywordLength || text.compare(i, keywordLength, "include") != 0) {
+            return false;
+        }
+        i += keywordLength;
+        while (i < end && IsSpace(text[i])) {
+            ++i;
+        }
+        if (i == end || (text[i] != '"' && text[i] != '<')) {
+            return false;
+        }
+        const char closing = text[i] == '"' ? '"' : '>';
+        const size_t nameEnd = text.find(closing, i + 1);
+        if (nameEnd == std::string::npos || nameEnd >= end || nameEnd == i + 1) {
+            return false;
+        }
+        name.assign(text, i + 1, nameEnd - i - 1);
+        return true;
+    }
+
+    // Directives inside block comments don't count, a comment opened on a line is closed by the end of it
+    bool UpdateBlockComment(const std::string& text, size_t begin, size_t end, bool inComment) {
+        for (size_t i = begin; i + 1 < end; ++i) {
+            if (inComment && text[i] == '*' && text[i + 1] == '/') {
+                inComment = false;
+                ++i;
+            } else if (!inComment && text[i] == '/' && text[i + 1] == '/') {
+                break;
+            } else if (!inComment && text[i] == '/' && text[i + 1] == '*') {
+                inComment = true;
+                ++i;
+            }
+        }
+        return inComment;
+    }
+}
+
+void ShaderLoader::AddIncludeDirectory(const std::string& directory) {
+    m_includeDirectories.push_back(directory);
+}
+
+bool ShaderLoader::Load(const std::string& path, ShaderSource& source) {
+    source.text.clear();
+    source.files.clear();
+
+    const std::string normalized = Normalize(path);
+    const File* file = findFile(normalized);
+    if (!file) {
+        LOGE("Could not read shader " + path);
+        return false;
+    }
+    source.files.push_back(normalized);
+    return expand(normalized, *file, source);
+}
+
+void ShaderLoader::Invalidate(const std::string& path) {
+    m_files.erase(Normalize(path));
+}
+
+const ShaderLoader::File* ShaderLoader::findFile(const std::string& path) {
+    auto it = m_files.find(path);
+    if (it != m_files.end()) {
+        return &it->second;
+    }
+
+    File file;
+    if (!ReadWholeFile(path, file.text)) {
+        return nullptr;
+    }
+    // Scan once for the directives, expanding is then only copying the text between them
+    bool inComment = false;
+    uint32_t line = 1;
+    for (size_t begin = 0; begin < file.text.size(); ++line) {
+        size_t end = file.text.find('\n', begin);
+        if (end == std::string::npos) {
+            end = file.text.size();
+        }
+        const size_t lineEnd = end > begin && file.text[end - 1] == '\r' ? end - 1 : end;
+        Include include;
+        if (!inComment && ParseInclude(file.text, begin, lineEnd, include.name)) {
+            include.begin = begin;
+            include.end = lineEnd;
+            include.line = line;
+            file.includes.push_back(std::move(include));
+        } else {
+            inComment = UpdateBlockComment(file.text, begin, lineEnd, inComment);
+        }
+        begin = end + 1;
+    }
+    return &m_files.emplace(path, std::move(file)).first->second;
+}
+
+std::string ShaderLoader::resolve(const std::string& name, const std::string& includer) {
+    const std::string local = Normalize((std::filesystem::path(includer).parent_path() / name).generic_string());
+    if (findFile(local)) {
+        return local;
+    }
+    for (const std::string& directory : m_includeDirectories) {
+        const std::string candidate = Normalize((std::filesystem::path(directory) / name).generic_string());
+        if (findFile(candidate)) {
+            return candidate;
+        }
+    }
+    return std::string();
+}
+
+bool ShaderLoader::expand(const std::string& path, const File& file, ShaderSource& source) {
+    const uint32_t index = static_cast<uint32_t>(source.files.size() - 1);
+    size_t copied = 0;
+    for (const Include& include : file.includes) {
+        source.text.append(file.text, copied, include.begin - copied);
+        copied = include.end;
+
+        const std::string includePath = resolve(include.name, path);
+        if (includePath.empty()) {
+            LOGE("Could not find " + include.name + " included from " + path + ":" + std::to_string(include.line));
+            return false;
+        }
+        // Already pasted, leave the line empty so the numbering stays the same
+        if (std::find(source.files.begin(), source.files.end(), includePath) != source.files.end()) {
+            continue;
+        }
+
+        source.files.push_back(includePath);
+        source.text += "#line 1 " + std::to_string(source.files.size() - 1) + "\n";
+        // findFile can't fail, resolve just read it. Pointers into the cache stay valid while it grows
+        if (!expand(includePath, *findFile(includePath), source)) {
+            return false;
+        }
+        if (source.text.back() != '\n') {
+            source.text += '\n';
+        }
+        source.text += "#line " + std::to_string(include.line + 1) + " " + std::to_string(index);
+    }
+    source.text.append(file.text, copied, std::string::npos);
+    return true;
+}
+
+} // namespace dw
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace dw {
+
+// An expanded shader. files[0] is the loaded file followed by every file it included, in the order they were
+// pasted. The expansion sets #line line index directives, so the source string number compilers print with
+// an error is the index of the file here.
+struct ShaderSource {
+    std::string text;
+    std::vector<std::string> files;
+};
+
+// Reads shader files and pastes #include "name" directives in place. Includes are searched next to the
+// including file first, then in the include directories. Every file is read with one bulk read and parsed
+// once, later loads of shaders sharing headers only copy the cached pieces. A file is pasted once per shader,
+// as if every header had an include guard, which also stops include cycles. Directives must stand on their
+// own line and should come after the #version line.
+class ShaderLoader {
+public:
+    void AddIncludeDirectory(const std::string& directory);
+
+    /* Reads path and expands its includes. False if path or one of its includes can't be read */
+    bool Load(const std::string& path, ShaderSource& source);
+    /* Drops a changed file from the cache, the next load that uses it reads it again */
+    void Invalidate(const std::string& path);
+    void Clear() { m_files.clear(); }
+
+private:
+    struct Include {
+        size_t begin = 0; // Offsets of the directive line in the file, without the line break
+        size_t end = 0;
+        uint32_t line = 0;
+        std::string name;
+    };
+
+    struct File {
+        std::string text;
+        std::vector<Include> includes;
+    };
+
+    const File* findFile(const std::string& path);
+    std::string resolve(const std::string& name, const std::string& includer);
+    bool expand(const std::string& path, const File& file, ShaderSource& source);
+
+    std::vector<std::string> m_includeDirectories;
+    std::unordered_map<std::string, File> m_files; // Keyed by the normalized path
+};
+
+} // namespace dw
@@ -0,0 +1,1191 @@
+#include "textureencoder.h"
+#include "textureencoder_kernels.h"
+#include "threadpool.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+#if defined(DW_SSE2_ENABLED)
+  #include <emmintrin.h>
+#endif
+
+namespace {
+    const uint32_t s_BLOCKS_PER_JOB = 256; // Rows of blocks are handed to the workers in jobs of about this many
+    const uint32_t s_REFINEMENTS[3] = { 0, 1, 2 }; // Least squares passes per quality tier
+    const uint32_t s_BC7_PARTITION_CANDIDATES = 4; // Two subset partitions encoded at high quality
+
+    // Where each index lands between the two endpoints, negative for the values that aren't on the line
+    const float s_BC1_WEIGHTS4[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+    const float s_BC1_WEIGHTS3[4] = { 0.0f, 1.0f, 0.5f, -1.0f };
+    const float s_BC4_WEIGHTS8[8] = { 0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f };
+    const float s_BC4_WEIGHTS6[8] = { 0.0f, 1.0f, 0.2f, 0.4f, 0.6f, 0.8f, -1.0f, -1.0f };
+
+    // BC7 interpolates in 64ths
+    const uint32_t s_BC7_WEIGHTS3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+    const uint32_t s_BC7_WEIGHTS2[4] = { 0, 21, 43, 64 };
+    const uint32_t s_BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    // Texels of the second subset of each two subset partition, and the texel of that subset whose index
+    // drops its highest bit
+    const uint16_t s_BC7_PARTITIONS2[64] = {
+        0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80, 0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+        0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE, 0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+        0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A, 0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+        0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C, 0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22
+    };
+    const uint8_t s_BC7_ANCHORS2[64] = {
+        15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+        15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+        15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6,
+        6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15
+    };
+
+    using Texels = uint8_t[16][4];
+    using Ends = float[2][4];
+
+    // Writes fields lowest bit first, the way BC7 lays out its blocks
+    class BitWriter {
+    public:
+        explicit BitWriter(uint8_t* out) : m_out(out) {
+            std::memset(m_out, 0, 16);
+        }
+
+        void Write(uint32_t value, uint32_t bits) {
+            for (uint32_t i = 0; i < bits; ++i, ++m_bit) {
+                m_out[m_bit >> 3] |= static_cast<uint8_t>(((value >> i) & 1) << (m_bit & 7));
+            }
+        }
+
+    private:
+        uint8_t* m_out;
+        uint32_t m_bit = 0;
+    };
+
+    float Clamp(float value) {
+        return std::min(std::max(value, 0.0f), 255.0f);
+    }
+
+    uint32_t Quantize(float value, float scale, uint32_t maximum) {
+        return std::min(static_cast<uint32_t>(std::lround(std::max(value * scale, 0.0f))), maximum);
+    }
+
+    void StoreUint16(uint8_t* out, uint32_t value) {
+        out[0] = static_cast<uint8_t>(value);
+        out[1] = static_cast<uint8_t>(value >> 8);
+    }
+
+    // Texels past the right and bottom edge repeat the last column and row
+    void LoadTexels(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, Texels& texels) {
+        for (uint32_t y = 0; y < 4; ++y) {
+            const size_t row = std::min(blockY * 4 + y, height - 1) * static_cast<size_t>(width);
+            for (uint32_t x = 0; x < 4; ++x) {
+                std::memcpy(texels[y * 4 + x], rgba + (row + std::min(blockX * 4 + x, width - 1)) * 4, 4);
+            }
+        }
+    }
+
+    // Moves one channel to red and clears the others, to encode it on its own
+    void ExtractChannel(const Texels& texels, uint32_t channel, Texels& out) {
+        std::memset(out, 0, sizeof(Texels));
+        for (uint32_t t = 0; t < 16; ++t) {
+            out[t][0] = texels[t][channel];
+        }
+    }
+
+    dw::encoder::Block MakeBlock(const Texels& texels, uint32_t channels) {
+        dw::encoder::Block block;
+        for (uint32_t t = 0; t < 16; ++t) {
+            block.rg[t * 2 + 0] = channels > 0 ? texels[t][0] : 0;
+            block.rg[t * 2 + 1] = channels > 1 ? texels[t][1] : 0;
+            block.ba[t * 2 + 0] = channels > 2 ? texels[t][2] : 0;
+            block.ba[t * 2 + 1] = channels > 3 ? texels[t][3] : 0;
+        }
+        return block;
+    }
+
+    // Returns how many texels are in mask, of which mean and covariance receive those of the first channels
+    uint32_t ComputeCovariance(const Texels& texels, uint32_t mask, uint32_t channels, float* mean, float (*covariance)[4]) {
+        std::memset(mean, 0, sizeof(float) * 4);
+        std::memset(covariance, 0, sizeof(float) * 16);
+        uint32_t count = 0;
+        for (uint32_t t = 0; t < 16; ++t) {
+            if (mask & (1 << t)) {
+                for (uint32_t c = 0; c < channels; ++c) {
+                    mean[c] += texels[t][c];
+                }
+                ++count;
+            }
+        }
+        if (count == 0) {
+            return 0;
+        }
+        for (uint32_t c = 0; c < channels; ++c) {
+            mean[c] /= count;
+        }
+        for (uint32_t t = 0; t < 16; ++t) {
+            if (mask & (1 << t)) {
+                for (uint32_t a = 0; a < channels; ++a) {
+                    for (uint32_t b = 0; b < channels; ++b) {
+                        covariance[a][b] += (texels[t][a] - mean[a]) * (texels[t][b] - mean[b]);
+                    }
+                }
+            }
+        }
+        return count;
+    }
+
+    // Power iteration, axis starts out as a guess and ends up scaled so its largest channel is 1
+    void ComputePrincipalAxis(const float (*covariance)[4], uint32_t channels, float* axis) {
+        for (uint32_t i = 0; i < dw::encoder::s_POWER_ITERATIONS; ++i) {
+            float next[4] = {};
+            float largest = 0.0f;
+            for (uint32_t a = 0; a < channels; ++a) {
+                for (uint32_t b = 0; b < channels; ++b) {
+                    next[a] += covariance[a][b] * axis[b];
+                }
+                largest = std::max(largest, std::fabs(next[a]));
+            }
+            if (largest <= 0.0f) {
+                return;
+            }
+            for (uint32_t c = 0; c < channels; ++c) {
+                axis[c] = next[c] / largest;
+            }
+        }
+    }
+
+    // Line through the texels in mask over the first channels, as its two ends. Either the bounding box
+    // diagonal, flipped in the channels that fall while the widest one rises, or the principal axis
+    void FitLine(const Texels& texels, uint32_t mask, uint32_t channels, bool principalAxis, Ends& ends) {
+        std::memset(ends, 0, sizeof(Ends));
+        float mean[4];
+        float covariance[4][4];
+        if (ComputeCovariance(texels, mask, channels, mean, covariance) == 0) {
+            return;
+        }
+        float minimum[4] = { 255.0f, 255.0f, 255.0f, 255.0f };
+        float maximum[4] = {};
+        for (uint32_t t = 0; t < 16; ++t) {
+            if (mask & (1 << t)) {
+                for (uint32_t c = 0; c < channels; ++c) {
+                    minimum[c] = std::min(minimum[c], static_cast<float>(texels[t][c]));
+                    maximum[c] = std::max(maximum[c], static_cast<float>(texels[t][c]));
+                }
+            }
+        }
+        uint32_t widest = 0;
+        for (uint32_t c = 0; c < channels; ++c) {
+            if (maximum[c] - minimum[c] > maximum[widest] - minimum[widest]) {
+                widest = c;
+            }
+        }
+        for (uint32_t c = 0; c < channels; ++c) {
+            const bool isFalling = covariance[c][widest] < 0.0f;
+            ends[0][c] = isFalling ? maximum[c] : minimum[c];
+            ends[1][c] = isFalling ? minimum[c] : maximum[c];
+        }
+        if (!principalAxis) {
+            return;
+        }
+
+        // The diagonal is usually close to the axis already
+        float axis[4] = {};
+        float lengthSquared = 0.0f;
+        for (uint32_t c = 0; c < channels; ++c) {
+            axis[c] = ends[1][c] - ends[0][c];
+        }
+        ComputePrincipalAxis(covariance, channels, axis);
+        for (uint32_t c = 0; c < channels; ++c) {
+            lengthSquared += axis[c] * axis[c];
+        }
+        if (lengthSquared <= 0.0f) {
+            return;
+        }
+
+        float low = FLT_MAX;
+        float high = -FLT_MAX;
+        for (uint32_t t = 0; t < 16; ++t) {
+            if (mask & (1 << t)) {
+                float projection = 0.0f;
+                for (uint32_t c = 0; c < channels; ++c) {
+                    projection += (texels[t][c] - mean[c]) * axis[c];
+                }
+                low = std::min(low, projection);
+                high = std::max(high, projection);
+            }
+        }
+        for (uint32_t c = 0; c < channels; ++c) {
+            ends[0][c] = Clamp(mean[c] + axis[c] * low / lengthSquared);
+            ends[1][c] = Clamp(mean[c] + axis[c] * high / lengthSquared);
+        }
+    }
+
+    // Summed squared distance from their principal axis of count texels with the moments sums, what any
+    // line through them misses at least
+    float GetLineError(const float* sums, float count) {
+        if (count == 0.0f) {
+            return 0.0f;
+        }
+        const float* products = sums + 3;
+        const float scale = 1.0f / count;
+        float covariance[4][4] = {};
+        covariance[0][0] = products[0] - sums[0] * sums[0] * scale;
+        covariance[0][1] = covariance[1][0] = products[1] - sums[0] * sums[1] * scale;
+        covariance[0][2] = covariance[2][0] = products[2] - sums[0] * sums[2] * scale;
+        covariance[1][1] = products[3] - sums[1] * sums[1] * scale;
+        covariance[1][2] = covariance[2][1] = products[4] - sums[1] * sums[2] * scale;
+        covariance[2][2] = products[5] - sums[2] * sums[2] * scale;
+
+        uint32_t widest = 0;
+        float trace = 0.0f;
+        for (uint32_t c = 0; c < 3; ++c) {
+            widest = covariance[c][c] > covariance[widest][widest] ? c : widest;
+            trace += covariance[c][c];
+        }
+        float axis[4] = { covariance[widest][0], covariance[widest][1], covariance[widest][2], 0.0f };
+        ComputePrincipalAxis(covariance, 3, axis);
+
+        float along = 0.0f;
+        float lengthSquared = 0.0f;
+        for (uint32_t a = 0; a < 3; ++a) {
+            for (uint32_t b = 0; b < 3; ++b) {
+                along += axis[a] * covariance[a][b] * axis[b];
+            }
+            lengthSquared += axis[a] * axis[a];
+        }
+        const float error = lengthSquared > 0.0f ? trace - along / lengthSquared : trace;
+        return error > 0.0f ? error : 0.0f;
+    }
+
+    // Least squares ends for the indices picked, where index i blends the ends by weights[i]. False if the
+    // indices don't pin down both ends
+    bool RefineLine(const Texels& texels, uint32_t mask, uint32_t channels, const uint8_t* indices, const float* weights, Ends& ends) {
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        float xa[4] = {};
+        float xb[4] = {};
+        for (uint32_t t = 0; t < 16; ++t) {
+            const float b = weights[indices[t]];
+            if (!(mask & (1 << t)) || b < 0.0f) {
+                continue;
+            }
+            const float a = 1.0f - b;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (uint32_t c = 0; c < channels; ++c) {
+                xa[c] += a * texels[t][c];
+                xb[c] += b * texels[t][c];
+            }
+        }
+        const float determinant = aa * bb - ab * ab;
+        if (determinant < 1e-4f) {
+            return false;
+        }
+        for (uint32_t c = 0; c < channels; ++c) {
+            ends[0][c] = Clamp((bb * xa[c] - ab * xb[c]) / determinant);
+            ends[1][c] = Clamp((aa * xb[c] - ab * xa[c]) / determinant);
+        }
+        return true;
+    }
+
+    // Encodes the ends with tryEnds, then refines them from the indices they got as long as that lowers the
+    // error. tryEnds(ends, out, indices) may swap the ends, as long as they match the indices it returns
+    template <typename TryEnds>
+    uint32_t EncodeRefined(const Texels& texels, uint32_t mask, uint32_t channels, uint32_t refinements, const float* weights,
+                           Ends& ends, uint8_t* out, size_t size, const TryEnds& tryEnds) {
+        uint8_t indices[16] = {};
+        uint32_t error = tryEnds(ends, out, indices);
+        for (uint32_t i = 0; i < refinements && error > 0; ++i) {
+            Ends refined;
+            std::memcpy(refined, ends, sizeof(Ends));
+            if (!RefineLine(texels, mask, channels, indices, weights, refined)) {
+                break;
+            }
+            uint8_t candidate[16];
+            uint8_t candidateIndices[16] = {};
+            const uint32_t candidateError = tryEnds(refined, candidate, candidateIndices);
+            if (candidateError >= error) {
+                break;
+            }
+            error = candidateError;
+            std::memcpy(out, candidate, size);
+            std::memcpy(indices, candidateIndices, sizeof(indices));
+            std::memcpy(ends, refined, sizeof(Ends));
+        }
+        return error;
+    }
+
+    uint32_t To565(const float* color) {
+        return Quantize(color[0], 31.0f / 255.0f, 31) << 11 | Quantize(color[1], 63.0f / 255.0f, 63) << 5 | Quantize(color[2], 31.0f / 255.0f, 31);
+    }
+
+    void From565(uint32_t color, uint8_t* rgb) {
+        const uint32_t r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+        rgb[0] = static_cast<uint8_t>(r << 3 | r >> 2);
+        rgb[1] = static_cast<uint8_t>(g << 2 | g >> 4);
+        rgb[2] = static_cast<uint8_t>(b << 3 | b >> 2);
+    }
+
+    // Transparent texels get index 3 of the three color mode, they aren't in mask
+    uint32_t TryBc1(const dw::encoder::Block& block, uint32_t mask, uint32_t transparent, bool threeColors, Ends& ends,
+                    const dw::encoder::Kernels& kernels, uint8_t* out, uint8_t* indices) {
+        uint32_t colors[2] = { To565(ends[0]), To565(ends[1]) };
+        // Four colors need color0 > color1, three colors the opposite
+        if (threeColors ? colors[0] > colors[1] : colors[0] < colors[1]) {
+            std::swap(colors[0], colors[1]);
+            std::swap_ranges(ends[0], ends[0] + 4, ends[1]);
+        }
+        uint8_t palette[4][4] = {};
+        From565(colors[0], palette[0]);
+        From565(colors[1], palette[1]);
+        uint32_t count = 4;
+        if (threeColors) {
+            for (uint32_t c = 0; c < 3; ++c) {
+                palette[2][c] = static_cast<uint8_t>((palette[0][c] + palette[1][c] + 1) / 2);
+            }
+            count = 3;
+        } else if (colors[0] == colors[1]) {
+            count = 1;
+        } else {
+            for (uint32_t c = 0; c < 3; ++c) {
+                palette[2][c] = static_cast<uint8_t>((2 * palette[0][c] + palette[1][c] + 1) / 3);
+                palette[3][c] = static_cast<uint8_t>((palette[0][c] + 2 * palette[1][c] + 1) / 3);
+            }
+        }
+
+        const uint32_t error = kernels.selectIndices(block, palette, count, mask, indices);
+        uint32_t bits = 0;
+        for (uint32_t t = 0; t < 16; ++t) {
+            if (transparent & (1 << t)) {
+                indices[t] = 3;
+            }
+            bits |= static_cast<uint32_t>(indices[t]) << (t * 2);
+        }
+        StoreUint16(out, colors[0]);
+        StoreUint16(out + 2, colors[1]);
+        StoreUint16(out + 4, bits);
+        StoreUint16(out + 6, bits >> 16);
+        return error;
+    }
+
+    uint32_t EncodeBc1(const Texels& texels, dw::TextureEncoder::Quality quality, const dw::encoder::Kernels& kernels,
+                       bool allowTransparent, uint8_t* out) {
+        uint32_t transparent = 0;
+        for (uint32_t t = 0; t < 16 && allowTransparent; ++t) {
+            transparent |= texels[t][3] < 128 ? 1 << t : 0;
+        }
+        const uint32_t mask = ~transparent & 0xFFFF;
+        if (mask == 0) {
+            // Three colors with every index pointing at transparent black
+            std::memset(out, 0, 4);
+            std::memset(out + 4, 0xFF, 4);
+            return 0;
+        }
+
+        const dw::encoder::Block block = MakeBlock(texels, 3);
+        const bool threeColors = transparent != 0;
+        const auto tryColors = [&](bool three) {
+            return [&, three](Ends& ends, uint8_t* candidate, uint8_t* indices) {
+                return TryBc1(block, mask, transparent, three, ends, kernels, candidate, indices);
+            };
+        };
+        Ends ends;
+        FitLine(texels, mask, 3, quality != dw::TextureEncoder::QUALITY_FAST, ends);
+        uint32_t error = EncodeRefined(texels, mask, 3, s_REFINEMENTS[quality], threeColors ? s_BC1_WEIGHTS3 : s_BC1_WEIGHTS4,
+                                       ends, out, 8, tryColors(threeColors));
+
+        if (quality == dw::TextureEncoder::QUALITY_HIGH && allowTransparent && !threeColors && error > 0) {
+            // Texels halfway between two colors are closer to the three color midpoint than to a third
+            Ends threeEnds;
+            uint8_t candidate[8];
+            FitLine(texels, mask, 3, true, threeEnds);
+            const uint32_t threeError = EncodeRefined(texels, mask, 3, s_REFINEMENTS[quality], s_BC1_WEIGHTS3, threeEnds,
+                                                      candidate, 8, tryColors(true));
+            if (threeError < error) {
+                error = threeError;
+                std::memcpy(out, candidate, 8);
+            }
+        }
+        return error;
+    }
+
+    uint32_t TryBc4(const dw::encoder::Block& block, bool sixValues, Ends& ends, const dw::encoder::Kernels& kernels,
+                    uint8_t* out, uint8_t* indices) {
+        uint32_t values[2] = { Quantize(ends[0][0], 1.0f, 255), Quantize(ends[1][0], 1.0f, 255) };
+        // Eight values need red0 > red1, six values and 0 and 255 the opposite
+        if (sixValues ? values[0] > values[1] : values[0] < values[1]) {
+            std::swap(values[0], values[1]);
+            std::swap_ranges(ends[0], ends[0] + 4, ends[1]);
+        }
+        uint8_t palette[8][4] = {};
+        palette[0][0] = static_cast<uint8_t>(values[0]);
+        palette[1][0] = static_cast<uint8_t>(values[1]);
+        uint32_t count = 8;
+        if (sixValues) {
+            for (uint32_t i = 2; i < 6; ++i) {
+                palette[i][0] = static_cast<uint8_t>(((6 - i) * values[0] + (i - 1) * values[1] + 2) / 5);
+            }
+            palette[7][0] = 255;
+        } else if (values[0] == values[1]) {
+            count = 1;
+        } else {
+            for (uint32_t i = 2; i < 8; ++i) {
+                palette[i][0] = static_cast<uint8_t>(((8 - i) * values[0] + (i - 1) * values[1] + 3) / 7);
+            }
+        }
+
+        const uint32_t error = kernels.selectIndices(block, palette, count, 0xFFFF, indices);
+        uint64_t bits = 0;
+        for (uint32_t t = 0; t < 16; ++t) {
+            bits |= static_cast<uint64_t>(indices[t]) << (t * 3);
+        }
+        out[0] = static_cast<uint8_t>(values[0]);
+        out[1] = static_cast<uint8_t>(values[1]);
+        for (uint32_t i = 0; i < 6; ++i) {
+            out[2 + i] = static_cast<uint8_t>(bits >> (i * 8));
+        }
+        return error;
+    }
+
+    // Encodes the red channel
+    uint32_t EncodeBc4(const Texels& texels, dw::TextureEncoder::Quality quality, const dw::encoder::Kernels& kernels, uint8_t* out) {
+        const dw::encoder::Block block = MakeBlock(texels, 1);
+        const auto tryValues = [&](bool six) {
+            return [&, six](Ends& ends, uint8_t* candidate, uint8_t* indices) {
+                return TryBc4(block, six, ends, kernels, candidate, indices);
+            };
+        };
+        Ends ends;
+        FitLine(texels, 0xFFFF, 1, false, ends);
+        uint32_t error = EncodeRefined(texels, 0xFFFF, 1, s_REFINEMENTS[quality], s_BC4_WEIGHTS8, ends, out, 8, tryValues(false));
+        if (quality != dw::TextureEncoder::QUALITY_HIGH || error == 0) {
+            return error;
+        }
+
+        // Six values leave 0 and 255 to the texels at the extremes and spread finer over the others
+        uint32_t inner = 0;
+        for (uint32_t t = 0; t < 16; ++t) {
+            inner |= texels[t][0] != 0 && texels[t][0] != 255 ? 1 << t : 0;
+        }
+        if (inner != 0 && inner != 0xFFFF) {
+            Ends sixEnds;
+            uint8_t candidate[8];
+            FitLine(texels, inner, 1, false, sixEnds);
+            const uint32_t sixError = EncodeRefined(texels, 0xFFFF, 1, s_REFINEMENTS[quality], s_BC4_WEIGHTS6, sixEnds, candidate, 8,
+                                                    tryValues(true));
+            if (sixError < error) {
+                error = sixError;
+                std::memcpy(out, candidate, 8);
+            }
+        }
+        return error;
+    }
+
+    // Mode 6: one subset of RGBA, 7 bits per channel and a p-bit below them for each endpoint. The p-bits are
+    // either the two bits of pbits or, if that is negative, those landing closest to the ends
+    uint32_t TryBc7Mode6(const dw::encoder::Block& block, int32_t pbits, Ends& ends, const dw::encoder::Kernels& kernels,
+                         uint8_t* out, uint8_t* indices) {
+        uint8_t quantized[2][4] = {};
+        uint32_t pbit[2] = {};
+        for (uint32_t e = 0; e < 2; ++e) {
+            float closest = FLT_MAX;
+            for (uint32_t p = 0; p < 2; ++p) {
+                if (pbits >= 0 && p != ((static_cast<uint32_t>(pbits) >> e) & 1)) {
+                    continue;
+                }
+                uint8_t candidate[4];
+                float distance = 0.0f;
+                for (uint32_t c = 0; c < 4; ++c) {
+                    candidate[c] = static_cast<uint8_t>(Quantize(ends[e][c] - p, 0.5f, 127));
+                    const float difference = (candidate[c] << 1 | p) - ends[e][c];
+                    distance += difference * difference;
+                }
+                if (distance < closest) {
+                    closest = distance;
+                    std::memcpy(quantized[e], candidate, 4);
+                    pbit[e] = p;
+                }
+            }
+        }
+
+        uint8_t palette[16][4];
+        for (uint32_t i = 0; i < 16; ++i) {
+            for (uint32_t c = 0; c < 4; ++c) {
+                const uint32_t low = quantized[0][c] << 1 | pbit[0], high = quantized[1][c] << 1 | pbit[1];
+                palette[i][c] = static_cast<uint8_t>(((64 - s_BC7_WEIGHTS4[i]) * low + s_BC7_WEIGHTS4[i] * high + 32) >> 6);
+            }
+        }
+        const uint32_t error = kernels.selectIndices(block, palette, 16, 0xFFFF, indices);
+
+        // The first texel's index is stored without its highest bit, which has to be 0
+        if (indices[0] >= 8) {
+            std::swap_ranges(quantized[0], quantized[0] + 4, quantized[1]);
+            std::swap(pbit[0], pbit[1]);
+            std::swap_ranges(ends[0], ends[0] + 4, ends[1]);
+            for (uint32_t t = 0; t < 16; ++t) {
+                indices[t] = static_cast<uint8_t>(15 - indices[t]);
+            }
+        }
+        BitWriter bits(out);
+        bits.Write(1 << 6, 7);
+        for (uint32_t c = 0; c < 4; ++c) {
+            bits.Write(quantized[0][c], 7);
+            bits.Write(quantized[1][c], 7);
+        }
+        bits.Write(pbit[0], 1);
+        bits.Write(pbit[1], 1);
+        bits.Write(indices[0], 3);
+        for (uint32_t t = 1; t < 16; ++t) {
+            bits.Write(indices[t], 4);
+        }
+        return error;
+    }
+
+    // Half of mode 5: the first channels of the block with 2 bit indices, 7 bit color or 8 bit alpha endpoints.
+    // out receives the endpoints from byte 0 and the indices packed from byte 8, ends are swapped along with
+    // them if the first texel's index would need its highest bit
+    uint32_t TryBc7Mode5Part(const dw::encoder::Block& block, uint32_t channels, uint32_t bits, Ends& ends,
+                             const dw::encoder::Kernels& kernels, uint8_t* out, uint8_t* indices) {
+        const uint32_t maximum = (1u << bits) - 1;
+        uint8_t quantized[2][4] = {};
+        uint8_t colors[2][4] = {};
+        for (uint32_t e = 0; e < 2; ++e) {
+            for (uint32_t c = 0; c < channels; ++c) {
+                quantized[e][c] = static_cast<uint8_t>(Quantize(ends[e][c], maximum / 255.0f, maximum));
+                colors[e][c] = static_cast<uint8_t>(bits == 8 ? quantized[e][c] : quantized[e][c] << 1 | quantized[e][c] >> 6);
+            }
+        }
+        uint8_t palette[4][4] = {};
+        for (uint32_t i = 0; i < 4; ++i) {
+            for (uint32_t c = 0; c < channels; ++c) {
+                palette[i][c] = static_cast<uint8_t>(((64 - s_BC7_WEIGHTS2[i]) * colors[0][c] + s_BC7_WEIGHTS2[i] * colors[1][c] + 32) >> 6);
+            }
+        }
+        const uint32_t error = kernels.selectIndices(block, palette, 4, 0xFFFF, indices);
+
+        if (indices[0] >= 2) {
+            std::swap_ranges(quantized[0], quantized[0] + 4, quantized[1]);
+            std::swap_ranges(ends[0], ends[0] + 4, ends[1]);
+            for (uint32_t t = 0; t < 16; ++t) {
+                indices[t] = static_cast<uint8_t>(3 - indices[t]);
+            }
+        }
+        std::memset(out, 0, 12);
+        std::memcpy(out, quantized[0], 4);
+        std::memcpy(out + 4, quantized[1], 4);
+        for (uint32_t t = 0; t < 16; ++t) {
+            out[8 + t / 4] |= static_cast<uint8_t>(indices[t] << (t % 4 * 2));
+        }
+        return error;
+    }
+
+    // Mode 5: one subset with the color and the alpha on lines of their own, for blocks where alpha doesn't
+    // follow the color, such as the edges of cut outs
+    uint32_t EncodeBc7Mode5(const Texels& texels, dw::TextureEncoder::Quality quality, const dw::encoder::Kernels& kernels, uint8_t* out) {
+        float weights[4];
+        for (uint32_t i = 0; i < 4; ++i) {
+            weights[i] = s_BC7_WEIGHTS2[i] / 64.0f;
+        }
+        Texels alpha;
+        ExtractChannel(texels, 3, alpha);
+        const dw::encoder::Block colorBlock = MakeBlock(texels, 3);
+        const dw::encoder::Block alphaBlock = MakeBlock(alpha, 1);
+
+        uint8_t color[12];
+        Ends colorEnds;
+        FitLine(texels, 0xFFFF, 3, quality != dw::TextureEncoder::QUALITY_FAST, colorEnds);
+        uint32_t error = EncodeRefined(texels, 0xFFFF, 3, s_REFINEMENTS[quality], weights, colorEnds, color, sizeof(color),
+                                       [&](Ends& candidateEnds, uint8_t* candidate, uint8_t* indices) {
+            return TryBc7Mode5Part(colorBlock, 3, 7, candidateEnds, kernels, candidate, indices);
+        });
+        uint8_t values[12];
+        Ends alphaEnds;
+        FitLine(alpha, 0xFFFF, 1, false, alphaEnds);
+        error += EncodeRefined(alpha, 0xFFFF, 1, s_REFINEMENTS[quality], weights, alphaEnds, values, sizeof(values),
+                               [&](Ends& candidateEnds, uint8_t* candidate, uint8_t* indices) {
+            return TryBc7Mode5Part(alphaBlock, 1, 8, candidateEnds, kernels, candidate, indices);
+        });
+
+        // No channel rotation
+        BitWriter bits(out);
+        bits.Write(1 << 5, 6);
+        bits.Write(0, 2);
+        for (uint32_t c = 0; c < 3; ++c) {
+            bits.Write(color[c], 7);
+            bits.Write(color[4 + c], 7);
+        }
+        bits.Write(values[0], 8);
+        bits.Write(values[4], 8);
+        for (const uint8_t* indices : { color + 8, values + 8 }) {
+            for (uint32_t t = 0; t < 16; ++t) {
+                bits.Write(indices[t / 4] >> (t % 4 * 2), t == 0 ? 1 : 2);
+            }
+        }
+        return error;
+    }
+
+    // One subset of mode 1: RGB, 6 bits per channel and a p-bit below them shared by both endpoints. Only
+    // the indices of the texels in mask are written
+    uint32_t TryBc7Mode1Subset(const dw::encoder::Block& block, uint32_t mask, const Ends& ends, const dw::encoder::Kernels& kernels,
+                               uint8_t (*quantized)[4], uint32_t& pbit, uint8_t* indices) {
+        uint32_t error = UINT32_MAX;
+        for (uint32_t p = 0; p < 2; ++p) {
+            uint8_t candidate[2][4] = {};
+            uint8_t colors[2][4] = {};
+            for (uint32_t e = 0; e < 2; ++e) {
+                for (uint32_t c = 0; c < 3; ++c) {
+                    candidate[e][c] = static_cast<uint8_t>(Quantize(ends[e][c] * 127.0f / 255.0f - p, 0.5f, 63));
+                    const uint32_t value = candidate[e][c] << 1 | p;
+                    colors[e][c] = static_cast<uint8_t>(value << 1 | value >> 6);
+                }
+            }
+            uint8_t palette[8][4];
+            for (uint32_t i = 0; i < 8; ++i) {
+                for (uint32_t c = 0; c < 3; ++c) {
+                    palette[i][c] = static_cast<uint8_t>(((64 - s_BC7_WEIGHTS3[i]) * colors[0][c] + s_BC7_WEIGHTS3[i] * colors[1][c] + 32) >> 6);
+                }
+                palette[i][3] = 255;
+            }
+            uint8_t candidateIndices[16];
+            std::memcpy(candidateIndices, indices, sizeof(candidateIndices));
+            const uint32_t candidateError = kernels.selectIndices(block, palette, 8, mask, candidateIndices);
+            if (candidateError < error) {
+                error = candidateError;
+                std::memcpy(quantized, candidate, sizeof(candidate));
+                std::memcpy(indices, candidateIndices, sizeof(candidateIndices));
+                pbit = p;
+            }
+        }
+        return error;
+    }
+
+    // Mode 1: two subsets of RGB split by one of 64 partitions
+    uint32_t EncodeBc7Mode1(const Texels& texels, const dw::encoder::Block& block, uint32_t partition, const dw::encoder::Kernels& kernels,
+                            uint8_t* out) {
+        float weights[8];
+        for (uint32_t i = 0; i < 8; ++i) {
+            weights[i] = s_BC7_WEIGHTS3[i] / 64.0f;
+        }
+        const uint32_t masks[2] = { ~s_BC7_PARTITIONS2[partition] & 0xFFFFu, s_BC7_PARTITIONS2[partition] };
+        uint8_t quantized[2][2][4];
+        uint32_t pbits[2] = {};
+        uint8_t indices[16] = {};
+        uint32_t error = 0;
+        for (uint32_t s = 0; s < 2; ++s) {
+            Ends ends;
+            FitLine(texels, masks[s], 3, true, ends);
+            uint32_t subsetError = TryBc7Mode1Subset(block, masks[s], ends, kernels, quantized[s], pbits[s], indices);
+            for (uint32_t i = 0; i < s_REFINEMENTS[dw::TextureEncoder::QUALITY_HIGH] && subsetError > 0; ++i) {
+                Ends refined;
+                std::memcpy(refined, ends, sizeof(Ends));
+                if (!RefineLine(texels, masks[s], 3, indices, weights, refined)) {
+                    break;
+                }
+                uint8_t candidate[2][4];
+                uint32_t pbit = 0;
+                uint8_t candidateIndices[16];
+                std::memcpy(candidateIndices, indices, sizeof(candidateIndices));
+                const uint32_t candidateError = TryBc7Mode1Subset(block, masks[s], refined, kernels, candidate, pbit, candidateIndices);
+                if (candidateError >= subsetError) {
+                    break;
+                }
+                subsetError = candidateError;
+                std::memcpy(ends, refined, sizeof(Ends));
+                std::memcpy(quantized[s], candidate, sizeof(candidate));
+                std::memcpy(indices, candidateIndices, sizeof(indices));
+                pbits[s] = pbit;
+            }
+            error += subsetError;
+        }
+
+        // The first texel of each subset stores its index without the highest bit, which has to be 0
+        const uint32_t anchors[2] = { 0, s_BC7_ANCHORS2[partition] };
+        for (uint32_t s = 0; s < 2; ++s) {
+            if (indices[anchors[s]] >= 4) {
+                std::swap_ranges(quantized[s][0], quantized[s][0] + 4, quantized[s][1]);
+                for (uint32_t t = 0; t < 16; ++t) {
+                    if (masks[s] & (1 << t)) {
+                        indices[t] = static_cast<uint8_t>(7 - indices[t]);
+                    }
+                }
+            }
+        }
+        BitWriter bits(out);
+        bits.Write(1 << 1, 2);
+        bits.Write(partition, 6);
+        for (uint32_t c = 0; c < 3; ++c) {
+            for (uint32_t s = 0; s < 2; ++s) {
+                bits.Write(quantized[s][0][c], 6);
+                bits.Write(quantized[s][1][c], 6);
+            }
+        }
+        bits.Write(pbits[0], 1);
+        bits.Write(pbits[1], 1);
+        for (uint32_t t = 0; t < 16; ++t) {
+            bits.Write(indices[t], t == anchors[0] || t == anchors[1] ? 2 : 3);
+        }
+        return error;
+    }
+
+    uint32_t EncodeBc7(const Texels& texels, dw::TextureEncoder::Quality quality, const dw::encoder::Kernels& kernels, uint8_t* out) {
+        const dw::encoder::Block block = MakeBlock(texels, 4);
+        float weights[16];
+        for (uint32_t i = 0; i < 16; ++i) {
+            weights[i] = s_BC7_WEIGHTS4[i] / 64.0f;
+        }
+        Ends ends;
+        FitLine(texels, 0xFFFF, 4, quality != dw::TextureEncoder::QUALITY_FAST, ends);
+        uint32_t error = EncodeRefined(texels, 0xFFFF, 4, s_REFINEMENTS[quality], weights, ends, out, 16,
+                                       [&](Ends& candidateEnds, uint8_t* candidate, uint8_t* indices) {
+            return TryBc7Mode6(block, -1, candidateEnds, kernels, candidate, indices);
+        });
+        if (quality == dw::TextureEncoder::QUALITY_FAST || error == 0) {
+            return error;
+        }
+
+        bool isOpaque = true;
+        for (uint32_t t = 0; t < 16; ++t) {
+            isOpaque = isOpaque && texels[t][3] == 255;
+        }
+        uint8_t candidate[16];
+        if (!isOpaque) {
+            const uint32_t mode5Error = EncodeBc7Mode5(texels, quality, kernels, candidate);
+            if (mode5Error < error) {
+                error = mode5Error;
+                std::memcpy(out, candidate, 16);
+            }
+        }
+        if (quality != dw::TextureEncoder::QUALITY_HIGH || error == 0) {
+            return error;
+        }
+
+        // The p-bits closest to each end aren't always the best pair
+        uint8_t indices[16];
+        for (int32_t pbits = 0; pbits < 4; ++pbits) {
+            Ends pairEnds;
+            std::memcpy(pairEnds, ends, sizeof(Ends));
+            const uint32_t pairError = TryBc7Mode6(block, pbits, pairEnds, kernels, candidate, indices);
+            if (pairError < error) {
+                error = pairError;
+                std::memcpy(out, candidate, 16);
+            }
+        }
+        if (!isOpaque || error == 0) {
+            return error;
+        }
+        // Partitions are ranked by how far their subsets are from lines, only the best few are encoded
+        float errors[64];
+        kernels.ratePartitions(block, s_BC7_PARTITIONS2, 64, errors);
+        std::pair<float, uint32_t> partitions[64];
+        for (uint32_t p = 0; p < 64; ++p) {
+            partitions[p] = std::make_pair(errors[p], p);
+        }
+        std::partial_sort(partitions, partitions + s_BC7_PARTITION_CANDIDATES, partitions + 64);
+        for (uint32_t i = 0; i < s_BC7_PARTITION_CANDIDATES; ++i) {
+            const uint32_t mode1Error = EncodeBc7Mode1(texels, block, partitions[i].second, kernels, candidate);
+            if (mode1Error < error) {
+                error = mode1Error;
+                std::memcpy(out, candidate, 16);
+            }
+        }
+        return error;
+    }
+
+    // Returns the summed squared error of the encoded channels
+    uint32_t EncodeBlock(const Texels& texels, dw::TextureFormat format, dw::TextureEncoder::Quality quality,
+                         const dw::encoder::Kernels& kernels, uint8_t* out) {
+        Texels channel;
+        switch (format) {
+            case dw::TEXTURE_FORMAT_BC1:
+            case dw::TEXTURE_FORMAT_BC1_SRGB:
+                return EncodeBc1(texels, quality, kernels, true, out);
+            case dw::TEXTURE_FORMAT_BC3:
+            case dw::TEXTURE_FORMAT_BC3_SRGB: {
+                ExtractChannel(texels, 3, channel);
+                const uint32_t error = EncodeBc4(channel, quality, kernels, out);
+                return error + EncodeBc1(texels, quality, kernels, false, out + 8);
+            }
+            case dw::TEXTURE_FORMAT_BC4:
+                return EncodeBc4(texels, quality, kernels, out);
+            case dw::TEXTURE_FORMAT_BC5: {
+                const uint32_t error = EncodeBc4(texels, quality, kernels, out);
+                ExtractChannel(texels, 1, channel);
+                return error + EncodeBc4(channel, quality, kernels, out + 8);
+            }
+            case dw::TEXTURE_FORMAT_BC7:
+            case dw::TEXTURE_FORMAT_BC7_SRGB:
+                return EncodeBc7(texels, quality, kernels, out);
+            default:
+                assert(false && "Unexpected encoded texture format");
+                return 0;
+        }
+    }
+
+    uint32_t GetEncodedChannels(dw::TextureFormat format) {
+        switch (format) {
+            case dw::TEXTURE_FORMAT_BC1: return 3;
+            case dw::TEXTURE_FORMAT_BC1_SRGB: return 3;
+            case dw::TEXTURE_FORMAT_BC4: return 1;
+            case dw::TEXTURE_FORMAT_BC5: return 2;
+            default: return 4;
+        }
+    }
+
+    // 2x2 box filter, odd sizes drop their last row or column
+    void Downsample(const uint8_t* in, uint32_t width, uint32_t height, std::vector<uint8_t>& out) {
+        const uint32_t outWidth = std::max(width / 2, 1u);
+        const uint32_t outHeight = std::max(height / 2, 1u);
+        out.resize(static_cast<size_t>(outWidth) * outHeight * 4);
+        for (uint32_t y = 0; y < outHeight; ++y) {
+            const uint8_t* rows[2] = { in + std::min(y * 2, height - 1) * static_cast<size_t>(width) * 4,
+                                       in + std::min(y * 2 + 1, height - 1) * static_cast<size_t>(width) * 4 };
+            for (uint32_t x = 0; x < outWidth; ++x) {
+                const size_t left = std::min(x * 2, width - 1) * 4, right = std::min(x * 2 + 1, width - 1) * 4;
+                for (uint32_t c = 0; c < 4; ++c) {
+                    const uint32_t sum = rows[0][left + c] + rows[0][right + c] + rows[1][left + c] + rows[1][right + c];
+                    out[(static_cast<size_t>(y) * outWidth + x) * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+                }
+            }
+        }
+    }}
+
+namespace dw {
+namespace encoder {
+
+uint32_t SelectIndicesScalar(const Block& block, const uint8_t (*palette)[4], uint32_t count, uint32_t mask, uint8_t* indices) {
+    uint32_t error = 0;
+    for (uint32_t t = 0; t < 16; ++t) {
+        if (!(mask & (1 << t))) {
+            continue;
+        }
+        int32_t closest = INT32_MAX;
+        for (uint32_t i = 0; i < count; ++i) {
+            const int32_t r = block.rg[t * 2 + 0] - palette[i][0];
+            const int32_t g = block.rg[t * 2 + 1] - palette[i][1];
+            const int32_t b = block.ba[t * 2 + 0] - palette[i][2];
+            const int32_t a = block.ba[t * 2 + 1] - palette[i][3];
+            const int32_t distance = r * r + g * g + b * b + a * a;
+            if (distance < closest) {
+                closest = distance;
+                indices[t] = static_cast<uint8_t>(i);
+            }
+        }
+        error += static_cast<uint32_t>(closest);
+    }
+    return error;
+}
+
+void GetMoments(const Block& block, float (*moments)[9], float* total) {
+    std::memset(total, 0, sizeof(float) * 9);
+    for (uint32_t t = 0; t < 16; ++t) {
+        const float r = block.rg[t * 2 + 0], g = block.rg[t * 2 + 1], b = block.ba[t * 2 + 0];
+        const float texel[9] = { r, g, b, r * r, r * g, r * b, g * g, g * b, b * b };
+        for (uint32_t i = 0; i < 9; ++i) {
+            moments[t][i] = texel[i];
+            total[i] += texel[i];
+        }
+    }
+}
+
+void RatePartitionsScalar(const Block& block, const uint16_t* partitions, uint32_t count, float* errors) {
+    float moments[16][9];
+    float total[9];
+    GetMoments(block, moments, total);
+    for (uint32_t p = 0; p < count; ++p) {
+        float second[9] = {};
+        float secondCount = 0.0f;
+        for (uint32_t t = 0; t < 16; ++t) {
+            if (partitions[p] & (1 << t)) {
+                for (uint32_t i = 0; i < 9; ++i) {
+                    second[i] += moments[t][i];
+                }
+                secondCount += 1.0f;
+            }
+        }
+        float first[9];
+        for (uint32_t i = 0; i < 9; ++i) {
+            first[i] = total[i] - second[i];
+        }
+        errors[p] = GetLineError(first, 16.0f - secondCount) + GetLineError(second, secondCount);
+    }
+}
+
+Kernels GetScalarKernels() {
+    Kernels kernels;
+    kernels.selectIndices = SelectIndicesScalar;
+    kernels.ratePartitions = RatePartitionsScalar;
+    return kernels;
+}
+
+#if defined(DW_SSE2_ENABLED)
+namespace {
+    // Each 32 bit lane holds a pair of channels of one texel, the multiply-add sums their squared differences
+    __m128i Distance(__m128i rg, __m128i ba, __m128i paletteRg, __m128i paletteBa) {
+        const __m128i differenceRg = _mm_sub_epi16(rg, paletteRg);
+        const __m128i differenceBa = _mm_sub_epi16(ba, paletteBa);
+        return _mm_add_epi32(_mm_madd_epi16(differenceRg, differenceRg), _mm_madd_epi16(differenceBa, differenceBa));
+    }
+
+    uint32_t SelectIndicesSse2(const Block& block, const uint8_t (*palette)[4], uint32_t count, uint32_t mask, uint8_t* indices) {
+        __m128i rg[4], ba[4], closest[4], picked[4];
+        for (uint32_t i = 0; i < 4; ++i) {
+            rg[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block.rg + i * 8));
+            ba[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block.ba + i * 8));
+            closest[i] = _mm_set1_epi32(INT32_MAX);
+            picked[i] = _mm_setzero_si128();
+        }
+        for (uint32_t p = 0; p < count; ++p) {
+            const __m128i paletteRg = _mm_set1_epi32(palette[p][0] | palette[p][1] << 16);
+            const __m128i paletteBa = _mm_set1_epi32(palette[p][2] | palette[p][3] << 16);
+            const __m128i index = _mm_set1_epi32(static_cast<int32_t>(p));
+            for (uint32_t i = 0; i < 4; ++i) {
+                const __m128i distance = Distance(rg[i], ba[i], paletteRg, paletteBa);
+                const __m128i isCloser = _mm_cmpgt_epi32(closest[i], distance);
+                closest[i] = _mm_or_si128(_mm_and_si128(isCloser, distance), _mm_andnot_si128(isCloser, closest[i]));
+                picked[i] = _mm_or_si128(_mm_and_si128(isCloser, index), _mm_andnot_si128(isCloser, picked[i]));
+            }
+        }
+
+        int32_t distances[16];
+        int32_t pickedIndices[16];
+        for (uint32_t i = 0; i < 4; ++i) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(distances + i * 4), closest[i]);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pickedIndices + i * 4), picked[i]);
+        }
+        uint32_t error = 0;
+        for (uint32_t t = 0; t < 16; ++t) {
+            if (mask & (1 << t)) {
+                indices[t] = static_cast<uint8_t>(pickedIndices[t]);
+                error += static_cast<uint32_t>(distances[t]);
+            }
+        }
+        return error;
+    }
+
+    __m128 Select(__m128 isTrue, __m128 ifTrue, __m128 ifFalse) {
+        return _mm_or_ps(_mm_and_ps(isTrue, ifTrue), _mm_andnot_ps(isTrue, ifFalse));
+    }
+
+    // The line error of RatePartitionsScalar for 4 subsets at once. Lanes whose power iteration stopped
+    // early compute the same axis again, which keeps them where the scalar loop left off
+    __m128 GetLineErrors(const __m128* sums, __m128 count) {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128* products = sums + 3;
+        const __m128 scale = _mm_div_ps(_mm_set1_ps(1.0f), count);
+        __m128 covariance[3][3];
+        covariance[0][0] = _mm_sub_ps(products[0], _mm_mul_ps(_mm_mul_ps(sums[0], sums[0]), scale));
+        covariance[0][1] = covariance[1][0] = _mm_sub_ps(products[1], _mm_mul_ps(_mm_mul_ps(sums[0], sums[1]), scale));
+        covariance[0][2] = covariance[2][0] = _mm_sub_ps(products[2], _mm_mul_ps(_mm_mul_ps(sums[0], sums[2]), scale));
+        covariance[1][1] = _mm_sub_ps(products[3], _mm_mul_ps(_mm_mul_ps(sums[1], sums[1]), scale));
+        covariance[1][2] = covariance[2][1] = _mm_sub_ps(products[4], _mm_mul_ps(_mm_mul_ps(sums[1], sums[2]), scale));
+        covariance[2][2] = _mm_sub_ps(products[5], _mm_mul_ps(_mm_mul_ps(sums[2], sums[2]), scale));
+
+        __m128 widest = covariance[0][0];
+        __m128 axis[3] = { covariance[0][0], covariance[0][1], covariance[0][2] };
+        __m128 trace = _mm_add_ps(zero, covariance[0][0]);
+        for (uint32_t c = 1; c < 3; ++c) {
+            const __m128 isWider = _mm_cmpgt_ps(covariance[c][c], widest);
+            widest = Select(isWider, covariance[c][c], widest);
+            for (uint32_t i = 0; i < 3; ++i) {
+                axis[i] = Select(isWider, covariance[c][i], axis[i]);
+            }
+            trace = _mm_add_ps(trace, covariance[c][c]);
+        }
+
+        const __m128 absolute = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+        for (uint32_t i = 0; i < s_POWER_ITERATIONS; ++i) {
+            __m128 next[3];
+            __m128 largest = zero;
+            for (uint32_t a = 0; a < 3; ++a) {
+                next[a] = zero;
+                for (uint32_t b = 0; b < 3; ++b) {
+                    next[a] = _mm_add_ps(next[a], _mm_mul_ps(covariance[a][b], axis[b]));
+                }
+                largest = _mm_max_ps(largest, _mm_and_ps(next[a], absolute));
+            }
+            const __m128 isPositive = _mm_cmpgt_ps(largest, zero);
+            for (uint32_t c = 0; c < 3; ++c) {
+                axis[c] = Select(isPositive, _mm_div_ps(next[c], largest), axis[c]);
+            }
+        }
+
+        __m128 along = zero;
+        __m128 lengthSquared = zero;
+        for (uint32_t a = 0; a < 3; ++a) {
+            for (uint32_t b = 0; b < 3; ++b) {
+                along = _mm_add_ps(along, _mm_mul_ps(_mm_mul_ps(axis[a], covariance[a][b]), axis[b]));
+            }
+            lengthSquared = _mm_add_ps(lengthSquared, _mm_mul_ps(axis[a], axis[a]));
+        }
+        __m128 error = Select(_mm_cmpgt_ps(lengthSquared, zero), _mm_sub_ps(trace, _mm_div_ps(along, lengthSquared)), trace);
+        error = Select(_mm_cmpgt_ps(error, zero), error, zero);
+        return Select(_mm_cmpeq_ps(count, zero), zero, error);
+    }
+
+    // 4 partitions at once, one per lane
+    void RatePartitionsSse2(const Block& block, const uint16_t* partitions, uint32_t count, float* errors) {
+        float moments[16][9];
+        float total[9];
+        GetMoments(block, moments, total);
+        uint32_t p = 0;
+        for (; p + 4 <= count; p += 4) {
+            const __m128i masks = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(partitions + p)), _mm_setzero_si128());
+            __m128 second[9];
+            for (uint32_t i = 0; i < 9; ++i) {
+                second[i] = _mm_setzero_ps();
+            }
+            __m128 secondCount = _mm_setzero_ps();
+            for (uint32_t t = 0; t < 16; ++t) {
+                const __m128i bit = _mm_set1_epi32(1 << t);
+                const __m128 isInSecond = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(masks, bit), bit));
+                for (uint32_t i = 0; i < 9; ++i) {
+                    second[i] = _mm_add_ps(second[i], _mm_and_ps(_mm_set1_ps(moments[t][i]), isInSecond));
+                }
+                secondCount = _mm_add_ps(secondCount, _mm_and_ps(_mm_set1_ps(1.0f), isInSecond));
+            }
+            __m128 first[9];
+            for (uint32_t i = 0; i < 9; ++i) {
+                first[i] = _mm_sub_ps(_mm_set1_ps(total[i]), second[i]);
+            }
+            const __m128 firstCount = _mm_sub_ps(_mm_set1_ps(16.0f), secondCount);
+            _mm_storeu_ps(errors + p, _mm_add_ps(GetLineErrors(first, firstCount), GetLineErrors(second, secondCount)));
+        }
+        RatePartitionsScalar(block, partitions + p, count - p, errors + p);
+    }
+}
+
+Kernels GetSse2Kernels() {
+    Kernels kernels;
+    kernels.selectIndices = SelectIndicesSse2;
+    kernels.ratePartitions = RatePartitionsSse2;
+    return kernels;
+}
+#endif
+
+} // namespace encoder
+
+TextureEncoder::TextureEncoder(Quality quality, uint32_t numThreads) : TextureEncoder(quality, numThreads, GetBestKernelSet()) {}
+
+TextureEncoder::TextureEncoder(Quality quality, uint32_t numThreads, KernelSet kernels)
+    : m_pool(std::make_unique<ThreadPool>(numThreads))
+    , m_quality(quality) {
+    m_kernelSet = std::min(kernels, GetBestKernelSet());
+}
+
+TextureEncoder::~TextureEncoder() = default;
+
+uint32_t TextureEncoder::GetNumThreads() const {
+    return m_pool->GetNumThreads();
+}
+
+bool TextureEncoder::IsFormatSupported(TextureFormat format) {
+    return IsTextureFormatCompressed(format);
+}
+
+bool TextureEncoder::Encode(const uint8_t* rgba, uint32_t width, uint32_t height, TextureFormat format, void* out, float* rmsError) const {
+    if (!IsFormatSupported(format)) {
+        LOGE("Texture format " + std::to_string(format) + " can't be encoded");
+        return false;
+    }
+    if (width == 0 || height == 0) {
+        LOGE("Can't encode an empty texture");
+        return false;
+    }
+    encoder::Kernels kernels = encoder::GetScalarKernels();
+#if defined(DW_SSE2_ENABLED)
+    if (m_kernelSet == KERNELS_SSE2) {
+        kernels = encoder::GetSse2Kernels();
+    }
+#endif
+#if defined(DW_AVX2_ENABLED)
+    if (m_kernelSet == KERNELS_AVX2) {
+        kernels = encoder::GetAvx2Kernels();
+    }
+#endif
+
+    const uint32_t blocksX = (width + 3) / 4;
+    const uint32_t blocksY = (height + 3) / 4;
+    const uint32_t blockSize = GetTextureFormatSize(format);
+    const uint32_t rowsPerJob = std::max(s_BLOCKS_PER_JOB / blocksX, 1u);
+    const uint32_t numJobs = (blocksY + rowsPerJob - 1) / rowsPerJob;
+    std::vector<uint64_t> errors(numJobs, 0);
+    uint8_t* blocks = static_cast<uint8_t*>(out);
+    m_pool->ParallelFor(numJobs, [&](uint32_t job) {
+        Texels texels;
+        uint64_t error = 0;
+        const uint32_t lastRow = std::min((job + 1) * rowsPerJob, blocksY);
+        for (uint32_t blockY = job * rowsPerJob; blockY < lastRow; ++blockY) {
+            for (uint32_t blockX = 0; blockX < blocksX; ++blockX) {
+                LoadTexels(rgba, width, height, blockX, blockY, texels);
+                error += EncodeBlock(texels, format, m_quality, kernels, blocks + (static_cast<size_t>(blockY) * blocksX + blockX) * blockSize);
+            }
+        }
+        errors[job] = error;
+    });
+
+    if (rmsError) {
+        uint64_t error = 0;
+        for (uint64_t jobError : errors) {
+            error += jobError;
+        }
+        const double samples = static_cast<double>(blocksX) * blocksY * 16 * GetEncodedChannels(format);
+        *rmsError = static_cast<float>(std::sqrt(error / samples));
+    }
+    return true;
+}
+
+bool TextureEncoder::EncodeTexture(const uint8_t* rgba, const TextureDescription& description, std::vector<uint8_t>& blocks,
+                                   std::vector<void*>& data) const {
+    if (!IsFormatSupported(description.format)) {
+        LOGE("Texture format " + std::to_string(description.format) + " can't be encoded");
+        return false;
+    }
+    if (description.mipLevels == 0 || description.mipLevels > GetMipLevelCount(description.width, description.height)) {
+        LOGE("Can't encode " + std::to_string(description.mipLevels) + " levels of a " + std::to_string(description.width)
+             + "x" + std::to_string(description.height) + " texture");
+        return false;
+    }
+
+    std::vector<size_t> offsets;
+    size_t size = 0;
+    for (uint32_t layer = 0; layer < description.layers; ++layer) {
+        for (uint32_t level = 0; level < description.mipLevels; ++level) {
+            offsets.push_back(size);
+            size += description.GetLevelSize(level);
+        }
+    }
+    blocks.resize(size);
+
+    std::vector<uint8_t> texels;
+    std::vector<uint8_t> downsampled;
+    const size_t layerSize = static_cast<size_t>(description.width) * description.height * 4;
+    for (uint32_t layer = 0; layer < description.layers; ++layer) {
+        const uint8_t* level = rgba + layer * layerSize;
+        for (uint32_t i = 0; i < description.mipLevels; ++i) {
+            if (i > 0) {
+                Downsample(level, GetMipLevelSize(description.width, i - 1), GetMipLevelSize(description.height, i - 1), downsampled);
+                std::swap(texels, downsampled);
+                level = texels.data();
+            }
+            const size_t offset = offsets[layer * description.mipLevels + i];
+            if (!Encode(level, GetMipLevelSize(description.width, i), GetMipLevelSize(description.height, i), description.format,
+                        blocks.data() + offset)) {
+                return false;
+            }
+        }
+    }
+
+    data.clear();
+    for (size_t offset : offsets) {
+        data.push_back(blocks.data() + offset);
+    }
+    return true;
+}
+
+} // namespace dw
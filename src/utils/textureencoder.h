@@ -0,0 +1,69 @@
+#pragma once
+
+#include "irenderer.h"
+#include "cpufeatures.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace dw {
+
+class ThreadPool;
+
+// Compresses RGBA8 texels to BC1, BC3, BC4, BC5 and BC7 at runtime, for textures that can't be compressed
+// ahead of time such as baked atlases and procedural content. Blocks are encoded in parallel on a pool of
+// worker threads, picking indices with SSE2 or AVX2 kernels chosen at construction from what the CPU
+// supports. The quality tier trades speed for error:
+//   QUALITY_FAST fits the endpoints to the bounding box of the block.
+//   QUALITY_NORMAL fits them along the principal axis and refines them once by least squares, and BC7 also
+//   tries separate alpha for blocks that aren't opaque.
+//   QUALITY_HIGH refines twice, tries the alternative BC1 and BC4 modes and every BC7 p-bit pair, and BC7
+//   also tries two subsets in the most promising partitions for opaque blocks.
+// The blocks go straight to the texture upload path:
+//   TextureEncoder encoder;
+//   std::vector<uint8_t> blocks;
+//   std::vector<void*> data;
+//   encoder.EncodeTexture(texels, description, blocks, data);
+//   engine.CreateTexture(object, description, data);
+// SRGB formats are encoded like the others, the texels are compared as they're stored.
+class TextureEncoder {
+public:
+    enum Quality {
+        QUALITY_FAST,
+        QUALITY_NORMAL,
+        QUALITY_HIGH
+    };
+
+    /* Uses numThreads threads, one per hardware thread if 0, and the widest kernels the build and the CPU support */
+    explicit TextureEncoder(Quality quality = QUALITY_NORMAL, uint32_t numThreads = 0);
+    /* Forces a kernel set, falling back to narrower ones that are available */
+    TextureEncoder(Quality quality, uint32_t numThreads, KernelSet kernels);
+    ~TextureEncoder();
+
+    TextureEncoder(const TextureEncoder& encoder) = delete;
+    TextureEncoder& operator= (const TextureEncoder& encoder) = delete;
+
+    /* BC1, BC3, BC4, BC5, BC7 and their SRGB variants */
+    static bool IsFormatSupported(TextureFormat format);
+
+    /* Encodes width x height tightly packed RGBA8 texels to format, writing TextureDescription::GetLevelSize
+       bytes to out. BC4 keeps red, BC5 red and green, BC1 turns texels with alpha below 128 transparent.
+       rmsError receives the root mean square difference per encoded channel, over whole blocks */
+    bool Encode(const uint8_t* rgba, uint32_t width, uint32_t height, TextureFormat format, void* out, float* rmsError = nullptr) const;
+    /* Encodes every level of every layer of description, rgba holding the RGBA8 texels of the first level of
+       each layer one after the other. The finer levels are box filtered down from it. blocks receives the
+       encoded levels and data the pointers into it that RenderEngine::CreateTexture takes */
+    bool EncodeTexture(const uint8_t* rgba, const TextureDescription& description, std::vector<uint8_t>& blocks,
+                       std::vector<void*>& data) const;
+
+    Quality GetQuality() const { return m_quality; }
+    KernelSet GetKernelSet() const { return m_kernelSet; }
+    uint32_t GetNumThreads() const;
+
+private:
+    std::unique_ptr<ThreadPool> m_pool;
+    Quality m_quality = QUALITY_NORMAL;
+    KernelSet m_kernelSet = KERNELS_SCALAR;
+};
+
+} // namespace dw
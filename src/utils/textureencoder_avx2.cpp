@@ -0,0 +1,157 @@
+// Built with AVX2 code generation, nothing in here may run before TextureEncoder checked the CPU
+#include "textureencoder_kernels.h"
+
+#include <climits>
+#include <immintrin.h>
+
+namespace dw {
+namespace encoder {
+
+namespace {
+    // Each 32 bit lane holds a pair of channels of one texel, the multiply-add sums their squared differences
+    __m256i Distance(__m256i rg, __m256i ba, __m256i paletteRg, __m256i paletteBa) {
+        const __m256i differenceRg = _mm256_sub_epi16(rg, paletteRg);
+        const __m256i differenceBa = _mm256_sub_epi16(ba, paletteBa);
+        return _mm256_add_epi32(_mm256_madd_epi16(differenceRg, differenceRg), _mm256_madd_epi16(differenceBa, differenceBa));
+    }
+
+    // Texels 0 to 7 in the low half, 8 to 15 in the high one
+    uint32_t SelectIndicesAvx2(const Block& block, const uint8_t (*palette)[4], uint32_t count, uint32_t mask, uint8_t* indices) {
+        const __m256i rgLow = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block.rg));
+        const __m256i rgHigh = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block.rg + 16));
+        const __m256i baLow = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block.ba));
+        const __m256i baHigh = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block.ba + 16));
+        __m256i closestLow = _mm256_set1_epi32(INT32_MAX);
+        __m256i closestHigh = closestLow;
+        __m256i pickedLow = _mm256_setzero_si256();
+        __m256i pickedHigh = pickedLow;
+        for (uint32_t p = 0; p < count; ++p) {
+            const __m256i paletteRg = _mm256_set1_epi32(palette[p][0] | palette[p][1] << 16);
+            const __m256i paletteBa = _mm256_set1_epi32(palette[p][2] | palette[p][3] << 16);
+            const __m256i index = _mm256_set1_epi32(static_cast<int32_t>(p));
+
+            const __m256i distanceLow = Distance(rgLow, baLow, paletteRg, paletteBa);
+            const __m256i distanceHigh = Distance(rgHigh, baHigh, paletteRg, paletteBa);
+            pickedLow = _mm256_blendv_epi8(pickedLow, index, _mm256_cmpgt_epi32(closestLow, distanceLow));
+            pickedHigh = _mm256_blendv_epi8(pickedHigh, index, _mm256_cmpgt_epi32(closestHigh, distanceHigh));
+            closestLow = _mm256_min_epi32(closestLow, distanceLow);
+            closestHigh = _mm256_min_epi32(closestHigh, distanceHigh);
+        }
+
+        int32_t distances[16];
+        int32_t pickedIndices[16];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(distances), closestLow);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(distances + 8), closestHigh);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(pickedIndices), pickedLow);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(pickedIndices + 8), pickedHigh);
+        uint32_t error = 0;
+        for (uint32_t t = 0; t < 16; ++t) {
+            if (mask & (1 << t)) {
+                indices[t] = static_cast<uint8_t>(pickedIndices[t]);
+                error += static_cast<uint32_t>(distances[t]);
+            }
+        }
+        return error;
+    }
+
+    __m256 Select(__m256 isTrue, __m256 ifTrue, __m256 ifFalse) {
+        return _mm256_blendv_ps(ifFalse, ifTrue, isTrue);
+    }
+
+    // The line error of RatePartitionsScalar for 8 subsets at once. Lanes whose power iteration stopped
+    // early compute the same axis again, which keeps them where the scalar loop left off
+    __m256 GetLineErrors(const __m256* sums, __m256 count) {
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256* products = sums + 3;
+        const __m256 scale = _mm256_div_ps(_mm256_set1_ps(1.0f), count);
+        __m256 covariance[3][3];
+        covariance[0][0] = _mm256_sub_ps(products[0], _mm256_mul_ps(_mm256_mul_ps(sums[0], sums[0]), scale));
+        covariance[0][1] = covariance[1][0] = _mm256_sub_ps(products[1], _mm256_mul_ps(_mm256_mul_ps(sums[0], sums[1]), scale));
+        covariance[0][2] = covariance[2][0] = _mm256_sub_ps(products[2], _mm256_mul_ps(_mm256_mul_ps(sums[0], sums[2]), scale));
+        covariance[1][1] = _mm256_sub_ps(products[3], _mm256_mul_ps(_mm256_mul_ps(sums[1], sums[1]), scale));
+        covariance[1][2] = covariance[2][1] = _mm256_sub_ps(products[4], _mm256_mul_ps(_mm256_mul_ps(sums[1], sums[2]), scale));
+        covariance[2][2] = _mm256_sub_ps(products[5], _mm256_mul_ps(_mm256_mul_ps(sums[2], sums[2]), scale));
+
+        __m256 widest = covariance[0][0];
+        __m256 axis[3] = { covariance[0][0], covariance[0][1], covariance[0][2] };
+        __m256 trace = _mm256_add_ps(zero, covariance[0][0]);
+        for (uint32_t c = 1; c < 3; ++c) {
+            const __m256 isWider = _mm256_cmp_ps(covariance[c][c], widest, _CMP_GT_OQ);
+            widest = Select(isWider, covariance[c][c], widest);
+            for (uint32_t i = 0; i < 3; ++i) {
+                axis[i] = Select(isWider, covariance[c][i], axis[i]);
+            }
+            trace = _mm256_add_ps(trace, covariance[c][c]);
+        }
+
+        const __m256 absolute = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+        for (uint32_t i = 0; i < s_POWER_ITERATIONS; ++i) {
+            __m256 next[3];
+            __m256 largest = zero;
+            for (uint32_t a = 0; a < 3; ++a) {
+                next[a] = zero;
+                for (uint32_t b = 0; b < 3; ++b) {
+                    next[a] = _mm256_add_ps(next[a], _mm256_mul_ps(covariance[a][b], axis[b]));
+                }
+                largest = _mm256_max_ps(largest, _mm256_and_ps(next[a], absolute));
+            }
+            const __m256 isPositive = _mm256_cmp_ps(largest, zero, _CMP_GT_OQ);
+            for (uint32_t c = 0; c < 3; ++c) {
+                axis[c] = Select(isPositive, _mm256_div_ps(next[c], largest), axis[c]);
+            }
+        }
+
+        __m256 along = zero;
+        __m256 lengthSquared = zero;
+        for (uint32_t a = 0; a < 3; ++a) {
+            for (uint32_t b = 0; b < 3; ++b) {
+                along = _mm256_add_ps(along, _mm256_mul_ps(_mm256_mul_ps(axis[a], covariance[a][b]), axis[b]));
+            }
+            lengthSquared = _mm256_add_ps(lengthSquared, _mm256_mul_ps(axis[a], axis[a]));
+        }
+        __m256 error = Select(_mm256_cmp_ps(lengthSquared, zero, _CMP_GT_OQ), _mm256_sub_ps(trace, _mm256_div_ps(along, lengthSquared)), trace);
+        error = Select(_mm256_cmp_ps(error, zero, _CMP_GT_OQ), error, zero);
+        return Select(_mm256_cmp_ps(count, zero, _CMP_EQ_OQ), zero, error);
+    }
+
+    // 8 partitions at once, one per lane
+    void RatePartitionsAvx2(const Block& block, const uint16_t* partitions, uint32_t count, float* errors) {
+        float moments[16][9];
+        float total[9];
+        GetMoments(block, moments, total);
+        uint32_t p = 0;
+        for (; p + 8 <= count; p += 8) {
+            const __m256i masks = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(partitions + p)));
+            __m256 second[9];
+            for (uint32_t i = 0; i < 9; ++i) {
+                second[i] = _mm256_setzero_ps();
+            }
+            __m256 secondCount = _mm256_setzero_ps();
+            for (uint32_t t = 0; t < 16; ++t) {
+                const __m256i bit = _mm256_set1_epi32(1 << t);
+                const __m256 isInSecond = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(masks, bit), bit));
+                for (uint32_t i = 0; i < 9; ++i) {
+                    second[i] = _mm256_add_ps(second[i], _mm256_and_ps(_mm256_set1_ps(moments[t][i]), isInSecond));
+                }
+                secondCount = _mm256_add_ps(secondCount, _mm256_and_ps(_mm256_set1_ps(1.0f), isInSecond));
+            }
+            __m256 first[9];
+            for (uint32_t i = 0; i < 9; ++i) {
+                first[i] = _mm256_sub_ps(_mm256_set1_ps(total[i]), second[i]);
+            }
+            const __m256 firstCount = _mm256_sub_ps(_mm256_set1_ps(16.0f), secondCount);
+            _mm256_storeu_ps(errors + p, _mm256_add_ps(GetLineErrors(first, firstCount), GetLineErrors(second, secondCount)));
+        }
+        RatePartitionsScalar(block, partitions + p, count - p, errors + p);
+    }
+}
+
+Kernels GetAvx2Kernels() {
+    Kernels kernels;
+    kernels.selectIndices = SelectIndicesAvx2;
+    kernels.ratePartitions = RatePartitionsAvx2;
+    return kernels;
+}
+
+} // namespace encoder
+} // namespace dw
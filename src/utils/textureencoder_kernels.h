@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include "cpufeatures.h"
+
+// Inner loops of the TextureEncoder, one table per instruction set. Endpoints are fitted by the same scalar
+// code for every set, the kernels pick indices in exact integer math and rate partitions with the same float
+// operations in the same order, so every set encodes a texture to the same bytes.
+namespace dw {
+namespace encoder {
+
+// The 16 texels of a 4x4 block, row by row. Pairs of channels are interleaved so one multiply-add of the
+// differences sums the squares of both, channels a format doesn't encode are 0.
+struct Block {
+    int16_t rg[32]; // r0 g0 r1 g1 ...
+    int16_t ba[32];
+};
+
+const uint32_t s_POWER_ITERATIONS = 8; // Of every principal axis search
+
+struct Kernels {
+    /* Writes the index of the closest of count palette colors, at most 16, for every texel set in mask to
+       indices, ties going to the lower index. Returns the summed squared distance of those texels */
+    uint32_t (*selectIndices)(const Block& block, const uint8_t (*palette)[4], uint32_t count, uint32_t mask, uint8_t* indices);
+    /* Rates count two subset partitions of the RGB of the block, each given as the mask of the texels in its
+       second subset. errors receives the summed squared distance of the texels from the principal axis of
+       their subset, the float math is done in the same order in every set */
+    void (*ratePartitions)(const Block& block, const uint16_t* partitions, uint32_t count, float* errors);
+};
+
+// Sums of r, g, b, rr, rg, rb, gg, gb and bb per texel and over the block, which the partition subsets add up.
+// They're integers small enough for floats to hold exactly
+void GetMoments(const Block& block, float (*moments)[9], float* total);
+
+// The scalar kernels also finish the tails of the wider sets
+uint32_t SelectIndicesScalar(const Block& block, const uint8_t (*palette)[4], uint32_t count, uint32_t mask, uint8_t* indices);
+void RatePartitionsScalar(const Block& block, const uint16_t* partitions, uint32_t count, float* errors);
+
+Kernels GetScalarKernels();
+#if defined(DW_SSE2_ENABLED)
+Kernels GetSse2Kernels();
+#endif
+#if defined(DW_AVX2_ENABLED)
+Kernels GetAvx2Kernels();
+#endif
+
+} // namespace encoder
+} // namespace dw
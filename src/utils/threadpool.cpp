@@ -0,0 +1,100 @@
+#include "threadpool.h"
+
+#include <algorithm>
+
+namespace dw {
+
+ThreadPool::ThreadPool(uint32_t numThreads) {
+    if (numThreads == 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    m_workers.reserve(numThreads - 1);
+    for (uint32_t i = 1; i < numThreads; ++i) {
+        m_workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isShuttingDown = true;
+    }
+    m_wakeCondition.notify_all();
+
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& job) {
+    if (count == 0) {
+        return;
+    }
+
+    // Not worth waking anyone up
+    if (m_workers.empty() || count == 1) {
+        for (uint32_t i = 0; i < count; ++i) {
+            job(i);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> dispatchLock(m_dispatchMutex);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = &job;
+        m_jobCount = count;
+        m_nextJob = 0;
+        m_finishedJobs = 0;
+        ++m_generation;
+    }
+    m_wakeCondition.notify_all();
+
+    runJobs(&job, count);
+
+    // Workers that picked up this generation must have left runJobs before the job goes out of scope
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_doneCondition.wait(lock, [this, count] { return m_finishedJobs == count && m_activeWorkers == 0; });
+    m_job = nullptr;
+    m_jobCount = 0;
+}
+
+void ThreadPool::workerLoop() {
+    uint64_t seenGeneration = 0;
+    while (true) {
+        const std::function<void(uint32_t)>* job;
+        uint32_t count;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeCondition.wait(lock, [this, seenGeneration] { return m_isShuttingDown || m_generation != seenGeneration; });
+            if (m_isShuttingDown) {
+                return;
+            }
+            seenGeneration = m_generation;
+            job = m_job;
+            count = m_jobCount;
+            ++m_activeWorkers;
+        }
+
+        if (job) {
+            runJobs(job, count);
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        --m_activeWorkers;
+        m_doneCondition.notify_one();
+    }
+}
+
+void ThreadPool::runJobs(const std::function<void(uint32_t)>* job, uint32_t count) {
+    for (uint32_t index = m_nextJob++; index < count; index = m_nextJob++) {
+        (*job)(index);
+        if (++m_finishedJobs == count) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_doneCondition.notify_one();
+        }
+    }
+}
+
+} // namespace dw
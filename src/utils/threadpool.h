@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dw {
+
+// Fixed size pool of worker threads used by the CPU backends to split work into independent jobs.
+// The calling thread participates in the work, so a pool created with N threads spawns N - 1 workers.
+class ThreadPool {
+public:
+    /* Creates a pool with numThreads threads, or one per hardware thread if numThreads is 0 */
+    explicit ThreadPool(uint32_t numThreads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool& pool) = delete;
+    ThreadPool& operator= (const ThreadPool& pool) = delete;
+
+    /* Runs job(index) for every index in [0, count) and blocks until all of them have finished */
+    void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& job);
+
+    uint32_t GetNumThreads() const { return static_cast<uint32_t>(m_workers.size()) + 1; }
+
+private:
+    void workerLoop();
+    void runJobs(const std::function<void(uint32_t)>* job, uint32_t count);
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::mutex m_dispatchMutex;
+    std::condition_variable m_wakeCondition;
+    std::condition_variable m_doneCondition;
+
+    const std::function<void(uint32_t)>* m_job = nullptr;
+    uint32_t m_jobCount = 0;
+    uint32_t m_activeWorkers = 0;
+    std::atomic<uint32_t> m_nextJob{ 0 };
+    std::atomic<uint32_t> m_finishedJobs{ 0 };
+    uint64_t m_generation = 0;
+    bool m_isShuttingDown = false;
+};
+
+} // namespace dw
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cmath>
+
+// Minimal vector math for the CPU backends. Matrices are column major to match the std140
+// layout the shaders (and glm) use for constant buffers.
+namespace dw {
+
+struct Vec3 {
+    float x, y, z;
+
+    Vec3 operator+(const Vec3& rhs) const { return { x + rhs.x, y + rhs.y, z + rhs.z }; }
+    Vec3 operator-(const Vec3& rhs) const { return { x - rhs.x, y - rhs.y, z - rhs.z }; }
+    Vec3 operator*(float s) const { return { x * s, y * s, z * s }; }
+    float& operator[](int i) { return (&x)[i]; }
+    float operator[](int i) const { return (&x)[i]; }
+};
+
+struct Vec4 {
+    float x, y, z, w;
+
+    Vec4 operator+(const Vec4& rhs) const { return { x + rhs.x, y + rhs.y, z + rhs.z, w + rhs.w }; }
+    Vec4 operator-(const Vec4& rhs) const { return { x - rhs.x, y - rhs.y, z - rhs.z, w - rhs.w }; }
+    Vec4 operator*(float s) const { return { x * s, y * s, z * s, w * s }; }
+    Vec3 xyz() const { return { x, y, z }; }
+};
+
+struct Mat4 {
+    float m[16]; // m[column * 4 + row]
+
+    static Mat4 Identity() {
+        return {{ 1.0f, 0.0f, 0.0f, 0.0f,
+                  0.0f, 1.0f, 0.0f, 0.0f,
+                  0.0f, 0.0f, 1.0f, 0.0f,
+                  0.0f, 0.0f, 0.0f, 1.0f }};
+    }
+
+    Mat4 operator*(const Mat4& rhs) const {
+        Mat4 result;
+        for (int column = 0; column < 4; ++column) {
+            for (int row = 0; row < 4; ++row) {
+                result.m[column * 4 + row] = m[0 * 4 + row] * rhs.m[column * 4 + 0] +
+                                             m[1 * 4 + row] * rhs.m[column * 4 + 1] +
+                                             m[2 * 4 + row] * rhs.m[column * 4 + 2] +
+                                             m[3 * 4 + row] * rhs.m[column * 4 + 3];
+            }
+        }
+        return result;
+    }
+
+    Vec4 operator*(const Vec4& v) const {
+        return { m[0] * v.x + m[4] * v.y + m[8]  * v.z + m[12] * v.w,
+                 m[1] * v.x + m[5] * v.y + m[9]  * v.z + m[13] * v.w,
+                 m[2] * v.x + m[6] * v.y + m[10] * v.z + m[14] * v.w,
+                 m[3] * v.x + m[7] * v.y + m[11] * v.z + m[15] * v.w };
+    }
+};
+
+inline float Dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline Vec3 Cross(const Vec3& a, const Vec3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+inline Vec3 Normalize(const Vec3& v) { return v * (1.0f / std::sqrt(Dot(v, v))); }
+inline Vec3 Min(const Vec3& a, const Vec3& b) { return { std::fmin(a.x, b.x), std::fmin(a.y, b.y), std::fmin(a.z, b.z) }; }
+inline Vec3 Max(const Vec3& a, const Vec3& b) { return { std::fmax(a.x, b.x), std::fmax(a.y, b.y), std::fmax(a.z, b.z) }; }
+
+// General 4x4 inverse (cofactor expansion), returns identity for singular matrices
+inline Mat4 Inverse(const Mat4& mat) {
+    const float* a = mat.m;
+    Mat4 inv;
+    float* o = inv.m;
+    o[0]  =  a[5] * a[10] * a[15] - a[5] * a[11] * a[14] - a[9] * a[6] * a[15] + a[9] * a[7] * a[14] + a[13] * a[6] * a[11] - a[13] * a[7] * a[10];
+    o[4]  = -a[4] * a[10] * a[15] + a[4] * a[11] * a[14] + a[8] * a[6] * a[15] - a[8] * a[7] * a[14] - a[12] * a[6] * a[11] + a[12] * a[7] * a[10];
+    o[8]  =  a[4] * a[9]  * a[15] - a[4] * a[11] * a[13] - a[8] * a[5] * a[15] + a[8] * a[7] * a[13] + a[12] * a[5] * a[11] - a[12] * a[7] * a[9];
+    o[12] = -a[4] * a[9]  * a[14] + a[4] * a[10] * a[13] + a[8] * a[5] * a[14] - a[8] * a[6] * a[13] - a[12] * a[5] * a[10] + a[12] * a[6] * a[9];
+    o[1]  = -a[1] * a[10] * a[15] + a[1] * a[11] * a[14] + a[9] * a[2] * a[15] - a[9] * a[3] * a[14] - a[13] * a[2] * a[11] + a[13] * a[3] * a[10];
+    o[5]  =  a[0] * a[10] * a[15] - a[0] * a[11] * a[14] - a[8] * a[2] * a[15] + a[8] * a[3] * a[14] + a[12] * a[2] * a[11] - a[12] * a[3] * a[10];
+    o[9]  = -a[0] * a[9]  * a[15] + a[0] * a[11] * a[13] + a[8] * a[1] * a[15] - a[8] * a[3] * a[13] - a[12] * a[1] * a[11] + a[12] * a[3] * a[9];
+    o[13] =  a[0] * a[9]  * a[14] - a[0] * a[10] * a[13] - a[8] * a[1] * a[14] + a[8] * a[2] * a[13] + a[12] * a[1] * a[10] - a[12] * a[2] * a[9];
+    o[2]  =  a[1] * a[6]  * a[15] - a[1] * a[7]  * a[14] - a[5] * a[2] * a[15] + a[5] * a[3] * a[14] + a[13] * a[2] * a[7]  - a[13] * a[3] * a[6];
+    o[6]  = -a[0] * a[6]  * a[15] + a[0] * a[7]  * a[14] + a[4] * a[2] * a[15] - a[4] * a[3] * a[14] - a[12] * a[2] * a[7]  + a[12] * a[3] * a[6];
+    o[10] =  a[0] * a[5]  * a[15] - a[0] * a[7]  * a[13] - a[4] * a[1] * a[15] + a[4] * a[3] * a[13] + a[12] * a[1] * a[7]  - a[12] * a[3] * a[5];
+    o[14] = -a[0] * a[5]  * a[14] + a[0] * a[6]  * a[13] + a[4] * a[1] * a[14] - a[4] * a[2] * a[13] - a[12] * a[1] * a[6]  + a[12] * a[2] * a[5];
+    o[3]  = -a[1] * a[6]  * a[11] + a[1] * a[7]  * a[10] + a[5] * a[2] * a[11] - a[5] * a[3] * a[10] - a[9]  * a[2] * a[7]  + a[9]  * a[3] * a[6];
+    o[7]  =  a[0] * a[6]  * a[11] - a[0] * a[7]  * a[10] - a[4] * a[2] * a[11] + a[4] * a[3] * a[10] + a[8]  * a[2] * a[7]  - a[8]  * a[3] * a[6];
+    o[11] = -a[0] * a[5]  * a[11] + a[0] * a[7]  * a[9]  + a[4] * a[1] * a[11] - a[4] * a[3] * a[9]  - a[8]  * a[1] * a[7]  + a[8]  * a[3] * a[5];
+    o[15] =  a[0] * a[5]  * a[10] - a[0] * a[6]  * a[9]  - a[4] * a[1] * a[10] + a[4] * a[2] * a[9]  + a[8]  * a[1] * a[6]  - a[8]  * a[2] * a[5];
+
+    const float determinant = a[0] * o[0] + a[1] * o[4] + a[2] * o[8] + a[3] * o[12];
+    if (determinant == 0.0f) {
+        return Mat4::Identity();
+    }
+
+    const float invDeterminant = 1.0f / determinant;
+    for (float& value : inv.m) {
+        value *= invDeterminant;
+    }
+    return inv;
+}
+
+} // namespace dw
@@ -0,0 +1,160 @@
+#include "vertexformat.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    template <typename T>
+    T Read(const uint8_t* data, uint32_t index) {
+        T value;
+        std::memcpy(&value, data + index * sizeof(T), sizeof(T));
+        return value;
+    }
+
+    // Sign extends the bits [shift, shift + bits) of a packed word
+    int32_t ExtractSigned(uint32_t packed, uint32_t shift, uint32_t bits) {
+        return static_cast<int32_t>(packed << (32 - shift - bits)) >> (32 - bits);
+    }
+
+    // Like GL 4.2 and Vulkan the most negative value maps to -1 as well, so 0 stays exact
+    float Snorm(int32_t value, float maxValue) {
+        return std::max(static_cast<float>(value) / maxValue, -1.0f);
+    }
+}
+
+namespace dw {
+
+float HalfToFloat(uint16_t half) {
+    const uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+    const uint32_t exponent = (half >> 10) & 0x1f;
+    uint32_t mantissa = half & 0x3ff;
+
+    uint32_t bits;
+    if (exponent == 0x1f) {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    } else if (exponent != 0) {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    } else if (mantissa == 0) {
+        bits = sign;
+    } else {
+        // Denormal half, normalize the mantissa for the wider float exponent
+        uint32_t shift = 0;
+        while (!(mantissa & 0x400)) {
+            mantissa <<= 1;
+            ++shift;
+        }
+        bits = sign | ((127 - 15 + 1 - shift) << 23) | ((mantissa & 0x3ff) << 13);
+    }
+
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+uint16_t FloatToHalf(float value) {
+    const uint32_t s_F32_INFINITY = 255u << 23;
+    const uint32_t s_F16_OVERFLOW = (127u + 16u) << 23;  // Smallest float that rounds to half infinity
+    const uint32_t s_F16_MIN_NORMAL = 113u << 23;        // 2^-14
+    const uint32_t s_DENORMAL_MAGIC = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+
+    uint32_t half;
+    if (bits >= s_F16_OVERFLOW) {
+        half = bits > s_F32_INFINITY ? 0x7e00 : 0x7c00;
+    } else if (bits < s_F16_MIN_NORMAL) {
+        // Adding the magic number lets the FPU do the denormal shift with round to nearest even
+        float magic;
+        std::memcpy(&magic, &s_DENORMAL_MAGIC, sizeof(magic));
+        float shifted;
+        std::memcpy(&shifted, &bits, sizeof(shifted));
+        shifted += magic;
+        std::memcpy(&half, &shifted, sizeof(half));
+        half -= s_DENORMAL_MAGIC;
+    } else {
+        const uint32_t mantissaOdd = (bits >> 13) & 1;
+        bits += ((15u - 127u) << 23) + 0xfff;
+        bits += mantissaOdd;
+        half = bits >> 13;
+    }
+    return static_cast<uint16_t>(half | (sign >> 16));
+}
+
+void DecodeVertexAttribute(VertexFormat format, const uint8_t* data, float out[4]) {
+    out[0] = 0.0f;
+    out[1] = 0.0f;
+    out[2] = 0.0f;
+    out[3] = 1.0f;
+    switch (format) {
+        case VERTEX_FORMAT_FLOAT2:
+        case VERTEX_FORMAT_FLOAT3:
+        case VERTEX_FORMAT_FLOAT4:
+            std::memcpy(out, data, GetVertexFormatSize(format));
+            break;
+        case VERTEX_FORMAT_HALF2:
+        case VERTEX_FORMAT_HALF4:
+            for (uint32_t i = 0; i < GetVertexFormatSize(format) / 2; ++i) {
+                out[i] = HalfToFloat(Read<uint16_t>(data, i));
+            }
+            break;
+        case VERTEX_FORMAT_UNORM8X4:
+            for (uint32_t i = 0; i < 4; ++i) {
+                out[i] = data[i] / 255.0f;
+            }
+            break;
+        case VERTEX_FORMAT_SNORM8X4:
+            for (uint32_t i = 0; i < 4; ++i) {
+                out[i] = Snorm(Read<int8_t>(data, i), 127.0f);
+            }
+            break;
+        case VERTEX_FORMAT_UNORM16X2:
+        case VERTEX_FORMAT_UNORM16X4:
+            for (uint32_t i = 0; i < GetVertexFormatSize(format) / 2; ++i) {
+                out[i] = Read<uint16_t>(data, i) / 65535.0f;
+            }
+            break;
+        case VERTEX_FORMAT_SNORM16X2:
+        case VERTEX_FORMAT_SNORM16X4:
+            for (uint32_t i = 0; i < GetVertexFormatSize(format) / 2; ++i) {
+                out[i] = Snorm(Read<int16_t>(data, i), 32767.0f);
+            }
+            break;
+        case VERTEX_FORMAT_UNORM10_10_10_2: {
+            const uint32_t packed = Read<uint32_t>(data, 0);
+            out[0] = (packed & 0x3ff) / 1023.0f;
+            out[1] = ((packed >> 10) & 0x3ff) / 1023.0f;
+            out[2] = ((packed >> 20) & 0x3ff) / 1023.0f;
+            out[3] = (packed >> 30) / 3.0f;
+            break;
+        }
+        case VERTEX_FORMAT_SNORM10_10_10_2: {
+            const uint32_t packed = Read<uint32_t>(data, 0);
+            out[0] = Snorm(ExtractSigned(packed, 0, 10), 511.0f);
+            out[1] = Snorm(ExtractSigned(packed, 10, 10), 511.0f);
+            out[2] = Snorm(ExtractSigned(packed, 20, 10), 511.0f);
+            out[3] = Snorm(ExtractSigned(packed, 30, 2), 1.0f);
+            break;
+        }
+    }
+}
+
+void DecodeVertices(const VertexLayout& layout, const void* vertices, uint32_t count, float* outVertices) {
+    const uint8_t* source = static_cast<const uint8_t*>(vertices);
+    for (uint32_t v = 0; v < count; ++v) {
+        float* out = outVertices + v * 8;
+        out[0] = out[1] = out[2] = out[4] = out[5] = out[6] = 0.0f;
+        out[3] = out[7] = 1.0f;
+        for (uint32_t i = 0; i < layout.attributeCount; ++i) {
+            const VertexAttribute& attribute = layout.attributes[i];
+            if (attribute.location <= 1) {
+                DecodeVertexAttribute(attribute.format, source + attribute.offset, out + attribute.location * 4);
+            }
+        }
+        source += layout.stride;
+    }
+}
+
+} // namespace dw
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "irenderer.h"
+#include <cstdint>
+
+// CPU side reading of the vertex formats, used by the backends that shade on the CPU.
+namespace dw {
+
+/* IEEE 754 half to float, denormals, infinities and NaN included */
+float HalfToFloat(uint16_t half);
+/* Float to half rounded to nearest even like F16C, out of range values become infinity */
+uint16_t FloatToHalf(float value);
+
+/* Reads one attribute as four floats, components the format doesn't have read as (0, 0, 0, 1) */
+void DecodeVertexAttribute(VertexFormat format, const uint8_t* data, float out[4]);
+
+/* Expands count vertices to the standard { vec4 position; vec4 color; } layout. Locations other than 0
+   and 1 are skipped, a missing position or color reads as (0, 0, 0, 1) */
+void DecodeVertices(const VertexLayout& layout, const void* vertices, uint32_t count, float* outVertices);
+
+} // namespace dw
@@ -0,0 +1,395 @@
+#include "vertexpacker.h"
+#include "vertexpacker_kernels.h"
+#include "vertexformat.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(DW_SSE2_ENABLED)
+  #include <emmintrin.h>
+#endif
+
+namespace {
+    const uint32_t s_CHUNK_SIZE = 1024; // Vertices converted at a time, keeps the scratch buffers in L1/L2
+    const float s_RADIANS_TO_DEGREES = 57.2957795f;
+
+    // Copies count elements of Size bytes into every stride bytes of out, the fixed size lets memcpy become a move
+    template <uint32_t Size>
+    void Scatter(const uint8_t* in, uint32_t count, uint8_t* out, uint32_t stride) {
+        for (uint32_t i = 0; i < count; ++i) {
+            std::memcpy(out + i * stride, in + i * Size, Size);
+        }
+    }
+
+    void Scatter(const void* in, uint32_t size, uint32_t count, uint8_t* out, uint32_t stride) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(in);
+        switch (size) {
+            case 4: Scatter<4>(bytes, count, out, stride); break;
+            case 8: Scatter<8>(bytes, count, out, stride); break;
+            case 12: Scatter<12>(bytes, count, out, stride); break;
+            default: assert(false && "Unexpected packed attribute size");
+        }
+    }
+
+    void Accumulate(dw::QuantizationError& error, double& sumOfSquares, float difference) {
+        error.max = std::max(error.max, difference);
+        sumOfSquares += static_cast<double>(difference) * difference;
+    }
+
+    void Finish(dw::QuantizationError& error, double sumOfSquares, uint64_t samples) {
+        error.rms = samples ? static_cast<float>(std::sqrt(sumOfSquares / samples)) : 0.0f;
+    }}
+
+namespace dw {
+namespace packer {
+
+void FloatToHalfScalar(const float* in, uint16_t* out, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = FloatToHalf(in[i]);
+    }
+}
+
+// nearbyint rounds to nearest even in the default rounding mode, like cvtps2dq
+void FloatToSnorm16Scalar(const float* in, int16_t* out, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = static_cast<int16_t>(std::nearbyint(std::min(std::max(in[i], -1.0f), 1.0f) * 32767.0f));
+    }
+}
+
+void FloatToUnorm16Scalar(const float* in, uint16_t* out, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = static_cast<uint16_t>(std::nearbyint(std::min(std::max(in[i], 0.0f), 1.0f) * 65535.0f));
+    }
+}
+
+void FloatToUnorm8Scalar(const float* in, uint8_t* out, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = static_cast<uint8_t>(std::nearbyint(std::min(std::max(in[i], 0.0f), 1.0f) * 255.0f));
+    }
+}
+
+// Projects onto the octahedron |x| + |y| + |z| = 1 and folds the lower half over the diagonals
+void EncodeOctahedralScalar(const float* normals, float* out, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        const float x = normals[i * 3 + 0];
+        const float y = normals[i * 3 + 1];
+        const float z = normals[i * 3 + 2];
+        const float length = std::fabs(x) + std::fabs(y) + std::fabs(z);
+        const float scale = length > 0.0f ? 1.0f / length : 0.0f;
+        const float octX = x * scale;
+        const float octY = y * scale;
+        if (z < 0.0f) {
+            out[i * 2 + 0] = (1.0f - std::fabs(octY)) * (octX >= 0.0f ? 1.0f : -1.0f);
+            out[i * 2 + 1] = (1.0f - std::fabs(octX)) * (octY >= 0.0f ? 1.0f : -1.0f);
+        } else {
+            out[i * 2 + 0] = octX;
+            out[i * 2 + 1] = octY;
+        }
+    }
+}
+
+Kernels GetScalarKernels() {
+    return { FloatToHalfScalar, FloatToSnorm16Scalar, FloatToUnorm16Scalar, FloatToUnorm8Scalar, EncodeOctahedralScalar };
+}
+
+#if defined(DW_SSE2_ENABLED)
+namespace {
+    // Same steps as dw::FloatToHalf with the branches turned into selects, halves end up in the low 16 bits
+    __m128i FloatToHalf4(__m128 value) {
+        const __m128i sign = _mm_and_si128(_mm_castps_si128(value), _mm_set1_epi32(static_cast<int32_t>(0x80000000u)));
+        const __m128i bits = _mm_xor_si128(_mm_castps_si128(value), sign);
+
+        const __m128i isOverflow = _mm_cmpgt_epi32(bits, _mm_set1_epi32(((127 + 16) << 23) - 1));
+        const __m128i isNan = _mm_cmpgt_epi32(bits, _mm_set1_epi32(255 << 23));
+        const __m128i overflow = _mm_or_si128(_mm_set1_epi32(0x7c00), _mm_and_si128(isNan, _mm_set1_epi32(0x0200)));
+
+        const __m128i isDenormal = _mm_cmplt_epi32(bits, _mm_set1_epi32(113 << 23));
+        const __m128i magic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+        const __m128i denormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(bits), _mm_castsi128_ps(magic))), magic);
+
+        const __m128i mantissaOdd = _mm_and_si128(_mm_srli_epi32(bits, 13), _mm_set1_epi32(1));
+        __m128i normal = _mm_add_epi32(bits, _mm_set1_epi32(((15 - 127) * (1 << 23)) + 0xfff));
+        normal = _mm_srli_epi32(_mm_add_epi32(normal, mantissaOdd), 13);
+
+        __m128i result = _mm_or_si128(_mm_and_si128(isDenormal, denormal), _mm_andnot_si128(isDenormal, normal));
+        result = _mm_or_si128(_mm_and_si128(isOverflow, overflow), _mm_andnot_si128(isOverflow, result));
+        return _mm_or_si128(result, _mm_srli_epi32(sign, 16));
+    }
+
+    // packs_epi32 saturates, sign extending the low halves first keeps all 16 bits
+    __m128i PackLow16(__m128i a, __m128i b) {
+        return _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16), _mm_srai_epi32(_mm_slli_epi32(b, 16), 16));
+    }
+
+    __m128i ToInt(__m128 value, float minValue, float scale) {
+        const __m128 clamped = _mm_min_ps(_mm_max_ps(value, _mm_set1_ps(minValue)), _mm_set1_ps(1.0f));
+        return _mm_cvtps_epi32(_mm_mul_ps(clamped, _mm_set1_ps(scale)));
+    }
+
+    void FloatToHalfSse2(const float* in, uint16_t* out, size_t count) {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            const __m128i low = FloatToHalf4(_mm_loadu_ps(in + i));
+            const __m128i high = FloatToHalf4(_mm_loadu_ps(in + i + 4));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), PackLow16(low, high));
+        }
+        FloatToHalfScalar(in + i, out + i, count - i);
+    }
+
+    void FloatToSnorm16Sse2(const float* in, int16_t* out, size_t count) {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            const __m128i low = ToInt(_mm_loadu_ps(in + i), -1.0f, 32767.0f);
+            const __m128i high = ToInt(_mm_loadu_ps(in + i + 4), -1.0f, 32767.0f);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(low, high));
+        }
+        FloatToSnorm16Scalar(in + i, out + i, count - i);
+    }
+
+    void FloatToUnorm16Sse2(const float* in, uint16_t* out, size_t count) {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            const __m128i low = ToInt(_mm_loadu_ps(in + i), 0.0f, 65535.0f);
+            const __m128i high = ToInt(_mm_loadu_ps(in + i + 4), 0.0f, 65535.0f);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), PackLow16(low, high));
+        }
+        FloatToUnorm16Scalar(in + i, out + i, count - i);
+    }
+
+    void FloatToUnorm8Sse2(const float* in, uint8_t* out, size_t count) {
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            const __m128i a = ToInt(_mm_loadu_ps(in + i), 0.0f, 255.0f);
+            const __m128i b = ToInt(_mm_loadu_ps(in + i + 4), 0.0f, 255.0f);
+            const __m128i c = ToInt(_mm_loadu_ps(in + i + 8), 0.0f, 255.0f);
+            const __m128i d = ToInt(_mm_loadu_ps(in + i + 12), 0.0f, 255.0f);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+        }
+        FloatToUnorm8Scalar(in + i, out + i, count - i);
+    }
+
+    void EncodeOctahedralSse2(const float* normals, float* out, size_t count) {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            // x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3 to x, y and z of the four normals
+            const __m128 a = _mm_loadu_ps(normals + i * 3);
+            const __m128 b = _mm_loadu_ps(normals + i * 3 + 4);
+            const __m128 c = _mm_loadu_ps(normals + i * 3 + 8);
+            const __m128 x = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 2, 3, 0)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(0, 1, 0, 2)), _MM_SHUFFLE(2, 0, 1, 0));
+            const __m128 y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 0, 3, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+            const __m128 z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), c, _MM_SHUFFLE(3, 0, 2, 0));
+
+            const __m128 length = _mm_add_ps(_mm_add_ps(_mm_and_ps(x, absMask), _mm_and_ps(y, absMask)), _mm_and_ps(z, absMask));
+            const __m128 scale = _mm_and_ps(_mm_cmpgt_ps(length, zero), _mm_div_ps(one, length));
+            const __m128 octX = _mm_mul_ps(x, scale);
+            const __m128 octY = _mm_mul_ps(y, scale);
+
+            const __m128 signX = _mm_or_ps(one, _mm_andnot_ps(_mm_cmpge_ps(octX, zero), _mm_set1_ps(-0.0f)));
+            const __m128 signY = _mm_or_ps(one, _mm_andnot_ps(_mm_cmpge_ps(octY, zero), _mm_set1_ps(-0.0f)));
+            const __m128 foldedX = _mm_mul_ps(_mm_sub_ps(one, _mm_and_ps(octY, absMask)), signX);
+            const __m128 foldedY = _mm_mul_ps(_mm_sub_ps(one, _mm_and_ps(octX, absMask)), signY);
+            const __m128 isLower = _mm_cmplt_ps(z, zero);
+            const __m128 resultX = _mm_or_ps(_mm_and_ps(isLower, foldedX), _mm_andnot_ps(isLower, octX));
+            const __m128 resultY = _mm_or_ps(_mm_and_ps(isLower, foldedY), _mm_andnot_ps(isLower, octY));
+
+            _mm_storeu_ps(out + i * 2, _mm_unpacklo_ps(resultX, resultY));
+            _mm_storeu_ps(out + i * 2 + 4, _mm_unpackhi_ps(resultX, resultY));
+        }
+        EncodeOctahedralScalar(normals + i * 3, out + i * 2, count - i);
+    }
+}
+
+Kernels GetSse2Kernels() {
+    return { FloatToHalfSse2, FloatToSnorm16Sse2, FloatToUnorm16Sse2, FloatToUnorm8Sse2, EncodeOctahedralSse2 };
+}
+#endif
+
+} // namespace packer
+
+VertexPacker::VertexPacker(const VertexPackFormat& format) : VertexPacker(format, GetBestKernelSet()) {}
+
+VertexPacker::VertexPacker(const VertexPackFormat& format, KernelSet kernels) : m_format(format) {
+    const VertexFormat position = m_format.position;
+    if (position != VERTEX_FORMAT_FLOAT3 && position != VERTEX_FORMAT_HALF4 && position != VERTEX_FORMAT_SNORM16X4) {
+        LOGW("Unsupported packed position format, using HALF4");
+        m_format.position = VERTEX_FORMAT_HALF4;
+    }
+    const VertexFormat uv = m_format.uv;
+    if (uv != VERTEX_FORMAT_FLOAT2 && uv != VERTEX_FORMAT_HALF2 && uv != VERTEX_FORMAT_UNORM16X2) {
+        LOGW("Unsupported packed uv format, using HALF2");
+        m_format.uv = VERTEX_FORMAT_HALF2;
+    }
+    m_kernelSet = std::min(kernels, GetBestKernelSet());
+}
+
+VertexLayout VertexPacker::GetLayout(const VertexStreams& streams) const {
+    VertexLayout layout;
+    if (streams.positions) {
+        layout.Add(s_POSITION_LOCATION, m_format.position);
+    }
+    if (streams.colors) {
+        layout.Add(s_COLOR_LOCATION, VERTEX_FORMAT_UNORM8X4);
+    }
+    if (streams.normals) {
+        layout.Add(s_NORMAL_LOCATION, VERTEX_FORMAT_SNORM16X2);
+    }
+    if (streams.uvs) {
+        layout.Add(s_UV_LOCATION, m_format.uv);
+    }
+    return layout;
+}
+
+PackReport VertexPacker::Pack(const VertexStreams& streams, void* out, bool measureError) const {
+    packer::Kernels kernels = packer::GetScalarKernels();
+#if defined(DW_SSE2_ENABLED)
+    if (m_kernelSet == KERNELS_SSE2) {
+        kernels = packer::GetSse2Kernels();
+    }
+#endif
+#if defined(DW_AVX2_ENABLED)
+    if (m_kernelSet == KERNELS_AVX2) {
+        kernels = packer::GetAvx2Kernels();
+    }
+#endif
+
+    PackReport report;
+    const VertexLayout layout = GetLayout(streams);
+    const bool isSnormPosition = streams.positions && m_format.position == VERTEX_FORMAT_SNORM16X4;
+    if (isSnormPosition && streams.count > 0) {
+        float minimum[3] = { streams.positions[0], streams.positions[1], streams.positions[2] };
+        float maximum[3] = { minimum[0], minimum[1], minimum[2] };
+        for (uint32_t v = 1; v < streams.count; ++v) {
+            for (uint32_t c = 0; c < 3; ++c) {
+                minimum[c] = std::min(minimum[c], streams.positions[v * 3 + c]);
+                maximum[c] = std::max(maximum[c], streams.positions[v * 3 + c]);
+            }
+        }
+        for (uint32_t c = 0; c < 3; ++c) {
+            report.positionOffset[c] = (minimum[c] + maximum[c]) * 0.5f;
+            report.positionScale[c] = std::max((maximum[c] - minimum[c]) * 0.5f, 1e-20f);
+        }
+    }
+    const float inverseScale[3] = { 1.0f / report.positionScale[0], 1.0f / report.positionScale[1], 1.0f / report.positionScale[2] };
+
+    std::vector<float> expanded(s_CHUNK_SIZE * 4);
+    std::vector<uint8_t> converted(s_CHUNK_SIZE * 16);
+    uint16_t* converted16 = reinterpret_cast<uint16_t*>(converted.data());
+    uint8_t* output = static_cast<uint8_t*>(out);
+
+    for (uint32_t first = 0; first < streams.count; first += s_CHUNK_SIZE) {
+        const uint32_t count = std::min(s_CHUNK_SIZE, streams.count - first);
+        uint8_t* chunk = output + static_cast<size_t>(first) * layout.stride;
+        const VertexAttribute* attribute = layout.attributes;
+
+        if (streams.positions) {
+            const float* positions = streams.positions + static_cast<size_t>(first) * 3;
+            if (m_format.position == VERTEX_FORMAT_FLOAT3) {
+                Scatter(positions, 12, count, chunk + attribute->offset, layout.stride);
+            } else {
+                // Widen to xyz1, the only pass the kernels can't do in place of the input
+                for (uint32_t v = 0; v < count; ++v) {
+                    for (uint32_t c = 0; c < 3; ++c) {
+                        expanded[v * 4 + c] = (positions[v * 3 + c] - report.positionOffset[c]) * inverseScale[c];
+                    }
+                    expanded[v * 4 + 3] = 1.0f;
+                }
+                if (isSnormPosition) {
+                    kernels.floatToSnorm16(expanded.data(), reinterpret_cast<int16_t*>(converted16), count * 4);
+                } else {
+                    kernels.floatToHalf(expanded.data(), converted16, count * 4);
+                }
+                Scatter(converted.data(), 8, count, chunk + attribute->offset, layout.stride);
+            }
+            ++attribute;
+        }
+
+        if (streams.colors) {
+            kernels.floatToUnorm8(streams.colors + static_cast<size_t>(first) * 4, converted.data(), count * 4);
+            Scatter(converted.data(), 4, count, chunk + attribute->offset, layout.stride);
+            ++attribute;
+        }
+
+        if (streams.normals) {
+            kernels.encodeOctahedral(streams.normals + static_cast<size_t>(first) * 3, expanded.data(), count);
+            kernels.floatToSnorm16(expanded.data(), reinterpret_cast<int16_t*>(converted16), count * 2);
+            Scatter(converted.data(), 4, count, chunk + attribute->offset, layout.stride);
+            ++attribute;
+        }
+
+        if (streams.uvs) {
+            const float* uvs = streams.uvs + static_cast<size_t>(first) * 2;
+            if (m_format.uv == VERTEX_FORMAT_FLOAT2) {
+                Scatter(uvs, 8, count, chunk + attribute->offset, layout.stride);
+            } else {
+                if (m_format.uv == VERTEX_FORMAT_HALF2) {
+                    kernels.floatToHalf(uvs, converted16, count * 2);
+                } else {
+                    kernels.floatToUnorm16(uvs, converted16, count * 2);
+                }
+                Scatter(converted.data(), 4, count, chunk + attribute->offset, layout.stride);
+            }
+        }
+    }
+
+    if (measureError) {
+        measure(streams, layout, out, report);
+    }
+    return report;
+}
+
+void VertexPacker::measure(const VertexStreams& streams, const VertexLayout& layout, const void* packed, PackReport& report) const {
+    double positionSum = 0.0, normalSum = 0.0, colorSum = 0.0, uvSum = 0.0;
+    const uint8_t* vertex = static_cast<const uint8_t*>(packed);
+    for (uint32_t v = 0; v < streams.count; ++v, vertex += layout.stride) {
+        for (uint32_t i = 0; i < layout.attributeCount; ++i) {
+            const VertexAttribute& attribute = layout.attributes[i];
+            float value[4];
+            DecodeVertexAttribute(attribute.format, vertex + attribute.offset, value);
+
+            if (attribute.location == s_POSITION_LOCATION) {
+                float distanceSquared = 0.0f;
+                for (uint32_t c = 0; c < 3; ++c) {
+                    const float difference = value[c] * report.positionScale[c] + report.positionOffset[c] - streams.positions[v * 3 + c];
+                    distanceSquared += difference * difference;
+                }
+                Accumulate(report.position, positionSum, std::sqrt(distanceSquared));
+            } else if (attribute.location == s_COLOR_LOCATION) {
+                for (uint32_t c = 0; c < 4; ++c) {
+                    Accumulate(report.color, colorSum, std::fabs(value[c] - streams.colors[v * 4 + c]));
+                }
+            } else if (attribute.location == s_NORMAL_LOCATION) {
+                float x = value[0];
+                float y = value[1];
+                const float z = 1.0f - std::fabs(x) - std::fabs(y);
+                if (z < 0.0f) {
+                    const float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+                    y = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+                    x = foldedX;
+                }
+                const float length = std::sqrt(x * x + y * y + z * z);
+                const float* normal = streams.normals + v * 3;
+                const float originalLength = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+                float cosine = (x * normal[0] + y * normal[1] + z * normal[2]) / (length * originalLength);
+                cosine = std::min(std::max(cosine, -1.0f), 1.0f);
+                Accumulate(report.normal, normalSum, std::acos(cosine) * s_RADIANS_TO_DEGREES);
+            } else if (attribute.location == s_UV_LOCATION) {
+                for (uint32_t c = 0; c < 2; ++c) {
+                    Accumulate(report.uv, uvSum, std::fabs(value[c] - streams.uvs[v * 2 + c]));
+                }
+            }
+        }
+    }
+    Finish(report.position, positionSum, streams.positions ? streams.count : 0);
+    Finish(report.normal, normalSum, streams.normals ? streams.count : 0);
+    Finish(report.color, colorSum, streams.colors ? streams.count * 4ull : 0);
+    Finish(report.uv, uvSum, streams.uvs ? streams.count * 2ull : 0);
+}
+
+} // namespace dw
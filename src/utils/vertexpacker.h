@@ -0,0 +1,80 @@
+#pragma once
+
+#include "irenderer.h"
+#include "cpufeatures.h"
+#include <cstdint>
+
+namespace dw {
+
+// Float input streams of a mesh, count vertices each. Streams the mesh doesn't have are left null.
+struct VertexStreams {
+    const float* positions = nullptr; // xyz
+    const float* normals = nullptr;   // xyz, unit length
+    const float* colors = nullptr;    // rgba in [0, 1]
+    const float* uvs = nullptr;       // uv
+    uint32_t count = 0;
+};
+
+// Packed formats per stream. Positions take FLOAT3, HALF4 or SNORM16X4 and uvs FLOAT2, HALF2 or UNORM16X2.
+// Normals are always octahedral encoded to SNORM16X2 and colors stored as UNORM8X4.
+struct VertexPackFormat {
+    VertexFormat position = VERTEX_FORMAT_HALF4;
+    VertexFormat uv = VERTEX_FORMAT_HALF2;
+};
+
+// Largest and root mean square difference between the input and the packed values read back
+struct QuantizationError {
+    float max = 0.0f;
+    float rms = 0.0f;
+};
+
+struct PackReport {
+    // SNORM16X4 positions are stored relative to the bounds and read back as position * positionScale + positionOffset,
+    // fold this into the model matrix. Identity for the other position formats
+    float positionScale[3] = { 1.0f, 1.0f, 1.0f };
+    float positionOffset[3] = { 0.0f, 0.0f, 0.0f };
+
+    // Only filled in when measured. Positions in object space units, normals in degrees, colors and uvs per component
+    QuantizationError position;
+    QuantizationError normal;
+    QuantizationError color;
+    QuantizationError uv;
+};
+
+// Converts float vertex streams to one interleaved buffer of compact formats. The heavy lifting is done in
+// chunks by SSE2 or AVX2/F16C kernels, picked at construction from what the CPU supports. The output goes
+// straight into a mapped vertex buffer:
+//   VertexPacker packer;
+//   engine.CreateVertexBuffer(object, streams.count, packer.GetLayout(streams));
+//   packer.Pack(streams, engine.MapVertexBuffer(object));
+//   engine.UnmapVertexBuffer(object);
+// The octahedral normal n.xy decodes to normalize(vec3(n.xy, 1 - |n.x| - |n.y|)), with n.xy folded back by
+// (1 - |n.yx|) * sign(n.xy) where the z computed that way is negative.
+class VertexPacker {
+public:
+    static const uint32_t s_POSITION_LOCATION = 0;
+    static const uint32_t s_COLOR_LOCATION = 1;
+    static const uint32_t s_NORMAL_LOCATION = 4; // 2 and 3 are taken by the instance data
+    static const uint32_t s_UV_LOCATION = 5;
+
+    /* Uses the widest kernels the build and the CPU support */
+    explicit VertexPacker(const VertexPackFormat& format = VertexPackFormat());
+    /* Forces a kernel set, falling back to narrower ones that are available */
+    VertexPacker(const VertexPackFormat& format, KernelSet kernels);
+
+    /* Layout of the packed vertices, attributes in the order position, color, normal, uv */
+    VertexLayout GetLayout(const VertexStreams& streams) const;
+    /* Writes streams.count vertices of GetLayout(streams) to out. Reading the result back to measure the
+       quantization error costs about as much as packing, so it's optional */
+    PackReport Pack(const VertexStreams& streams, void* out, bool measureError = false) const;
+
+    KernelSet GetKernelSet() const { return m_kernelSet; }
+
+private:
+    void measure(const VertexStreams& streams, const VertexLayout& layout, const void* packed, PackReport& report) const;
+
+    VertexPackFormat m_format;
+    KernelSet m_kernelSet = KERNELS_SCALAR;
+};
+
+} // namespace dw
@@ -0,0 +1,102 @@
+// Built with AVX2 and F16C code generation, nothing in here may run before VertexPacker checked the CPU
+#include "vertexpacker_kernels.h"
+
+#include <immintrin.h>
+
+namespace dw {
+namespace packer {
+
+namespace {
+    __m256i ToInt(__m256 value, float minValue, float scale) {
+        const __m256 clamped = _mm256_min_ps(_mm256_max_ps(value, _mm256_set1_ps(minValue)), _mm256_set1_ps(1.0f));
+        return _mm256_cvtps_epi32(_mm256_mul_ps(clamped, _mm256_set1_ps(scale)));
+    }
+
+    // The 256 bit packs work per 128 bit lane, this puts the four 64 bit quarters back in order
+    __m256i FixLanes(__m256i packed) {
+        return _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0));
+    }
+
+    void FloatToHalfAvx2(const float* in, uint16_t* out, size_t count) {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT));
+        }
+        FloatToHalfScalar(in + i, out + i, count - i);
+    }
+
+    void FloatToSnorm16Avx2(const float* in, int16_t* out, size_t count) {
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            const __m256i low = ToInt(_mm256_loadu_ps(in + i), -1.0f, 32767.0f);
+            const __m256i high = ToInt(_mm256_loadu_ps(in + i + 8), -1.0f, 32767.0f);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), FixLanes(_mm256_packs_epi32(low, high)));
+        }
+        FloatToSnorm16Scalar(in + i, out + i, count - i);
+    }
+
+    void FloatToUnorm16Avx2(const float* in, uint16_t* out, size_t count) {
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            const __m256i low = ToInt(_mm256_loadu_ps(in + i), 0.0f, 65535.0f);
+            const __m256i high = ToInt(_mm256_loadu_ps(in + i + 8), 0.0f, 65535.0f);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), FixLanes(_mm256_packus_epi32(low, high)));
+        }
+        FloatToUnorm16Scalar(in + i, out + i, count - i);
+    }
+
+    void FloatToUnorm8Avx2(const float* in, uint8_t* out, size_t count) {
+        const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+        size_t i = 0;
+        for (; i + 32 <= count; i += 32) {
+            const __m256i a = ToInt(_mm256_loadu_ps(in + i), 0.0f, 255.0f);
+            const __m256i b = ToInt(_mm256_loadu_ps(in + i + 8), 0.0f, 255.0f);
+            const __m256i c = ToInt(_mm256_loadu_ps(in + i + 16), 0.0f, 255.0f);
+            const __m256i d = ToInt(_mm256_loadu_ps(in + i + 24), 0.0f, 255.0f);
+            const __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_permutevar8x32_epi32(packed, order));
+        }
+        FloatToUnorm8Scalar(in + i, out + i, count - i);
+    }
+
+    void EncodeOctahedralAvx2(const float* normals, float* out, size_t count) {
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+        const __m256i stride = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            const float* base = normals + i * 3;
+            const __m256 x = _mm256_i32gather_ps(base + 0, stride, 4);
+            const __m256 y = _mm256_i32gather_ps(base + 1, stride, 4);
+            const __m256 z = _mm256_i32gather_ps(base + 2, stride, 4);
+
+            const __m256 length = _mm256_add_ps(_mm256_add_ps(_mm256_and_ps(x, absMask), _mm256_and_ps(y, absMask)), _mm256_and_ps(z, absMask));
+            const __m256 scale = _mm256_and_ps(_mm256_cmp_ps(length, zero, _CMP_GT_OQ), _mm256_div_ps(one, length));
+            const __m256 octX = _mm256_mul_ps(x, scale);
+            const __m256 octY = _mm256_mul_ps(y, scale);
+
+            const __m256 negativeOne = _mm256_set1_ps(-1.0f);
+            const __m256 signX = _mm256_blendv_ps(negativeOne, one, _mm256_cmp_ps(octX, zero, _CMP_GE_OQ));
+            const __m256 signY = _mm256_blendv_ps(negativeOne, one, _mm256_cmp_ps(octY, zero, _CMP_GE_OQ));
+            const __m256 foldedX = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_and_ps(octY, absMask)), signX);
+            const __m256 foldedY = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_and_ps(octX, absMask)), signY);
+            const __m256 isLower = _mm256_cmp_ps(z, zero, _CMP_LT_OQ);
+            const __m256 resultX = _mm256_blendv_ps(octX, foldedX, isLower);
+            const __m256 resultY = _mm256_blendv_ps(octY, foldedY, isLower);
+
+            const __m256 low = _mm256_unpacklo_ps(resultX, resultY);
+            const __m256 high = _mm256_unpackhi_ps(resultX, resultY);
+            _mm256_storeu_ps(out + i * 2, _mm256_permute2f128_ps(low, high, 0x20));
+            _mm256_storeu_ps(out + i * 2 + 8, _mm256_permute2f128_ps(low, high, 0x31));
+        }
+        EncodeOctahedralScalar(normals + i * 3, out + i * 2, count - i);
+    }
+}
+
+Kernels GetAvx2Kernels() {
+    return { FloatToHalfAvx2, FloatToSnorm16Avx2, FloatToUnorm16Avx2, FloatToUnorm8Avx2, EncodeOctahedralAvx2 };
+}
+
+} // namespace packer
+} // namespace dw
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "cpufeatures.h"
+
+// Conversion loops of the VertexPacker, one table per instruction set. Every kernel converts count
+// contiguous elements, snorm and unorm values are clamped and rounded to nearest even, the same result
+// in every set.
+namespace dw {
+namespace packer {
+
+struct Kernels {
+    void (*floatToHalf)(const float* in, uint16_t* out, size_t count);
+    void (*floatToSnorm16)(const float* in, int16_t* out, size_t count);
+    void (*floatToUnorm16)(const float* in, uint16_t* out, size_t count);
+    void (*floatToUnorm8)(const float* in, uint8_t* out, size_t count);
+    /* count xyz normals to count octahedral xy pairs in [-1, 1] */
+    void (*encodeOctahedral)(const float* normals, float* out, size_t count);
+};
+
+// The scalar kernels also finish the tails of the wider sets
+void FloatToHalfScalar(const float* in, uint16_t* out, size_t count);
+void FloatToSnorm16Scalar(const float* in, int16_t* out, size_t count);
+void FloatToUnorm16Scalar(const float* in, uint16_t* out, size_t count);
+void FloatToUnorm8Scalar(const float* in, uint8_t* out, size_t count);
+void EncodeOctahedralScalar(const float* normals, float* out, size_t count);
+
+Kernels GetScalarKernels();
+#if defined(DW_SSE2_ENABLED)
+Kernels GetSse2Kernels();
+#endif
+#if defined(DW_AVX2_ENABLED)
+Kernels GetAvx2Kernels();
+#endif
+
+} // namespace packer
+} // namespace dw
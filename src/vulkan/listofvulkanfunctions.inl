@@ -32,6 +32,7 @@ INSTANCE_LEVEL_VULKAN_FUNCTION(vkGetDeviceProcAddr)
 INSTANCE_LEVEL_VULKAN_FUNCTION(vkEnumerateDeviceExtensionProperties)
 INSTANCE_LEVEL_VULKAN_FUNCTION(vkGetPhysicalDeviceQueueFamilyProperties)
 INSTANCE_LEVEL_VULKAN_FUNCTION(vkDestroyInstance)
+INSTANCE_LEVEL_VULKAN_FUNCTION(vkGetPhysicalDeviceMemoryProperties)
 
 //...
 
@@ -68,6 +69,58 @@ DEVICE_LEVEL_VULKAN_FUNCTION(vkDeviceWaitIdle)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyDevice)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateBuffer)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkGetBufferMemoryRequirements)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyBuffer)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkAllocateMemory)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkFreeMemory)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkMapMemory)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkUnmapMemory)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkBindBufferMemory)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateImage)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyImage)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkGetImageMemoryRequirements)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkBindImageMemory)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateImageView)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyImageView)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateRenderPass)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyRenderPass)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateFramebuffer)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyFramebuffer)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateShaderModule)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyShaderModule)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateDescriptorSetLayout)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyDescriptorSetLayout)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateDescriptorPool)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyDescriptorPool)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkAllocateDescriptorSets)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkFreeDescriptorSets)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkUpdateDescriptorSets)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreatePipelineLayout)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyPipelineLayout)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateGraphicsPipelines)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyPipeline)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateCommandPool)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyCommandPool)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkAllocateCommandBuffers)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkFreeCommandBuffers)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkBeginCommandBuffer)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkEndCommandBuffer)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdBeginRenderPass)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdEndRenderPass)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdBindPipeline)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdBindVertexBuffers)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdBindIndexBuffer)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdBindDescriptorSets)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdSetViewport)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdSetScissor)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdDraw)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdDrawIndexed)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdPipelineBarrier)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdCopyImageToBuffer)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkQueueSubmit)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateFence)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyFence)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkWaitForFences)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkResetFences)
 // ...
 
 #undef DEVICE_LEVEL_VULKAN_FUNCTION
@@ -0,0 +1,929 @@
+#include "renderer_vk.h"
+#include "common/config.h"
+
+#include "direwolf/vulkan/vulkansetup.h"
+#include "vulkanfunctions.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "utils/logger.h"
+
+namespace {
+    const uint32_t s_DEFAULT_WIDTH = 1024;
+    const uint32_t s_DEFAULT_HEIGHT = 768;
+    const uint32_t s_INSTANCE_STRIDE = sizeof(dw::InstanceData);
+    const uint32_t s_MAX_CONSTANT_BUFFERS = 1024;
+    const VkFormat s_COLOR_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+    const VkFormat s_DEPTH_FORMAT = VK_FORMAT_D32_SFLOAT;
+    const VkClearColorValue s_CLEAR_COLOR = {{ 0.0f, 0.0f, 0.4f, 0.0f }}; // Same ugly color as the OpenGL backend
+
+    VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    VkFormat GetAttributeFormat(dw::VertexFormat format) {
+        switch (format) {
+            case dw::VERTEX_FORMAT_FLOAT2: return VK_FORMAT_R32G32_SFLOAT;
+            case dw::VERTEX_FORMAT_FLOAT3: return VK_FORMAT_R32G32B32_SFLOAT;
+            case dw::VERTEX_FORMAT_FLOAT4: return VK_FORMAT_R32G32B32A32_SFLOAT;
+            case dw::VERTEX_FORMAT_HALF2: return VK_FORMAT_R16G16_SFLOAT;
+            case dw::VERTEX_FORMAT_HALF4: return VK_FORMAT_R16G16B16A16_SFLOAT;
+            case dw::VERTEX_FORMAT_UNORM8X4: return VK_FORMAT_R8G8B8A8_UNORM;
+            case dw::VERTEX_FORMAT_SNORM8X4: return VK_FORMAT_R8G8B8A8_SNORM;
+            case dw::VERTEX_FORMAT_UNORM16X2: return VK_FORMAT_R16G16_UNORM;
+            case dw::VERTEX_FORMAT_UNORM16X4: return VK_FORMAT_R16G16B16A16_UNORM;
+            case dw::VERTEX_FORMAT_SNORM16X2: return VK_FORMAT_R16G16_SNORM;
+            case dw::VERTEX_FORMAT_SNORM16X4: return VK_FORMAT_R16G16B16A16_SNORM;
+            case dw::VERTEX_FORMAT_UNORM10_10_10_2: return VK_FORMAT_A2B10G10R10_UNORM_PACK32;
+            case dw::VERTEX_FORMAT_SNORM10_10_10_2: return VK_FORMAT_A2B10G10R10_SNORM_PACK32;
+        }
+        return VK_FORMAT_R32G32B32A32_SFLOAT;
+    }
+}
+
+namespace dw {
+
+using namespace vulkan;
+
+RendererVK::~RendererVK() {
+    if (m_device) {
+        vkDeviceWaitIdle(m_device);
+
+        m_pipelines.ForEach([this](Pipeline& pipeline) { destroyPipeline(pipeline); });
+        m_vertexBuffers.ForEach([this](VertexBuffer& vertexBuffer) {
+            destroyBuffer(vertexBuffer.buffer);
+            for (Buffer& copy : vertexBuffer.copies) {
+                destroyBuffer(copy);
+            }
+        });
+        m_indexBuffers.ForEach([this](IndexBuffer& indexBuffer) { destroyBuffer(indexBuffer.buffer); });
+        m_constantBuffers.ForEach([this](ConstantBuffer& constantBuffer) { destroyBuffer(constantBuffer.buffer); });
+        destroyBuffer(m_defaultInstanceBuffer);
+        for (Frame& frame : m_frames) {
+            vkDestroyFence(m_device, frame.fence, nullptr);
+        }
+
+        vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+        vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+        vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+        vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayout, nullptr);
+        vkDestroyFramebuffer(m_device, m_framebuffer, nullptr);
+        vkDestroyRenderPass(m_device, m_renderPass, nullptr);
+        for (uint32_t i = 0; i < 2; ++i) {
+            vkDestroyImageView(m_device, m_imageViews[i], nullptr);
+            vkDestroyImage(m_device, m_images[i], nullptr);
+            vkFreeMemory(m_device, m_imageMemory[i], nullptr);
+        }
+    }
+
+    DestroyLogicalDevice(m_device);
+    DestroyInstance(m_instance);
+    if (m_vulkanRTL) {
+        ReleaseRuntimeLibrary(m_vulkanRTL);
+    }
+}
+
+bool RendererVK::Initialize(const RendererCaps& /*caps*/, const PlatformData& platformData) {
+    LOGD("Initializing Vulkan Renderer");
+
+    m_width = platformData.width ? platformData.width : s_DEFAULT_WIDTH;
+    m_height = platformData.height ? platformData.height : s_DEFAULT_HEIGHT;
+
+    if (!createDevice() || !createRenderTarget() || !createSharedObjects()) {
+        LOGE("Failed to initialize the Vulkan renderer");
+        return false;
+    }
+    m_isInitialized = true;
+    return true;
+}
+
+bool RendererVK::createDevice() {
+    m_vulkanRTL = InitializeVulkan();
+    if (!m_vulkanRTL) {
+        return false;
+    }
+
+    VulkanInstanceInitData instanceInitData;
+    instanceInitData.applicationName = const_cast<char*>("DireWolf Application");
+    instanceInitData.engineName = const_cast<char*>("DireWolf Engine");
+    m_instance = CreateVulkanInstance(instanceInitData);
+    if (m_instance == VK_NULL_HANDLE) {
+        return false;
+    }
+
+    // Pick the first device with a graphics queue, lavapipe included
+    for (const VkPhysicalDevice& device : GetPhysicalDevices(m_instance)) {
+        if (GetSupportingQueueIndex(GetQueueProperties(device), VK_QUEUE_GRAPHICS_BIT, m_queueFamilyIndex)) {
+            m_physicalDevice = device;
+            break;
+        }
+    }
+    if (m_physicalDevice == VK_NULL_HANDLE) {
+        LOGE("No Vulkan device with a graphics queue found");
+        return false;
+    }
+
+    const VkPhysicalDeviceProperties properties = GetPhysicalDeviceProperties(m_physicalDevice);
+    m_uniformAlignment = properties.limits.minUniformBufferOffsetAlignment;
+    vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &m_memoryProperties);
+    LOGI(std::string("Vulkan renderer running on ") + properties.deviceName);
+
+    const float priority = 1.0f;
+    VkDeviceQueueCreateInfo queueCreateInfo = {};
+    queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queueCreateInfo.queueFamilyIndex = m_queueFamilyIndex;
+    queueCreateInfo.queueCount = 1;
+    queueCreateInfo.pQueuePriorities = &priority;
+
+    VkPhysicalDeviceFeatures features = {};
+    VkDeviceCreateInfo deviceCreateInfo = {};
+    deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    deviceCreateInfo.queueCreateInfoCount = 1;
+    deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+    deviceCreateInfo.pEnabledFeatures = &features;
+
+    m_device = CreateLogicalDevice(m_physicalDevice, deviceCreateInfo);
+    if (m_device == VK_NULL_HANDLE) {
+        return false;
+    }
+
+    vkGetDeviceQueue(m_device, m_queueFamilyIndex, 0, &m_queue);
+    return true;
+}
+
+bool RendererVK::createRenderTarget() {
+    const VkFormat formats[2] = { s_COLOR_FORMAT, s_DEPTH_FORMAT };
+    const VkImageUsageFlags usages[2] = {
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT
+    };
+    const VkImageAspectFlags aspects[2] = { VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_ASPECT_DEPTH_BIT };
+
+    for (uint32_t i = 0; i < 2; ++i) {
+        VkImageCreateInfo imageCreateInfo = {};
+        imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageCreateInfo.format = formats[i];
+        imageCreateInfo.extent = { m_width, m_height, 1 };
+        imageCreateInfo.mipLevels = 1;
+        imageCreateInfo.arrayLayers = 1;
+        imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageCreateInfo.usage = usages[i];
+        imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        if (vkCreateImage(m_device, &imageCreateInfo, nullptr, &m_images[i]) != VK_SUCCESS) {
+            return false;
+        }
+
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(m_device, m_images[i], &requirements);
+        VkMemoryAllocateInfo allocateInfo = {};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocateInfo.allocationSize = requirements.size;
+        if (!findMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, allocateInfo.memoryTypeIndex)
+            || vkAllocateMemory(m_device, &allocateInfo, nullptr, &m_imageMemory[i]) != VK_SUCCESS
+            || vkBindImageMemory(m_device, m_images[i], m_imageMemory[i], 0) != VK_SUCCESS) {
+            return false;
+        }
+
+        VkImageViewCreateInfo viewCreateInfo = {};
+        viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewCreateInfo.image = m_images[i];
+        viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewCreateInfo.format = formats[i];
+        viewCreateInfo.subresourceRange = { aspects[i], 0, 1, 0, 1 };
+        if (vkCreateImageView(m_device, &viewCreateInfo, nullptr, &m_imageViews[i]) != VK_SUCCESS) {
+            return false;
+        }
+    }
+
+    VkAttachmentDescription attachments[2] = {};
+    for (uint32_t i = 0; i < 2; ++i) {
+        attachments[i].format = formats[i];
+        attachments[i].samples = VK_SAMPLE_COUNT_1_BIT;
+        attachments[i].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        attachments[i].storeOp = i == 0 ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachments[i].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachments[i].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachments[i].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    }
+    attachments[0].finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    const VkAttachmentReference colorReference = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+    const VkAttachmentReference depthReference = { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+    VkSubpassDescription subpass = {};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorReference;
+    subpass.pDepthStencilAttachment = &depthReference;
+
+    VkRenderPassCreateInfo renderPassCreateInfo = {};
+    renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassCreateInfo.attachmentCount = 2;
+    renderPassCreateInfo.pAttachments = attachments;
+    renderPassCreateInfo.subpassCount = 1;
+    renderPassCreateInfo.pSubpasses = &subpass;
+    if (vkCreateRenderPass(m_device, &renderPassCreateInfo, nullptr, &m_renderPass) != VK_SUCCESS) {
+        return false;
+    }
+
+    VkFramebufferCreateInfo framebufferCreateInfo = {};
+    framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferCreateInfo.renderPass = m_renderPass;
+    framebufferCreateInfo.attachmentCount = 2;
+    framebufferCreateInfo.pAttachments = m_imageViews;
+    framebufferCreateInfo.width = m_width;
+    framebufferCreateInfo.height = m_height;
+    framebufferCreateInfo.layers = 1;
+    return vkCreateFramebuffer(m_device, &framebufferCreateInfo, nullptr, &m_framebuffer) == VK_SUCCESS;
+}
+
+bool RendererVK::createSharedObjects() {
+    VkDescriptorSetLayoutBinding binding = {};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+    setLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    setLayoutCreateInfo.bindingCount = 1;
+    setLayoutCreateInfo.pBindings = &binding;
+    if (vkCreateDescriptorSetLayout(m_device, &setLayoutCreateInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS) {
+        return false;
+    }
+
+    const VkDescriptorPoolSize poolSize = { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, s_MAX_CONSTANT_BUFFERS * s_FRAMES_IN_FLIGHT };
+    VkDescriptorPoolCreateInfo poolCreateInfo = {};
+    poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+    poolCreateInfo.maxSets = s_MAX_CONSTANT_BUFFERS * s_FRAMES_IN_FLIGHT;
+    poolCreateInfo.poolSizeCount = 1;
+    poolCreateInfo.pPoolSizes = &poolSize;
+    if (vkCreateDescriptorPool(m_device, &poolCreateInfo, nullptr, &m_descriptorPool) != VK_SUCCESS) {
+        return false;
+    }
+
+    VkPipelineLayoutCreateInfo layoutCreateInfo = {};
+    layoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutCreateInfo.setLayoutCount = 1;
+    layoutCreateInfo.pSetLayouts = &m_descriptorSetLayout;
+    if (vkCreatePipelineLayout(m_device, &layoutCreateInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
+        return false;
+    }
+
+    VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+    commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    commandPoolCreateInfo.queueFamilyIndex = m_queueFamilyIndex;
+    if (vkCreateCommandPool(m_device, &commandPoolCreateInfo, nullptr, &m_commandPool) != VK_SUCCESS) {
+        return false;
+    }
+
+    for (Frame& frame : m_frames) {
+        VkCommandBufferAllocateInfo allocateInfo = {};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocateInfo.commandPool = m_commandPool;
+        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocateInfo.commandBufferCount = 1;
+
+        VkFenceCreateInfo fenceCreateInfo = {};
+        fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        if (vkAllocateCommandBuffers(m_device, &allocateInfo, &frame.commandBuffer) != VK_SUCCESS
+            || vkCreateFence(m_device, &fenceCreateInfo, nullptr, &frame.fence) != VK_SUCCESS) {
+            return false;
+        }
+    }
+
+    if (!createBuffer(s_INSTANCE_STRIDE, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, m_defaultInstanceBuffer)) {
+        return false;
+    }
+    const InstanceData defaultInstance;
+    std::memcpy(m_defaultInstanceBuffer.mapped, &defaultInstance, sizeof(defaultInstance));
+    return true;
+}
+
+bool RendererVK::findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties, uint32_t& outIndex) const {
+    for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; ++i) {
+        if ((typeBits & (1u << i)) && (m_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            outIndex = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Every buffer lives in host visible memory and stays mapped, writes through Map wait for the frames reading it
+bool RendererVK::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, Buffer& outBuffer) const {
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = size;
+    bufferCreateInfo.usage = usage;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vkCreateBuffer(m_device, &bufferCreateInfo, nullptr, &outBuffer.buffer) != VK_SUCCESS) {
+        return false;
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(m_device, outBuffer.buffer, &requirements);
+    VkMemoryAllocateInfo allocateInfo = {};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocateInfo.allocationSize = requirements.size;
+    const VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    if (!findMemoryType(requirements.memoryTypeBits, properties, allocateInfo.memoryTypeIndex)
+        || vkAllocateMemory(m_device, &allocateInfo, nullptr, &outBuffer.memory) != VK_SUCCESS
+        || vkBindBufferMemory(m_device, outBuffer.buffer, outBuffer.memory, 0) != VK_SUCCESS
+        || vkMapMemory(m_device, outBuffer.memory, 0, VK_WHOLE_SIZE, 0, &outBuffer.mapped) != VK_SUCCESS) {
+        destroyBuffer(outBuffer);
+        return false;
+    }
+
+    return true;
+}
+
+void RendererVK::destroyBuffer(Buffer& buffer) const {
+    vkDestroyBuffer(m_device, buffer.buffer, nullptr);
+    vkFreeMemory(m_device, buffer.memory, nullptr);
+    buffer = Buffer();
+}
+
+bool RendererVK::isFramePending(uint64_t frameNumber) const {
+    // Render already waited for frames whose slot was reused since
+    if (frameNumber == 0 || m_frameIndex >= frameNumber + s_FRAMES_IN_FLIGHT) {
+        return false;
+    }
+    return m_frames[(frameNumber - 1) % s_FRAMES_IN_FLIGHT].isPending;
+}
+
+void RendererVK::waitForFrame(uint64_t frameNumber) {
+    if (isFramePending(frameNumber)) {
+        Frame& frame = m_frames[(frameNumber - 1) % s_FRAMES_IN_FLIGHT];
+        vkWaitForFences(m_device, 1, &frame.fence, VK_TRUE, UINT64_MAX);
+        frame.isPending = false;
+    }
+}
+
+bool RendererVK::CreateConstantBuffer(const GfxObject& object, uint32_t size) {
+    LOGD("Creating constant buffer with size " + std::to_string(size));
+    ConstantBuffer constantBuffer;
+    constantBuffer.sliceSize = AlignUp(size, m_uniformAlignment);
+    constantBuffer.shadow.resize(size);
+    if (!createBuffer(constantBuffer.sliceSize * s_FRAMES_IN_FLIGHT, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, constantBuffer.buffer)) {
+        LOGE("Failed to create constant buffer");
+        return false;
+    }
+
+    VkDescriptorSetLayout layouts[s_FRAMES_IN_FLIGHT];
+    std::fill_n(layouts, s_FRAMES_IN_FLIGHT, m_descriptorSetLayout);
+    VkDescriptorSetAllocateInfo allocateInfo = {};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocateInfo.descriptorPool = m_descriptorPool;
+    allocateInfo.descriptorSetCount = s_FRAMES_IN_FLIGHT;
+    allocateInfo.pSetLayouts = layouts;
+    if (vkAllocateDescriptorSets(m_device, &allocateInfo, constantBuffer.descriptorSets) != VK_SUCCESS) {
+        LOGE("Failed to allocate descriptor sets, too many constant buffers?");
+        destroyBuffer(constantBuffer.buffer);
+        return false;
+    }
+
+    VkDescriptorBufferInfo bufferInfos[s_FRAMES_IN_FLIGHT];
+    VkWriteDescriptorSet writes[s_FRAMES_IN_FLIGHT] = {};
+    for (uint32_t i = 0; i < s_FRAMES_IN_FLIGHT; ++i) {
+        bufferInfos[i] = { constantBuffer.buffer.buffer, constantBuffer.sliceSize * i, size };
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = constantBuffer.descriptorSets[i];
+        writes[i].dstBinding = 0;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        writes[i].pBufferInfo = &bufferInfos[i];
+    }
+    vkUpdateDescriptorSets(m_device, s_FRAMES_IN_FLIGHT, writes, 0, nullptr);
+
+    m_constantBuffers.Insert(object, std::move(constantBuffer));
+    return true;
+}
+
+bool RendererVK::CreateVertexBuffer(const GfxObject& object, uint32_t count, const VertexLayout& layout) {
+    VertexBuffer vertexBuffer;
+    vertexBuffer.layout = layout;
+    vertexBuffer.size = static_cast<VkDeviceSize>(count) * layout.stride;
+    if (!createBuffer(vertexBuffer.size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertexBuffer.buffer)) {
+        LOGE("Failed to create vertex buffer");
+        return false;
+    }
+    m_vertexBuffers.Insert(object, vertexBuffer);
+    return true;
+}
+
+bool RendererVK::CreateIndexBuffer(const GfxObject& object, uint32_t count, IndexFormat format) {
+    IndexBuffer indexBuffer;
+    indexBuffer.type = format == INDEX_FORMAT_UINT16 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+    if (!createBuffer(count * GetIndexSize(format), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indexBuffer.buffer)) {
+        LOGE("Failed to create index buffer");
+        return false;
+    }
+    m_indexBuffers.Insert(object, indexBuffer);
+    return true;
+}
+
+VkShaderModule RendererVK::createShaderModule(const ShaderBytecode& bytecode) const {
+    VkShaderModuleCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = bytecode.size;
+    createInfo.pCode = static_cast<const uint32_t*>(bytecode.data);
+
+    VkShaderModule shaderModule = VK_NULL_HANDLE;
+    if (!bytecode.data || vkCreateShaderModule(m_device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+        return VK_NULL_HANDLE;
+    }
+    return shaderModule;
+}
+
+bool RendererVK::CreatePipelineState(const GfxObject& object, const PipelineState& pipelineState) {
+    Pipeline pipeline;
+    pipeline.vertexModule = createShaderModule(pipelineState.vertexBytecode);
+    pipeline.fragmentModule = createShaderModule(pipelineState.fragmentBytecode);
+    if (!pipeline.vertexModule || !pipeline.fragmentModule) {
+        LOGE("Vulkan pipelines need SPIR-V in vertexBytecode and fragmentBytecode");
+        destroyPipeline(pipeline);
+        return false;
+    }
+
+    const VertexLayout standardLayout = VertexLayout::Standard();
+    const VkPipeline standardPipeline = createPipeline(pipeline, standardLayout);
+    if (!standardPipeline) {
+        destroyPipeline(pipeline);
+        return false;
+    }
+    pipeline.variants.emplace_back(standardLayout, standardPipeline);
+    m_pipelines.Insert(object, std::move(pipeline));
+    return true;
+}
+
+VkPipeline RendererVK::createPipeline(const Pipeline& pipeline, const VertexLayout& layout) const {
+    VkPipelineShaderStageCreateInfo stages[2] = {};
+    stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stages[0].module = pipeline.vertexModule;
+    stages[0].pName = "main";
+    stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    stages[1].module = pipeline.fragmentModule;
+    stages[1].pName = "main";
+
+    // Binding 0 per vertex, binding 1 per instance at locations 2 and 3 like the OpenGL backend
+    const VkVertexInputBindingDescription vertexBindings[2] = {
+        { 0, layout.stride, VK_VERTEX_INPUT_RATE_VERTEX },
+        { 1, s_INSTANCE_STRIDE, VK_VERTEX_INPUT_RATE_INSTANCE }
+    };
+    VkVertexInputAttributeDescription vertexAttributes[VertexLayout::s_MAX_ATTRIBUTES + 2];
+    for (uint32_t i = 0; i < layout.attributeCount; ++i) {
+        const VertexAttribute& attribute = layout.attributes[i];
+        vertexAttributes[i] = { attribute.location, 0, GetAttributeFormat(attribute.format), attribute.offset };
+    }
+    vertexAttributes[layout.attributeCount + 0] = { 2, 1, VK_FORMAT_R32G32B32A32_SFLOAT, 0 };
+    vertexAttributes[layout.attributeCount + 1] = { 3, 1, VK_FORMAT_R32G32B32A32_SFLOAT, sizeof(float) * 4 };
+    VkPipelineVertexInputStateCreateInfo vertexInput = {};
+    vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInput.vertexBindingDescriptionCount = 2;
+    vertexInput.pVertexBindingDescriptions = vertexBindings;
+    vertexInput.vertexAttributeDescriptionCount = layout.attributeCount + 2;
+    vertexInput.pVertexAttributeDescriptions = vertexAttributes;
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    // Viewport and scissor are dynamic so pipelines don't depend on the render target size
+    VkPipelineViewportStateCreateInfo viewportState = {};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+    const VkDynamicState dynamicStates[2] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamicState = {};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
+
+    VkPipelineRasterizationStateCreateInfo rasterization = {};
+    rasterization.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterization.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterization.cullMode = VK_CULL_MODE_NONE;
+    rasterization.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterization.lineWidth = 1.0f;
+
+    VkPipelineMultisampleStateCreateInfo multisample = {};
+    multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    // Same depth state as the OpenGL backend
+    VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = VK_TRUE;
+    depthStencil.depthWriteEnable = VK_TRUE;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+
+    VkPipelineColorBlendAttachmentState blendAttachment = {};
+    blendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    VkPipelineColorBlendStateCreateInfo colorBlend = {};
+    colorBlend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlend.attachmentCount = 1;
+    colorBlend.pAttachments = &blendAttachment;
+
+    VkGraphicsPipelineCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    createInfo.stageCount = 2;
+    createInfo.pStages = stages;
+    createInfo.pVertexInputState = &vertexInput;
+    createInfo.pInputAssemblyState = &inputAssembly;
+    createInfo.pViewportState = &viewportState;
+    createInfo.pRasterizationState = &rasterization;
+    createInfo.pMultisampleState = &multisample;
+    createInfo.pDepthStencilState = &depthStencil;
+    createInfo.pColorBlendState = &colorBlend;
+    createInfo.pDynamicState = &dynamicState;
+    createInfo.layout = m_pipelineLayout;
+    createInfo.renderPass = m_renderPass;
+    createInfo.subpass = 0;
+
+    VkPipeline result = VK_NULL_HANDLE;
+    if (vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &createInfo, nullptr, &result) != VK_SUCCESS) {
+        LOGE("Failed to create graphics pipeline");
+        return VK_NULL_HANDLE;
+    }
+    return result;
+}
+
+void RendererVK::destroyPipeline(Pipeline& pipeline) const {
+    for (auto& variant : pipeline.variants) {
+        vkDestroyPipeline(m_device, variant.second, nullptr);
+    }
+    pipeline.variants.clear();
+    vkDestroyShaderModule(m_device, pipeline.vertexModule, nullptr);
+    vkDestroyShaderModule(m_device, pipeline.fragmentModule, nullptr);
+    pipeline.vertexModule = VK_NULL_HANDLE;
+    pipeline.fragmentModule = VK_NULL_HANDLE;
+}
+
+void* RendererVK::MapConstantBuffer(const GfxObject& object) {
+    auto* constBuffer = m_constantBuffers.Find(object);
+    assert(constBuffer && "Failed to find requested constant buffer");
+    return constBuffer->shadow.data();
+}
+
+void RendererVK::UnmapConstantBuffer(const GfxObject& object) {
+    auto* constBuffer = m_constantBuffers.Find(object);
+    assert(constBuffer && "Failed to find requested constant buffer");
+    ++constBuffer->version;
+}
+
+void* RendererVK::MapVertexBuffer(const GfxObject& object) {
+    auto* vertexBuffer = m_vertexBuffers.Find(object);
+    assert(vertexBuffer && "Failed to find requested vertex buffer");
+    waitForFrame(vertexBuffer->buffer.lastFrame);
+    return vertexBuffer->buffer.mapped;
+}
+
+void RendererVK::UpdateVertexBuffer(const GfxObject& object, uint32_t offset, uint32_t size, const void* data, bool discard) {
+    auto* vertexBuffer = m_vertexBuffers.Find(object);
+    assert(vertexBuffer && "Failed to find requested vertex buffer");
+    if (discard && isFramePending(vertexBuffer->buffer.lastFrame)) {
+        Buffer* copy = std::min_element(std::begin(vertexBuffer->copies), std::end(vertexBuffer->copies), [](const Buffer& a, const Buffer& b) {
+            return a.lastFrame < b.lastFrame;
+        });
+        if (copy->buffer || createBuffer(vertexBuffer->size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, *copy)) {
+            std::swap(vertexBuffer->buffer, *copy);
+        } else {
+            LOGW("Failed to create a copy of a vertex buffer, the update waits for the GPU instead");
+        }
+    }
+    // After a swap this waits for an older frame, which the next Render waits for anyway to reuse its slot
+    waitForFrame(vertexBuffer->buffer.lastFrame);
+    std::memcpy(static_cast<uint8_t*>(vertexBuffer->buffer.mapped) + offset, data, size);
+}
+
+void RendererVK::DestroyVertexBuffer(const GfxObject& object) {
+    auto* vertexBuffer = m_vertexBuffers.Find(object);
+    if (vertexBuffer) {
+        vkDeviceWaitIdle(m_device);
+        destroyBuffer(vertexBuffer->buffer);
+        for (Buffer& copy : vertexBuffer->copies) {
+            destroyBuffer(copy);
+        }
+        m_vertexBuffers.Erase(object);
+    }
+}
+
+void* RendererVK::MapIndexBuffer(const GfxObject& object) {
+    auto* indexBuffer = m_indexBuffers.Find(object);
+    assert(indexBuffer && "Failed to find requested index buffer");
+    waitForFrame(indexBuffer->buffer.lastFrame);
+    return indexBuffer->buffer.mapped;
+}
+
+void RendererVK::DestroyIndexBuffer(const GfxObject& object) {
+    auto* indexBuffer = m_indexBuffers.Find(object);
+    if (indexBuffer) {
+        vkDeviceWaitIdle(m_device);
+        destroyBuffer(indexBuffer->buffer);
+        m_indexBuffers.Erase(object);
+    }
+}
+
+void RendererVK::DestroyConstantBuffer(const GfxObject& object) {
+    auto* constBuffer = m_constantBuffers.Find(object);
+    if (constBuffer) {
+        vkDeviceWaitIdle(m_device);
+        vkFreeDescriptorSets(m_device, m_descriptorPool, s_FRAMES_IN_FLIGHT, constBuffer->descriptorSets);
+        destroyBuffer(constBuffer->buffer);
+        m_constantBuffers.Erase(object);
+    }
+}
+
+void RendererVK::DestroyPipelineState(const GfxObject& object) {
+    auto* pipeline = m_pipelines.Find(object);
+    if (pipeline) {
+        vkDeviceWaitIdle(m_device);
+        destroyPipeline(*pipeline);
+        m_pipelines.Erase(object);
+    }
+}
+
+void RendererVK::Render(const CommandStream& commands) {
+    if (!m_isInitialized) {
+        return;
+    }
+
+    Frame& frame = m_frames[m_frameIndex % s_FRAMES_IN_FLIGHT];
+    if (frame.isPending) {
+        vkWaitForFences(m_device, 1, &frame.fence, VK_TRUE, UINT64_MAX);
+        frame.isPending = false;
+    }
+    vkResetFences(m_device, 1, &frame.fence);
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(frame.commandBuffer, &beginInfo);
+
+    VkClearValue clearValues[2];
+    clearValues[0].color = s_CLEAR_COLOR;
+    clearValues[1].depthStencil = { 1.0f, 0 };
+    VkRenderPassBeginInfo renderPassBeginInfo = {};
+    renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassBeginInfo.renderPass = m_renderPass;
+    renderPassBeginInfo.framebuffer = m_framebuffer;
+    renderPassBeginInfo.renderArea = { { 0, 0 }, { m_width, m_height } };
+    renderPassBeginInfo.clearValueCount = 2;
+    renderPassBeginInfo.pClearValues = clearValues;
+    vkCmdBeginRenderPass(frame.commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+    const VkViewport viewport = { 0.0f, 0.0f, static_cast<float>(m_width), static_cast<float>(m_height), 0.0f, 1.0f };
+    const VkRect2D scissor = { { 0, 0 }, { m_width, m_height } };
+    vkCmdSetViewport(frame.commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(frame.commandBuffer, 0, 1, &scissor);
+    m_boundPipelineState = nullptr;
+    m_boundVertexLayout = VertexLayout::Standard();
+    m_boundPipeline = VK_NULL_HANDLE;
+    m_boundInstanceBuffer = VK_NULL_HANDLE;
+
+    for (const CommandStream::Header* command = commands.Begin(); command != commands.End(); command = CommandStream::Next(command)) {
+        switch (command->type) {
+            case BIND_VERTEX_BUFFER:
+                bindVertexBuffer(CommandStream::Payload<BindVertexBufferCommand>(command));
+                break;
+            case BIND_PIPELINE_STATE:
+                bindPipelineState(CommandStream::Payload<BindPipelineStateCommand>(command));
+                break;
+            case BIND_CONSTANT_BUFFER:
+                bindConstantBuffer(CommandStream::Payload<BindConstantBufferCommand>(command));
+                break;
+            case BIND_INDEX_BUFFER:
+                bindIndexBuffer(CommandStream::Payload<BindIndexBufferCommand>(command));
+                break;
+            case DRAW:
+                draw(CommandStream::Payload<DrawCommand>(command));
+                break;
+            case DRAW_INSTANCED:
+                drawInstanced(CommandStream::Payload<DrawInstancedCommand>(command));
+                break;
+            case DRAW_INDEXED:
+                drawIndexed(CommandStream::Payload<DrawIndexedCommand>(command));
+                break;
+            case UPDATE_CONSTANT_BUFFER:
+            case UPDATE_VERTEX_BUFFER:
+                break; // Applied by RenderEngine before the frame
+            default:
+                std::cerr << "Unsupported rendering command!" << std::endl;
+        }
+    }
+
+    vkCmdEndRenderPass(frame.commandBuffer);
+    vkEndCommandBuffer(frame.commandBuffer);
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &frame.commandBuffer;
+    if (vkQueueSubmit(m_queue, 1, &submitInfo, frame.fence) != VK_SUCCESS) {
+        LOGE("Failed to submit frame");
+    } else {
+        frame.isPending = true;
+    }
+    ++m_frameIndex;
+}
+
+bool RendererVK::ReadColorBuffer(std::vector<uint32_t>& pixels, uint32_t& width, uint32_t& height) {
+    if (!m_isInitialized || m_frameIndex == 0) {
+        return false;
+    }
+
+    Buffer readback;
+    if (!createBuffer(static_cast<VkDeviceSize>(m_width) * m_height * sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_DST_BIT, readback)) {
+        LOGE("Failed to create the readback buffer");
+        return false;
+    }
+
+    VkCommandBufferAllocateInfo allocateInfo = {};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocateInfo.commandPool = m_commandPool;
+    allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocateInfo.commandBufferCount = 1;
+    VkFenceCreateInfo fenceCreateInfo = {};
+    fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    VkFence fence = VK_NULL_HANDLE;
+    bool result = vkAllocateCommandBuffers(m_device, &allocateInfo, &commandBuffer) == VK_SUCCESS
+                  && vkCreateFence(m_device, &fenceCreateInfo, nullptr, &fence) == VK_SUCCESS;
+
+    if (result) {
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+        // The render pass of the last frame left the color image in TRANSFER_SRC_OPTIMAL, the copy waits for its writes
+        VkImageMemoryBarrier imageBarrier = {};
+        imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        imageBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.image = m_images[0];
+        imageBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                             0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+        VkBufferImageCopy region = {};
+        region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        region.imageExtent = { m_width, m_height, 1 };
+        vkCmdCopyImageToBuffer(commandBuffer, m_images[0], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback.buffer, 1, &region);
+
+        VkMemoryBarrier hostBarrier = {};
+        hostBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &hostBarrier, 0, nullptr, 0, nullptr);
+        vkEndCommandBuffer(commandBuffer);
+
+        // Submitted after the last frame, so the copy sees it finished
+        VkSubmitInfo submitInfo = {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+        result = vkQueueSubmit(m_queue, 1, &submitInfo, fence) == VK_SUCCESS
+                 && vkWaitForFences(m_device, 1, &fence, VK_TRUE, UINT64_MAX) == VK_SUCCESS;
+    }
+
+    if (result) {
+        pixels.resize(static_cast<size_t>(m_width) * m_height);
+        std::memcpy(pixels.data(), readback.mapped, pixels.size() * sizeof(uint32_t));
+        width = m_width;
+        height = m_height;
+    } else {
+        LOGE("Failed to read back the color buffer");
+    }
+
+    vkDestroyFence(m_device, fence, nullptr);
+    if (commandBuffer) {
+        vkFreeCommandBuffers(m_device, m_commandPool, 1, &commandBuffer);
+    }
+    destroyBuffer(readback);
+    return result;
+}
+
+void RendererVK::bindPipelineState(const BindPipelineStateCommand& data) {
+    auto* pipeline = m_pipelines.Find(data.object);
+    assert(pipeline && "Failed to find requested pipeline state");
+    m_boundPipelineState = pipeline;
+}
+
+void RendererVK::bindConstantBuffer(const BindConstantBufferCommand& data) {
+    auto* constBuffer = m_constantBuffers.Find(data.object);
+    assert(constBuffer && "Failed to find requested constant buffer");
+    ConstantBuffer& constantBuffer = *constBuffer;
+
+    // This frame's slice is no longer read by the GPU since we waited for its fence
+    const uint32_t frameSlot = m_frameIndex % s_FRAMES_IN_FLIGHT;
+    if (constantBuffer.sliceVersions[frameSlot] != constantBuffer.version) {
+        uint8_t* slice = static_cast<uint8_t*>(constantBuffer.buffer.mapped) + constantBuffer.sliceSize * frameSlot;
+        std::memcpy(slice, constantBuffer.shadow.data(), constantBuffer.shadow.size());
+        constantBuffer.sliceVersions[frameSlot] = constantBuffer.version;
+    }
+
+    vkCmdBindDescriptorSets(m_frames[frameSlot].commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout,
+                            0, 1, &constantBuffer.descriptorSets[frameSlot], 0, nullptr);
+}
+
+void RendererVK::bindVertexBuffer(const BindVertexBufferCommand& data) {
+    auto* vertexBuffer = m_vertexBuffers.Find(data.object);
+    assert(vertexBuffer && "Failed to find requested vertex buffer");
+    vertexBuffer->buffer.lastFrame = m_frameIndex + 1;
+    const VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(m_frames[m_frameIndex % s_FRAMES_IN_FLIGHT].commandBuffer, 0, 1, &vertexBuffer->buffer.buffer, &offset);
+    m_boundVertexLayout = vertexBuffer->layout;
+}
+
+void RendererVK::bindIndexBuffer(const BindIndexBufferCommand& data) {
+    auto* indexBuffer = m_indexBuffers.Find(data.object);
+    assert(indexBuffer && "Failed to find requested index buffer");
+    indexBuffer->buffer.lastFrame = m_frameIndex + 1;
+    vkCmdBindIndexBuffer(m_frames[m_frameIndex % s_FRAMES_IN_FLIGHT].commandBuffer, indexBuffer->buffer.buffer, 0, indexBuffer->type);
+}
+
+void RendererVK::draw(const DrawCommand& data) {
+    if (!flushPipeline()) {
+        LOGW("Skipping draw without a bound pipeline state");
+        return;
+    }
+    bindInstanceBuffer(m_defaultInstanceBuffer.buffer);
+    vkCmdDraw(m_frames[m_frameIndex % s_FRAMES_IN_FLIGHT].commandBuffer, data.count, 1, data.startVertex, 0);
+}
+
+void RendererVK::drawInstanced(const DrawInstancedCommand& data) {
+    auto* instanceBuffer = m_vertexBuffers.Find(data.instanceBuffer);
+    if (!instanceBuffer || !flushPipeline()) {
+        LOGW("Skipping instanced draw without a bound pipeline state or a valid instance buffer");
+        return;
+    }
+    instanceBuffer->buffer.lastFrame = m_frameIndex + 1;
+    bindInstanceBuffer(instanceBuffer->buffer.buffer);
+    vkCmdDraw(m_frames[m_frameIndex % s_FRAMES_IN_FLIGHT].commandBuffer, data.count, data.instanceCount, data.startVertex, data.startInstance);
+}
+
+void RendererVK::drawIndexed(const DrawIndexedCommand& data) {
+    if (!flushPipeline()) {
+        LOGW("Skipping indexed draw without a bound pipeline state");
+        return;
+    }
+    bindInstanceBuffer(m_defaultInstanceBuffer.buffer);
+    vkCmdDrawIndexed(m_frames[m_frameIndex % s_FRAMES_IN_FLIGHT].commandBuffer, data.count, 1, data.startIndex, data.baseVertex, 0);
+}
+
+bool RendererVK::flushPipeline() {
+    if (!m_boundPipelineState) {
+        return false;
+    }
+
+    Pipeline& pipelineState = *m_boundPipelineState;
+    auto variant = std::find_if(pipelineState.variants.begin(), pipelineState.variants.end(), [this](const std::pair<VertexLayout, VkPipeline>& candidate) {
+        return candidate.first == m_boundVertexLayout;
+    });
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (variant != pipelineState.variants.end()) {
+        pipeline = variant->second;
+    } else {
+        LOGD("Creating pipeline variant for a vertex layout with stride " + std::to_string(m_boundVertexLayout.stride));
+        pipeline = createPipeline(pipelineState, m_boundVertexLayout);
+        if (!pipeline) {
+            return false;
+        }
+        pipelineState.variants.emplace_back(m_boundVertexLayout, pipeline);
+    }
+
+    if (pipeline != m_boundPipeline) {
+        vkCmdBindPipeline(m_frames[m_frameIndex % s_FRAMES_IN_FLIGHT].commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+        m_boundPipeline = pipeline;
+    }
+    return true;
+}
+
+void RendererVK::bindInstanceBuffer(VkBuffer buffer) {
+    if (m_boundInstanceBuffer == buffer) {
+        return;
+    }
+    const VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(m_frames[m_frameIndex % s_FRAMES_IN_FLIGHT].commandBuffer, 1, 1, &buffer, &offset);
+    m_boundInstanceBuffer = buffer;
+}
+
+}  // namespace dw
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "irenderer.h"
+#include "commandstream.h"
+#include "utils/handlepool.h"
+#include "direwolf/vulkan/vulkancommons.h"
+#include <utility>
+#include <vector>
+
+namespace dw {
+
+struct PlatformData;
+struct InitData;
+
+// Vulkan backend built on the vulkansetup layer. Renders offscreen into a color and depth image so it
+// runs headless (lavapipe included). Pipelines are created from the SPIR-V in PipelineState's bytecode,
+// all of them share one layout with the constant buffer at set 0, binding 0. The vertex input is baked
+// into Vulkan pipelines, so every vertex layout a pipeline state is drawn with gets its own pipeline.
+class RendererVK final : public IRenderer {
+public:
+    virtual ~RendererVK() override;
+
+    virtual bool Initialize(const RendererCaps& /*caps*/, const PlatformData& data) override;
+
+    virtual bool CreateConstantBuffer(const GfxObject& object, uint32_t size) override;
+    virtual bool CreateVertexBuffer(const GfxObject& object, uint32_t count, const VertexLayout& layout) override;
+    virtual bool CreateIndexBuffer(const GfxObject& object, uint32_t count, IndexFormat format) override;
+    virtual bool CreatePipelineState(const GfxObject& object, const PipelineState& state) override;
+    virtual bool CreateSamplerState(const GfxObject& /*object*/, const SamplerDescription& /*description*/) override { return false; }
+    virtual bool CreateTexture(const GfxObject& /*object*/, const TextureDescription& /*description*/, const std::vector<void*>& /*data*/) override { return false; }
+
+    virtual void* MapConstantBuffer(const GfxObject& handle) override;
+    virtual void* MapVertexBuffer(const GfxObject& handle) override;
+    virtual void* MapIndexBuffer(const GfxObject& handle) override;
+    virtual void UnmapVertexBuffer(const GfxObject& /*handle*/) override {};
+    virtual void UnmapIndexBuffer(const GfxObject& /*handle*/) override {};
+    virtual void UnmapConstantBuffer(const GfxObject& handle) override;
+    /* Discard updates of a buffer a queued frame still reads go to a copy of it instead of waiting for the frame */
+    virtual void UpdateVertexBuffer(const GfxObject& handle, uint32_t offset, uint32_t size, const void* data, bool discard) override;
+
+    virtual void DestroyConstantBuffer(const GfxObject& handle) override;
+    virtual void DestroyVertexBuffer(const GfxObject& handle) override;
+    virtual void DestroyIndexBuffer(const GfxObject& handle) override;
+    virtual void DestroyTexture(const GfxObject& /*handle*/) override {};
+    virtual void DestroyPipelineState(const GfxObject& handle) override;
+    virtual void DestroySamplerState(const GfxObject& /*handle*/) override {};
+
+    // Actual rendering commands that operate on updated and ready resources.
+    virtual void Render(const CommandStream& commands) override;
+    /* Copies the color image to the host and waits for it, meant for tests and screenshots rather than every frame */
+    virtual bool ReadColorBuffer(std::vector<uint32_t>& pixels, uint32_t& width, uint32_t& height) override;
+
+private:
+    static const uint32_t s_FRAMES_IN_FLIGHT = 2;
+
+    struct Buffer {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        void* mapped = nullptr;
+        uint64_t lastFrame = 0; // Number of the last frame reading the buffer, counting from 1
+    };
+
+    // The GPU may still read the previous frame, so each frame in flight gets its own copy of the
+    // constants. Map hands out a CPU shadow which is copied to the frame's slice when it's bound.
+    struct ConstantBuffer {
+        Buffer buffer;
+        VkDeviceSize sliceSize = 0;
+        VkDescriptorSet descriptorSets[s_FRAMES_IN_FLIGHT] = {};
+        uint64_t sliceVersions[s_FRAMES_IN_FLIGHT] = {};
+        uint64_t version = 1;
+        std::vector<uint8_t> shadow;
+    };
+
+    // A discard update of a buffer that frames in flight still read swaps in the copy the oldest of them used,
+    // data rewritten every frame ends up cycling through one copy per frame. Copies are created on first use
+    struct VertexBuffer {
+        Buffer buffer;
+        Buffer copies[s_FRAMES_IN_FLIGHT - 1];
+        VkDeviceSize size = 0;
+        VertexLayout layout;
+    };
+
+    // Shader modules are kept to create the pipelines of vertex layouts seen later, the standard layout is
+    // created up front
+    struct Pipeline {
+        VkShaderModule vertexModule = VK_NULL_HANDLE;
+        VkShaderModule fragmentModule = VK_NULL_HANDLE;
+        std::vector<std::pair<VertexLayout, VkPipeline>> variants;
+    };
+
+    struct IndexBuffer {
+        Buffer buffer;
+        VkIndexType type = VK_INDEX_TYPE_UINT16;
+    };
+
+    struct Frame {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        bool isPending = false; // Submitted and not waited for yet, a failed submit never signals the fence
+    };
+
+    bool createDevice();
+    bool createRenderTarget();
+    bool createSharedObjects();
+    bool createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, Buffer& outBuffer) const;
+    void destroyBuffer(Buffer& buffer) const;
+    /* Whether the frame numbered frameNumber, counting from 1, may still be running on the GPU */
+    bool isFramePending(uint64_t frameNumber) const;
+    /* Blocks until the GPU is done with the frame numbered frameNumber */
+    void waitForFrame(uint64_t frameNumber);
+    bool findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties, uint32_t& outIndex) const;
+    VkShaderModule createShaderModule(const ShaderBytecode& bytecode) const;
+    VkPipeline createPipeline(const Pipeline& pipeline, const VertexLayout& layout) const;
+    void destroyPipeline(Pipeline& pipeline) const;
+    /* Binds the variant of the bound pipeline state for the bound vertex layout, false without a pipeline state */
+    bool flushPipeline();
+
+    void bindConstantBuffer(const BindConstantBufferCommand& data);
+    void bindVertexBuffer(const BindVertexBufferCommand& data);
+    void bindIndexBuffer(const BindIndexBufferCommand& data);
+    void bindPipelineState(const BindPipelineStateCommand& data);
+    void draw(const DrawCommand& data);
+    void drawInstanced(const DrawInstancedCommand& data);
+    void drawIndexed(const DrawIndexedCommand& data);
+    void bindInstanceBuffer(VkBuffer buffer);
+
+    vulkan::VulkanRTLPtr m_vulkanRTL = nullptr;
+    VkInstance m_instance = VK_NULL_HANDLE;
+    VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkQueue m_queue = VK_NULL_HANDLE;
+    uint32_t m_queueFamilyIndex = 0;
+    VkPhysicalDeviceMemoryProperties m_memoryProperties = {};
+    VkDeviceSize m_uniformAlignment = 256;
+
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    VkImage m_images[2] = {};             // Color, depth
+    VkDeviceMemory m_imageMemory[2] = {};
+    VkImageView m_imageViews[2] = {};
+    VkRenderPass m_renderPass = VK_NULL_HANDLE;
+    VkFramebuffer m_framebuffer = VK_NULL_HANDLE;
+
+    VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    VkCommandPool m_commandPool = VK_NULL_HANDLE;
+    Frame m_frames[s_FRAMES_IN_FLIGHT];
+    uint64_t m_frameIndex = 0;
+    bool m_isInitialized = false;
+
+    HandleArray<VertexBuffer> m_vertexBuffers;
+    HandleArray<IndexBuffer> m_indexBuffers;
+    HandleArray<ConstantBuffer> m_constantBuffers;
+    HandleArray<Pipeline> m_pipelines;
+    Pipeline* m_boundPipelineState = nullptr;
+    VertexLayout m_boundVertexLayout;
+    VkPipeline m_boundPipeline = VK_NULL_HANDLE;
+
+    // Every pipeline reads per instance data from binding 1, draws without instance data read this single
+    // default instance
+    Buffer m_defaultInstanceBuffer;
+    VkBuffer m_boundInstanceBuffer = VK_NULL_HANDLE;
+};
+
+}  // namespace dw
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+
+// Expectations for the test executables. A failed CHECK prints where it failed and the test keeps going,
+// main returns GetResult() so ctest marks the run as failed
+namespace dw {
+namespace test {
+    inline uint32_t& GetFailureCount() {
+        static uint32_t count = 0;
+        return count;
+    }
+
+    inline int GetResult() {
+        return GetFailureCount() == 0 ? 0 : 1;
+    }
+}
+}
+
+#define CHECK(CONDITION)                                                                      \
+    do {                                                                                      \
+        if (!(CONDITION)) {                                                                   \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #CONDITION ") failed\n";  \
+            ++dw::test::GetFailureCount();                                                    \
+        }                                                                                     \
+    } while (false)
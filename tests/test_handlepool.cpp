@@ -0,0 +1,110 @@
+#include "check.h"
+#include "utils/handlepool.h"
+
+#include <string>
+
+// Generations of HandleAllocator and the stale handle checks of HandleArray
+namespace {
+    void TestAllocatorGenerations() {
+        dw::HandleAllocator allocator;
+        const dw::GfxObject first = allocator.Allocate();
+        const dw::GfxObject second = allocator.Allocate();
+        CHECK(first.IsValid() && second.IsValid());
+        CHECK(dw::handle::GetIndex(first) == 0 && dw::handle::GetIndex(second) == 1);
+        CHECK(dw::handle::GetGeneration(first) == 1);
+        CHECK(allocator.IsAlive(first) && allocator.IsAlive(second));
+
+        // The freed index comes back with the next generation, the old handle stays dead
+        CHECK(allocator.Free(first));
+        CHECK(!allocator.IsAlive(first));
+        CHECK(!allocator.Free(first));
+        const dw::GfxObject reused = allocator.Allocate();
+        CHECK(dw::handle::GetIndex(reused) == 0);
+        CHECK(dw::handle::GetGeneration(reused) == 2);
+        CHECK(reused != first);
+        CHECK(allocator.IsAlive(reused) && !allocator.IsAlive(first));
+
+        CHECK(!allocator.IsAlive(dw::GfxObject()));
+        CHECK(!allocator.IsAlive(dw::handle::Make(7, 1)));
+    }
+
+    // Freed indices are reused last in, first out
+    void TestAllocatorReuseOrder() {
+        dw::HandleAllocator allocator;
+        dw::GfxObject handles[3];
+        for (dw::GfxObject& handle : handles) {
+            handle = allocator.Allocate();
+        }
+        allocator.Free(handles[0]);
+        allocator.Free(handles[2]);
+        CHECK(dw::handle::GetIndex(allocator.Allocate()) == 2);
+        CHECK(dw::handle::GetIndex(allocator.Allocate()) == 0);
+        CHECK(dw::handle::GetIndex(allocator.Allocate()) == 3);
+    }
+
+    // The generation wraps around without ever reaching 0, which would make the handle invalid
+    void TestAllocatorGenerationWraps() {
+        dw::HandleAllocator allocator;
+        dw::GfxObject handle = allocator.Allocate();
+        for (uint32_t i = 0; i < dw::handle::s_GENERATION_MASK; ++i) {
+            CHECK(allocator.Free(handle));
+            handle = allocator.Allocate();
+            CHECK(handle.IsValid());
+            CHECK(dw::handle::GetGeneration(handle) != 0);
+        }
+        CHECK(dw::handle::GetGeneration(handle) == 1);
+    }
+
+    void TestArrayRejectsStaleHandles() {
+        dw::HandleAllocator allocator;
+        dw::HandleArray<std::string> values;
+        const dw::GfxObject first = allocator.Allocate();
+        values.Insert(first, "first");
+        CHECK(values.Find(first) && *values.Find(first) == "first");
+
+        CHECK(values.Erase(first));
+        CHECK(!values.Erase(first));
+        CHECK(values.Find(first) == nullptr);
+        allocator.Free(first);
+
+        // Same slot, next generation
+        const dw::GfxObject reused = allocator.Allocate();
+        values.Insert(reused, "reused");
+        CHECK(values.Find(first) == nullptr);
+        CHECK(!values.Erase(first));
+        CHECK(values.Find(reused) && *values.Find(reused) == "reused");
+
+        CHECK(values.Find(dw::GfxObject()) == nullptr);
+        CHECK(values.Find(dw::handle::Make(100, 1)) == nullptr);
+        const dw::HandleArray<std::string>& constValues = values;
+        CHECK(constValues.Find(reused) != nullptr);
+    }
+
+    void TestArrayForEach() {
+        dw::HandleAllocator allocator;
+        dw::HandleArray<uint32_t> values;
+        dw::GfxObject handles[4];
+        for (uint32_t i = 0; i < 4; ++i) {
+            handles[i] = allocator.Allocate();
+            values.Insert(handles[i], i + 1);
+        }
+        values.Erase(handles[1]);
+        uint32_t sum = 0;
+        uint32_t count = 0;
+        values.ForEach([&](uint32_t value) {
+            sum += value;
+            ++count;
+        });
+        CHECK(count == 3);
+        CHECK(sum == 1 + 3 + 4);
+    }
+}
+
+int main() {
+    TestAllocatorGenerations();
+    TestAllocatorReuseOrder();
+    TestAllocatorGenerationWraps();
+    TestArrayRejectsStaleHandles();
+    TestArrayForEach();
+    return dw::test::GetResult();
+}
@@ -0,0 +1,172 @@
+#include "check.h"
+#include "utils/logger.h"
+#include "utils/ktxfile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Writes KTX2 files to the working directory and checks what KtxFile reads back from them
+namespace {
+    const std::string s_PATH = "ktxfile_test.ktx2";
+    const uint8_t s_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+    const uint32_t s_VK_FORMAT_BC1_RGB_UNORM = 133;
+    const uint32_t s_VK_FORMAT_R8G8B8A8_UNORM = 37;
+
+    struct Header {
+        uint32_t vkFormat = s_VK_FORMAT_BC1_RGB_UNORM;
+        uint32_t width = 16;
+        uint32_t height = 8;
+        uint32_t depth = 0;
+        uint32_t layers = 2;
+        uint32_t faces = 1;
+        uint32_t levels = 3;
+        uint32_t supercompression = 0;
+    };
+
+    template <typename T>
+    void Write(std::vector<uint8_t>& file, size_t offset, T value) {
+        if (file.size() < offset + sizeof(T)) {
+            file.resize(offset + sizeof(T));
+        }
+        std::memcpy(file.data() + offset, &value, sizeof(T));
+    }
+
+    // Identifier, header and level index, followed by the levels smallest first like the tools write them.
+    // Every byte of a level holds its level and layer as level * 16 + layer
+    std::vector<uint8_t> MakeFile(const Header& header) {
+        std::vector<uint8_t> file(80, 0);
+        std::memcpy(file.data(), s_IDENTIFIER, sizeof(s_IDENTIFIER));
+        Write(file, 12, header.vkFormat);
+        Write(file, 16, uint32_t(1));
+        Write(file, 20, header.width);
+        Write(file, 24, header.height);
+        Write(file, 28, header.depth);
+        Write(file, 32, header.layers);
+        Write(file, 36, header.faces);
+        Write(file, 40, header.levels);
+        Write(file, 44, header.supercompression);
+
+        dw::TextureDescription description;
+        description.width = header.width;
+        description.height = header.height;
+        description.format = header.vkFormat == s_VK_FORMAT_R8G8B8A8_UNORM ? dw::TEXTURE_FORMAT_RGBA8 : dw::TEXTURE_FORMAT_BC1;
+        const uint32_t levels = header.levels > 0 ? header.levels : 1;
+        const uint32_t layers = header.layers > 0 ? header.layers : 1;
+        size_t offset = 80 + levels * 24;
+        for (uint32_t level = levels; level-- > 0;) {
+            const size_t levelSize = description.GetLevelSize(level);
+            Write(file, 80 + level * 24, uint64_t(offset));
+            Write(file, 80 + level * 24 + 8, uint64_t(levelSize * layers));
+            Write(file, 80 + level * 24 + 16, uint64_t(levelSize * layers));
+            file.resize(offset + levelSize * layers);
+            for (uint32_t layer = 0; layer < layers; ++layer) {
+                std::memset(file.data() + offset + layer * levelSize, static_cast<int>(level * 16 + layer), levelSize);
+            }
+            offset += levelSize * layers;
+        }
+        return file;
+    }
+
+    bool Open(dw::KtxFile& ktx, const std::vector<uint8_t>& file) {
+        {
+            std::ofstream out(s_PATH, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+        }
+        return ktx.Open(s_PATH);
+    }
+
+    void TestReadsLevels() {
+        const std::vector<uint8_t> file = MakeFile(Header());
+        dw::KtxFile ktx;
+        CHECK(Open(ktx, file));
+        const dw::TextureDescription& description = ktx.GetDescription();
+        CHECK(description.width == 16 && description.height == 8);
+        CHECK(description.layers == 2);
+        CHECK(description.mipLevels == 3);
+        CHECK(description.format == dw::TEXTURE_FORMAT_BC1);
+
+        // Smallest level first in the file, 8 bytes per layer at 4x2, then 16 at 8x4 and 64 at 16x8
+        const std::vector<size_t> offsets = { 80 + 3 * 24 + 16 + 32, 80 + 3 * 24 + 16, 80 + 3 * 24 };
+        CHECK(ktx.GetLevelOffsets() == offsets);
+
+        // All levels of the first layer, then of the second
+        const std::vector<void*>& data = ktx.GetData();
+        CHECK(data.size() == 6);
+        for (uint32_t layer = 0; layer < 2 && data.size() == 6; ++layer) {
+            for (uint32_t level = 0; level < 3; ++level) {
+                const uint8_t* texels = static_cast<const uint8_t*>(data[layer * 3 + level]);
+                const size_t levelSize = description.GetLevelSize(level);
+                CHECK(texels[0] == level * 16 + layer && texels[levelSize - 1] == level * 16 + layer);
+            }
+        }
+
+        ktx.Close();
+        CHECK(ktx.GetData().empty() && ktx.GetDescription().width == 0);
+    }
+
+    // No levels asks for them to be generated, no layers is a plain 2D texture
+    void TestDefaults() {
+        Header header;
+        header.vkFormat = s_VK_FORMAT_R8G8B8A8_UNORM;
+        header.layers = 0;
+        header.levels = 0;
+        dw::KtxFile ktx;
+        CHECK(Open(ktx, MakeFile(header)));
+        CHECK(ktx.GetDescription().format == dw::TEXTURE_FORMAT_RGBA8);
+        CHECK(ktx.GetDescription().layers == 1 && ktx.GetDescription().mipLevels == 1);
+        CHECK(ktx.GetData().size() == 1);
+    }
+
+    void TestRejectsInvalidFiles() {
+        dw::KtxFile ktx;
+        CHECK(!ktx.Open("ktxfile_missing.ktx2"));
+
+        std::vector<uint8_t> file = MakeFile(Header());
+        file[5] = '1';
+        CHECK(!Open(ktx, file));
+        CHECK(!Open(ktx, std::vector<uint8_t>(file.begin(), file.begin() + 40)));
+
+        Header header;
+        header.vkFormat = 999;
+        CHECK(!Open(ktx, MakeFile(header)));
+        header = Header();
+        header.faces = 6;
+        CHECK(!Open(ktx, MakeFile(header)));
+        header = Header();
+        header.supercompression = 1;
+        CHECK(!Open(ktx, MakeFile(header)));
+        header = Header();
+        header.depth = 4;
+        CHECK(!Open(ktx, MakeFile(header)));
+
+        // 16x8 has 5 levels
+        header = Header();
+        header.levels = 6;
+        CHECK(!Open(ktx, MakeFile(header)));
+
+        // A level of the wrong size, and a level running past the end of the file
+        file = MakeFile(Header());
+        Write(file, 80 + 8, uint64_t(63 * 2));
+        CHECK(!Open(ktx, file));
+        file = MakeFile(Header());
+        file.resize(file.size() - 1);
+        CHECK(!Open(ktx, file));
+        CHECK(ktx.GetData().empty());
+
+        CHECK(Open(ktx, MakeFile(Header())));
+    }
+}
+
+int main() {
+    // The failures are logged as errors
+    dw::Logger::Init(dw::Logger::ERR, "");
+    TestReadsLevels();
+    TestDefaults();
+    TestRejectsInvalidFiles();
+    std::remove(s_PATH.c_str());
+    dw::Logger::Destroy();
+    return dw::test::GetResult();
+}
@@ -0,0 +1,179 @@
+#include "check.h"
+#include "utils/meshoptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Runs the mesh optimizer passes over a shuffled grid and a closed box, checking every pass keeps the
+// triangles and the cache and fetch orders improve
+namespace {
+    const uint32_t s_GRID_SIZE = 48; // Vertices per side
+
+    struct Vertex {
+        float position[3];
+        float uv[2];
+    };
+
+    bool operator==(const Vertex& a, const Vertex& b) {
+        return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+    }
+
+    std::vector<Vertex> MakeGridVertices() {
+        std::vector<Vertex> vertices;
+        for (uint32_t y = 0; y < s_GRID_SIZE; ++y) {
+            for (uint32_t x = 0; x < s_GRID_SIZE; ++x) {
+                const float u = static_cast<float>(x) / (s_GRID_SIZE - 1), v = static_cast<float>(y) / (s_GRID_SIZE - 1);
+                vertices.push_back({ { u, v, 0.0f }, { u, v } });
+            }
+        }
+        return vertices;
+    }
+
+    // Two triangles per quad, in random order so the cache gets almost no reuse
+    template <typename Index>
+    std::vector<Index> MakeShuffledGridIndices() {
+        std::vector<std::array<Index, 3>> triangles;
+        for (uint32_t y = 0; y + 1 < s_GRID_SIZE; ++y) {
+            for (uint32_t x = 0; x + 1 < s_GRID_SIZE; ++x) {
+                const Index corner = static_cast<Index>(y * s_GRID_SIZE + x);
+                triangles.push_back({ corner, static_cast<Index>(corner + 1), static_cast<Index>(corner + s_GRID_SIZE) });
+                triangles.push_back({ static_cast<Index>(corner + 1), static_cast<Index>(corner + s_GRID_SIZE + 1), static_cast<Index>(corner + s_GRID_SIZE) });
+            }
+        }
+        std::mt19937 random(3);
+        std::shuffle(triangles.begin(), triangles.end(), random);
+        std::vector<Index> indices;
+        for (const std::array<Index, 3>& triangle : triangles) {
+            indices.insert(indices.end(), triangle.begin(), triangle.end());
+        }
+        return indices;
+    }
+
+    // The triangles as a sorted list, with their corners in the order they were given
+    template <typename Index>
+    std::vector<std::array<Index, 3>> GetTriangles(const std::vector<Index>& indices) {
+        std::vector<std::array<Index, 3>> triangles;
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            triangles.push_back({ indices[i], indices[i + 1], indices[i + 2] });
+        }
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    }
+
+    template <typename Index>
+    void TestGenerateIndexBuffer() {
+        // Every triangle with its own copy of the vertices, as a triangle list without indices comes in
+        const std::vector<Vertex> gridVertices = MakeGridVertices();
+        const std::vector<Index> gridIndices = MakeShuffledGridIndices<Index>();
+        std::vector<Vertex> unindexed;
+        for (Index index : gridIndices) {
+            unindexed.push_back(gridVertices[index]);
+        }
+
+        const uint32_t count = static_cast<uint32_t>(unindexed.size());
+        std::vector<Index> indices(count);
+        std::vector<Vertex> vertices(count);
+        const uint32_t uniqueCount = dw::mesh::GenerateIndexBuffer(indices.data(), vertices.data(), unindexed.data(), count, sizeof(Vertex));
+        CHECK(uniqueCount == s_GRID_SIZE * s_GRID_SIZE);
+        for (uint32_t i = 0; i < count; ++i) {
+            CHECK(indices[i] < uniqueCount);
+            CHECK(indices[i] < uniqueCount && vertices[indices[i]] == unindexed[i]);
+        }
+    }
+
+    template <typename Index>
+    void TestOptimizeVertexCache() {
+        const std::vector<Index> shuffled = MakeShuffledGridIndices<Index>();
+        const uint32_t indexCount = static_cast<uint32_t>(shuffled.size());
+        const uint32_t vertexCount = s_GRID_SIZE * s_GRID_SIZE;
+        std::vector<Index> optimized(indexCount);
+        dw::mesh::OptimizeVertexCache(optimized.data(), shuffled.data(), indexCount, vertexCount);
+        CHECK(GetTriangles(optimized) == GetTriangles(shuffled));
+
+        // A regular grid can't do better than 0.5, a good order gets well under 1 with a 16 entry cache
+        const float before = dw::mesh::ComputeACMR(shuffled.data(), indexCount, vertexCount);
+        const float after = dw::mesh::ComputeACMR(optimized.data(), indexCount, vertexCount);
+        CHECK(before > 2.0f);
+        CHECK(after >= 0.5f);
+        CHECK(after < 0.8f);
+
+        // Running in place gives the same order
+        std::vector<Index> inPlace = shuffled;
+        dw::mesh::OptimizeVertexCache(inPlace.data(), inPlace.data(), indexCount, vertexCount);
+        CHECK(inPlace == optimized);
+    }
+
+    // Reordering the clusters of the grid and of a closed box has to keep every triangle as it is
+    void TestOptimizeOverdraw() {
+        const std::vector<Vertex> vertices = MakeGridVertices();
+        const std::vector<uint32_t> shuffled = MakeShuffledGridIndices<uint32_t>();
+        const uint32_t indexCount = static_cast<uint32_t>(shuffled.size());
+        const uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+        std::vector<uint32_t> cacheOptimized(indexCount);
+        dw::mesh::OptimizeVertexCache(cacheOptimized.data(), shuffled.data(), indexCount, vertexCount);
+        std::vector<uint32_t> optimized(indexCount);
+        dw::mesh::OptimizeOverdraw(optimized.data(), cacheOptimized.data(), indexCount, vertices.data(), vertexCount, sizeof(Vertex));
+        CHECK(GetTriangles(optimized) == GetTriangles(shuffled));
+        // Clusters start where the cache does, reordering them costs little reuse
+        const float cacheAcmr = dw::mesh::ComputeACMR(cacheOptimized.data(), indexCount, vertexCount);
+        CHECK(dw::mesh::ComputeACMR(optimized.data(), indexCount, vertexCount) < cacheAcmr * 1.1f);
+
+        const float box[8][3] = { { 0, 0, 0 }, { 1, 0, 0 }, { 1, 1, 0 }, { 0, 1, 0 }, { 0, 0, 1 }, { 1, 0, 1 }, { 1, 1, 1 }, { 0, 1, 1 } };
+        const uint16_t boxIndices[36] = {
+            0, 2, 1, 0, 3, 2, 4, 5, 6, 4, 6, 7, 0, 1, 5, 0, 5, 4, 3, 6, 2, 3, 7, 6, 0, 4, 7, 0, 7, 3, 1, 2, 6, 1, 6, 5
+        };
+        uint16_t boxOptimized[36];
+        dw::mesh::OptimizeOverdraw(boxOptimized, boxIndices, 36, box, 8, sizeof(box[0]));
+        CHECK(GetTriangles(std::vector<uint16_t>(boxOptimized, boxOptimized + 36)) == GetTriangles(std::vector<uint16_t>(boxIndices, boxIndices + 36)));
+    }
+
+    template <typename Index>
+    void TestOptimizeVertexFetch() {
+        // One extra vertex no triangle uses, it has to be dropped
+        std::vector<Vertex> vertices = MakeGridVertices();
+        vertices.push_back({ { 9.0f, 9.0f, 9.0f }, { 9.0f, 9.0f } });
+        const std::vector<Index> original = MakeShuffledGridIndices<Index>();
+        std::vector<Index> indices = original;
+        std::vector<Vertex> fetched(vertices.size());
+        const uint32_t count = dw::mesh::OptimizeVertexFetch(fetched.data(), indices.data(), static_cast<uint32_t>(indices.size()),
+                                                             vertices.data(), static_cast<uint32_t>(vertices.size()), sizeof(Vertex));
+        CHECK(count == s_GRID_SIZE * s_GRID_SIZE);
+
+        // Vertices are numbered in the order the index buffer first uses them
+        uint32_t nextNew = 0;
+        for (size_t i = 0; i < indices.size(); ++i) {
+            CHECK(indices[i] <= nextNew);
+            if (indices[i] == nextNew) {
+                ++nextNew;
+            }
+            CHECK(indices[i] < count && fetched[indices[i]] == vertices[original[i]]);
+        }
+        CHECK(nextNew == count);
+    }
+
+    void TestComputeACMR() {
+        const uint16_t strip[12] = { 0, 1, 2, 2, 1, 3, 2, 3, 4, 4, 3, 5 };
+        CHECK(dw::mesh::ComputeACMR(strip, 12, 6) == 1.5f);
+        const uint16_t separate[6] = { 0, 1, 2, 3, 4, 5 };
+        CHECK(dw::mesh::ComputeACMR(separate, 6, 6) == 3.0f);
+        // A cache of 3 has lost vertex 0 again by the time it comes back
+        const uint16_t evicted[12] = { 0, 1, 2, 3, 4, 5, 0, 1, 2, 0, 1, 2 };
+        CHECK(dw::mesh::ComputeACMR(evicted, 12, 6, 3) == 9.0f / 4.0f);
+        CHECK(dw::mesh::ComputeACMR(evicted, 0, 6) == 0.0f);
+    }
+}
+
+int main() {
+    TestGenerateIndexBuffer<uint16_t>();
+    TestGenerateIndexBuffer<uint32_t>();
+    TestOptimizeVertexCache<uint16_t>();
+    TestOptimizeVertexCache<uint32_t>();
+    TestOptimizeOverdraw();
+    TestOptimizeVertexFetch<uint16_t>();
+    TestOptimizeVertexFetch<uint32_t>();
+    TestComputeACMR();
+    return dw::test::GetResult();
+}
@@ -0,0 +1,190 @@
+#include "check.h"
+#include "commandstream.h"
+#include "renderqueue.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// Sorting, bind filtering and instance merging of RenderQueue, checked on the commands it writes
+namespace {
+    std::vector<dw::RenderCommandType> GetTypes(const dw::CommandStream& stream) {
+        std::vector<dw::RenderCommandType> types;
+        for (auto* command = stream.Begin(); command != stream.End(); command = dw::CommandStream::Next(command)) {
+            types.push_back(command->type);
+        }
+        return types;
+    }
+
+    dw::QueuedDraw MakeDraw(uint32_t pipeline, uint32_t vertexBuffer, uint32_t constantBuffer, uint32_t startVertex) {
+        dw::QueuedDraw draw;
+        draw.pipelineState = dw::GfxObject(pipeline);
+        draw.vertexBuffer = dw::GfxObject(vertexBuffer);
+        draw.constantBuffer = dw::GfxObject(constantBuffer);
+        draw.count = 3;
+        draw.startVertex = startVertex;
+        return draw;
+    }
+
+    // Keys spread over every byte with plenty of duplicates, each draw tagged with its submission order in
+    // startVertex. The draws have to come out by key and, for equal keys, in submission order
+    void TestSortIsStable() {
+        std::mt19937_64 random(7);
+        std::vector<std::pair<uint64_t, uint32_t>> expected;
+        dw::RenderQueue queue;
+        for (uint32_t i = 0; i < 5000; ++i) {
+            const uint64_t key = random() & 0xFF0000FF000000F3ull;
+            queue.Submit(key, MakeDraw(1, 1, 1, i));
+            expected.push_back({ key, i });
+        }
+        std::stable_sort(expected.begin(), expected.end(), [](const std::pair<uint64_t, uint32_t>& a, const std::pair<uint64_t, uint32_t>& b) {
+            return a.first < b.first;
+        });
+        queue.Sort();
+
+        dw::CommandStream stream;
+        queue.Write(stream);
+        std::vector<uint32_t> order;
+        for (auto* command = stream.Begin(); command != stream.End(); command = dw::CommandStream::Next(command)) {
+            if (command->type == dw::DRAW) {
+                order.push_back(dw::CommandStream::Payload<dw::DrawCommand>(command).startVertex);
+            }
+        }
+        CHECK(order.size() == expected.size());
+        for (size_t i = 0; i < order.size() && i < expected.size(); ++i) {
+            CHECK(order[i] == expected[i].second);
+        }
+    }
+
+    // Keys sharing every byte take the path that skips passes, the order has to stay the submission order
+    void TestSortKeepsEqualKeys() {
+        dw::RenderQueue queue;
+        for (uint32_t i = 0; i < 16; ++i) {
+            queue.Submit(dw::RenderQueue::MakeKey(1, 2, 3, 0.5f), MakeDraw(1, 1, 1, i));
+        }
+        queue.Sort();
+        dw::CommandStream stream;
+        queue.Write(stream);
+        uint32_t next = 0;
+        for (auto* command = stream.Begin(); command != stream.End(); command = dw::CommandStream::Next(command)) {
+            if (command->type == dw::DRAW) {
+                CHECK(dw::CommandStream::Payload<dw::DrawCommand>(command).startVertex == next++);
+            }
+        }
+        CHECK(next == 16);
+    }
+
+    void TestMakeKey() {
+        CHECK(dw::RenderQueue::MakeKey(0, 0, 0, 0.0f) == 0);
+        CHECK(dw::RenderQueue::MakeKey(0, 0, 0, 2.0f) == 0xFFFFFF);
+        CHECK(dw::RenderQueue::MakeKey(0, 0, 0, -1.0f) == 0);
+        CHECK(dw::RenderQueue::MakeKey(0xAB, 0x1234, 0x5678, 0.0f) == 0xAB12345678000000ull);
+        CHECK(dw::RenderQueue::MakeKey(1, 0, 0, 1.0f) > dw::RenderQueue::MakeKey(0, 0xFFFF, 0xFFFF, 1.0f));
+    }
+
+    // Only the state that changed between draws is bound, and a new vertex buffer binds the index buffer again
+    void TestWriteDropsRedundantBinds() {
+        dw::RenderQueue queue;
+        queue.Submit(0, MakeDraw(1, 10, 20, 0));
+        queue.Submit(1, MakeDraw(1, 10, 20, 3));
+        queue.Submit(2, MakeDraw(1, 10, 21, 6));
+        queue.Submit(3, MakeDraw(2, 10, 21, 9));
+        dw::QueuedDraw indexed = MakeDraw(2, 11, 21, 0);
+        indexed.indexBuffer = dw::GfxObject(30);
+        queue.Submit(4, indexed);
+        queue.Submit(5, indexed);
+        indexed.vertexBuffer = dw::GfxObject(10);
+        queue.Submit(6, indexed);
+        queue.Sort();
+
+        dw::CommandStream stream;
+        queue.Write(stream);
+        const std::vector<dw::RenderCommandType> expected = {
+            dw::BIND_PIPELINE_STATE, dw::BIND_CONSTANT_BUFFER, dw::BIND_VERTEX_BUFFER, dw::DRAW,
+            dw::DRAW,
+            dw::BIND_CONSTANT_BUFFER, dw::DRAW,
+            dw::BIND_PIPELINE_STATE, dw::DRAW,
+            dw::BIND_VERTEX_BUFFER, dw::BIND_INDEX_BUFFER, dw::DRAW_INDEXED,
+            dw::DRAW_INDEXED,
+            dw::BIND_VERTEX_BUFFER, dw::BIND_INDEX_BUFFER, dw::DRAW_INDEXED
+        };
+        CHECK(GetTypes(stream) == expected);
+    }
+
+    // Runs of draws that differ by instance data alone become one DRAW_INSTANCED, a different constant buffer
+    // or vertex range starts a new one and indexed draws are written one by one
+    void TestWriteInstancedMerges() {
+        dw::RenderQueue queue;
+        for (uint32_t i = 0; i < 3; ++i) {
+            dw::QueuedDraw draw = MakeDraw(1, 10, 20, 0);
+            draw.instance.offset[0] = static_cast<float>(i);
+            queue.Submit(i, draw);
+        }
+        dw::QueuedDraw other = MakeDraw(1, 10, 21, 0);
+        other.instance.offset[0] = 3.0f;
+        queue.Submit(3, other);
+        other.startVertex = 3;
+        other.instance.offset[0] = 4.0f;
+        queue.Submit(4, other);
+        dw::QueuedDraw indexed = MakeDraw(1, 10, 21, 0);
+        indexed.indexBuffer = dw::GfxObject(30);
+        queue.Submit(5, indexed);
+        queue.Submit(6, indexed);
+        queue.Sort();
+
+        dw::CommandStream stream;
+        std::vector<dw::InstanceData> instances;
+        const dw::GfxObject instanceBuffer(40);
+        queue.WriteInstanced(stream, instanceBuffer, instances);
+        const std::vector<dw::RenderCommandType> expected = {
+            dw::BIND_PIPELINE_STATE, dw::BIND_CONSTANT_BUFFER, dw::BIND_VERTEX_BUFFER, dw::DRAW_INSTANCED,
+            dw::BIND_CONSTANT_BUFFER, dw::DRAW_INSTANCED,
+            dw::DRAW_INSTANCED,
+            dw::BIND_INDEX_BUFFER, dw::DRAW_INDEXED,
+            dw::DRAW_INDEXED
+        };
+        CHECK(GetTypes(stream) == expected);
+
+        const uint32_t expectedRuns[3][3] = { { 0, 3, 0 }, { 0, 1, 3 }, { 3, 1, 4 } }; // startVertex, instanceCount, startInstance
+        uint32_t run = 0;
+        for (auto* command = stream.Begin(); command != stream.End(); command = dw::CommandStream::Next(command)) {
+            if (command->type != dw::DRAW_INSTANCED || run >= 3) {
+                continue;
+            }
+            const dw::DrawInstancedCommand& draw = dw::CommandStream::Payload<dw::DrawInstancedCommand>(command);
+            CHECK(draw.count == 3);
+            CHECK(draw.startVertex == expectedRuns[run][0]);
+            CHECK(draw.instanceCount == expectedRuns[run][1]);
+            CHECK(draw.startInstance == expectedRuns[run][2]);
+            CHECK(draw.instanceBuffer == instanceBuffer);
+            ++run;
+        }
+        CHECK(run == 3);
+        CHECK(instances.size() == 5);
+        for (size_t i = 0; i < instances.size(); ++i) {
+            CHECK(instances[i].offset[0] == static_cast<float>(i));
+        }
+    }
+
+    void TestClear() {
+        dw::RenderQueue queue;
+        queue.Submit(0, MakeDraw(1, 1, 1, 0));
+        CHECK(queue.GetDrawCount() == 1);
+        queue.Clear();
+        CHECK(queue.GetDrawCount() == 0);
+        queue.Sort();
+        dw::CommandStream stream;
+        queue.Write(stream);
+        CHECK(stream.IsEmpty());
+    }
+}
+
+int main() {
+    TestSortIsStable();
+    TestSortKeepsEqualKeys();
+    TestMakeKey();
+    TestWriteDropsRedundantBinds();
+    TestWriteInstancedMerges();
+    TestClear();
+    return dw::test::GetResult();
+}
@@ -0,0 +1,117 @@
+#include "check.h"
+#include "utils/logger.h"
+#include "utils/shaderloader.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+// Expands shaders written to a scratch directory in the working directory
+namespace {
+    const std::string s_DIRECTORY = "shaderloader_files";
+
+    void WriteFile(const std::string& name, const std::string& text) {
+        const std::filesystem::path path = std::filesystem::path(s_DIRECTORY) / name;
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream(path, std::ios::binary) << text;
+    }
+
+    std::string GetPath(const std::string& name) {
+        return (std::filesystem::path(s_DIRECTORY) / name).lexically_normal().generic_string();
+    }
+
+    // Includes are searched next to the includer before the include directories, and the #line directives
+    // name the files by their index in ShaderSource::files
+    void TestResolvesIncludes() {
+        WriteFile("main.vertex", "#version 450\n#include \"common.glsl\"\n  # include <lib/math.glsl>\nvoid main() {}\n");
+        WriteFile("common.glsl", "float common;\n");
+        WriteFile("lib/math.glsl", "#include \"constants.glsl\"\nfloat math;");
+        WriteFile("lib/constants.glsl", "float local;\n");
+        WriteFile("include/lib/math.glsl", "float shadowed;\n");
+        WriteFile("include/constants.glsl", "float fallback;\n");
+
+        dw::ShaderLoader loader;
+        loader.AddIncludeDirectory(GetPath("include"));
+        dw::ShaderSource source;
+        CHECK(loader.Load(GetPath("main.vertex"), source));
+        const std::string expected =
+            "#version 450\n"
+            "#line 1 1\n"
+            "float common;\n"
+            "#line 3 0\n"
+            "#line 1 2\n"
+            "#line 1 3\n"
+            "float local;\n"
+            "#line 2 2\n"
+            "float math;\n"
+            "#line 4 0\n"
+            "void main() {}\n";
+        CHECK(source.text == expected);
+        const std::vector<std::string> files = { GetPath("main.vertex"), GetPath("common.glsl"), GetPath("lib/math.glsl"), GetPath("lib/constants.glsl") };
+        CHECK(source.files == files);
+
+        // Only found in the include directory
+        WriteFile("fallback.vertex", "#include \"constants.glsl\"\n");
+        CHECK(loader.Load(GetPath("fallback.vertex"), source));
+        CHECK(source.text == "#line 1 1\nfloat fallback;\n#line 2 0\n");
+    }
+
+    // A file is pasted once per shader, which also ends cycles
+    void TestStopsCycles() {
+        WriteFile("cycle.vertex", "#include \"a.glsl\"\n#include \"b.glsl\"\nvoid main() {}\n");
+        WriteFile("a.glsl", "#include \"b.glsl\"\nfloat a;\n");
+        WriteFile("b.glsl", "#include \"a.glsl\"\nfloat b;\n");
+        WriteFile("self.glsl", "#include \"self.glsl\"\nfloat self;\n");
+
+        dw::ShaderLoader loader;
+        dw::ShaderSource source;
+        CHECK(loader.Load(GetPath("cycle.vertex"), source));
+        CHECK(source.files.size() == 3);
+        CHECK(source.text == "#line 1 1\n#line 1 2\n\nfloat b;\n#line 2 1\nfloat a;\n#line 2 0\n\nvoid main() {}\n");
+
+        CHECK(loader.Load(GetPath("self.glsl"), source));
+        CHECK(source.files.size() == 1);
+        CHECK(source.text == "\nfloat self;\n");
+    }
+
+    // Directives in comments stay, missing files fail the load
+    void TestCommentsAndMissingFiles() {
+        WriteFile("commented.vertex", "/* start\n#include \"missing.glsl\"\n*/\n// #include \"missing.glsl\"\nvoid main() {}\n");
+        WriteFile("broken.vertex", "#include \"missing.glsl\"\n");
+
+        dw::ShaderLoader loader;
+        dw::ShaderSource source;
+        CHECK(loader.Load(GetPath("commented.vertex"), source));
+        CHECK(source.text == "/* start\n#include \"missing.glsl\"\n*/\n// #include \"missing.glsl\"\nvoid main() {}\n");
+        CHECK(!loader.Load(GetPath("broken.vertex"), source));
+        CHECK(!loader.Load(GetPath("nothing.vertex"), source));
+    }
+
+    // Files are cached until they're invalidated
+    void TestInvalidate() {
+        WriteFile("cached.vertex", "#include \"cached.glsl\"\n");
+        WriteFile("cached.glsl", "float before;\n");
+        dw::ShaderLoader loader;
+        dw::ShaderSource source;
+        CHECK(loader.Load(GetPath("cached.vertex"), source));
+        WriteFile("cached.glsl", "float after;\n");
+        CHECK(loader.Load(GetPath("cached.vertex"), source));
+        CHECK(source.text.find("before") != std::string::npos);
+        loader.Invalidate(GetPath("cached.glsl"));
+        CHECK(loader.Load(GetPath("cached.vertex"), source));
+        CHECK(source.text.find("after") != std::string::npos);
+    }
+}
+
+int main() {
+    // The failures are logged as errors
+    dw::Logger::Init(dw::Logger::ERR, "");
+    std::filesystem::remove_all(s_DIRECTORY);
+    TestResolvesIncludes();
+    TestStopsCycles();
+    TestCommentsAndMissingFiles();
+    TestInvalidate();
+    std::filesystem::remove_all(s_DIRECTORY);
+    dw::Logger::Destroy();
+    return dw::test::GetResult();
+}